@@ -0,0 +1,20 @@
+prefix              := /usr
+PREFIX              := $(prefix)
+exec_prefix         := /usr
+libdir              := /usr/lib
+LIBDIR              := $(libdir)
+debug               := y
+BISON               := /usr/bin/bison
+FLEX                :=
+PYTHON              := python
+PYTHON_PATH         := /usr/bin/python
+PERL                := /usr/bin/perl
+BASH                := /bin/bash
+PTHREAD_CFLAGS      := -pthread
+PTHREAD_LDFLAGS     := -pthread
+PTHREAD_LIBS        :=
+PTYFUNCS_LIBS       := -lutil
+XENSTAT_XENTOP      := n
+OCAML_TOOLS         := n
+CONFIG_SYSTEM_LIBAIO:= n
+ZLIB                := -lz
@@ -26,10 +26,12 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 #include <errno.h>
+#include <fcntl.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
 #include <sys/time.h>
+#include <sys/epoll.h>
 
 #include "scheduler.h"
 #include "tapdisk-log.h"
@@ -37,6 +39,7 @@
 #define DBG(_f, _a...)               tlog_write(TLOG_DBG, _f, ##_a)
 
 #define SCHEDULER_MAX_TIMEOUT        600
+#define SCHEDULER_MAX_EVENTS         64
 #define SCHEDULER_POLL_FD           (SCHEDULER_POLL_READ_FD |	\
 				     SCHEDULER_POLL_WRITE_FD |	\
 				     SCHEDULER_POLL_EXCEPT_FD)
@@ -47,8 +50,20 @@
 #define scheduler_for_each_event(s, event, tmp)	\
 	list_for_each_entry_safe(event, tmp, &(s)->events, next)
 
+/*
+ * Descriptors are kept registered with epoll for as long as some event
+ * wants them, so waiting costs nothing per idle event.  Several events
+ * may share a descriptor; the epoll registration covers all of them.
+ */
+struct scheduler_fd {
+	int                          fd;
+	char                         mode;
+	struct list_head             events;
+};
+
 typedef struct event {
 	char                         mode;
+	char                         pending;
 	event_id_t                   id;
 
 	int                          fd;
@@ -59,47 +74,125 @@ typedef struct event {
 	void                        *private;
 
 	struct list_head             next;
+	struct list_head             fd_next;
+	struct list_head             timer;
+	struct list_head             ready;
 } event_t;
 
+static int
+scheduler_epoll_ctl(scheduler_t *s, struct scheduler_fd *sfd, char mode)
+{
+	struct epoll_event ev;
+	int op, err;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.data.ptr = sfd;
+
+	if (mode & SCHEDULER_POLL_READ_FD)
+		ev.events |= EPOLLIN;
+	if (mode & SCHEDULER_POLL_WRITE_FD)
+		ev.events |= EPOLLOUT;
+	if (mode & SCHEDULER_POLL_EXCEPT_FD)
+		ev.events |= EPOLLPRI;
+
+	if (!mode)
+		op = EPOLL_CTL_DEL;
+	else if (!sfd->mode)
+		op = EPOLL_CTL_ADD;
+	else
+		op = EPOLL_CTL_MOD;
+
+	err = epoll_ctl(s->epoll_fd, op, sfd->fd, &ev);
+
+	/*
+	 * Closing a descriptor drops it from the epoll set behind our
+	 * back, and the number may since have been reused.
+	 */
+	if (err && errno == ENOENT && op == EPOLL_CTL_MOD)
+		err = epoll_ctl(s->epoll_fd, EPOLL_CTL_ADD, sfd->fd, &ev);
+	else if (err && errno == EEXIST && op == EPOLL_CTL_ADD)
+		err = epoll_ctl(s->epoll_fd, EPOLL_CTL_MOD, sfd->fd, &ev);
+	else if (err && op == EPOLL_CTL_DEL)
+		err = 0;
+
+	return err ? -errno : 0;
+}
+
+/* Recompute what we wait for on a descriptor after its events change. */
+static int
+scheduler_update_fd(scheduler_t *s, struct scheduler_fd *sfd)
+{
+	event_t *event;
+	char mode = 0;
+	int err;
+
+	list_for_each_entry(event, &sfd->events, fd_next)
+		mode |= event->mode & SCHEDULER_POLL_FD;
+
+	if (mode != sfd->mode) {
+		err = scheduler_epoll_ctl(s, sfd, mode);
+		if (err)
+			return err;
+		sfd->mode = mode;
+	}
+
+	if (!mode) {
+		s->fds[sfd->fd] = NULL;
+		free(sfd);
+	}
+
+	return 0;
+}
+
+static struct scheduler_fd *
+scheduler_get_fd(scheduler_t *s, int fd)
+{
+	struct scheduler_fd *sfd, **fds;
+	int nr;
+
+	if (fd < 0)
+		return NULL;
+
+	if (fd >= s->nr_fds) {
+		nr = MAX(s->nr_fds * 2, fd + 1);
+		fds = realloc(s->fds, nr * sizeof(*fds));
+		if (!fds)
+			return NULL;
+		memset(fds + s->nr_fds, 0, (nr - s->nr_fds) * sizeof(*fds));
+		s->fds    = fds;
+		s->nr_fds = nr;
+	}
+
+	sfd = s->fds[fd];
+	if (!sfd) {
+		sfd = calloc(1, sizeof(*sfd));
+		if (!sfd)
+			return NULL;
+		sfd->fd = fd;
+		INIT_LIST_HEAD(&sfd->events);
+		s->fds[fd] = sfd;
+	}
+
+	return sfd;
+}
+
 static void
 scheduler_prepare_events(scheduler_t *s)
 {
 	int diff;
 	struct timeval now;
-	event_t *event, *tmp;
-
-	FD_ZERO(&s->read_fds);
-	FD_ZERO(&s->write_fds);
-	FD_ZERO(&s->except_fds);
+	event_t *event;
 
-	s->max_fd  = 0;
 	s->timeout = SCHEDULER_MAX_TIMEOUT;
 
 	gettimeofday(&now, NULL);
 
-	scheduler_for_each_event(s, event, tmp) {
-		if (event->mode & SCHEDULER_POLL_READ_FD) {
-			FD_SET(event->fd, &s->read_fds);
-			s->max_fd = MAX(event->fd, s->max_fd);
-		}
-
-		if (event->mode & SCHEDULER_POLL_WRITE_FD) {
-			FD_SET(event->fd, &s->write_fds);
-			s->max_fd = MAX(event->fd, s->max_fd);
-		}
-
-		if (event->mode & SCHEDULER_POLL_EXCEPT_FD) {
-			FD_SET(event->fd, &s->except_fds);
-			s->max_fd = MAX(event->fd, s->max_fd);
-		}
-
-		if (event->mode & SCHEDULER_POLL_TIMEOUT) {
-			diff = event->deadline - now.tv_sec;
-			if (diff > 0)
-				s->timeout = MIN(s->timeout, diff);
-			else
-				s->timeout = 0;
-		}
+	list_for_each_entry(event, &s->timers, timer) {
+		diff = event->deadline - now.tv_sec;
+		if (diff > 0)
+			s->timeout = MIN(s->timeout, diff);
+		else
+			s->timeout = 0;
 	}
 
 	s->timeout = MIN(s->timeout, s->max_timeout);
@@ -118,45 +211,63 @@ scheduler_event_callback(event_t *event, char mode)
 }
 
 static void
-scheduler_run_events(scheduler_t *s)
+scheduler_queue_fd_events(scheduler_t *s, struct scheduler_fd *sfd,
+			  uint32_t revents)
 {
-	struct timeval now;
-	event_t *event, *tmp;
-
-	gettimeofday(&now, NULL);
+	event_t *event;
+	char mode = 0;
+
+	if (revents & (EPOLLIN | EPOLLHUP | EPOLLERR))
+		mode |= SCHEDULER_POLL_READ_FD;
+	if (revents & (EPOLLOUT | EPOLLERR))
+		mode |= SCHEDULER_POLL_WRITE_FD;
+	if (revents & EPOLLPRI)
+		mode |= SCHEDULER_POLL_EXCEPT_FD;
+
+	list_for_each_entry(event, &sfd->events, fd_next) {
+		if (event->pending)
+			continue;
+
+		if (event->mode & mode & SCHEDULER_POLL_READ_FD)
+			event->pending = SCHEDULER_POLL_READ_FD;
+		else if (event->mode & mode & SCHEDULER_POLL_WRITE_FD)
+			event->pending = SCHEDULER_POLL_WRITE_FD;
+		else if (event->mode & mode & SCHEDULER_POLL_EXCEPT_FD)
+			event->pending = SCHEDULER_POLL_EXCEPT_FD;
+		else
+			continue;
+
+		list_add_tail(&event->ready, &s->ready);
+	}
+}
 
- again:
-	s->restart = 0;
+static void
+scheduler_run_events(scheduler_t *s, struct epoll_event *evs, int nr)
+{
+	struct timeval now;
+	event_t *event;
+	char mode;
+	int i;
 
-	scheduler_for_each_event(s, event, tmp) {
-		if ((event->mode & SCHEDULER_POLL_READ_FD) &&
-		    FD_ISSET(event->fd, &s->read_fds)) {
-			FD_CLR(event->fd, &s->read_fds);
-			scheduler_event_callback(event, SCHEDULER_POLL_READ_FD);
-			goto next;
-		}
+	for (i = 0; i < nr; i++)
+		scheduler_queue_fd_events(s, evs[i].data.ptr, evs[i].events);
 
-		if ((event->mode & SCHEDULER_POLL_WRITE_FD) &&
-		    FD_ISSET(event->fd, &s->write_fds)) {
-			FD_CLR(event->fd, &s->write_fds);
-			scheduler_event_callback(event, SCHEDULER_POLL_WRITE_FD);
-			goto next;
-		}
+	gettimeofday(&now, NULL);
 
-		if ((event->mode & SCHEDULER_POLL_EXCEPT_FD) &&
-		    FD_ISSET(event->fd, &s->except_fds)) {
-			FD_CLR(event->fd, &s->except_fds);
-			scheduler_event_callback(event, SCHEDULER_POLL_EXCEPT_FD);
-			goto next;
+	list_for_each_entry(event, &s->timers, timer)
+		if (!event->pending && event->deadline <= now.tv_sec) {
+			event->pending = SCHEDULER_POLL_TIMEOUT;
+			list_add_tail(&event->ready, &s->ready);
 		}
 
-		if ((event->mode & SCHEDULER_POLL_TIMEOUT) &&
-		    (event->deadline <= now.tv_sec))
-		    scheduler_event_callback(event, SCHEDULER_POLL_TIMEOUT);
+	/* Callbacks may unregister any event, including queued ones. */
+	while (!list_empty(&s->ready)) {
+		event = list_entry(s->ready.next, event_t, ready);
+		list_del_init(&event->ready);
 
-	next:
-		if (s->restart)
-			goto again;
+		mode = event->pending;
+		event->pending = 0;
+		scheduler_event_callback(event, mode);
 	}
 }
 
@@ -164,8 +275,10 @@ int
 scheduler_register_event(scheduler_t *s, char mode, int fd,
 			 int timeout, event_cb_t cb, void *private)
 {
+	struct scheduler_fd *sfd = NULL;
 	event_t *event;
 	struct timeval now;
+	int err;
 
 	if (!cb)
 		return -EINVAL;
@@ -173,13 +286,25 @@ scheduler_register_event(scheduler_t *s, char mode, int fd,
 	if (!(mode & SCHEDULER_POLL_TIMEOUT) && !(mode & SCHEDULER_POLL_FD))
 		return -EINVAL;
 
+	if (mode & SCHEDULER_POLL_FD) {
+		sfd = scheduler_get_fd(s, fd);
+		if (!sfd)
+			return fd < 0 ? -EBADF : -ENOMEM;
+	}
+
 	event = calloc(1, sizeof(event_t));
-	if (!event)
+	if (!event) {
+		if (sfd)
+			scheduler_update_fd(s, sfd);
 		return -ENOMEM;
+	}
 
 	gettimeofday(&now, NULL);
 
 	INIT_LIST_HEAD(&event->next);
+	INIT_LIST_HEAD(&event->fd_next);
+	INIT_LIST_HEAD(&event->timer);
+	INIT_LIST_HEAD(&event->ready);
 
 	event->mode     = mode;
 	event->fd       = fd;
@@ -187,7 +312,22 @@ scheduler_register_event(scheduler_t *s, char mode, int fd,
 	event->deadline = now.tv_sec + timeout;
 	event->cb       = cb;
 	event->private  = private;
-	event->id       = s->uuid++;
+
+	if (sfd) {
+		list_add_tail(&event->fd_next, &sfd->events);
+		err = scheduler_update_fd(s, sfd);
+		if (err) {
+			list_del(&event->fd_next);
+			scheduler_update_fd(s, sfd);
+			free(event);
+			return err;
+		}
+	}
+
+	if (mode & SCHEDULER_POLL_TIMEOUT)
+		list_add_tail(&event->timer, &s->timers);
+
+	event->id = s->uuid++;
 
 	if (!s->uuid)
 		s->uuid++;
@@ -208,8 +348,13 @@ scheduler_unregister_event(scheduler_t *s, event_id_t id)
 	scheduler_for_each_event(s, event, tmp)
 		if (event->id == id) {
 			list_del(&event->next);
+			list_del(&event->timer);
+			list_del(&event->ready);
+			if (event->mode & SCHEDULER_POLL_FD) {
+				list_del(&event->fd_next);
+				scheduler_update_fd(s, s->fds[event->fd]);
+			}
 			free(event);
-			s->restart = 1;
 			break;
 		}
 }
@@ -224,42 +369,44 @@ scheduler_set_max_timeout(scheduler_t *s, int timeout)
 int
 scheduler_wait_for_events(scheduler_t *s)
 {
+	struct epoll_event evs[SCHEDULER_MAX_EVENTS];
 	int ret;
-	struct timeval tv;
 
 	scheduler_prepare_events(s);
 
-	tv.tv_sec  = s->timeout;
-	tv.tv_usec = 0;
-
 	DBG("timeout: %d, max_timeout: %d\n",
 	    s->timeout, s->max_timeout);
 
-	ret = select(s->max_fd + 1, &s->read_fds,
-		     &s->write_fds, &s->except_fds, &tv);
+	ret = epoll_wait(s->epoll_fd, evs, SCHEDULER_MAX_EVENTS,
+			 s->timeout * 1000);
 
-	s->restart     = 0;
 	s->timeout     = SCHEDULER_MAX_TIMEOUT;
 	s->max_timeout = SCHEDULER_MAX_TIMEOUT;
 
 	if (ret < 0)
-		return ret;
+		return -errno;
 
-	scheduler_run_events(s);
+	scheduler_run_events(s, evs, ret);
 
 	return ret;
 }
 
-void
+int
 scheduler_initialize(scheduler_t *s)
 {
 	memset(s, 0, sizeof(scheduler_t));
 
 	s->uuid = 1;
 
-	FD_ZERO(&s->read_fds);
-	FD_ZERO(&s->write_fds);
-	FD_ZERO(&s->except_fds);
-
 	INIT_LIST_HEAD(&s->events);
+	INIT_LIST_HEAD(&s->timers);
+	INIT_LIST_HEAD(&s->ready);
+
+	s->epoll_fd = epoll_create(SCHEDULER_MAX_EVENTS);
+	if (s->epoll_fd < 0)
+		return -errno;
+
+	fcntl(s->epoll_fd, F_SETFD, FD_CLOEXEC);
+
+	return 0;
 }
@@ -28,8 +28,6 @@
 #ifndef _SCHEDULER_H_
 #define _SCHEDULER_H_
 
-#include <sys/select.h>
-
 #include "list.h"
 
 #define SCHEDULER_POLL_READ_FD       0x1
@@ -40,21 +38,23 @@
 typedef int                          event_id_t;
 typedef void (*event_cb_t)          (event_id_t id, char mode, void *private);
 
+struct scheduler_fd;
+
 typedef struct scheduler {
-	fd_set                       read_fds;
-	fd_set                       write_fds;
-	fd_set                       except_fds;
+	int                          epoll_fd;
+	struct scheduler_fd        **fds;
+	int                          nr_fds;
 
 	struct list_head             events;
+	struct list_head             timers;
+	struct list_head             ready;
 
 	int                          uuid;
-	int                          max_fd;
 	int                          timeout;
-	int                          restart;
 	int                          max_timeout;
 } scheduler_t;
 
-void scheduler_initialize(scheduler_t *);
+int scheduler_initialize(scheduler_t *);
 event_id_t scheduler_register_event(scheduler_t *, char mode,
 				    int fd, int timeout,
 				    event_cb_t cb, void *private);
@@ -283,9 +283,7 @@ tapdisk_server_init(void)
 	memset(&server, 0, sizeof(server));
 	INIT_LIST_HEAD(&server.vbds);
 
-	scheduler_initialize(&server.scheduler);
-
-	return 0;
+	return scheduler_initialize(&server.scheduler);
 }
 
 int
@@ -311,7 +309,9 @@ tapdisk_server_initialize(void)
 {
 	int err;
 
-	tapdisk_server_init();
+	err = tapdisk_server_init();
+	if (err)
+		return err;
 
 	err = tapdisk_server_complete();
 	if (err)
@@ -29,6 +29,9 @@
 #include <errno.h>
 #include <string.h>
 #include <sys/select.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
 #include <fcntl.h>
 #include <unistd.h>
 #include <termios.h>
@@ -70,6 +73,17 @@ static evtchn_port_or_error_t log_hv_evtchn = -1;
 static xc_interface *xch; /* why does xenconsoled have two xc handles ? */
 static xc_evtchn *xce_handle = NULL;
 
+#define IO_IN	1
+#define IO_OUT	2
+
+/* A file descriptor the main loop waits on, and what it waits for. */
+struct io_fd {
+	int fd;
+	unsigned int events;
+	void (*handler)(struct io_fd *io, unsigned int events);
+	struct domain *dom;
+};
+
 struct buffer {
 	char *data;
 	size_t consumed;
@@ -95,9 +109,183 @@ struct domain {
 	struct xencons_interface *interface;
 	int event_count;
 	long long next_period;
+	struct io_fd tty_io;
+	struct io_fd ring_io;
+	bool dirty;
+	struct domain *dirty_next;
+	struct domain *limited_next;
 };
 
 static struct domain *dom_head;
+/* Domains whose ring or buffer state changed since the last wait. */
+static struct domain *dirty_head;
+/* Domains which used up their event allowance for this period. */
+static struct domain *limited_head;
+
+static struct io_fd xs_io = { .fd = -1 };
+static struct io_fd hv_io = { .fd = -1 };
+
+/*
+ * Waiting for file descriptors.  The set of descriptors is only touched
+ * when what we wait for changes, and that is only worked out again for
+ * the domains on the dirty list, so with epoll the cost of a pass depends
+ * on how many domains had events rather than on how many there are.
+ * Linux uses epoll, which has no FD_SETSIZE limit; elsewhere select() is
+ * used, which still scans every descriptor.
+ */
+#ifdef __linux__
+static int epoll_fd = -1;
+
+static int io_init(void)
+{
+	epoll_fd = epoll_create(64);
+	if (epoll_fd == -1)
+		return -1;
+	fcntl(epoll_fd, F_SETFD, FD_CLOEXEC);
+	return 0;
+}
+
+static int io_ctl(struct io_fd *io, unsigned int events)
+{
+	struct epoll_event ev = { .data.ptr = io };
+	int op;
+
+	if (!events)
+		return epoll_ctl(epoll_fd, EPOLL_CTL_DEL, io->fd, NULL);
+
+	op = io->events ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+	ev.events = ((events & IO_IN) ? EPOLLIN : 0) |
+		    ((events & IO_OUT) ? EPOLLOUT : 0);
+	return epoll_ctl(epoll_fd, op, io->fd, &ev);
+}
+
+static int io_wait(int timeout)
+{
+	struct epoll_event evs[64];
+	struct io_fd *io;
+	unsigned int events;
+	int i, nr;
+
+	nr = epoll_wait(epoll_fd, evs, sizeof(evs) / sizeof(evs[0]), timeout);
+
+	/* Events for a descriptor dropped earlier in the batch are stale. */
+	for (i = 0; i < nr; i++) {
+		io = evs[i].data.ptr;
+		if (io->fd == -1)
+			continue;
+		events = 0;
+		if (evs[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+			events |= IO_IN;
+		if (evs[i].events & EPOLLOUT)
+			events |= IO_OUT;
+		io->handler(io, events & io->events);
+	}
+
+	return nr;
+}
+#else
+static fd_set io_readfds, io_writefds;
+static struct io_fd *io_fds[FD_SETSIZE];
+static int io_max_fd = -1;
+
+static int io_init(void)
+{
+	FD_ZERO(&io_readfds);
+	FD_ZERO(&io_writefds);
+	return 0;
+}
+
+static int io_ctl(struct io_fd *io, unsigned int events)
+{
+	if (io->fd >= FD_SETSIZE) {
+		errno = EMFILE;
+		return -1;
+	}
+
+	if (events & IO_IN)
+		FD_SET(io->fd, &io_readfds);
+	else
+		FD_CLR(io->fd, &io_readfds);
+	if (events & IO_OUT)
+		FD_SET(io->fd, &io_writefds);
+	else
+		FD_CLR(io->fd, &io_writefds);
+
+	io_fds[io->fd] = events ? io : NULL;
+	if (events && io->fd > io_max_fd)
+		io_max_fd = io->fd;
+	return 0;
+}
+
+static int io_wait(int timeout)
+{
+	fd_set readfds = io_readfds, writefds = io_writefds;
+	struct timeval tv;
+	struct io_fd *io;
+	unsigned int events;
+	int fd, ret;
+
+	tv.tv_sec = timeout / 1000;
+	tv.tv_usec = (timeout % 1000) * 1000;
+	ret = select(io_max_fd + 1, &readfds, &writefds, 0,
+		     timeout >= 0 ? &tv : NULL);
+
+	for (fd = 0; ret > 0 && fd <= io_max_fd; fd++) {
+		io = io_fds[fd];
+		if (io == NULL || io->fd != fd)
+			continue;
+		events = 0;
+		if (FD_ISSET(fd, &readfds))
+			events |= IO_IN;
+		if (FD_ISSET(fd, &writefds))
+			events |= IO_OUT;
+		if (events)
+			io->handler(io, events & io->events);
+	}
+
+	return ret;
+}
+#endif
+
+static long long monotonic_ms(void)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) < 0)
+		return -1;
+	return ((long long)ts.tv_sec * 1000) + (ts.tv_nsec / 1000000);
+}
+
+/* Have handle_io() work out again what to wait for on a domain. */
+static void domain_mark_dirty(struct domain *dom)
+{
+	if (dom->dirty)
+		return;
+	dom->dirty = true;
+	dom->dirty_next = dirty_head;
+	dirty_head = dom;
+}
+
+/* Start, change or stop waiting on fd; -1 means it has gone away. */
+static void io_update(struct io_fd *io, int fd, unsigned int events)
+{
+	if (fd != io->fd) {
+		if (io->fd != -1 && io->events)
+			io_ctl(io, 0);
+		io->fd = fd;
+		io->events = 0;
+	}
+
+	if (fd == -1 || events == io->events)
+		return;
+
+	if (io_ctl(io, events) == -1) {
+		dolog(LOG_ERR, "Failed to wait on fd %d: %d (%s)",
+		      fd, errno, strerror(errno));
+		return;
+	}
+	io->events = events;
+}
 
 static int write_all(int fd, const char* buf, size_t len)
 {
@@ -324,6 +512,7 @@ static int create_domain_log(struct domain *dom)
 static void domain_close_tty(struct domain *dom)
 {
 	if (dom->master_fd != -1) {
+		io_update(&dom->tty_io, -1, 0);
 		close(dom->master_fd);
 		dom->master_fd = -1;
 	}
@@ -468,6 +657,15 @@ out:
 }
  
 /* Takes tuples of names, scanf-style args, and void **, NULL terminated. */
+static void domain_close_evtchn(struct domain *dom)
+{
+	if (dom->xce_handle != NULL) {
+		io_update(&dom->ring_io, -1, 0);
+		xc_evtchn_close(dom->xce_handle);
+		dom->xce_handle = NULL;
+	}
+}
+
 static int xs_gather(struct xs_handle *xs, const char *dir, ...)
 {
 	va_list ap;
@@ -548,8 +746,7 @@ static int domain_create_ring(struct domain *dom)
 
 	dom->local_port = -1;
 	dom->remote_port = -1;
-	if (dom->xce_handle != NULL)
-		xc_evtchn_close(dom->xce_handle);
+	domain_close_evtchn(dom);
 
 	/* Opening evtchn independently for each console is a bit
 	 * wasteful, but that's how the code is structured... */
@@ -564,8 +761,7 @@ static int domain_create_ring(struct domain *dom)
 
 	if (rc == -1) {
 		err = errno;
-		xc_evtchn_close(dom->xce_handle);
-		dom->xce_handle = NULL;
+		domain_close_evtchn(dom);
 		goto out;
 	}
 	dom->local_port = rc;
@@ -574,8 +770,7 @@ static int domain_create_ring(struct domain *dom)
 	if (dom->master_fd == -1) {
 		if (!domain_create_tty(dom)) {
 			err = errno;
-			xc_evtchn_close(dom->xce_handle);
-			dom->xce_handle = NULL;
+			domain_close_evtchn(dom);
 			dom->local_port = -1;
 			dom->remote_port = -1;
 			goto out;
@@ -589,6 +784,9 @@ static int domain_create_ring(struct domain *dom)
 	return err;
 }
 
+static void handle_tty_io(struct io_fd *io, unsigned int events);
+static void handle_ring_io(struct io_fd *io, unsigned int events);
+
 static bool watch_domain(struct domain *dom, bool watch)
 {
 	char domid_str[3 + MAX_STRLEN(dom->domid)];
@@ -658,11 +856,22 @@ static struct domain *create_domain(int domid)
 	dom->interface = NULL;
 	dom->xce_handle = NULL;
 
+	dom->tty_io.fd = -1;
+	dom->tty_io.events = 0;
+	dom->tty_io.handler = handle_tty_io;
+	dom->tty_io.dom = dom;
+	dom->ring_io.fd = -1;
+	dom->ring_io.events = 0;
+	dom->ring_io.handler = handle_ring_io;
+	dom->ring_io.dom = dom;
+	dom->dirty = false;
+
 	if (!watch_domain(dom, true))
 		goto out;
 
 	dom->next = dom_head;
 	dom_head = dom;
+	domain_mark_dirty(dom);
 
 	dolog(LOG_DEBUG, "New domain %d", domid);
 
@@ -689,6 +898,24 @@ static void remove_domain(struct domain *dom)
 
 	dolog(LOG_DEBUG, "Removing domain-%d", dom->domid);
 
+	if (dom->dirty) {
+		for (pp = &dirty_head; *pp; pp = &(*pp)->dirty_next) {
+			if (dom == *pp) {
+				*pp = dom->dirty_next;
+				break;
+			}
+		}
+	}
+
+	if (dom->event_count >= RATE_LIMIT_ALLOWANCE) {
+		for (pp = &limited_head; *pp; pp = &(*pp)->limited_next) {
+			if (dom == *pp) {
+				*pp = dom->limited_next;
+				break;
+			}
+		}
+	}
+
 	for (pp = &dom_head; *pp; pp = &(*pp)->next) {
 		if (dom == *pp) {
 			*pp = dom->next;
@@ -723,9 +950,8 @@ static void shutdown_domain(struct domain *d)
 	if (d->interface != NULL)
 		munmap(d->interface, getpagesize());
 	d->interface = NULL;
-	if (d->xce_handle != NULL)
-		xc_evtchn_close(d->xce_handle);
-	d->xce_handle = NULL;
+	domain_close_evtchn(d);
+	domain_mark_dirty(d);
 }
 
 static unsigned enum_pass = 0;
@@ -751,6 +977,10 @@ void enum_domains(void)
 			dom->last_seen = enum_pass;
 		domid = dominfo.domid + 1;
 	}
+
+	for (dom = dom_head; dom; dom = dom->next)
+		if (dom->last_seen != enum_pass && !dom->is_dead)
+			shutdown_domain(dom);
 }
 
 static int ring_free_bytes(struct domain *dom)
@@ -844,6 +1074,7 @@ static void handle_tty_write(struct domain *dom)
 static void handle_ring_read(struct domain *dom)
 {
 	evtchn_port_or_error_t port;
+	long long now;
 
 	if (dom->is_dead)
 		return;
@@ -851,12 +1082,47 @@ static void handle_ring_read(struct domain *dom)
 	if ((port = xc_evtchn_pending(dom->xce_handle)) == -1)
 		return;
 
+	/* Start a new period if the last one is over, with the same 5ms
+	   of fuzz as handle_io() allows. */
+	now = monotonic_ms();
+	if ((now+5) > dom->next_period) {
+		dom->next_period = now + RATE_LIMIT_PERIOD;
+		dom->event_count = 0;
+	}
+
 	dom->event_count++;
 
 	buffer_append(dom);
 
 	if (dom->event_count < RATE_LIMIT_ALLOWANCE)
 		(void)xc_evtchn_unmask(dom->xce_handle, port);
+	else {
+		dom->limited_next = limited_head;
+		limited_head = dom;
+	}
+
+	/* The guest may have made room in the ring, too. */
+	domain_mark_dirty(dom);
+}
+
+static void handle_tty_io(struct io_fd *io, unsigned int events)
+{
+	struct domain *dom = io->dom;
+
+	if (events & IO_IN)
+		handle_tty_read(dom);
+
+	/* The read may have replaced the tty. */
+	if ((events & IO_OUT) && io->fd != -1)
+		handle_tty_write(dom);
+
+	domain_mark_dirty(dom);
+}
+
+static void handle_ring_io(struct io_fd *io, unsigned int events)
+{
+	if (io->dom->event_count < RATE_LIMIT_ALLOWANCE)
+		handle_ring_read(io->dom);
 }
 
 static void handle_xs(void)
@@ -876,8 +1142,10 @@ static void handle_xs(void)
 		dom = lookup_domain(domid);
 		/* We may get watches firing for domains that have recently
 		   been removed, so dom may be NULL here. */
-		if (dom && dom->is_dead == false)
+		if (dom && dom->is_dead == false) {
 			domain_create_ring(dom);
+			domain_mark_dirty(dom);
+		}
 	}
 
 	free(vec);
@@ -910,6 +1178,16 @@ static void handle_hv_logs(void)
 	(void)xc_evtchn_unmask(xce_handle, port);
 }
 
+static void handle_xs_io(struct io_fd *io, unsigned int events)
+{
+	handle_xs();
+}
+
+static void handle_hv_io(struct io_fd *io, unsigned int events)
+{
+	handle_hv_logs();
+}
+
 static void handle_log_reload(void)
 {
 	if (log_guest) {
@@ -928,11 +1206,40 @@ static void handle_log_reload(void)
 	}
 }
 
+/* Work out what to wait for on a domain's ring and tty. */
+static void domain_update_io(struct domain *d)
+{
+	unsigned int events = 0;
+
+	if (d->event_count < RATE_LIMIT_ALLOWANCE && d->xce_handle != NULL) {
+		if (discard_overflowed_data ||
+		    !d->buffer.max_capacity ||
+		    d->buffer.size < d->buffer.max_capacity)
+			events = IO_IN;
+	}
+	io_update(&d->ring_io, d->xce_handle ?
+		  xc_evtchn_fd(d->xce_handle) : -1, events);
+
+	events = 0;
+	if (d->master_fd != -1) {
+		if (!d->is_dead && ring_free_bytes(d))
+			events |= IO_IN;
+		if (!buffer_empty(&d->buffer))
+			events |= IO_OUT;
+	}
+	io_update(&d->tty_io, d->master_fd, events);
+}
+
 void handle_io(void)
 {
-	fd_set readfds, writefds;
 	int ret;
 
+	if (io_init() == -1) {
+		dolog(LOG_ERR, "Failed to set up polling: %d (%s)",
+		      errno, strerror(errno));
+		return;
+	}
+
 	if (log_hv) {
 		xch = xc_interface_open(0,0,0);
 		if (!xch) {
@@ -955,133 +1262,83 @@ void handle_io(void)
 			      "%d (%s)", errno, strerror(errno));
 			goto out;
 		}
+		hv_io.handler = handle_hv_io;
+		io_update(&hv_io, xc_evtchn_fd(xce_handle), IO_IN);
 	}
 
+	xs_io.handler = handle_xs_io;
+	io_update(&xs_io, xs_fileno(xs), IO_IN);
+
 	for (;;) {
-		struct domain *d, *n;
-		int max_fd = -1;
-		struct timeval timeout;
-		struct timespec ts;
+		struct domain *d, **pp;
 		long long now, next_timeout = 0;
+		int timeout = -1;
 
-		FD_ZERO(&readfds);
-		FD_ZERO(&writefds);
-
-		FD_SET(xs_fileno(xs), &readfds);
-		max_fd = MAX(xs_fileno(xs), max_fd);
-
-		if (log_hv) {
-			FD_SET(xc_evtchn_fd(xce_handle), &readfds);
-			max_fd = MAX(xc_evtchn_fd(xce_handle), max_fd);
-		}
-
-		if (clock_gettime(CLOCK_MONOTONIC, &ts) < 0)
+		now = monotonic_ms();
+		if (now < 0)
 			return;
-		now = ((long long)ts.tv_sec * 1000) + (ts.tv_nsec / 1000000);
 
-		/* Re-calculate any event counter allowances & unblock
-		   domains with new allowance */
-		for (d = dom_head; d; d = d->next) {
-			/* Add 5ms of fuzz since select() often returns
-			   a couple of ms sooner than requested. Without
-			   the fuzz we typically do an extra spin in select()
-			   with a 1/2 ms timeout every other iteration */
+		/* Unblock rate limited domains whose period is over.  Add
+		   5ms of fuzz since the wait often returns a couple of ms
+		   sooner than requested. Without the fuzz we typically do
+		   an extra spin with a 1/2 ms timeout every other
+		   iteration */
+		for (pp = &limited_head; (d = *pp) != NULL; ) {
 			if ((now+5) > d->next_period) {
+				*pp = d->limited_next;
 				d->next_period = now + RATE_LIMIT_PERIOD;
-				if (d->event_count >= RATE_LIMIT_ALLOWANCE) {
-					(void)xc_evtchn_unmask(d->xce_handle, d->local_port);
-				}
 				d->event_count = 0;
+				if (d->xce_handle != NULL)
+					(void)xc_evtchn_unmask(d->xce_handle,
+							       d->local_port);
+				domain_mark_dirty(d);
+				continue;
 			}
-		}
 
-		for (d = dom_head; d; d = d->next) {
-			if (d->event_count >= RATE_LIMIT_ALLOWANCE) {
-				/* Determine if we're going to be the next time slice to expire */
-				if (!next_timeout ||
-				    d->next_period < next_timeout)
-					next_timeout = d->next_period;
-			} else if (d->xce_handle != NULL) {
-				if (discard_overflowed_data ||
-				    !d->buffer.max_capacity ||
-				    d->buffer.size < d->buffer.max_capacity) {
-					int evtchn_fd = xc_evtchn_fd(d->xce_handle);
-					FD_SET(evtchn_fd, &readfds);
-					max_fd = MAX(evtchn_fd, max_fd);
-				}
-			}
+			/* Determine if we're going to be the next time slice to expire */
+			if (!next_timeout ||
+			    d->next_period < next_timeout)
+				next_timeout = d->next_period;
+			pp = &d->limited_next;
+		}
 
-			if (d->master_fd != -1) {
-				if (!d->is_dead && ring_free_bytes(d))
-					FD_SET(d->master_fd, &readfds);
+		/* Only domains whose state changed need looking at.  Dead
+		   ones are freed here, once no event for them is pending. */
+		while ((d = dirty_head) != NULL) {
+			dirty_head = d->dirty_next;
+			d->dirty = false;
 
-				if (!buffer_empty(&d->buffer))
-					FD_SET(d->master_fd, &writefds);
-				max_fd = MAX(d->master_fd, max_fd);
-			}
+			if (d->is_dead)
+				cleanup_domain(d);
+			else
+				domain_update_io(d);
 		}
 
 		/* If any domain has been rate limited, we need to work
-		   out what timeout to supply to select */
+		   out what timeout to wait for */
 		if (next_timeout) {
 			long long duration = (next_timeout - now);
 			if (duration <= 0) /* sanity check */
 				duration = 1;
-			timeout.tv_sec = duration / 1000;
-			timeout.tv_usec = ((duration - (timeout.tv_sec * 1000))
-					   * 1000);
+			timeout = duration;
 		}
 
-		ret = select(max_fd + 1, &readfds, &writefds, 0,
-			     next_timeout ? &timeout : NULL);
+		ret = io_wait(timeout);
 
 		if (log_reload) {
 			handle_log_reload();
 			log_reload = 0;
 		}
 
-		/* Abort if select failed, except for EINTR cases
+		/* Abort if the wait failed, except for EINTR cases
 		   which indicate a possible log reload */
 		if (ret == -1) {
 			if (errno == EINTR)
 				continue;
-			dolog(LOG_ERR, "Failure in select: %d (%s)",
+			dolog(LOG_ERR, "Failure waiting for events: %d (%s)",
 			      errno, strerror(errno));
 			break;
 		}
-
-		if (log_hv && FD_ISSET(xc_evtchn_fd(xce_handle), &readfds))
-			handle_hv_logs();
-
-		if (ret <= 0)
-			continue;
-
-		if (FD_ISSET(xs_fileno(xs), &readfds))
-			handle_xs();
-
-		for (d = dom_head; d; d = n) {
-			n = d->next;
-			if (d->event_count < RATE_LIMIT_ALLOWANCE) {
-				if (d->xce_handle != NULL &&
-				    FD_ISSET(xc_evtchn_fd(d->xce_handle),
-					     &readfds))
-					handle_ring_read(d);
-			}
-
-			if (d->master_fd != -1 && FD_ISSET(d->master_fd,
-							   &readfds))
-				handle_tty_read(d);
-
-			if (d->master_fd != -1 && FD_ISSET(d->master_fd,
-							   &writefds))
-				handle_tty_write(d);
-
-			if (d->last_seen != enum_pass)
-				shutdown_domain(d);
-
-			if (d->is_dead)
-				cleanup_domain(d);
-		}
 	}
 
  out:
@@ -1094,9 +1351,11 @@ void handle_io(void)
 		xch = 0;
 	}
 	if (xce_handle != NULL) {
+		io_update(&hv_io, -1, 0);
 		xc_evtchn_close(xce_handle);
 		xce_handle = NULL;
 	}
+	io_update(&xs_io, -1, 0);
 	log_hv_evtchn = -1;
 }
 
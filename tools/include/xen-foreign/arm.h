@@ -0,0 +1,77 @@
+
+/*
+ * public xen defines and struct for arm
+ * generated by mkheader.py -- DO NOT EDIT
+ */
+
+#ifndef __FOREIGN_ARM_H__
+#define __FOREIGN_ARM_H__ 1
+
+#define XEN_LEGACY_MAX_VCPUS_ARM 1
+#define _VGCF_online_ARM                   0
+#define VGCF_online_ARM                    (1<<_VGCF_online_ARM)
+
+#define arm_has_no_vcpu_cr_regs 1
+
+#define arm_has_no_vcpu_ar_regs 1
+
+#define arm_has_no_start_info 1
+
+#define arm_has_no_trap_info 1
+
+struct cpu_user_regs_arm {
+    uint32_t r0;
+    uint32_t r1;
+    uint32_t r2;
+    uint32_t r3;
+    uint32_t r4;
+    uint32_t r5;
+    uint32_t r6;
+    uint32_t r7;
+    uint32_t r8;
+    uint32_t r9;
+    uint32_t r10;
+    union {
+        uint32_t r11;
+        uint32_t fp;
+    };
+    uint32_t r12;
+    uint32_t sp; 
+    union {
+        uint32_t lr; 
+        uint32_t lr_usr;
+    };
+    uint32_t pc; 
+    uint32_t cpsr; 
+    uint32_t pad0; 
+    uint32_t sp_usr; 
+    uint32_t sp_irq, lr_irq;
+    uint32_t sp_svc, lr_svc;
+    uint32_t sp_abt, lr_abt;
+    uint32_t sp_und, lr_und;
+    uint32_t r8_fiq, r9_fiq, r10_fiq, r11_fiq, r12_fiq;
+    uint32_t sp_fiq, lr_fiq;
+    uint32_t spsr_svc, spsr_abt, spsr_und, spsr_irq, spsr_fiq;
+    uint32_t pad1; 
+};
+typedef struct cpu_user_regs_arm cpu_user_regs_arm_t;
+
+struct vcpu_guest_context_arm {
+    uint32_t flags;                         
+    struct cpu_user_regs_arm user_regs;         
+    uint32_t sctlr;
+    uint32_t ttbr0, ttbr1, ttbcr;
+};
+typedef struct vcpu_guest_context_arm vcpu_guest_context_arm_t;
+
+#define arm_has_no_arch_vcpu_info 1
+
+#define arm_has_no_vcpu_time_info 1
+
+#define arm_has_no_vcpu_info 1
+
+#define arm_has_no_arch_shared_info 1
+
+#define arm_has_no_shared_info 1
+
+#endif /* __FOREIGN_ARM_H__ */
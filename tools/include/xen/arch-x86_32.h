@@ -0,0 +1 @@
+/root/repo/tools/include/../../xen/include/public/arch-x86_32.h
\ No newline at end of file
@@ -0,0 +1 @@
+/root/repo/tools/include/../../xen/include/public/grant_table.h
\ No newline at end of file
@@ -0,0 +1 @@
+/root/repo/tools/include/../../xen/include/xen/elfstructs.h
\ No newline at end of file
@@ -284,23 +284,40 @@ void invalidate_cache_page(comp_ctx *ctx, xen_pfn_t pfn)
     }
 }
 
-int xc_compression_add_page(xc_interface *xch, comp_ctx *ctx,
-                            char *page, xen_pfn_t pfn, int israw)
+int xc_compression_claim_page(xc_interface *xch, comp_ctx *ctx,
+                              xen_pfn_t pfn, int israw, char **slot)
 {
     if (pfn > ctx->dom_pfnlist_size)
     {
         ERROR("Invalid pfn passed into "
-              "xc_compression_add_page %" PRIpfn "\n", pfn);
+              "xc_compression_claim_page %" PRIpfn "\n", pfn);
         return -2;
     }
 
+    if (ctx->pfns_len == NRPAGES(PAGE_BUFFER_SIZE))
+        return -1;
+
     /* pagetable page */
     if (israw)
         invalidate_cache_page(ctx, pfn);
     ctx->sendbuf_pfns[ctx->pfns_len] = israw ? INVALID_P2M_ENTRY : pfn;
-    memcpy(ctx->inputbuf + ctx->pfns_len * XC_PAGE_SIZE, page, XC_PAGE_SIZE);
+    *slot = ctx->inputbuf + ctx->pfns_len * XC_PAGE_SIZE;
     ctx->pfns_len++;
 
+    return 0;
+}
+
+int xc_compression_add_page(xc_interface *xch, comp_ctx *ctx,
+                            char *page, xen_pfn_t pfn, int israw)
+{
+    char *slot;
+    int rc;
+
+    rc = xc_compression_claim_page(xch, ctx, pfn, israw, &slot);
+    if (rc)
+        return rc;
+    memcpy(slot, page, XC_PAGE_SIZE);
+
     /* check if we have run out of space. If so,
      * we need to synchronously compress the pages and flush them out
      */
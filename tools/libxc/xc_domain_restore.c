@@ -27,9 +27,10 @@
  * The superpages flag in restore has two different meanings depending on
  * the type of domain.
  *
- * For an HVM domain, the flag means to look for properly aligned contiguous
- * pages and try to allocate a superpage to satisfy it.  If that fails,
- * fall back to small pages.
+ * For an HVM domain, the flag means to allocate memory in the largest
+ * aligned extent (1GB, then 2MB) around each pfn the stream brings in, and
+ * give back the pfns in it which turn out not to be part of the guest.  If
+ * an extent can't be allocated, fall back to small pages.
  *
  * For a PV domain, the flag means allocate all memory as superpages.  If that
  * fails, the restore fails.  This behavior is required for PV guests who
@@ -38,14 +39,18 @@
 
 #include <stdlib.h>
 #include <unistd.h>
+#include <pthread.h>
 
 #include "xg_private.h"
 #include "xg_save_restore.h"
 #include "xc_dom.h"
+#include "xc_bitops.h"
 
 #include <xen/hvm/ioreq.h>
 #include <xen/hvm/params.h>
 
+struct restore_copiers;
+
 struct restore_ctx {
     unsigned long max_mfn; /* max mfn of the current host machine */
     unsigned long hvirt_start; /* virtual starting address of the hypervisor */
@@ -61,6 +66,14 @@ struct restore_ctx {
     int last_checkpoint; /* Set when we should commit to the current checkpoint when it completes. */
     int compressing; /* Set when sender signals that pages would be sent compressed (for Remus) */
     struct domain_info_context dinfo;
+    /* HVM superpage restore; see hvm_alloc_extent(). */
+    unsigned char *sp_tried; /* per 2MB region: an extent has been tried */
+    unsigned long *sp_unseen; /* allocated pfns not yet seen in the stream */
+    unsigned long nr_unseen;
+    xen_pfn_t *sp_release; /* pfns to give back */
+    unsigned int nr_release;
+    unsigned long nr_1gb, nr_2mb, nr_released; /* stats */
+    struct restore_copiers *copiers; /* NULL: copy pages in line */
 };
 
 #define HEARTBEAT_MS 1000
@@ -118,7 +131,186 @@ static ssize_t rdexact(xc_interface *xch, struct restore_ctx *ctx,
 #define SUPERPAGE_PFN_SHIFT  9
 #define SUPERPAGE_NR_PFNS    (1UL << SUPERPAGE_PFN_SHIFT)
 #define SUPERPAGE(_pfn) ((_pfn) & (~(SUPERPAGE_NR_PFNS-1)))
-#define SUPER_PAGE_START(pfn)    (((pfn) & (SUPERPAGE_NR_PFNS-1)) == 0 )
+#define SUPERPAGE_1GB_SHIFT   18
+#define SUPERPAGE_1GB_NR_PFNS (1UL << SUPERPAGE_1GB_SHIFT)
+
+/*
+** HVM superpages.  xc_hvm_build lays guest memory out in 1GB and 2MB
+** extents wherever it can, but the stream doesn't say where they were, and
+** pages arrive a batch at a time, possibly out of order.  So when a pfn
+** turns up in an aligned region which nothing has been allocated in yet,
+** allocate the largest extent covering it, on the assumption that the rest
+** of the region will follow.  Each pfn in the extent is then accounted for
+** as the stream comes in: a hole (XTAB) is given back at the end of the
+** batch it arrives in, and whatever the stream never mentions is given back
+** once all of memory has been received.  Xen splits the extent's mapping
+** only where pfns are given back, so regions which were superpages when
+** the guest was built come back as superpages.
+**
+** 1GB is only tried for the first pfn seen in a 1GB region, and each 2MB
+** region is tried at most once, so a failed allocation (no contiguous
+** memory, or the domain's allocation limit) costs one hypercall and no
+** more.
+*/
+static int hvm_init_extents(struct restore_ctx *ctx)
+{
+    unsigned long p2m_size = ctx->dinfo.p2m_size;
+
+    ctx->sp_tried = calloc((p2m_size >> SUPERPAGE_PFN_SHIFT) + 1, 1);
+    ctx->sp_unseen = bitmap_alloc(p2m_size);
+    ctx->sp_release = malloc(MAX_BATCH_SIZE * sizeof(xen_pfn_t));
+
+    return (ctx->sp_tried && ctx->sp_unseen && ctx->sp_release) ? 0 : -1;
+}
+
+static void hvm_free_extents(struct restore_ctx *ctx)
+{
+    free(ctx->sp_tried);
+    free(ctx->sp_unseen);
+    free(ctx->sp_release);
+    ctx->sp_tried = NULL;
+    ctx->sp_unseen = NULL;
+    ctx->sp_release = NULL;
+}
+
+static int hvm_flush_release(xc_interface *xch, uint32_t dom,
+                             struct restore_ctx *ctx)
+{
+    if ( ctx->nr_release == 0 )
+        return 0;
+
+    if ( xc_domain_decrease_reservation_exact(xch, dom, ctx->nr_release, 0,
+                                              ctx->sp_release) )
+    {
+        PERROR("Failed to release %u pfns from superpages", ctx->nr_release);
+        return -1;
+    }
+
+    ctx->nr_released += ctx->nr_release;
+    ctx->nr_release = 0;
+    return 0;
+}
+
+/* Give a speculatively allocated pfn back, now or at the next flush. */
+static int hvm_release_pfn(xc_interface *xch, uint32_t dom,
+                           struct restore_ctx *ctx, unsigned long pfn)
+{
+    ctx->p2m[pfn] = INVALID_P2M_ENTRY;
+    ctx->nr_pfns--;
+    ctx->sp_release[ctx->nr_release++] = pfn;
+
+    return (ctx->nr_release == MAX_BATCH_SIZE)
+        ? hvm_flush_release(xch, dom, ctx) : 0;
+}
+
+/*
+ * Called when the stream mentions @pfn.  Returns 1 if @pfn had been
+ * allocated as part of an extent and the caller need do nothing more,
+ * -1 on error, else 0.
+ */
+static int hvm_see_pfn(xc_interface *xch, uint32_t dom,
+                       struct restore_ctx *ctx, unsigned long pfn,
+                       unsigned long pagetype)
+{
+    if ( (pfn >= ctx->dinfo.p2m_size) ||
+         !test_and_clear_bit(pfn, ctx->sp_unseen) )
+        return 0;
+
+    ctx->nr_unseen--;
+    if ( (pagetype == XEN_DOMCTL_PFINFO_XTAB) &&
+         hvm_release_pfn(xch, dom, ctx, pfn) )
+        return -1;
+
+    return 1;
+}
+
+/* Give back every pfn the stream hasn't mentioned yet. */
+static int hvm_release_unseen(xc_interface *xch, uint32_t dom,
+                              struct restore_ctx *ctx)
+{
+    unsigned long pfn;
+
+    for ( pfn = 0; ctx->nr_unseen && (pfn < ctx->dinfo.p2m_size); pfn++ )
+    {
+        if ( !test_and_clear_bit(pfn, ctx->sp_unseen) )
+            continue;
+        ctx->nr_unseen--;
+        if ( hvm_release_pfn(xch, dom, ctx, pfn) )
+            return -1;
+    }
+
+    return hvm_flush_release(xch, dom, ctx);
+}
+
+static int hvm_try_extent(xc_interface *xch, uint32_t dom,
+                          struct restore_ctx *ctx, unsigned long base,
+                          unsigned int order)
+{
+    unsigned long nr = 1UL << order, k;
+    xen_pfn_t extent = base;
+
+    if ( base + nr > ctx->dinfo.p2m_size )
+        return 0;
+
+    for ( k = 0; k < nr; k++ )
+        if ( ctx->p2m[base + k] != INVALID_P2M_ENTRY )
+            return 0;
+
+    if ( xc_domain_populate_physmap_exact(xch, dom, 1, order, 0, &extent) )
+    {
+        DPRINTF("No %s page available for pfn %#lx\n",
+                order == SUPERPAGE_1GB_SHIFT ? "1GB" : "2MB", base);
+        return 0;
+    }
+
+    for ( k = 0; k < nr; k++ )
+    {
+        ctx->p2m[base + k] = base + k;
+        set_bit(base + k, ctx->sp_unseen);
+    }
+    ctx->nr_pfns += nr;
+    ctx->nr_unseen += nr;
+    if ( order == SUPERPAGE_1GB_SHIFT )
+        ctx->nr_1gb++;
+    else
+        ctx->nr_2mb++;
+
+    return 1;
+}
+
+/*
+ * Try to allocate an extent covering @pfn, which the stream has just
+ * brought in for the first time.  Returns 1 if that worked.
+ */
+static int hvm_alloc_extent(xc_interface *xch, uint32_t dom,
+                            struct restore_ctx *ctx, unsigned long pfn)
+{
+    unsigned long region = pfn >> SUPERPAGE_PFN_SHIFT;
+    unsigned long first = region & ~((1UL << (SUPERPAGE_1GB_SHIFT -
+                                              SUPERPAGE_PFN_SHIFT)) - 1);
+    unsigned long k, nr = 1UL << (SUPERPAGE_1GB_SHIFT - SUPERPAGE_PFN_SHIFT);
+    int untouched = 1;
+
+    if ( (pfn >= ctx->dinfo.p2m_size) || ctx->sp_tried[region] )
+        return 0;
+
+    if ( (first + nr) << SUPERPAGE_PFN_SHIFT <= ctx->dinfo.p2m_size )
+    {
+        for ( k = 0; untouched && (k < nr); k++ )
+            untouched = !ctx->sp_tried[first + k];
+        if ( untouched &&
+             hvm_try_extent(xch, dom, ctx, first << SUPERPAGE_PFN_SHIFT,
+                            SUPERPAGE_1GB_SHIFT) )
+        {
+            memset(&ctx->sp_tried[first], 1, nr);
+            return 1;
+        }
+    }
+
+    ctx->sp_tried[region] = 1;
+    return hvm_try_extent(xch, dom, ctx, region << SUPERPAGE_PFN_SHIFT,
+                          SUPERPAGE_PFN_SHIFT);
+}
 
 /*
 ** When we're restoring into a pv superpage-allocated guest, we take
@@ -746,6 +938,8 @@ typedef struct {
     uint64_t paging_ring_pfn;
     uint64_t access_ring_pfn;
     uint64_t sharing_ring_pfn;
+    uint64_t ioreq_server_pfn;
+    uint64_t nr_ioreq_server_pages;
     uint64_t vm86_tss;
     uint64_t console_pfn;
     uint64_t acpi_ioport_location;
@@ -858,6 +1052,26 @@ static int pagebuf_get_one(xc_interface *xch, struct restore_ctx *ctx,
         // DPRINTF("sharing ring pfn address: %llx\n", buf->sharing_ring_pfn);
         return pagebuf_get_one(xch, ctx, buf, fd, dom);
 
+    case XC_SAVE_ID_HVM_IOREQ_SERVER_PFN:
+        /* Skip padding 4 bytes then read the ioreq server pfn. */
+        if ( RDEXACT(fd, &buf->ioreq_server_pfn, sizeof(uint32_t)) ||
+             RDEXACT(fd, &buf->ioreq_server_pfn, sizeof(uint64_t)) )
+        {
+            PERROR("error read the ioreq server pfn");
+            return -1;
+        }
+        return pagebuf_get_one(xch, ctx, buf, fd, dom);
+
+    case XC_SAVE_ID_HVM_NR_IOREQ_SERVER_PAGES:
+        /* Skip padding 4 bytes then read the number of ioreq server pages. */
+        if ( RDEXACT(fd, &buf->nr_ioreq_server_pages, sizeof(uint32_t)) ||
+             RDEXACT(fd, &buf->nr_ioreq_server_pages, sizeof(uint64_t)) )
+        {
+            PERROR("error read the number of ioreq server pages");
+            return -1;
+        }
+        return pagebuf_get_one(xch, ctx, buf, fd, dom);
+
     case XC_SAVE_ID_HVM_VM86_TSS:
         /* Skip padding 4 bytes then read the vm86 TSS location. */
         if ( RDEXACT(fd, &buf->vm86_tss, sizeof(uint32_t)) ||
@@ -1083,20 +1297,398 @@ static int pagebuf_get(xc_interface *xch, struct restore_ctx *ctx,
     return rc;
 }
 
+#ifndef __MINIOS__
+/*
+ * While the first copy of memory is coming in, batches are read from the
+ * stream by a separate thread, so that receiving the next few batches
+ * overlaps with allocating and filling in the pages of this one.  Only page
+ * arrays are handed over batch by batch: every other chunk accumulates in
+ * the reader's own pagebuf, which the main thread takes over once the end
+ * of memory has been read.
+ */
+#define RESTORE_READAHEAD 4 /* batches buffered ahead of apply_batch() */
+#define RESTORE_STOP_MS  100 /* how often an idle reader checks for a stop */
+
+struct restore_reader {
+    xc_interface *xch;
+    struct restore_ctx *ctx;
+    int fd;
+    uint32_t dom;
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+
+    pagebuf_t buf;
+    pagebuf_t batches[RESTORE_READAHEAD];
+    unsigned int prod, cons;
+    int done, error, exiting;
+    int err; /* errno of a failed read */
+};
+
+/* Move the page arrays (and only them) from one pagebuf to another. */
+static void pagebuf_move_pages(pagebuf_t *to, pagebuf_t *from)
+{
+    void *pages = to->pages;
+    unsigned long *pfn_types = to->pfn_types;
+
+    to->pages = from->pages;
+    to->pfn_types = from->pfn_types;
+    to->nr_pages = from->nr_pages;
+    to->nr_physpages = from->nr_physpages;
+    to->verify = from->verify;
+
+    /* Hand the old arrays back so that they get reused. */
+    from->pages = pages;
+    from->pfn_types = pfn_types;
+    from->nr_pages = from->nr_physpages = 0;
+}
+
+/*
+ * Wait for the next chunk to start arriving.  Returns 0 if the main thread
+ * asked us to stop meanwhile.  A chunk which has started is read to its
+ * end, which the sender either provides or cuts short by closing the
+ * stream, so a stop never waits for more than that.
+ */
+static int restore_reader_wait(struct restore_reader *rd)
+{
+    struct timeval tv;
+    fd_set rfds;
+    int rc, exiting;
+
+    for ( ; ; )
+    {
+        pthread_mutex_lock(&rd->lock);
+        exiting = rd->exiting;
+        pthread_mutex_unlock(&rd->lock);
+        if ( exiting )
+            return 0;
+
+        tv.tv_sec = 0;
+        tv.tv_usec = RESTORE_STOP_MS * 1000;
+        FD_ZERO(&rfds);
+        FD_SET(rd->fd, &rfds);
+        rc = select(rd->fd + 1, &rfds, NULL, NULL, &tv);
+        /* On an error, let the read report it. */
+        if ( rc > 0 || (rc < 0 && errno != EINTR) )
+            return 1;
+    }
+}
+
+static void *restore_reader_thread(void *arg)
+{
+    struct restore_reader *rd = arg;
+    pagebuf_t *slot;
+    int rc;
+
+    for ( ; ; )
+    {
+        pthread_mutex_lock(&rd->lock);
+        while ( (rd->prod - rd->cons) == RESTORE_READAHEAD && !rd->exiting )
+            pthread_cond_wait(&rd->cond, &rd->lock);
+        pthread_mutex_unlock(&rd->lock);
+        if ( !restore_reader_wait(rd) )
+            break;
+
+        slot = &rd->batches[rd->prod % RESTORE_READAHEAD];
+        pagebuf_move_pages(&rd->buf, slot);
+        rc = pagebuf_get_one(rd->xch, rd->ctx, &rd->buf, rd->fd, rd->dom);
+        pagebuf_move_pages(slot, &rd->buf);
+
+        pthread_mutex_lock(&rd->lock);
+        if ( rc < 0 )
+        {
+            rd->err = errno;
+            rd->error = 1;
+        }
+        else
+            rd->prod++;
+        rd->done = (rc < 0) || (slot->nr_pages == 0);
+        pthread_cond_broadcast(&rd->cond);
+        pthread_mutex_unlock(&rd->lock);
+
+        if ( rd->done )
+            break;
+    }
+
+    return NULL;
+}
+
+static struct restore_reader *restore_reader_start(
+    xc_interface *xch, struct restore_ctx *ctx, int fd, uint32_t dom)
+{
+    struct restore_reader *rd;
+
+    if ( (rd = calloc(1, sizeof(*rd))) == NULL )
+        return NULL;
+
+    rd->xch = xch;
+    rd->ctx = ctx;
+    rd->fd = fd;
+    rd->dom = dom;
+    pthread_mutex_init(&rd->lock, NULL);
+    pthread_cond_init(&rd->cond, NULL);
+
+    if ( pthread_create(&rd->thread, NULL, restore_reader_thread, rd) )
+    {
+        DPRINTF("Could not start reader thread, reading synchronously\n");
+        pthread_cond_destroy(&rd->cond);
+        pthread_mutex_destroy(&rd->lock);
+        free(rd);
+        return NULL;
+    }
+
+    return rd;
+}
+
+static void restore_reader_stop(struct restore_reader *rd)
+{
+    unsigned int i;
+
+    if ( rd == NULL )
+        return;
+
+    /* Don't wait for more of a stream we're no longer interested in. */
+    pthread_mutex_lock(&rd->lock);
+    rd->exiting = 1;
+    pthread_cond_broadcast(&rd->cond);
+    pthread_mutex_unlock(&rd->lock);
+    pthread_join(rd->thread, NULL);
+
+    pthread_cond_destroy(&rd->cond);
+    pthread_mutex_destroy(&rd->lock);
+
+    for ( i = 0; i < RESTORE_READAHEAD; i++ )
+        pagebuf_free(&rd->batches[i]);
+    pagebuf_free(&rd->buf);
+    free(rd);
+}
+
+/*
+ * Take the next batch, in the same form pagebuf_get_one() would have left
+ * it in @buf.  After the last one (nr_pages == 0) the reader is finished
+ * with, and @buf has taken over everything else that it read.
+ */
+static int restore_reader_get(struct restore_reader *rd, pagebuf_t *buf)
+{
+    pthread_mutex_lock(&rd->lock);
+    while ( rd->prod == rd->cons && !rd->error )
+        pthread_cond_wait(&rd->cond, &rd->lock);
+    if ( rd->prod == rd->cons )
+    {
+        pthread_mutex_unlock(&rd->lock);
+        errno = rd->err;
+        return -1;
+    }
+
+    pagebuf_move_pages(buf, &rd->batches[rd->cons % RESTORE_READAHEAD]);
+    rd->cons++;
+    pthread_cond_broadcast(&rd->cond);
+    pthread_mutex_unlock(&rd->lock);
+
+    if ( buf->nr_pages == 0 )
+    {
+        /* Everything but the (empty) page arrays comes from the reader. */
+        pagebuf_move_pages(&rd->buf, buf);
+        pagebuf_free(buf);
+        *buf = rd->buf;
+        memset(&rd->buf, 0, sizeof(rd->buf));
+    }
+
+    return 0;
+}
+
+/*
+ * Copying pages from the stream into guest memory is most of the CPU time
+ * of a restore, and every page is independent, so plain data pages are
+ * copied by a pool of threads along with the main one.  apply_batch()
+ * queues them while it deals in order with everything else (page tables,
+ * M2P updates, broken pages), then hands the queue over and waits for it
+ * to drain before unmapping the batch.  Compressed (Remus) and verify-mode
+ * batches are still copied in line.
+ *
+ * The pool has one thread per online CPU, up to RESTORE_MAX_COPIERS, or as
+ * many as XC_RESTORE_COPIERS in the environment says.
+ */
+#define RESTORE_MAX_COPIERS 16
+#define RESTORE_COPY_CHUNK  32 /* pages a copier takes at a time */
+
+struct restore_copiers {
+    pthread_t threads[RESTORE_MAX_COPIERS];
+    unsigned int nr_threads; /* not counting the main thread */
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+
+    struct {
+        void *dst;
+        const void *src;
+    } pages[MAX_BATCH_SIZE];
+    unsigned int nr_pages, next, busy;
+    unsigned long round;
+    int exiting;
+};
+
+static void restore_copy_chunks(struct restore_copiers *cp)
+{
+    unsigned int i, end;
+
+    for ( ; ; )
+    {
+        pthread_mutex_lock(&cp->lock);
+        i = cp->next;
+        end = i + RESTORE_COPY_CHUNK;
+        if ( end > cp->nr_pages )
+            end = cp->nr_pages;
+        cp->next = end;
+        pthread_mutex_unlock(&cp->lock);
+
+        if ( i >= end )
+            return;
+        for ( ; i < end; i++ )
+            memcpy(cp->pages[i].dst, cp->pages[i].src, PAGE_SIZE);
+    }
+}
+
+static void *restore_copier_thread(void *arg)
+{
+    struct restore_copiers *cp = arg;
+    unsigned long round = 0;
+
+    pthread_mutex_lock(&cp->lock);
+    for ( ; ; )
+    {
+        while ( (cp->round == round) && !cp->exiting )
+            pthread_cond_wait(&cp->cond, &cp->lock);
+        if ( cp->exiting )
+            break;
+        round = cp->round;
+        pthread_mutex_unlock(&cp->lock);
+
+        restore_copy_chunks(cp);
+
+        pthread_mutex_lock(&cp->lock);
+        if ( --cp->busy == 0 )
+            pthread_cond_broadcast(&cp->cond);
+    }
+    pthread_mutex_unlock(&cp->lock);
+
+    return NULL;
+}
+
+static void restore_copiers_stop(struct restore_copiers *cp)
+{
+    unsigned int i;
+
+    if ( cp == NULL )
+        return;
+
+    pthread_mutex_lock(&cp->lock);
+    cp->exiting = 1;
+    pthread_cond_broadcast(&cp->cond);
+    pthread_mutex_unlock(&cp->lock);
+
+    for ( i = 0; i < cp->nr_threads; i++ )
+        pthread_join(cp->threads[i], NULL);
+
+    pthread_cond_destroy(&cp->cond);
+    pthread_mutex_destroy(&cp->lock);
+    free(cp);
+}
+
+static struct restore_copiers *restore_copiers_start(xc_interface *xch)
+{
+    struct restore_copiers *cp;
+    const char *env = getenv("XC_RESTORE_COPIERS");
+    long nr = env ? strtol(env, NULL, 0) : sysconf(_SC_NPROCESSORS_ONLN);
+
+    if ( nr > RESTORE_MAX_COPIERS )
+        nr = RESTORE_MAX_COPIERS;
+    /* The main thread copies too. */
+    if ( nr <= 1 || (cp = calloc(1, sizeof(*cp))) == NULL )
+        return NULL;
+
+    pthread_mutex_init(&cp->lock, NULL);
+    pthread_cond_init(&cp->cond, NULL);
+
+    for ( ; cp->nr_threads < nr - 1; cp->nr_threads++ )
+        if ( pthread_create(&cp->threads[cp->nr_threads], NULL,
+                            restore_copier_thread, cp) )
+            break;
+
+    if ( cp->nr_threads == 0 )
+    {
+        DPRINTF("Could not start copier threads, copying in line\n");
+        restore_copiers_stop(cp);
+        return NULL;
+    }
+
+    DPRINTF("Copying pages on %u threads\n", cp->nr_threads + 1);
+    return cp;
+}
+
+static void restore_copy_queue(struct restore_copiers *cp,
+                               void *dst, const void *src)
+{
+    cp->pages[cp->nr_pages].dst = dst;
+    cp->pages[cp->nr_pages].src = src;
+    cp->nr_pages++;
+}
+
+static void restore_copy_run(struct restore_copiers *cp)
+{
+    /* Not worth waking anyone for a handful of pages. */
+    if ( cp->nr_pages > RESTORE_COPY_CHUNK )
+    {
+        pthread_mutex_lock(&cp->lock);
+        cp->next = 0;
+        cp->busy = cp->nr_threads;
+        cp->round++;
+        pthread_cond_broadcast(&cp->cond);
+        pthread_mutex_unlock(&cp->lock);
+
+        restore_copy_chunks(cp);
+
+        pthread_mutex_lock(&cp->lock);
+        while ( cp->busy )
+            pthread_cond_wait(&cp->cond, &cp->lock);
+        pthread_mutex_unlock(&cp->lock);
+    }
+    else
+    {
+        cp->next = 0;
+        restore_copy_chunks(cp);
+    }
+
+    cp->nr_pages = 0;
+}
+#else
+/* Mini-OS has no threads, so there the stream is always read in line. */
+struct restore_reader;
+#define restore_reader_start(xch, ctx, fd, dom) NULL
+#define restore_reader_stop(rd) ((void)(rd))
+#define restore_reader_get(rd, buf) (-1)
+
+/* ... and pages are always copied in line. */
+#define restore_copiers_start(xch) NULL
+#define restore_copiers_stop(cp) ((void)(cp))
+#define restore_copy_queue(cp, dst, src) ((void)0)
+#define restore_copy_run(cp) ((void)0)
+#endif /* !__MINIOS__ */
+
 static int apply_batch(xc_interface *xch, uint32_t dom, struct restore_ctx *ctx,
                        xen_pfn_t* region_mfn, unsigned long* pfn_type, int pae_extended_cr3,
                        struct xc_mmu* mmu,
                        pagebuf_t* pagebuf, int curbatch)
 {
     int i, j, curpage, nr_mfns;
-    int k, scount;
-    unsigned long superpage_start=INVALID_P2M_ENTRY;
     /* used by debug verify code */
     unsigned long buf[PAGE_SIZE/sizeof(unsigned long)];
     /* Our mapping of the current region (batch) */
     char *region_base;
     /* A temporary mapping, and a copy, of one frame of guest memory. */
     unsigned long *page = NULL;
+    const char *src;
     int nraces = 0;
     struct domain_info_context *dinfo = &ctx->dinfo;
     int* pfn_err = NULL;
@@ -1108,104 +1700,45 @@ static int apply_batch(xc_interface *xch, uint32_t dom, struct restore_ctx *ctx,
     if (j > MAX_BATCH_SIZE)
         j = MAX_BATCH_SIZE;
 
-    /* First pass for this batch: work out how much memory to alloc, and detect superpages */
-    nr_mfns = scount = 0;
+    /* First pass for this batch: work out how much memory to alloc */
+    nr_mfns = 0;
     for ( i = 0; i < j; i++ )
     {
         unsigned long pfn, pagetype;
         pfn      = pagebuf->pfn_types[i + curbatch] & ~XEN_DOMCTL_PFINFO_LTAB_MASK;
         pagetype = pagebuf->pfn_types[i + curbatch] &  XEN_DOMCTL_PFINFO_LTAB_MASK;
 
+        if ( ctx->sp_unseen )
+        {
+            rc = hvm_see_pfn(xch, dom, ctx, pfn, pagetype);
+            if ( rc < 0 )
+                return -1;
+            if ( rc )
+                continue;
+        }
+
         /* For allocation purposes, treat XEN_DOMCTL_PFINFO_XALLOC as a normal page */
         if ( (pagetype != XEN_DOMCTL_PFINFO_XTAB) && 
              (ctx->p2m[pfn] == INVALID_P2M_ENTRY) )
         {
             /* Have a live PFN which hasn't had an MFN allocated */
-
-            /* Logic if we're in the middle of detecting a candidate superpage */
-            if ( superpage_start != INVALID_P2M_ENTRY )
+            if ( ctx->sp_unseen && hvm_alloc_extent(xch, dom, ctx, pfn) )
             {
-                /* Is this the next expected continuation? */
-                if ( pfn == superpage_start + scount )
-                {
-                    if ( !ctx->superpages )
-                    {
-                        ERROR("Unexpexted codepath with no superpages");
-                        return -1;
-                    }
-
-                    scount++;
-
-                    /* If we've found a whole superpage, allocate it and update p2m */
-                    if ( scount  == SUPERPAGE_NR_PFNS )
-                    {
-                        unsigned long supermfn;
-
-
-                        supermfn=superpage_start;
-                        if ( xc_domain_populate_physmap_exact(xch, dom, 1,
-                                         SUPERPAGE_PFN_SHIFT, 0, &supermfn) != 0 )
-                        {
-                            DPRINTF("No 2M page available for pfn 0x%lx, fall back to 4K page.\n",
-                                    superpage_start);
-                            /* If we're falling back from a failed allocation, subtract one
-                             * from count, since the last page == pfn, which will behandled
-                             * anyway. */
-                            scount--;
-                            goto fallback;
-                        }
-
-                        DPRINTF("Mapping superpage (%d) pfn %lx, mfn %lx\n", scount, superpage_start, supermfn);
-                        for (k=0; k<scount; k++)
-                        {
-                            /* We just allocated a new mfn above; update p2m */
-                            ctx->p2m[superpage_start+k] = supermfn+k;
-                            ctx->nr_pfns++;
-                            /* region_map[] will be set below */
-                        }
-                        superpage_start=INVALID_P2M_ENTRY;
-                        scount=0;
-                    }
-                    continue;
-                }
-                
-            fallback:
-                DPRINTF("Falling back %d pages pfn %lx\n", scount, superpage_start);
-                for (k=0; k<scount; k++)
-                {
-                    ctx->p2m_batch[nr_mfns++] = superpage_start+k; 
-                    ctx->p2m[superpage_start+k]--;
-                }
-                superpage_start = INVALID_P2M_ENTRY;
-                scount=0;
+                clear_bit(pfn, ctx->sp_unseen);
+                ctx->nr_unseen--;
+                continue;
             }
 
-            /* Are we ready to start a new superpage candidate? */
-            if ( ctx->hvm && ctx->superpages && SUPER_PAGE_START(pfn) )
-            {
-                superpage_start=pfn;
-                scount++;
-            }
-            else
-            {
-                /* Add the current pfn to pfn_batch */
-                ctx->p2m_batch[nr_mfns++] = pfn;
-                ctx->p2m[pfn]--;
-            }
+            /* Add the current pfn to pfn_batch */
+            ctx->p2m_batch[nr_mfns++] = pfn;
+            ctx->p2m[pfn]--;
         }
     }
+    rc = -1;
 
-    /* Clean up any partial superpage candidates */
-    if ( superpage_start != INVALID_P2M_ENTRY )
-    {
-        DPRINTF("Falling back %d pages pfn %lx\n", scount, superpage_start);
-        for (k=0; k<scount; k++)
-        {
-            ctx->p2m_batch[nr_mfns++] = superpage_start+k; 
-            ctx->p2m[superpage_start+k]--;
-        }
-        superpage_start = INVALID_P2M_ENTRY;
-    }
+    /* Holes found in extents go back before we ask for more memory. */
+    if ( ctx->sp_unseen && hvm_flush_release(xch, dom, ctx) )
+        return -1;
 
     /* Now allocate a bunch of mfns for this batch */
     if ( nr_mfns )
@@ -1218,6 +1751,20 @@ static int apply_batch(xc_interface *xch, uint32_t dom, struct restore_ctx *ctx,
             rc = xc_domain_populate_physmap_exact(xch, dom, nr_mfns, 0, 0,
                                                   ctx->p2m_batch);
 
+        /*
+         * Extents not filled in yet may be what's keeping us over the
+         * domain's limit: give their unseen pfns back (they'll be
+         * allocated singly when they turn up) and try once more.
+         */
+        if ( rc && ctx->nr_unseen )
+        {
+            DPRINTF("Releasing %lu unseen pfns from superpages\n",
+                    ctx->nr_unseen);
+            if ( hvm_release_unseen(xch, dom, ctx) == 0 )
+                rc = xc_domain_populate_physmap_exact(xch, dom, nr_mfns, 0, 0,
+                                                      ctx->p2m_batch);
+        }
+
         if (rc)
         {
             ERROR("Failed to allocate memory for batch.!\n"); 
@@ -1305,6 +1852,7 @@ static int apply_batch(xc_interface *xch, uint32_t dom, struct restore_ctx *ctx,
 
         /* In verify mode, we use a copy; otherwise we work in place */
         page = pagebuf->verify ? (void *)buf : (region_base + i*PAGE_SIZE);
+        src = pagebuf->pages + (curpage + curbatch) * PAGE_SIZE;
 
         /* Remus - page decompression */
         if (pagebuf->compressing)
@@ -1318,9 +1866,13 @@ static int apply_batch(xc_interface *xch, uint32_t dom, struct restore_ctx *ctx,
                 goto err_mapped;
             }
         }
+        else if ( ctx->copiers && !pagebuf->verify &&
+                  ((pagetype & XEN_DOMCTL_PFINFO_LTABTYPE_MASK) ==
+                   XEN_DOMCTL_PFINFO_NOTAB) )
+            /* Plain data: leave it to the copiers, below. */
+            restore_copy_queue(ctx->copiers, page, src);
         else
-            memcpy(page, pagebuf->pages + (curpage + curbatch) * PAGE_SIZE,
-                   PAGE_SIZE);
+            memcpy(page, src, PAGE_SIZE);
 
         pagetype &= XEN_DOMCTL_PFINFO_LTABTYPE_MASK;
 
@@ -1392,6 +1944,9 @@ static int apply_batch(xc_interface *xch, uint32_t dom, struct restore_ctx *ctx,
         }
     } /* end of 'batch' for loop */
 
+    if ( ctx->copiers )
+        restore_copy_run(ctx->copiers);
+
     rc = nraces;
 
   err_mapped:
@@ -1455,6 +2010,7 @@ int xc_domain_restore(xc_interface *xch, int io_fd, uint32_t dom,
     int new_ctxt_format = 0;
 
     pagebuf_t pagebuf;
+    struct restore_reader *reader = NULL;
     tailbuf_t tailbuf, tmptail;
     struct toolstack_data_t tdata, tdatatmp;
     void* vcpup;
@@ -1570,6 +2126,13 @@ int xc_domain_restore(xc_interface *xch, int io_fd, uint32_t dom,
     for ( pfn = 0; pfn < dinfo->p2m_size; pfn++ )
         ctx->p2m[pfn] = INVALID_P2M_ENTRY;
 
+    if ( hvm && superpages && hvm_init_extents(ctx) )
+    {
+        ERROR("memory alloc failed");
+        errno = ENOMEM;
+        goto out;
+    }
+
     mmu = xc_alloc_mmu_updates(xch, dom);
     if ( mmu == NULL )
     {
@@ -1584,6 +2147,10 @@ int xc_domain_restore(xc_interface *xch, int io_fd, uint32_t dom,
      * We uncanonicalise page tables as we go.
      */
 
+    /* Read ahead of apply_batch() until the first checkpoint is in. */
+    reader = restore_reader_start(xch, ctx, io_fd, dom);
+    ctx->copiers = restore_copiers_start(xch);
+
     n = m = 0;
  loadpages:
     for ( ; ; )
@@ -1595,7 +2162,8 @@ int xc_domain_restore(xc_interface *xch, int io_fd, uint32_t dom,
         if ( !ctx->completed ) {
             pagebuf.nr_physpages = pagebuf.nr_pages = 0;
             pagebuf.compbuf_pos = pagebuf.compbuf_size = 0;
-            if ( pagebuf_get_one(xch, ctx, &pagebuf, io_fd, dom) < 0 ) {
+            if ( (reader ? restore_reader_get(reader, &pagebuf)
+                         : pagebuf_get_one(xch, ctx, &pagebuf, io_fd, dom)) < 0 ) {
                 PERROR("Error when reading batch");
                 goto out;
             }
@@ -1619,6 +2187,10 @@ int xc_domain_restore(xc_interface *xch, int io_fd, uint32_t dom,
                 xc_set_hvm_param(xch, dom, HVM_PARAM_ACCESS_RING_PFN, pagebuf.access_ring_pfn);
             if ( pagebuf.sharing_ring_pfn )
                 xc_set_hvm_param(xch, dom, HVM_PARAM_SHARING_RING_PFN, pagebuf.sharing_ring_pfn);
+            if ( pagebuf.ioreq_server_pfn )
+                xc_set_hvm_param(xch, dom, HVM_PARAM_IOREQ_SERVER_PFN, pagebuf.ioreq_server_pfn);
+            if ( pagebuf.nr_ioreq_server_pages )
+                xc_set_hvm_param(xch, dom, HVM_PARAM_NR_IOREQ_SERVER_PAGES, pagebuf.nr_ioreq_server_pages);
             if ( pagebuf.vm86_tss )
                 xc_set_hvm_param(xch, dom, HVM_PARAM_VM86_TSS, pagebuf.vm86_tss);
             if ( pagebuf.console_pfn )
@@ -1691,6 +2263,20 @@ int xc_domain_restore(xc_interface *xch, int io_fd, uint32_t dom,
         }
     }
 
+    restore_reader_stop(reader);
+    reader = NULL;
+
+    if ( ctx->sp_unseen )
+    {
+        /* All of memory is in: whatever hasn't turned up isn't coming. */
+        if ( hvm_release_unseen(xch, dom, ctx) )
+            goto out;
+        DPRINTF("Restored with %lu 1GB and %lu 2MB extents, "
+                "%lu pfns given back\n",
+                ctx->nr_1gb, ctx->nr_2mb, ctx->nr_released);
+        hvm_free_extents(ctx);
+    }
+
     /*
      * Ensure we flush all machphys updates before potential PAE-specific
      * reallocations below.
@@ -2297,6 +2883,9 @@ int xc_domain_restore(xc_interface *xch, int io_fd, uint32_t dom,
     rc = 0;
 
  out:
+    restore_reader_stop(reader);
+    restore_copiers_stop(ctx->copiers);
+    hvm_free_extents(ctx);
     if ( (rc != 0) && (dom != 0) )
         xc_domain_destroy(xch, dom);
     xc_hypercall_buffer_free(xch, ctxt);
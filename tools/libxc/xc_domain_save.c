@@ -25,6 +25,7 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <sys/time.h>
+#include <pthread.h>
 
 #include "xc_private.h"
 #include "xc_bitops.h"
@@ -802,6 +803,648 @@ static int save_tsc_info(xc_interface *xch, uint32_t dom, int io_fd)
     return 0;
 }
 
+/*
+** Pages are sent through a pipeline.  The main thread chooses the pfns of
+** a batch and maps them; a pool of worker threads prepares mapped batches;
+** and a single writer thread emits the batches in the order in which they
+** were mapped, so the stream is what a sequential save would have produced.
+**
+** Preparing a batch means canonicalising its page tables (PV only) or,
+** with checkpoint compression, copying all of its pages into the places
+** which the main thread reserved for them in the compression page buffer,
+** in stream order, when it submitted the batch.  The delta compression
+** itself still runs in the main thread once the domain has been resumed.
+** An uncompressed HVM save has nothing to prepare, so it starts no
+** workers.  When the compression page buffer fills up, the main thread
+** drains the pipeline and compresses it between two batches, rather than
+** in the middle of one as the sequential loop did.
+**
+** If the writer thread cannot be started (or on Mini-OS, which has no
+** threads), batches are prepared and written synchronously by the main
+** thread.
+*/
+#define DEF_SAVE_WORKERS   2   /* batch preparation threads */
+#define MAX_SAVE_WORKERS  16
+
+enum batch_state {
+    BATCH_FREE,       /* on the free list, or being filled by the mapper */
+    BATCH_MAPPED,     /* queued for a worker */
+    BATCH_PREPARING,  /* page tables or pages being copied */
+    BATCH_PREPARED,   /* waiting for its turn at the writer */
+};
+
+struct save_batch {
+    struct save_batch *next;
+    enum batch_state state;
+    unsigned int seq;
+
+    unsigned int batch;
+    int last_iter, compressing;
+    struct outbuf *ob;
+
+    xen_pfn_t *pfn_type;
+    unsigned long *pfn_batch;
+    int *pfn_err;
+    unsigned char *region_base;
+
+    /* Canonicalised copies of the batch's page tables, in batch order. */
+    char *ptpages;
+    unsigned int max_ptpages;
+
+    /* With compression: where each page goes in the page buffer, or NULL. */
+    char **compslots;
+};
+
+struct save_pipeline {
+    xc_interface *xch;
+    struct save_ctx *ctx;
+    comp_ctx *compress_ctx;
+    int io_fd, live;
+
+    pthread_mutex_t lock;
+#ifndef __MINIOS__
+    pthread_cond_t cond;
+    pthread_t writer, *workers;
+#endif
+
+    struct save_batch *batches, *free_list, *cur;
+    struct save_batch *mapped_head, **mapped_tail;
+    unsigned int nr_batches, next_seq, write_seq, in_flight;
+
+    unsigned int nr_workers;
+    int threaded, exiting, error;
+};
+
+#ifndef __MINIOS__
+#define pipeline_wait(pl) pthread_cond_wait(&(pl)->cond, &(pl)->lock)
+#define pipeline_wake(pl) pthread_cond_broadcast(&(pl)->cond)
+#else
+#define pipeline_wait(pl) ((void)0)
+#define pipeline_wake(pl) ((void)0)
+#endif
+
+/* Does this canonical pfn_type[] entry describe a page table to rewrite? */
+static int pfn_type_is_pagetable(xen_pfn_t type)
+{
+    unsigned long pagetype = type & XEN_DOMCTL_PFINFO_LTAB_MASK;
+
+    if ( pagetype == XEN_DOMCTL_PFINFO_XTAB
+         || pagetype == XEN_DOMCTL_PFINFO_BROKEN
+         || pagetype == XEN_DOMCTL_PFINFO_XALLOC )
+        return 0;
+
+    pagetype &= XEN_DOMCTL_PFINFO_LTABTYPE_MASK;
+
+    return (pagetype >= XEN_DOMCTL_PFINFO_L1TAB) &&
+           (pagetype <= XEN_DOMCTL_PFINFO_L4TAB);
+}
+
+/* Copy a mapped batch's pages into their compression page buffer slots. */
+static int save_batch_copy(struct save_pipeline *pl, struct save_batch *b)
+{
+    xc_interface *xch = pl->xch;
+    unsigned long pfn, pagetype;
+    unsigned int j;
+    char *spage;
+
+    for ( j = 0; j < b->batch; j++ )
+    {
+        if ( b->compslots[j] == NULL )
+            continue;
+
+        spage = (char *)b->region_base + (PAGE_SIZE*j);
+        if ( !pfn_type_is_pagetable(b->pfn_type[j]) )
+        {
+            memcpy(b->compslots[j], spage, PAGE_SIZE);
+            continue;
+        }
+
+        pfn      = b->pfn_type[j] & ~XEN_DOMCTL_PFINFO_LTAB_MASK;
+        pagetype = b->pfn_type[j] &  XEN_DOMCTL_PFINFO_LTABTYPE_MASK;
+
+        if ( canonicalize_pagetable(pl->ctx, pagetype, pfn, spage,
+                                    b->compslots[j]) && !pl->live )
+        {
+            ERROR("Fatal PT race (pfn %lx, type %08lx)", pfn, pagetype);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+** Prepare a mapped batch for the writer: canonicalise its page tables into
+** b->ptpages or, if it is being compressed, copy all of its pages out.
+*/
+static int save_batch_prepare(struct save_pipeline *pl, struct save_batch *b)
+{
+    xc_interface *xch = pl->xch;
+    unsigned long pfn, pagetype;
+    unsigned int j, nr = 0;
+    char *p;
+
+    if ( b->compressing )
+        return save_batch_copy(pl, b);
+
+    for ( j = 0; j < b->batch; j++ )
+        if ( pfn_type_is_pagetable(b->pfn_type[j]) )
+            nr++;
+
+    if ( nr == 0 )
+        return 0;
+
+    if ( nr > b->max_ptpages )
+    {
+        if ( !(p = realloc(b->ptpages, nr * PAGE_SIZE)) )
+        {
+            ERROR("Could not allocate page table buffer");
+            return -1;
+        }
+        b->ptpages = p;
+        b->max_ptpages = nr;
+    }
+
+    for ( p = b->ptpages, j = 0; j < b->batch; j++ )
+    {
+        if ( !pfn_type_is_pagetable(b->pfn_type[j]) )
+            continue;
+
+        pfn      = b->pfn_type[j] & ~XEN_DOMCTL_PFINFO_LTAB_MASK;
+        pagetype = b->pfn_type[j] &  XEN_DOMCTL_PFINFO_LTABTYPE_MASK;
+
+        if ( canonicalize_pagetable(pl->ctx, pagetype, pfn,
+                                    b->region_base + (PAGE_SIZE*j), p) &&
+             !pl->live )
+        {
+            ERROR("Fatal PT race (pfn %lx, type %08lx)", pfn, pagetype);
+            return -1;
+        }
+
+        p += PAGE_SIZE;
+    }
+
+    return 0;
+}
+
+/*
+** Emit a prepared batch: its size, its pfn_type[] and then its pages,
+** unless they are being compressed.
+*/
+static int save_batch_write(struct save_pipeline *pl, struct save_batch *b)
+{
+    xc_interface *xch = pl->xch;
+    int fd = pl->io_fd;
+    unsigned int batch = b->batch;
+    xen_pfn_t *pfn_type = b->pfn_type;
+    unsigned char *region_base = b->region_base;
+    char *ptpage = b->ptpages;
+    int j, run = 0;
+
+    if ( write_buffer(xch, b->last_iter, b->ob, fd,
+                      &batch, sizeof(unsigned int)) )
+    {
+        PERROR("Error when writing to state file (2)");
+        return -1;
+    }
+
+    if ( sizeof(unsigned long) < sizeof(*pfn_type) )
+        for ( j = 0; j < batch; j++ )
+            ((unsigned long *)pfn_type)[j] = pfn_type[j];
+    if ( write_buffer(xch, b->last_iter, b->ob, fd,
+                      pfn_type, sizeof(unsigned long)*batch) )
+    {
+        PERROR("Error when writing to state file (3)");
+        return -1;
+    }
+    if ( sizeof(unsigned long) < sizeof(*pfn_type) )
+        for ( j = batch - 1; j >= 0; j-- )
+            pfn_type[j] = ((unsigned long *)pfn_type)[j];
+
+    /* The pages are in the compression page buffer already. */
+    if ( b->compressing )
+        return 0;
+
+    /* entering this loop, pfn_type is now in pfns (Not mfns) */
+    for ( j = 0; j < batch; j++ )
+    {
+        unsigned long pagetype;
+
+        pagetype = pfn_type[j] &  XEN_DOMCTL_PFINFO_LTAB_MASK;
+
+        if ( pagetype != 0 )
+        {
+            /* If the page is not a normal data page, write out any
+               run of pages we may have previously acumulated */
+            if ( run )
+            {
+                if ( write_uncached(xch, b->last_iter, b->ob, fd,
+                                    (char*)region_base+(PAGE_SIZE*(j-run)),
+                                    PAGE_SIZE*run) != PAGE_SIZE*run )
+                {
+                    PERROR("Error when writing to state file (4a)"
+                          " (errno %d)", errno);
+                    return -1;
+                }
+                run = 0;
+            }
+        }
+
+        if ( !pfn_type_is_pagetable(pfn_type[j]) )
+        {
+            /*
+             * skip pages that aren't present,
+             * or are broken, or are alloc-only
+             */
+            if ( pagetype == XEN_DOMCTL_PFINFO_XTAB
+                || pagetype == XEN_DOMCTL_PFINFO_BROKEN
+                || pagetype == XEN_DOMCTL_PFINFO_XALLOC )
+                continue;
+
+            /* We have a normal page: accumulate it for writing. */
+            run++;
+            continue;
+        }
+
+        /* We have a pagetable page: send the rewritten copy. */
+        if ( write_uncached(xch, b->last_iter, b->ob, fd,
+                            ptpage, PAGE_SIZE) != PAGE_SIZE )
+        {
+            PERROR("Error when writing to state file (4b)"
+                  " (errno %d)", errno);
+            return -1;
+        }
+        ptpage += PAGE_SIZE;
+    } /* end of the write out for this batch */
+
+    if ( run )
+    {
+        /* write out the last accumulated run of pages */
+        if ( write_uncached(xch, b->last_iter, b->ob, fd,
+                            (char*)region_base+(PAGE_SIZE*(j-run)),
+                            PAGE_SIZE*run) != PAGE_SIZE*run )
+        {
+            PERROR("Error when writing to state file (4c)"
+                  " (errno %d)", errno);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* Return a written (or abandoned) batch to the free list.  Lock held. */
+static void save_batch_free(struct save_pipeline *pl, struct save_batch *b)
+{
+    b->region_base = NULL;
+    b->state = BATCH_FREE;
+    b->next = pl->free_list;
+    pl->free_list = b;
+}
+
+#ifndef __MINIOS__
+static void *save_worker(void *arg)
+{
+    struct save_pipeline *pl = arg;
+    struct save_batch *b;
+    int rc;
+
+    pthread_mutex_lock(&pl->lock);
+    for ( ; ; )
+    {
+        while ( !pl->mapped_head && !pl->exiting )
+            pipeline_wait(pl);
+        if ( !(b = pl->mapped_head) )
+            break;
+
+        if ( !(pl->mapped_head = b->next) )
+            pl->mapped_tail = &pl->mapped_head;
+        b->state = BATCH_PREPARING;
+
+        rc = 0;
+        if ( !pl->error )
+        {
+            pthread_mutex_unlock(&pl->lock);
+            rc = save_batch_prepare(pl, b);
+            pthread_mutex_lock(&pl->lock);
+        }
+
+        if ( rc )
+            pl->error = 1;
+        b->state = BATCH_PREPARED;
+        pipeline_wake(pl);
+    }
+    pthread_mutex_unlock(&pl->lock);
+
+    return NULL;
+}
+
+static void *save_writer(void *arg)
+{
+    struct save_pipeline *pl = arg;
+    struct save_batch *b;
+    unsigned int i;
+    int prepare, error, rc;
+
+    pthread_mutex_lock(&pl->lock);
+    for ( ; ; )
+    {
+        for ( b = NULL, i = 0; i < pl->nr_batches && !b; i++ )
+            if ( pl->batches[i].state != BATCH_FREE &&
+                 pl->batches[i].seq == pl->write_seq )
+                b = &pl->batches[i];
+
+        if ( !b || b->state == BATCH_PREPARING )
+        {
+            if ( !b && pl->exiting )
+                break;
+            pipeline_wait(pl);
+            continue;
+        }
+
+        /*
+         * If no worker has picked up the next batch in the stream yet (or
+         * there are no workers), don't wait: prepare it here.  Being the
+         * oldest batch in flight, it is at the head of the queue.
+         */
+        prepare = (b->state == BATCH_MAPPED);
+        if ( prepare )
+        {
+            if ( !(pl->mapped_head = b->next) )
+                pl->mapped_tail = &pl->mapped_head;
+            b->state = BATCH_PREPARING;
+        }
+        error = pl->error;
+        pthread_mutex_unlock(&pl->lock);
+
+        rc = 0;
+        if ( !error )
+        {
+            if ( prepare )
+                rc = save_batch_prepare(pl, b);
+            if ( !rc )
+                rc = save_batch_write(pl, b);
+        }
+        munmap(b->region_base, b->batch * PAGE_SIZE);
+
+        pthread_mutex_lock(&pl->lock);
+        if ( rc )
+            pl->error = 1;
+        save_batch_free(pl, b);
+        pl->write_seq++;
+        pl->in_flight--;
+        pipeline_wake(pl);
+    }
+    pthread_mutex_unlock(&pl->lock);
+
+    return NULL;
+}
+#endif /* !__MINIOS__ */
+
+static void save_pipeline_destroy(struct save_pipeline *pl)
+{
+    unsigned int i;
+
+    if ( pl == NULL )
+        return;
+
+#ifndef __MINIOS__
+    if ( pl->threaded )
+    {
+        pthread_mutex_lock(&pl->lock);
+        pl->exiting = 1;
+        pipeline_wake(pl);
+        pthread_mutex_unlock(&pl->lock);
+
+        for ( i = 0; i < pl->nr_workers; i++ )
+            pthread_join(pl->workers[i], NULL);
+        pthread_join(pl->writer, NULL);
+    }
+
+    pthread_cond_destroy(&pl->cond);
+    free(pl->workers);
+#endif
+
+    for ( i = 0; i < pl->nr_batches; i++ )
+    {
+        free(pl->batches[i].pfn_type);
+        free(pl->batches[i].pfn_batch);
+        free(pl->batches[i].pfn_err);
+        free(pl->batches[i].ptpages);
+        free(pl->batches[i].compslots);
+    }
+    free(pl->batches);
+    free(pl);
+}
+
+static struct save_pipeline *save_pipeline_create(
+    xc_interface *xch, struct save_ctx *ctx, comp_ctx *compress_ctx,
+    int io_fd, int live, unsigned int nr_workers)
+{
+    struct save_pipeline *pl;
+    struct save_batch *b;
+    unsigned int i;
+
+    if ( (pl = calloc(1, sizeof(*pl))) == NULL )
+        return NULL;
+
+    pl->xch = xch;
+    pl->ctx = ctx;
+    pl->compress_ctx = compress_ctx;
+    pl->io_fd = io_fd;
+    pl->live = live;
+    pl->mapped_tail = &pl->mapped_head;
+    pthread_mutex_init(&pl->lock, NULL);
+#ifndef __MINIOS__
+    pthread_cond_init(&pl->cond, NULL);
+    if ( nr_workers &&
+         (pl->workers = calloc(nr_workers, sizeof(*pl->workers))) == NULL )
+        goto fail;
+#endif
+
+    /* One batch being mapped, one being written, and some slack. */
+    pl->nr_batches = nr_workers + 3;
+    if ( (pl->batches = calloc(pl->nr_batches, sizeof(*pl->batches))) == NULL )
+        goto fail;
+
+    for ( i = 0; i < pl->nr_batches; i++ )
+    {
+        b = &pl->batches[i];
+        b->pfn_type  = calloc(1, ROUNDUP(MAX_BATCH_SIZE * sizeof(*b->pfn_type),
+                                         PAGE_SHIFT));
+        b->pfn_batch = calloc(MAX_BATCH_SIZE, sizeof(*b->pfn_batch));
+        b->pfn_err   = malloc(MAX_BATCH_SIZE * sizeof(*b->pfn_err));
+        b->compslots = malloc(MAX_BATCH_SIZE * sizeof(*b->compslots));
+        if ( (b->pfn_type == NULL) || (b->pfn_batch == NULL) ||
+             (b->pfn_err == NULL) || (b->compslots == NULL) )
+            goto fail;
+        save_batch_free(pl, b);
+    }
+
+#ifndef __MINIOS__
+    if ( pthread_create(&pl->writer, NULL, save_writer, pl) )
+    {
+        DPRINTF("Could not start writer thread, saving synchronously\n");
+        return pl;
+    }
+    pl->threaded = 1;
+
+    for ( i = 0; i < nr_workers; i++ )
+    {
+        if ( pthread_create(&pl->workers[i], NULL, save_worker, pl) )
+        {
+            DPRINTF("Could only start %u of %u worker threads\n",
+                    i, nr_workers);
+            break;
+        }
+        pl->nr_workers++;
+    }
+#endif
+
+    return pl;
+
+ fail:
+    save_pipeline_destroy(pl);
+    return NULL;
+}
+
+/*
+** The batch which the main thread is to fill in next.  Waits for one to be
+** written if they are all in use.  Returns NULL if the pipeline has failed.
+*/
+static struct save_batch *save_pipeline_get(struct save_pipeline *pl)
+{
+    struct save_batch *b;
+
+    pthread_mutex_lock(&pl->lock);
+    while ( !pl->cur && !pl->error )
+    {
+        if ( (pl->cur = pl->free_list) != NULL )
+            pl->free_list = pl->cur->next;
+        else
+            pipeline_wait(pl);
+    }
+    b = pl->error ? NULL : pl->cur;
+    pthread_mutex_unlock(&pl->lock);
+
+    return b;
+}
+
+/* Wait until every submitted batch has gone to the stream. */
+static int save_pipeline_drain(struct save_pipeline *pl)
+{
+    int rc;
+
+    pthread_mutex_lock(&pl->lock);
+    while ( pl->in_flight )
+        pipeline_wait(pl);
+    rc = pl->error ? -1 : 0;
+    pthread_mutex_unlock(&pl->lock);
+
+    return rc;
+}
+
+/*
+** Reserve places in the compression page buffer for the pages of the
+** current batch, in stream order.  If the buffer fills up, the batches
+** already submitted are drained and the buffer is compressed to the stream,
+** which is a corner case that slows down checkpointing, as it happens while
+** the domain is suspended.  If it happens frequently, increase
+** PAGE_BUFFER_SIZE in xc_compression.c.
+*/
+static int save_batch_claim(struct save_pipeline *pl, struct save_batch *b)
+{
+    xc_interface *xch = pl->xch;
+    unsigned long pfn, pagetype;
+    unsigned int j;
+    int c_err;
+
+    for ( j = 0; j < b->batch; j++ )
+    {
+        pfn      = b->pfn_type[j] & ~XEN_DOMCTL_PFINFO_LTAB_MASK;
+        pagetype = b->pfn_type[j] &  XEN_DOMCTL_PFINFO_LTAB_MASK;
+
+        b->compslots[j] = NULL;
+        if ( pagetype == XEN_DOMCTL_PFINFO_XTAB
+             || pagetype == XEN_DOMCTL_PFINFO_BROKEN
+             || pagetype == XEN_DOMCTL_PFINFO_XALLOC )
+            continue;
+
+        /* Page tables are sent raw. */
+        while ( (c_err = xc_compression_claim_page(
+                     xch, pl->compress_ctx, pfn,
+                     pfn_type_is_pagetable(b->pfn_type[j]),
+                     &b->compslots[j])) == -1 )
+        {
+            if ( save_pipeline_drain(pl) )
+                return -1;
+            if ( write_compressed(xch, pl->compress_ctx, b->last_iter,
+                                  b->ob, pl->io_fd) < 0 )
+            {
+                ERROR("Error when writing compressed data (4b)\n");
+                return -1;
+            }
+        }
+
+        if ( c_err == -2 ) /* OOB PFN */
+        {
+            ERROR("Could not add page "
+                  "(pfn:%" PRIpfn "to page buffer\n", pfn);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* Hand the current batch, now mapped, on to be prepared and written. */
+static int save_pipeline_submit(struct save_pipeline *pl, int last_iter,
+                                int compressing, struct outbuf *ob)
+{
+    struct save_batch *b = pl->cur;
+    int rc;
+
+    b->last_iter = last_iter;
+    b->compressing = compressing;
+    b->ob = ob;
+
+    if ( compressing && save_batch_claim(pl, b) )
+    {
+        munmap(b->region_base, b->batch * PAGE_SIZE);
+        b->region_base = NULL;
+        pthread_mutex_lock(&pl->lock);
+        pl->error = 1;
+        pthread_mutex_unlock(&pl->lock);
+        return -1;
+    }
+
+    if ( !pl->threaded )
+    {
+        rc = save_batch_prepare(pl, b);
+        if ( !rc )
+            rc = save_batch_write(pl, b);
+        munmap(b->region_base, b->batch * PAGE_SIZE);
+        b->region_base = NULL;
+        if ( rc )
+            pl->error = 1;
+        return rc;
+    }
+
+    pthread_mutex_lock(&pl->lock);
+    pl->cur = NULL;
+    b->seq = pl->next_seq++;
+    b->state = BATCH_MAPPED;
+    b->next = NULL;
+    *pl->mapped_tail = b;
+    pl->mapped_tail = &b->next;
+    pl->in_flight++;
+    pipeline_wake(pl);
+    rc = pl->error ? -1 : 0;
+    pthread_mutex_unlock(&pl->lock);
+
+    return rc;
+}
+
 int xc_domain_save(xc_interface *xch, int io_fd, uint32_t dom, uint32_t max_iters,
                    uint32_t max_factor, uint32_t flags,
                    struct save_callbacks* callbacks, int hvm,
@@ -814,7 +1457,7 @@ int xc_domain_save(xc_interface *xch, int io_fd, uint32_t dom, uint32_t max_iter
     int live  = (flags & XCFLAGS_LIVE);
     int debug = (flags & XCFLAGS_DEBUG);
     int superpages = !!hvm;
-    int race = 0, sent_last_iter, skip_this_iter = 0;
+    int sent_last_iter, skip_this_iter = 0;
     unsigned int sent_this_iter = 0;
     int tmem_saved = 0;
 
@@ -838,6 +1481,11 @@ int xc_domain_save(xc_interface *xch, int io_fd, uint32_t dom, uint32_t max_iter
     /* base of the region in which domain memory is mapped */
     unsigned char *region_base = NULL;
 
+    /* Batches on their way to the stream, and the one being filled in */
+    struct save_pipeline *pl = NULL;
+    struct save_batch *b;
+    unsigned int nr_workers;
+
     /* A copy of the CPU eXtended States of the guest. */
     DECLARE_HYPERCALL_BUFFER(void, buffer);
 
@@ -1039,17 +1687,21 @@ int xc_domain_save(xc_interface *xch, int io_fd, uint32_t dom, uint32_t max_iter
 
     analysis_phase(xch, dom, ctx, HYPERCALL_BUFFER(to_skip), 0);
 
-    pfn_type   = malloc(ROUNDUP(MAX_BATCH_SIZE * sizeof(*pfn_type), PAGE_SHIFT));
-    pfn_batch  = calloc(MAX_BATCH_SIZE, sizeof(*pfn_batch));
-    pfn_err    = malloc(MAX_BATCH_SIZE * sizeof(*pfn_err));
-    if ( (pfn_type == NULL) || (pfn_batch == NULL) || (pfn_err == NULL) )
+    nr_workers = (flags & XCFLAGS_WORKERS_MASK) >> XCFLAGS_WORKERS_SHIFT;
+    nr_workers = nr_workers ? : DEF_SAVE_WORKERS;
+    if ( nr_workers > MAX_SAVE_WORKERS )
+        nr_workers = MAX_SAVE_WORKERS;
+    /* Without compression, HVM batches have nothing to be prepared. */
+    if ( hvm && !(flags & XCFLAGS_CHECKPOINT_COMPRESS) )
+        nr_workers = 0;
+
+    pl = save_pipeline_create(xch, ctx, compress_ctx, io_fd, live, nr_workers);
+    if ( pl == NULL )
     {
         ERROR("failed to alloc memory for pfn_type and/or pfn_batch arrays");
         errno = ENOMEM;
         goto out;
     }
-    memset(pfn_type, 0,
-           ROUNDUP(MAX_BATCH_SIZE * sizeof(*pfn_type), PAGE_SHIFT));
 
     /* Setup the mfn_to_pfn table mapping */
     if ( !(ctx->live_m2p = xc_map_m2p(xch, ctx->max_mfn, PROT_READ, &ctx->m2p_mfn0)) )
@@ -1150,6 +1802,15 @@ int xc_domain_save(xc_interface *xch, int io_fd, uint32_t dom, uint32_t max_iter
                 }
             }
 
+            if ( (b = save_pipeline_get(pl)) == NULL )
+            {
+                ERROR("Error when writing to state file (pages)");
+                goto out;
+            }
+            pfn_type  = b->pfn_type;
+            pfn_batch = b->pfn_batch;
+            pfn_err   = b->pfn_err;
+
             /* load pfn_type[] with the mfn of all the pages we're doing in
                this batch. */
             for  ( batch = 0;
@@ -1332,173 +1993,28 @@ int xc_domain_save(xc_interface *xch, int io_fd, uint32_t dom, uint32_t max_iter
                 continue; /* bail on this batch: no valid pages */
             }
 
-            if ( wrexact(io_fd, &batch, sizeof(unsigned int)) )
-            {
-                PERROR("Error when writing to state file (2)");
-                goto out;
-            }
-
-            if ( sizeof(unsigned long) < sizeof(*pfn_type) )
-                for ( j = 0; j < batch; j++ )
-                    ((unsigned long *)pfn_type)[j] = pfn_type[j];
-            if ( wrexact(io_fd, pfn_type, sizeof(unsigned long)*batch) )
+            /* Page tables get canonicalised (or pages copied for
+               compression) as the batch is prepared. */
+            b->region_base = region_base;
+            b->batch = batch;
+            if ( save_pipeline_submit(pl, last_iter, compressing, ob) )
             {
-                PERROR("Error when writing to state file (3)");
+                ERROR("Error when writing to state file (pages)");
                 goto out;
             }
-            if ( sizeof(unsigned long) < sizeof(*pfn_type) )
-                while ( --j >= 0 )
-                    pfn_type[j] = ((unsigned long *)pfn_type)[j];
-
-            /* entering this loop, pfn_type is now in pfns (Not mfns) */
-            run = 0;
-            for ( j = 0; j < batch; j++ )
-            {
-                unsigned long pfn, pagetype;
-                void *spage = (char *)region_base + (PAGE_SIZE*j);
-
-                pfn      = pfn_type[j] & ~XEN_DOMCTL_PFINFO_LTAB_MASK;
-                pagetype = pfn_type[j] &  XEN_DOMCTL_PFINFO_LTAB_MASK;
-
-                if ( pagetype != 0 )
-                {
-                    /* If the page is not a normal data page, write out any
-                       run of pages we may have previously acumulated */
-                    if ( !compressing && run )
-                    {
-                        if ( wruncached(io_fd, live,
-                                       (char*)region_base+(PAGE_SIZE*(j-run)), 
-                                       PAGE_SIZE*run) != PAGE_SIZE*run )
-                        {
-                            PERROR("Error when writing to state file (4a)"
-                                  " (errno %d)", errno);
-                            goto out;
-                        }                        
-                        run = 0;
-                    }
-                }
-
-                /*
-                 * skip pages that aren't present,
-                 * or are broken, or are alloc-only
-                 */
-                if ( pagetype == XEN_DOMCTL_PFINFO_XTAB
-                    || pagetype == XEN_DOMCTL_PFINFO_BROKEN
-                    || pagetype == XEN_DOMCTL_PFINFO_XALLOC )
-                    continue;
-
-                pagetype &= XEN_DOMCTL_PFINFO_LTABTYPE_MASK;
-
-                if ( (pagetype >= XEN_DOMCTL_PFINFO_L1TAB) &&
-                     (pagetype <= XEN_DOMCTL_PFINFO_L4TAB) )
-                {
-                    /* We have a pagetable page: need to rewrite it. */
-                    race = 
-                        canonicalize_pagetable(ctx, pagetype, pfn, spage, page); 
-
-                    if ( race && !live )
-                    {
-                        ERROR("Fatal PT race (pfn %lx, type %08lx)", pfn,
-                              pagetype);
-                        goto out;
-                    }
-
-                    if (compressing)
-                    {
-                        int c_err;
-                        /* Mark pagetable page to be sent uncompressed */
-                        c_err = xc_compression_add_page(xch, compress_ctx, page,
-                                                        pfn, 1 /* raw page */);
-                        if (c_err == -2) /* OOB PFN */
-                        {
-                            ERROR("Could not add pagetable page "
-                                  "(pfn:%" PRIpfn "to page buffer\n", pfn);
-                            goto out;
-                        }
-
-                        if (c_err == -1)
-                        {
-                            /*
-                             * We are out of buffer space to hold dirty
-                             * pages. Compress and flush the current buffer
-                             * to make space. This is a corner case, that
-                             * slows down checkpointing as the compression
-                             * happens while domain is suspended. Happens
-                             * seldom and if you find this occuring
-                             * frequently, increase the PAGE_BUFFER_SIZE
-                             * in xc_compression.c.
-                             */
-                            if (wrcompressed(io_fd) < 0)
-                            {
-                                ERROR("Error when writing compressed"
-                                      " data (4b)\n");
-                                goto out;
-                            }
-                        }
-                    }
-                    else if ( wruncached(io_fd, live, page,
-                                         PAGE_SIZE) != PAGE_SIZE )
-                    {
-                        PERROR("Error when writing to state file (4b)"
-                              " (errno %d)", errno);
-                        goto out;
-                    }
-                }
-                else
-                {
-                    /* We have a normal page: accumulate it for writing. */
-                    if (compressing)
-                    {
-                        int c_err;
-                        /* For checkpoint compression, accumulate the page in the
-                         * page buffer, to be compressed later.
-                         */
-                        c_err = xc_compression_add_page(xch, compress_ctx, spage,
-                                                        pfn, 0 /* not raw page */);
-
-                        if (c_err == -2) /* OOB PFN */
-                        {
-                            ERROR("Could not add page "
-                                  "(pfn:%" PRIpfn "to page buffer\n", pfn);
-                            goto out;
-                        }
-
-                        if (c_err == -1)
-                        {
-                            if (wrcompressed(io_fd) < 0)
-                            {
-                                ERROR("Error when writing compressed"
-                                      " data (4c)\n");
-                                goto out;
-                            }
-                        }
-                    }
-                    else
-                        run++;
-                }
-            } /* end of the write out for this batch */
-
-            if ( run )
-            {
-                /* write out the last accumulated run of pages */
-                if ( wruncached(io_fd, live,
-                               (char*)region_base+(PAGE_SIZE*(j-run)), 
-                               PAGE_SIZE*run) != PAGE_SIZE*run )
-                {
-                    PERROR("Error when writing to state file (4c)"
-                          " (errno %d)", errno);
-                    goto out;
-                }                        
-            }
 
             sent_this_iter += batch;
 
-            munmap(region_base, batch*PAGE_SIZE);
-
         } /* end of this while loop for this iteration */
 
       skip:
 
+        if ( save_pipeline_drain(pl) )
+        {
+            ERROR("Error when writing to state file (pages)");
+            goto out;
+        }
+
         xc_report_progress_step(xch, dinfo->p2m_size, dinfo->p2m_size);
 
         total_sent += sent_this_iter;
@@ -1687,6 +2203,30 @@ int xc_domain_save(xc_interface *xch, int io_fd, uint32_t dom, uint32_t max_iter
             goto out;
         }
 
+        chunk.id = XC_SAVE_ID_HVM_IOREQ_SERVER_PFN;
+        chunk.data = 0;
+        xc_get_hvm_param(xch, dom, HVM_PARAM_IOREQ_SERVER_PFN,
+                         (unsigned long *)&chunk.data);
+
+        if ( (chunk.data != 0) &&
+             wrexact(io_fd, &chunk, sizeof(chunk)) )
+        {
+            PERROR("Error when writing the ioreq server pfn for guest");
+            goto out;
+        }
+
+        chunk.id = XC_SAVE_ID_HVM_NR_IOREQ_SERVER_PAGES;
+        chunk.data = 0;
+        xc_get_hvm_param(xch, dom, HVM_PARAM_NR_IOREQ_SERVER_PAGES,
+                         (unsigned long *)&chunk.data);
+
+        if ( (chunk.data != 0) &&
+             wrexact(io_fd, &chunk, sizeof(chunk)) )
+        {
+            PERROR("Error when writing the ioreq server pages for guest");
+            goto out;
+        }
+
         chunk.id = XC_SAVE_ID_HVM_VM86_TSS;
         chunk.data = 0;
         xc_get_hvm_param(xch, dom, HVM_PARAM_VM86_TSS,
@@ -2034,6 +2574,9 @@ int xc_domain_save(xc_interface *xch, int io_fd, uint32_t dom, uint32_t max_iter
  out:
     completed = 1;
 
+    if ( pl && save_pipeline_drain(pl) )
+        rc = 1;
+
     if ( !rc && callbacks->postcopy )
         callbacks->postcopy(callbacks->data);
 
@@ -2125,9 +2668,7 @@ int xc_domain_save(xc_interface *xch, int io_fd, uint32_t dom, uint32_t max_iter
     xc_hypercall_buffer_free_pages(xch, to_send, NRPAGES(bitmap_size(dinfo->p2m_size)));
     xc_hypercall_buffer_free_pages(xch, to_skip, NRPAGES(bitmap_size(dinfo->p2m_size)));
 
-    free(pfn_type);
-    free(pfn_batch);
-    free(pfn_err);
+    save_pipeline_destroy(pl);
     free(to_fix);
 
     DPRINTF("Save exit rc=%d\n",rc);
@@ -63,6 +63,47 @@ int xc_mem_paging_evict(xc_interface *xch, domid_t domain_id, unsigned long gfn)
                                 gfn, NULL);
 }
 
+static int xc_mem_paging_batch(xc_interface *xch, domid_t domain_id,
+                               unsigned int op,
+                               xen_mem_paging_batch_t *batch, unsigned int nr)
+{
+    size_t size = nr * sizeof(*batch);
+    int rc, old_errno;
+
+    if ( nr > XENMEM_paging_batch_max )
+    {
+        errno = E2BIG;
+        return -1;
+    }
+
+    if ( mlock(batch, size) )
+        return -1;
+
+    rc = xc_mem_event_memop(xch, domain_id, op, XENMEM_paging_op,
+                            nr, batch);
+
+    old_errno = errno;
+    munlock(batch, size);
+    errno = old_errno;
+
+    return rc;
+}
+
+int xc_mem_paging_nominate_batch(xc_interface *xch, domid_t domain_id,
+                                 xen_mem_paging_batch_t *batch,
+                                 unsigned int nr)
+{
+    return xc_mem_paging_batch(xch, domain_id,
+                               XENMEM_paging_op_nominate_batch, batch, nr);
+}
+
+int xc_mem_paging_evict_batch(xc_interface *xch, domid_t domain_id,
+                              xen_mem_paging_batch_t *batch, unsigned int nr)
+{
+    return xc_mem_paging_batch(xch, domain_id,
+                               XENMEM_paging_op_evict_batch, batch, nr);
+}
+
 int xc_mem_paging_prep(xc_interface *xch, domid_t domain_id, unsigned long gfn)
 {
     return xc_mem_event_memop(xch, domain_id,
@@ -243,3 +243,8 @@ long xc_sharing_used_frames(xc_interface *xch)
     return do_memory_op(xch, XENMEM_get_sharing_shared_pages, NULL, 0);
 }
 
+long xc_sharing_cow_breaks(xc_interface *xch)
+{
+    return do_memory_op(xch, XENMEM_get_sharing_cow_breaks, NULL, 0);
+}
+
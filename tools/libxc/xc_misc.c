@@ -312,6 +312,63 @@ int xc_lockprof_query(xc_interface *xch,
     return rc;
 }
 
+static int xc_lockprof_sample_op(xc_interface *xch, uint32_t cmd,
+                                 uint32_t period)
+{
+    DECLARE_SYSCTL;
+
+    sysctl.cmd = XEN_SYSCTL_lockprof_op;
+    sysctl.u.lockprof_op.cmd = cmd;
+    sysctl.u.lockprof_op.period = period;
+    set_xen_guest_handle(sysctl.u.lockprof_op.data, HYPERCALL_BUFFER_NULL);
+    set_xen_guest_handle(sysctl.u.lockprof_op.samples, HYPERCALL_BUFFER_NULL);
+
+    return do_sysctl(xch, &sysctl);
+}
+
+int xc_lockprof_sample_enable(xc_interface *xch, uint32_t period)
+{
+    return xc_lockprof_sample_op(xch, XEN_SYSCTL_LOCKPROF_sample_enable,
+                                 period);
+}
+
+int xc_lockprof_sample_disable(xc_interface *xch)
+{
+    return xc_lockprof_sample_op(xch, XEN_SYSCTL_LOCKPROF_sample_disable, 0);
+}
+
+int xc_lockprof_sample_reset(xc_interface *xch)
+{
+    return xc_lockprof_sample_op(xch, XEN_SYSCTL_LOCKPROF_sample_reset, 0);
+}
+
+int xc_lockprof_sample_query(xc_interface *xch,
+                             uint32_t *n_elems,
+                             uint32_t *period,
+                             uint32_t *dropped,
+                             uint64_t *time,
+                             struct xc_hypercall_buffer *samples)
+{
+    int rc;
+    DECLARE_SYSCTL;
+    DECLARE_HYPERCALL_BUFFER_ARGUMENT(samples);
+
+    sysctl.cmd = XEN_SYSCTL_lockprof_op;
+    sysctl.u.lockprof_op.cmd = XEN_SYSCTL_LOCKPROF_sample_query;
+    sysctl.u.lockprof_op.max_elem = *n_elems;
+    set_xen_guest_handle(sysctl.u.lockprof_op.data, HYPERCALL_BUFFER_NULL);
+    set_xen_guest_handle(sysctl.u.lockprof_op.samples, samples);
+
+    rc = do_sysctl(xch, &sysctl);
+
+    *n_elems = sysctl.u.lockprof_op.nr_elem;
+    *period = sysctl.u.lockprof_op.period;
+    *dropped = sysctl.u.lockprof_op.dropped;
+    *time = sysctl.u.lockprof_op.time;
+
+    return rc;
+}
+
 int xc_getcpuinfo(xc_interface *xch, int max_cpus,
                   xc_cpuinfo_t *info, int *nr_cpus)
 {
@@ -460,6 +517,175 @@ int xc_hvm_inject_msi(
     return rc;
 }
 
+int xc_hvm_create_ioreq_server(
+    xc_interface *xch, domid_t dom, int handle_bufioreq, ioservid_t *id)
+{
+    DECLARE_HYPERCALL;
+    DECLARE_HYPERCALL_BUFFER(struct xen_hvm_create_ioreq_server, arg);
+    int rc;
+
+    arg = xc_hypercall_buffer_alloc(xch, arg, sizeof(*arg));
+    if ( arg == NULL )
+    {
+        PERROR("Could not allocate memory for xc_hvm_create_ioreq_server hypercall");
+        return -1;
+    }
+
+    hypercall.op     = __HYPERVISOR_hvm_op;
+    hypercall.arg[0] = HVMOP_create_ioreq_server;
+    hypercall.arg[1] = HYPERCALL_BUFFER_AS_ARG(arg);
+
+    arg->domid = dom;
+    arg->handle_bufioreq = !!handle_bufioreq;
+
+    rc = do_xen_hypercall(xch, &hypercall);
+    if ( rc == 0 )
+        *id = arg->id;
+
+    xc_hypercall_buffer_free(xch, arg);
+
+    return rc;
+}
+
+int xc_hvm_get_ioreq_server_info(
+    xc_interface *xch, domid_t dom, ioservid_t id, xen_pfn_t *ioreq_pfn,
+    xen_pfn_t *bufioreq_pfn, evtchn_port_t *bufioreq_port)
+{
+    DECLARE_HYPERCALL;
+    DECLARE_HYPERCALL_BUFFER(struct xen_hvm_get_ioreq_server_info, arg);
+    int rc;
+
+    arg = xc_hypercall_buffer_alloc(xch, arg, sizeof(*arg));
+    if ( arg == NULL )
+    {
+        PERROR("Could not allocate memory for xc_hvm_get_ioreq_server_info hypercall");
+        return -1;
+    }
+
+    hypercall.op     = __HYPERVISOR_hvm_op;
+    hypercall.arg[0] = HVMOP_get_ioreq_server_info;
+    hypercall.arg[1] = HYPERCALL_BUFFER_AS_ARG(arg);
+
+    arg->domid = dom;
+    arg->id = id;
+
+    rc = do_xen_hypercall(xch, &hypercall);
+    if ( rc == 0 )
+    {
+        *ioreq_pfn = arg->ioreq_pfn;
+        if ( bufioreq_pfn )
+            *bufioreq_pfn = arg->bufioreq_pfn;
+        if ( bufioreq_port )
+            *bufioreq_port = arg->bufioreq_port;
+    }
+
+    xc_hypercall_buffer_free(xch, arg);
+
+    return rc;
+}
+
+static int xc_hvm_io_range_op(
+    xc_interface *xch, unsigned long op, domid_t dom, ioservid_t id,
+    uint32_t type, uint64_t start, uint64_t end)
+{
+    DECLARE_HYPERCALL;
+    DECLARE_HYPERCALL_BUFFER(struct xen_hvm_io_range, arg);
+    int rc;
+
+    arg = xc_hypercall_buffer_alloc(xch, arg, sizeof(*arg));
+    if ( arg == NULL )
+    {
+        PERROR("Could not allocate memory for ioreq server range hypercall");
+        return -1;
+    }
+
+    hypercall.op     = __HYPERVISOR_hvm_op;
+    hypercall.arg[0] = op;
+    hypercall.arg[1] = HYPERCALL_BUFFER_AS_ARG(arg);
+
+    arg->domid = dom;
+    arg->id = id;
+    arg->type = type;
+    arg->start = start;
+    arg->end = end;
+
+    rc = do_xen_hypercall(xch, &hypercall);
+
+    xc_hypercall_buffer_free(xch, arg);
+
+    return rc;
+}
+
+int xc_hvm_map_io_range_to_ioreq_server(
+    xc_interface *xch, domid_t dom, ioservid_t id, int is_mmio,
+    uint64_t start, uint64_t end)
+{
+    return xc_hvm_io_range_op(xch, HVMOP_map_io_range_to_ioreq_server,
+                              dom, id,
+                              is_mmio ? HVMOP_IO_RANGE_MEMORY
+                                      : HVMOP_IO_RANGE_PORT,
+                              start, end);
+}
+
+int xc_hvm_unmap_io_range_from_ioreq_server(
+    xc_interface *xch, domid_t dom, ioservid_t id, int is_mmio,
+    uint64_t start, uint64_t end)
+{
+    return xc_hvm_io_range_op(xch, HVMOP_unmap_io_range_from_ioreq_server,
+                              dom, id,
+                              is_mmio ? HVMOP_IO_RANGE_MEMORY
+                                      : HVMOP_IO_RANGE_PORT,
+                              start, end);
+}
+
+int xc_hvm_map_pcidev_to_ioreq_server(
+    xc_interface *xch, domid_t dom, ioservid_t id, uint16_t segment,
+    uint8_t bus, uint8_t device, uint8_t function)
+{
+    uint64_t sbdf = HVMOP_PCI_SBDF(segment, bus, device, function);
+
+    return xc_hvm_io_range_op(xch, HVMOP_map_io_range_to_ioreq_server,
+                              dom, id, HVMOP_IO_RANGE_PCI, sbdf, sbdf);
+}
+
+int xc_hvm_unmap_pcidev_from_ioreq_server(
+    xc_interface *xch, domid_t dom, ioservid_t id, uint16_t segment,
+    uint8_t bus, uint8_t device, uint8_t function)
+{
+    uint64_t sbdf = HVMOP_PCI_SBDF(segment, bus, device, function);
+
+    return xc_hvm_io_range_op(xch, HVMOP_unmap_io_range_from_ioreq_server,
+                              dom, id, HVMOP_IO_RANGE_PCI, sbdf, sbdf);
+}
+
+int xc_hvm_destroy_ioreq_server(
+    xc_interface *xch, domid_t dom, ioservid_t id)
+{
+    DECLARE_HYPERCALL;
+    DECLARE_HYPERCALL_BUFFER(struct xen_hvm_destroy_ioreq_server, arg);
+    int rc;
+
+    arg = xc_hypercall_buffer_alloc(xch, arg, sizeof(*arg));
+    if ( arg == NULL )
+    {
+        PERROR("Could not allocate memory for xc_hvm_destroy_ioreq_server hypercall");
+        return -1;
+    }
+
+    hypercall.op     = __HYPERVISOR_hvm_op;
+    hypercall.arg[0] = HVMOP_destroy_ioreq_server;
+    hypercall.arg[1] = HYPERCALL_BUFFER_AS_ARG(arg);
+
+    arg->domid = dom;
+    arg->id = id;
+
+    rc = do_xen_hypercall(xch, &hypercall);
+
+    xc_hypercall_buffer_free(xch, arg);
+
+    return rc;
+}
+
 int xc_hvm_track_dirty_vram(
     xc_interface *xch, domid_t dom,
     uint64_t first_pfn, uint64_t nr,
@@ -1196,6 +1196,22 @@ int xc_lockprof_query(xc_interface *xch,
                       uint64_t *time,
                       xc_hypercall_buffer_t *data);
 
+/* Runtime lock contention sampling, one in every period acquisitions. */
+typedef xen_sysctl_lock_sample_t xc_lock_sample_t;
+int xc_lockprof_sample_enable(xc_interface *xch, uint32_t period);
+int xc_lockprof_sample_disable(xc_interface *xch);
+int xc_lockprof_sample_reset(xc_interface *xch);
+/*
+ * On entry *n_elems is the size of the samples buffer; on return it is the
+ * number of samples available.  *period is 0 if sampling is disabled.
+ */
+int xc_lockprof_sample_query(xc_interface *xch,
+                             uint32_t *n_elems,
+                             uint32_t *period,
+                             uint32_t *dropped,
+                             uint64_t *time,
+                             xc_hypercall_buffer_t *samples);
+
 void *xc_memalign(xc_interface *xch, size_t alignment, size_t size);
 
 /**
@@ -1562,6 +1578,34 @@ int xc_hvm_set_pci_link_route(
 int xc_hvm_inject_msi(
     xc_interface *xch, domid_t dom, uint64_t addr, uint32_t data);
 
+/*
+ * Secondary ioreq servers: an emulator creates one for the domain it
+ * serves, maps the pages from xc_hvm_get_ioreq_server_info() with
+ * xc_map_foreign_range(), binds the event channels in the ioreq page (and
+ * *bufioreq_port, if it asked for buffered ioreqs) and then claims the
+ * ranges it emulates.  Everything it doesn't claim still goes to the
+ * default device model.
+ */
+int xc_hvm_create_ioreq_server(
+    xc_interface *xch, domid_t dom, int handle_bufioreq, ioservid_t *id);
+int xc_hvm_get_ioreq_server_info(
+    xc_interface *xch, domid_t dom, ioservid_t id, xen_pfn_t *ioreq_pfn,
+    xen_pfn_t *bufioreq_pfn, evtchn_port_t *bufioreq_port);
+int xc_hvm_map_io_range_to_ioreq_server(
+    xc_interface *xch, domid_t dom, ioservid_t id, int is_mmio,
+    uint64_t start, uint64_t end);
+int xc_hvm_unmap_io_range_from_ioreq_server(
+    xc_interface *xch, domid_t dom, ioservid_t id, int is_mmio,
+    uint64_t start, uint64_t end);
+int xc_hvm_map_pcidev_to_ioreq_server(
+    xc_interface *xch, domid_t dom, ioservid_t id, uint16_t segment,
+    uint8_t bus, uint8_t device, uint8_t function);
+int xc_hvm_unmap_pcidev_from_ioreq_server(
+    xc_interface *xch, domid_t dom, ioservid_t id, uint16_t segment,
+    uint8_t bus, uint8_t device, uint8_t function);
+int xc_hvm_destroy_ioreq_server(
+    xc_interface *xch, domid_t dom, ioservid_t id);
+
 /*
  * Track dirty bit changes in the VRAM area
  *
@@ -1915,6 +1959,15 @@ int xc_mem_paging_disable(xc_interface *xch, domid_t domain_id);
 int xc_mem_paging_nominate(xc_interface *xch, domid_t domain_id,
                            unsigned long gfn);
 int xc_mem_paging_evict(xc_interface *xch, domid_t domain_id, unsigned long gfn);
+/*
+ * Nominate or evict up to XENMEM_paging_batch_max gfns in one hypercall.
+ * batch[i].rc gets the result for each gfn, as -errno.
+ */
+int xc_mem_paging_nominate_batch(xc_interface *xch, domid_t domain_id,
+                                 xen_mem_paging_batch_t *batch,
+                                 unsigned int nr);
+int xc_mem_paging_evict_batch(xc_interface *xch, domid_t domain_id,
+                              xen_mem_paging_batch_t *batch, unsigned int nr);
 int xc_mem_paging_prep(xc_interface *xch, domid_t domain_id, unsigned long gfn);
 int xc_mem_paging_load(xc_interface *xch, domid_t domain_id, 
                         unsigned long gfn, void *buffer);
@@ -2139,6 +2192,12 @@ long xc_sharing_freed_pages(xc_interface *xch);
  * applies to some of the pages counted in dominfo(d)->shr_pages.
  */
 long xc_sharing_used_frames(xc_interface *xch);
+
+/*
+ * This function returns the number of times a guest write to a shared
+ * page forced a private copy of it to be made, since boot.
+ */
+long xc_sharing_cow_breaks(xc_interface *xch);
 /*** End sharing interface ***/
 
 int xc_flask_load(xc_interface *xc_handle, char *buf, uint32_t size);
@@ -2200,6 +2259,19 @@ void xc_compression_free_context(xc_interface *xch, comp_ctx *ctx);
 int xc_compression_add_page(xc_interface *xch, comp_ctx *ctx, char *page,
 			    unsigned long pfn, int israw);
 
+/**
+ * Reserve the next place in the page buffer for a page, without copying
+ * it in yet.  On success *slot points at the XC_PAGE_SIZE bytes which the
+ * caller must fill in before calling xc_compression_compress_pages; that
+ * may be done by another thread, as the slot is not touched by any other
+ * compression call until then.
+ *
+ * returns 0 on success, -1 if the page buffer is full (no space was
+ *  reserved) and -2 if the pfn is out of bounds, as above.
+ */
+int xc_compression_claim_page(xc_interface *xch, comp_ctx *ctx,
+			      unsigned long pfn, int israw, char **slot);
+
 /**
  * Delta compress pages in the compression buffer and inserts the
  * compressed data into the supplied compression buffer compbuf, whose
@@ -28,6 +28,14 @@
 #define XCFLAGS_HVM       4
 #define XCFLAGS_STDVGA    8
 #define XCFLAGS_CHECKPOINT_COMPRESS    16
+/*
+ * Batch preparation threads for xc_domain_save (0: default).  libxl takes
+ * the number from LIBXL_SAVE_WORKERS, xc_save from its optional last
+ * argument.
+ */
+#define XCFLAGS_WORKERS_SHIFT  8
+#define XCFLAGS_WORKERS_MASK   (0xffU << XCFLAGS_WORKERS_SHIFT)
+#define XCFLAGS_WORKERS(n)     (((n) << XCFLAGS_WORKERS_SHIFT) & XCFLAGS_WORKERS_MASK)
 #define X86_64_B_SIZE   64 
 #define X86_32_B_SIZE   32
 
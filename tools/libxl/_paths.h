@@ -0,0 +1,12 @@
+#define SBINDIR "/usr/sbin"
+#define BINDIR "/usr/bin"
+#define LIBEXEC "/usr/lib/xen/bin"
+#define LIBDIR "/usr/lib"
+#define SHAREDIR "/usr/share"
+#define PRIVATE_BINDIR "/usr/lib/xen/bin"
+#define XENFIRMWAREDIR "/usr/lib/xen/boot"
+#define XEN_CONFIG_DIR "/etc/xen"
+#define XEN_SCRIPT_DIR "/etc/xen/scripts"
+#define XEN_LOCK_DIR "/var/lock"
+#define XEN_RUN_DIR "/var/run/xen"
+#define XEN_PAGING_DIR "/var/lib/xen/xenpaging"
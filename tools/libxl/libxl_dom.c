@@ -1205,6 +1205,7 @@ void libxl__domain_suspend(libxl__egc *egc, libxl__domain_suspend_state *dss)
     int port;
     int rc = ERROR_FAIL;
     unsigned long vm_generationid_addr;
+    const char *workers;
 
     /* Convenience aliases */
     const uint32_t domid = dss->domid;
@@ -1238,9 +1239,13 @@ void libxl__domain_suspend(libxl__egc *egc, libxl__domain_suspend_state *dss)
         abort();
     }
 
-    dss->xcflags = (live) ? XCFLAGS_LIVE : 0
-          | (debug) ? XCFLAGS_DEBUG : 0
-          | (dss->hvm) ? XCFLAGS_HVM : 0;
+    dss->xcflags = ((live) ? XCFLAGS_LIVE : 0)
+          | ((debug) ? XCFLAGS_DEBUG : 0)
+          | ((dss->hvm) ? XCFLAGS_HVM : 0);
+
+    workers = getenv("LIBXL_SAVE_WORKERS");
+    if (workers)
+        dss->xcflags |= XCFLAGS_WORKERS(strtoul(workers, NULL, 0));
 
     dss->suspend_eventchn = -1;
     dss->guest_responded = 0;
@@ -17,42 +17,36 @@
 #include <errno.h>
 #include <string.h>
 #include <inttypes.h>
+#include <unistd.h>
 
-int main(int argc, char *argv[])
+static xc_interface *xc_handle;
+
+static void usage(const char *prog)
+{
+    printf("%s: [-r] | [-e period | -d | -z] | [-s] [-n lines] [-H] "
+           "[-i secs]\n", prog);
+    printf("no args: print lock profile data (lock_profile=y builds)\n");
+    printf("    -r : reset profile data\n");
+    printf("contention sampling, in any build:\n");
+    printf("    -e : enable, sampling hold times of one in every 'period'\n");
+    printf("         acquisitions; waits are always recorded\n");
+    printf("    -d : disable\n");
+    printf("    -z : reset samples\n");
+    printf("    -s : print the most contended locks\n");
+    printf("    -n : number of locks to print (default 20)\n");
+    printf("    -H : also print wait and hold time histograms\n");
+    printf("    -i : refresh every 'secs' seconds, showing the contention\n");
+    printf("         over each interval\n");
+}
+
+static int print_profile(void)
 {
-    xc_interface      *xc_handle;
     uint32_t           i, j, n;
     uint64_t           time;
     double             l, b, sl, sb;
     char               name[60];
     DECLARE_HYPERCALL_BUFFER(xc_lockprof_data_t, data);
 
-    if ( (argc > 2) || ((argc == 2) && (strcmp(argv[1], "-r") != 0)) )
-    {
-        printf("%s: [-r]\n", argv[0]);
-        printf("no args: print lock profile data\n");
-        printf("    -r : reset profile data\n");
-        return 1;
-    }
-
-    if ( (xc_handle = xc_interface_open(0,0,0)) == 0 )
-    {
-        fprintf(stderr, "Error opening xc interface: %d (%s)\n",
-                errno, strerror(errno));
-        return 1;
-    }
-
-    if ( argc > 1 )
-    {
-        if ( xc_lockprof_reset(xc_handle) != 0 )
-        {
-            fprintf(stderr, "Error reseting profile data: %d (%s)\n",
-                    errno, strerror(errno));
-            return 1;
-        }
-        return 0;
-    }
-
     n = 0;
     if ( xc_lockprof_query_number(xc_handle, &n) != 0 )
     {
@@ -118,3 +112,311 @@ int main(int argc, char *argv[])
 
     return 0;
 }
+
+/*
+ * Contention samples.  In interval mode each query is compared with the
+ * previous one, so that the locks shown are those contended right now.
+ */
+struct sample_set {
+    xc_lock_sample_t *s;
+    uint32_t nr;
+    uint32_t period, dropped;
+    uint64_t time;
+};
+
+static int cmp_key(const void *a, const void *b)
+{
+    const xc_lock_sample_t *x = a, *y = b;
+
+    if ( x->lock != y->lock )
+        return x->lock < y->lock ? -1 : 1;
+    return x->site < y->site ? -1 : x->site > y->site;
+}
+
+static int cmp_wait(const void *a, const void *b)
+{
+    const xc_lock_sample_t *x = a, *y = b;
+
+    if ( x->wait_time != y->wait_time )
+        return x->wait_time < y->wait_time ? 1 : -1;
+    return x->sampled < y->sampled ? 1 : x->sampled > y->sampled ? -1 : 0;
+}
+
+static int query_samples(struct sample_set *set)
+{
+    DECLARE_HYPERCALL_BUFFER(xc_lock_sample_t, buf);
+    uint32_t n = 0, max;
+
+    buf = xc_hypercall_buffer_alloc(xc_handle, buf, sizeof(*buf));
+    if ( buf == NULL ||
+         xc_lockprof_sample_query(xc_handle, &n, &set->period, &set->dropped,
+                                  &set->time, HYPERCALL_BUFFER(buf)) != 0 )
+        goto err;
+    xc_hypercall_buffer_free(xc_handle, buf);
+
+    max = n + 32;
+    buf = xc_hypercall_buffer_alloc(xc_handle, buf, sizeof(*buf) * max);
+    n = max;
+    if ( buf == NULL ||
+         xc_lockprof_sample_query(xc_handle, &n, &set->period, &set->dropped,
+                                  &set->time, HYPERCALL_BUFFER(buf)) != 0 )
+        goto err;
+    if ( n > max )
+        n = max;
+
+    set->s = malloc(sizeof(*set->s) * (n + 1));
+    if ( set->s == NULL )
+        goto err;
+    memcpy(set->s, buf, sizeof(*set->s) * n);
+    set->nr = n;
+    xc_hypercall_buffer_free(xc_handle, buf);
+
+    qsort(set->s, set->nr, sizeof(*set->s), cmp_key);
+    return 0;
+
+ err:
+    fprintf(stderr, "Error getting lock samples: %d (%s)\n",
+            errno, strerror(errno));
+    if ( buf )
+        xc_hypercall_buffer_free(xc_handle, buf);
+    return 1;
+}
+
+/* Take the samples in prev away from those in cur. */
+static void subtract_samples(struct sample_set *cur,
+                             const struct sample_set *prev)
+{
+    xc_lock_sample_t *c, *p;
+    uint32_t i, k;
+
+    for ( i = 0; i < cur->nr; i++ )
+    {
+        c = &cur->s[i];
+        p = bsearch(c, prev->s, prev->nr, sizeof(*c), cmp_key);
+        /* Counts going down means the samples were reset in between. */
+        if ( p == NULL || p->sampled > c->sampled ||
+             p->contended > c->contended )
+            continue;
+        c->sampled -= p->sampled;
+        c->contended -= p->contended;
+        c->hold_time -= p->hold_time;
+        c->wait_time -= p->wait_time;
+        for ( k = 0; k < XEN_SYSCTL_LOCKPROF_BUCKETS; k++ )
+        {
+            c->hold_hist[k] -= p->hold_hist[k];
+            c->wait_hist[k] -= p->wait_hist[k];
+        }
+    }
+    cur->time -= prev->time;
+}
+
+/* Upper bound, in ns, of the bucket holding the given fraction of samples. */
+static uint64_t hist_bound(const uint32_t *hist, double frac)
+{
+    uint64_t total = 0, seen = 0;
+    unsigned int k;
+
+    for ( k = 0; k < XEN_SYSCTL_LOCKPROF_BUCKETS; k++ )
+        total += hist[k];
+    for ( k = 0; k < XEN_SYSCTL_LOCKPROF_BUCKETS; k++ )
+    {
+        seen += hist[k];
+        if ( seen && seen >= frac * total )
+            break;
+    }
+
+    return k ? 1ULL << k : 1;
+}
+
+static void print_hist(const char *what, const uint32_t *hist)
+{
+    unsigned int k, n = 0;
+
+    printf("      %s:", what);
+    for ( k = 0; k < XEN_SYSCTL_LOCKPROF_BUCKETS; k++ )
+    {
+        if ( !hist[k] )
+            continue;
+        if ( n++ && !(n % 6) )
+            printf("\n%*s", (int)strlen(what) + 7, "");
+        printf(" <%"PRIu64"ns:%u", (uint64_t)1 << k, hist[k]);
+    }
+    printf("\n");
+}
+
+static void print_samples(struct sample_set *set, unsigned int lines,
+                          int histograms)
+{
+    xc_lock_sample_t *s;
+    char dom[8];
+    uint32_t i;
+
+    qsort(set->s, set->nr, sizeof(*set->s), cmp_wait);
+
+    printf("lock sampling %s, period %u, over %.3fs",
+           set->period ? "on" : "off", set->period,
+           (double)set->time / 1E+09);
+    if ( set->dropped )
+        printf(", %u samples dropped (table full)", set->dropped);
+    printf("\n%-18s %-5s %-36s %10s %10s %10s %9s %9s %9s\n",
+           "lock", "dom", "acquired at", "waits", "wait ms", "wait avg",
+           "wait p99", "hold avg", "hold p99");
+
+    for ( i = 0; i < set->nr && i < lines; i++ )
+    {
+        s = &set->s[i];
+        if ( !s->contended && !s->sampled )
+            break;
+        if ( s->domid == DOMID_INVALID )
+            snprintf(dom, sizeof(dom), "-");
+        else
+            snprintf(dom, sizeof(dom), "%u", s->domid);
+        printf("%#018"PRIx64" %-5s %-36.36s %10"PRIu64" %10.3f ",
+               s->lock, dom, s->site_name, s->contended,
+               (double)s->wait_time / 1E+06);
+        if ( s->contended )
+            printf("%8.2fus %7"PRIu64"us ",
+                   (double)s->wait_time / s->contended / 1E+03,
+                   (hist_bound(s->wait_hist, 0.99) + 999) / 1000);
+        else
+            printf("%10s %9s ", "-", "-");
+        if ( s->sampled )
+            printf("%7.2fus %7"PRIu64"us\n",
+                   (double)s->hold_time / s->sampled / 1E+03,
+                   (hist_bound(s->hold_hist, 0.99) + 999) / 1000);
+        else
+            printf("%9s %9s\n", "-", "-");
+        if ( histograms )
+        {
+            print_hist("wait", s->wait_hist);
+            print_hist("hold", s->hold_hist);
+        }
+    }
+}
+
+static int show_samples(unsigned int lines, int histograms,
+                        unsigned int interval)
+{
+    struct sample_set prev = { 0 }, cur = { 0 }, delta;
+
+    if ( query_samples(&prev) )
+        return 1;
+    if ( !interval )
+    {
+        print_samples(&prev, lines, histograms);
+        free(prev.s);
+        return 0;
+    }
+
+    for ( ; ; )
+    {
+        sleep(interval);
+        if ( query_samples(&cur) )
+            return 1;
+
+        delta = cur;
+        delta.s = malloc(sizeof(*cur.s) * (cur.nr + 1));
+        if ( delta.s == NULL )
+            return 1;
+        memcpy(delta.s, cur.s, sizeof(*cur.s) * cur.nr);
+        subtract_samples(&delta, &prev);
+
+        printf("\033[H\033[J");
+        print_samples(&delta, lines, histograms);
+        fflush(stdout);
+
+        free(delta.s);
+        free(prev.s);
+        prev = cur;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int lines = 20, interval = 0;
+    int opt, reset = 0, enable = 0, disable = 0, zero = 0, samples = 0;
+    int histograms = 0, rc = 0;
+    unsigned long period = 0;
+
+    while ( (opt = getopt(argc, argv, "re:dzsn:Hi:h")) != -1 )
+    {
+        switch ( opt )
+        {
+        case 'r':
+            reset = 1;
+            break;
+        case 'e':
+            enable = 1;
+            period = strtoul(optarg, NULL, 0);
+            break;
+        case 'd':
+            disable = 1;
+            break;
+        case 'z':
+            zero = 1;
+            break;
+        case 's':
+            samples = 1;
+            break;
+        case 'n':
+            lines = strtoul(optarg, NULL, 0);
+            break;
+        case 'H':
+            histograms = 1;
+            break;
+        case 'i':
+            samples = 1;
+            interval = strtoul(optarg, NULL, 0);
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if ( optind != argc || (enable && !period) || (enable && disable) )
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if ( (xc_handle = xc_interface_open(0,0,0)) == 0 )
+    {
+        fprintf(stderr, "Error opening xc interface: %d (%s)\n",
+                errno, strerror(errno));
+        return 1;
+    }
+
+    if ( reset && xc_lockprof_reset(xc_handle) != 0 )
+    {
+        fprintf(stderr, "Error reseting profile data: %d (%s)\n",
+                errno, strerror(errno));
+        rc = 1;
+    }
+    if ( enable && xc_lockprof_sample_enable(xc_handle, period) != 0 )
+    {
+        fprintf(stderr, "Error enabling lock sampling: %d (%s)\n",
+                errno, strerror(errno));
+        rc = 1;
+    }
+    if ( disable && xc_lockprof_sample_disable(xc_handle) != 0 )
+    {
+        fprintf(stderr, "Error disabling lock sampling: %d (%s)\n",
+                errno, strerror(errno));
+        rc = 1;
+    }
+    if ( zero && xc_lockprof_sample_reset(xc_handle) != 0 )
+    {
+        fprintf(stderr, "Error reseting lock samples: %d (%s)\n",
+                errno, strerror(errno));
+        rc = 1;
+    }
+
+    if ( !rc && samples )
+        rc = show_samples(lines, histograms, interval);
+    else if ( !rc && !reset && !enable && !disable && !zero )
+        rc = print_profile();
+
+    xc_interface_close(xc_handle);
+
+    return rc;
+}
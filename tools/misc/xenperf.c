@@ -68,6 +68,61 @@ const char *hypercall_name_table[64] =
 };
 #undef X
 
+/* Upper bound of the histogram bucket holding the given fraction of samples. */
+static unsigned long long histo_bound(const xc_perfc_val_t *val,
+                                      unsigned int nr, unsigned int sum,
+                                      double frac)
+{
+    unsigned long long seen = 0;
+    unsigned int j;
+
+    for ( j = 0; j < nr; j++ )
+    {
+        seen += val[j];
+        if ( seen && seen >= frac * sum )
+            break;
+    }
+
+    return j ? 1ULL << j : 1;
+}
+
+/*
+ * Histograms are summarised as percentiles: p50 below 1024 means at least
+ * half of the samples were under 1024 (cycles, for the timed paths).
+ */
+static void print_histogram(const xc_perfc_val_t *val, unsigned int nr,
+                            unsigned int sum, int full)
+{
+    unsigned int j;
+    char label[48];
+
+    if ( sum )
+    {
+        printf(" p50<%llu p90<%llu p99<%llu max<%llu",
+               histo_bound(val, nr, sum, 0.5), histo_bound(val, nr, sum, 0.9),
+               histo_bound(val, nr, sum, 0.99), histo_bound(val, nr, sum, 1));
+        if ( val[nr - 1] )
+            printf(" (%u >= 2^%u)", (unsigned int)val[nr - 1], nr - 2);
+    }
+    printf("\n");
+
+    if ( !full )
+        return;
+    for ( j = 0; j < nr; j++ )
+    {
+        if ( val[j] == 0 )
+            continue;
+        if ( j == 0 )
+            snprintf(label, sizeof(label), "  0");
+        else if ( j == nr - 1 )
+            snprintf(label, sizeof(label), "  >= %llu", 1ULL << (j - 1));
+        else
+            snprintf(label, sizeof(label), "  [%llu, %llu)",
+                     1ULL << (j - 1), 1ULL << j);
+        printf("%-35s %12u\n", label, (unsigned int)val[j]);
+    }
+}
+
 int main(int argc, char *argv[])
 {
     int              i, j;
@@ -107,7 +162,7 @@ int main(int argc, char *argv[])
             printf("no args: print digested counters\n");
             printf("    -f : print full arrays/histograms\n");
             printf("    -p : print full arrays/histograms in pretty format\n");
-            printf("    -r : reset counters\n");
+            printf("    -r : reset counters and histograms\n");
             return 0;
         }
     }   
@@ -165,7 +220,9 @@ int main(int argc, char *argv[])
             sum += val[j];
         printf ("T=%10u ", (unsigned int)sum);
 
-        if ( full || (pcd[i].nr_vals <= 4) )
+        if ( pcd[i].flags & XEN_SYSCTL_PERFC_histogram )
+            print_histogram(val, pcd[i].nr_vals, sum, full);
+        else if ( full || (pcd[i].nr_vals <= 4) )
         {
             if ( pretty && (strcmp(pcd[i].name, "hypercalls") == 0) )
             {
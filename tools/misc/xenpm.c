@@ -69,6 +69,8 @@ void show_help(void)
             "                                     output after CTRL-C or SIGINT or several seconds.\n"
             " enable-turbo-mode     [cpuid]       enable Turbo Mode for processors that support it.\n"
             " disable-turbo-mode    [cpuid]       disable Turbo Mode for processors that support it.\n"
+            " get-scrub-backlog     [seconds]     show free memory still to be scrubbed; with an\n"
+            "                                     interval, keep sampling it until CTRL-C.\n"
             );
 }
 /* wrapper function */
@@ -1123,6 +1125,46 @@ void disable_turbo_mode(int argc, char *argv[])
                 errno, strerror(errno));
 }
 
+void scrub_backlog_func(int argc, char *argv[])
+{
+    xc_physinfo_t info = { 0 };
+    uint64_t last = 0;
+    int interval = 0, first = 1;
+
+    if ( argc > 0 && (sscanf(argv[0], "%d", &interval) != 1 || interval <= 0) )
+    {
+        fprintf(stderr, "Invalid interval '%s'\n", argv[0]);
+        exit(EINVAL);
+    }
+
+    for ( ; ; )
+    {
+        if ( xc_physinfo(xc_handle, &info) )
+        {
+            fprintf(stderr, "failed to get memory information (%d - %s)\n",
+                    errno, strerror(errno));
+            exit(errno);
+        }
+
+        printf("scrub backlog        : %"PRIu64" kB",
+               info.scrub_pages << (XC_PAGE_SHIFT - 10));
+        if ( !first )
+            printf(", scrubbed %"PRId64" kB/s",
+                   ((int64_t)(last - info.scrub_pages) << (XC_PAGE_SHIFT - 10))
+                   / interval);
+        printf(" (free %"PRIu64" kB)\n",
+               info.free_pages << (XC_PAGE_SHIFT - 10));
+
+        if ( !interval )
+            break;
+
+        fflush(stdout);
+        last = info.scrub_pages;
+        first = 0;
+        sleep(interval);
+    }
+}
+
 struct {
     const char *name;
     void (*function)(int argc, char *argv[]);
@@ -1145,6 +1187,7 @@ struct {
     { "set-max-cstate", set_max_cstate_func},
     { "enable-turbo-mode", enable_turbo_mode },
     { "disable-turbo-mode", disable_turbo_mode },
+    { "get-scrub-backlog", scrub_backlog_func },
 };
 
 int main(int argc, char *argv[])
@@ -0,0 +1,110 @@
+/*
+ * Just enough of the hypervisor environment to build common/rangeset.c
+ * and common/rbtree.c as a user-space program.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Headers whose contents are supplied below instead. */
+#define __XEN_CONFIG_H__
+#define __TYPES_H__
+#define _I386_ERRNO_H
+#define __SCHED_H__
+#define __XSM_H__
+
+#define __must_check __attribute__((__warn_unused_result__))
+#define EXPORT_SYMBOL(sym)
+
+#define container_of(ptr, type, member) ({                      \
+        typeof( ((type *)0)->member ) *__mptr = (ptr);          \
+        (type *)( (char *)__mptr - offsetof(type,member) );})
+
+#define ASSERT(p) assert(p)
+#define BUG_ON(p) assert(!(p))
+
+#define min(x, y) ((x) < (y) ? (x) : (y))
+#define max(x, y) ((x) > (y) ? (x) : (y))
+
+#define safe_strcpy(d, s) ({                    \
+    strncpy(d, s, sizeof(d) - 1);               \
+    (d)[sizeof(d) - 1] = '\0';                  \
+})
+
+/* Allocations are counted so that tests can check for leaks. */
+static long nr_allocs;
+static unsigned int fail_allocs_after = ~0u;
+
+static void *_xmalloc(size_t size)
+{
+    if ( fail_allocs_after == 0 )
+        return NULL;
+    fail_allocs_after--;
+    nr_allocs++;
+    return malloc(size);
+}
+#define xmalloc(type) ((type *)_xmalloc(sizeof(type)))
+
+static void xfree(void *p)
+{
+    if ( p != NULL )
+        nr_allocs--;
+    free(p);
+}
+
+/* printk() output is collected so that tests can check the dump format. */
+static char printk_buf[4096];
+
+static void printk(const char *fmt, ...)
+{
+    size_t len = strlen(printk_buf);
+    va_list args;
+
+    va_start(args, fmt);
+    vsnprintf(printk_buf + len, sizeof(printk_buf) - len, fmt, args);
+    va_end(args);
+}
+
+typedef struct { int held; } spinlock_t;
+
+static void spin_lock_init(spinlock_t *l) { l->held = 0; }
+static void spin_lock(spinlock_t *l) { assert(!l->held); l->held = 1; }
+static void spin_unlock(spinlock_t *l) { assert(l->held); l->held = 0; }
+
+struct list_head {
+    struct list_head *next, *prev;
+};
+
+#define INIT_LIST_HEAD(l) ((l)->next = (l)->prev = (l))
+#define list_empty(l) ((l)->next == (l))
+#define list_entry(p, type, member) container_of(p, type, member)
+#define list_for_each_entry(pos, head, member)                          \
+    for ( pos = list_entry((head)->next, typeof(*pos), member);         \
+          &pos->member != (head);                                       \
+          pos = list_entry(pos->member.next, typeof(*pos), member) )
+
+static void list_add(struct list_head *n, struct list_head *head)
+{
+    n->next = head->next;
+    n->prev = head;
+    head->next->prev = n;
+    head->next = n;
+}
+
+static void list_del(struct list_head *e)
+{
+    e->prev->next = e->next;
+    e->next->prev = e->prev;
+}
+
+struct domain {
+    unsigned int     domain_id;
+    struct list_head rangesets;
+    spinlock_t       rangesets_lock;
+};
@@ -0,0 +1,240 @@
+/*
+ * test_rangeset.c
+ *
+ * Self-test for the hypervisor's rangeset implementation.  common/rangeset.c
+ * and common/rbtree.c are built unmodified on top of harness.h.
+ *
+ * Ranges are added and removed both in fixed patterns that hit each
+ * merge/split case and at random against a bitmap model; after every step
+ * the set must hold exactly the model's runs, each as one maximal range.
+ */
+
+#include "harness.h"
+
+#include "rbtree.c"
+#include "rangeset.c"
+
+#define UNIVERSE 1024
+
+static unsigned char model[UNIVERSE];
+
+struct walk {
+    unsigned long s[UNIVERSE], e[UNIVERSE];
+    unsigned int nr;
+};
+
+static int record(unsigned long s, unsigned long e, void *ctxt)
+{
+    struct walk *w = ctxt;
+
+    w->s[w->nr] = s;
+    w->e[w->nr] = e;
+    w->nr++;
+    return 0;
+}
+
+/* Check the set holds exactly the model's runs, as maximal ranges. */
+static int check_model(struct rangeset *r)
+{
+    static struct walk w;
+    unsigned int i, n = 0, s;
+
+    w.nr = 0;
+    rangeset_report_ranges(r, 0, UNIVERSE - 1, record, &w);
+
+    for ( i = 0; i < UNIVERSE; )
+    {
+        if ( !model[i] )
+        {
+            i++;
+            continue;
+        }
+        for ( s = i; i < UNIVERSE && model[i]; i++ )
+            continue;
+        if ( n >= w.nr || w.s[n] != s || w.e[n] != i - 1 )
+            return 0;
+        n++;
+    }
+
+    return n == w.nr;
+}
+
+static void model_set(unsigned int s, unsigned int e, unsigned char val)
+{
+    memset(&model[s], val, e - s + 1);
+}
+
+static int model_contains(unsigned int s, unsigned int e)
+{
+    for ( ; s <= e; s++ )
+        if ( !model[s] )
+            return 0;
+    return 1;
+}
+
+static int model_overlaps(unsigned int s, unsigned int e)
+{
+    for ( ; s <= e; s++ )
+        if ( model[s] )
+            return 1;
+    return 0;
+}
+
+/* Dump r into a string, in the format used by the 'q' keyhandler. */
+static const char *dump(struct rangeset *r)
+{
+    printk_buf[0] = '\0';
+    rangeset_printk(r);
+    return printk_buf;
+}
+
+#define ADD(r, s, e)    if ( rangeset_add_range(r, s, e) ) goto fail
+#define REMOVE(r, s, e) if ( rangeset_remove_range(r, s, e) ) goto fail
+#define EXPECT(r, str)  if ( strcmp(dump(r), "test       {" str) ) goto fail
+
+int main(int argc, char **argv)
+{
+    struct domain dom = { .domain_id = 1 };
+    struct rangeset *r, *h;
+    unsigned int i, s, e;
+
+    rangeset_domain_initialise(&dom);
+
+    printf("%-40s", "Testing adding disjoint ranges...");
+    r = rangeset_new(&dom, "test", 0);
+    if ( !r || !rangeset_is_empty(r) )
+        goto fail;
+    EXPECT(r, " }");
+    ADD(r, 100, 199);
+    ADD(r, 10, 19);
+    ADD(r, 300, 300);
+    ADD(r, 50, 59);
+    EXPECT(r, " 10-19, 50-59, 100-199, 300 }");
+    printf("okay\n");
+
+    printf("%-40s", "Testing merging adjacent ranges...");
+    ADD(r, 20, 29);
+    ADD(r, 40, 49);
+    ADD(r, 200, 200);
+    ADD(r, 301, 301);
+    EXPECT(r, " 10-29, 40-59, 100-200, 300-301 }");
+    ADD(r, 30, 39);
+    EXPECT(r, " 10-59, 100-200, 300-301 }");
+    printf("okay\n");
+
+    printf("%-40s", "Testing merging overlapping ranges...");
+    ADD(r, 15, 25);
+    ADD(r, 5, 12);
+    ADD(r, 150, 250);
+    EXPECT(r, " 5-59, 100-250, 300-301 }");
+    ADD(r, 0, 400);
+    EXPECT(r, " 0-400 }");
+    printf("okay\n");
+
+    printf("%-40s", "Testing splitting ranges...");
+    REMOVE(r, 100, 100);
+    REMOVE(r, 200, 209);
+    REMOVE(r, 0, 0);
+    REMOVE(r, 400, 400);
+    EXPECT(r, " 1-99, 101-199, 210-399 }");
+    if ( !rangeset_contains_range(r, 101, 199) ||
+         rangeset_contains_range(r, 99, 101) ||
+         !rangeset_overlaps_range(r, 95, 105) ||
+         rangeset_overlaps_range(r, 200, 209) ||
+         rangeset_contains_singleton(r, 100) )
+        goto fail;
+    printf("okay\n");
+
+    printf("%-40s", "Testing removing across ranges...");
+    REMOVE(r, 50, 250);
+    EXPECT(r, " 1-49, 251-399 }");
+    REMOVE(r, 0, 1000);
+    if ( !rangeset_is_empty(r) )
+        goto fail;
+    EXPECT(r, " }");
+    REMOVE(r, 0, 1000);
+    printf("okay\n");
+
+    printf("%-40s", "Testing range limits...");
+    ADD(r, ~0UL - 1, ~0UL);
+    ADD(r, 0, 0);
+    if ( !rangeset_contains_singleton(r, ~0UL) ||
+         !rangeset_contains_singleton(r, 0) ||
+         rangeset_contains_singleton(r, 1) )
+        goto fail;
+    ADD(r, 1, ~0UL - 2);
+    if ( !rangeset_contains_range(r, 0, ~0UL) )
+        goto fail;
+    REMOVE(r, 1, ~0UL);
+    EXPECT(r, " 0 }");
+    REMOVE(r, 0, 0);
+    printf("okay\n");
+
+    printf("%-40s", "Testing hex pretty-printing...");
+    h = rangeset_new(&dom, "test", RANGESETF_prettyprint_hex);
+    if ( !h || rangeset_add_range(h, 0xa0, 0xbf) ||
+         rangeset_add_singleton(h, 0xfee) )
+        goto fail;
+    EXPECT(h, " a0-bf, fee }");
+    rangeset_destroy(h);
+    printf("okay\n");
+
+    printf("%-40s", "Testing allocation failure...");
+    ADD(r, 10, 20);
+    fail_allocs_after = 0;
+    if ( rangeset_add_range(r, 30, 40) != -ENOMEM ||
+         rangeset_remove_range(r, 15, 15) != -ENOMEM )
+        goto fail;
+    /* Neither needs a new range. */
+    ADD(r, 21, 25);
+    REMOVE(r, 10, 10);
+    fail_allocs_after = ~0u;
+    EXPECT(r, " 11-25 }");
+    REMOVE(r, 0, 100);
+    printf("okay\n");
+
+    printf("%-40s", "Testing random operations...");
+    srand(1);
+    for ( i = 0; i < 200000; i++ )
+    {
+        s = rand() % UNIVERSE;
+        e = s + rand() % (i & 1 ? 8 : 64);
+        if ( e >= UNIVERSE )
+            e = UNIVERSE - 1;
+
+        switch ( rand() % 4 )
+        {
+        case 0: case 1:
+            ADD(r, s, e);
+            model_set(s, e, 1);
+            break;
+        case 2:
+            REMOVE(r, s, e);
+            model_set(s, e, 0);
+            break;
+        case 3:
+            if ( rangeset_contains_range(r, s, e) != model_contains(s, e) ||
+                 rangeset_overlaps_range(r, s, e) != model_overlaps(s, e) )
+                goto fail;
+            break;
+        }
+
+        if ( !check_model(r) )
+            goto fail;
+    }
+    printf("okay\n");
+
+    printf("%-40s", "Testing teardown...");
+    if ( rangeset_new(&dom, "other", 0) == NULL )
+        goto fail;
+    rangeset_domain_destroy(&dom);
+    if ( nr_allocs != 0 )
+        goto fail;
+    printf("okay\n");
+
+    return 0;
+
+ fail:
+    printf("failed!\n");
+    return 1;
+}
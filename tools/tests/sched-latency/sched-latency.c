@@ -0,0 +1,262 @@
+/*
+ * sched-latency.c
+ *
+ * Measure wake-to-run latency as seen by a guest.
+ *
+ * Run inside a guest.  A sleeper thread, pinned to its own vCPU, blocks on
+ * a pipe; a waker thread on another vCPU stamps the time and writes to the
+ * pipe.  With nothing else to run the sleeper's vCPU is blocked in the
+ * hypervisor, so the time until the sleeper sees the stamp covers the
+ * event channel notification, the vCPU wakeup and runqueue insert, and the
+ * wait until the hypervisor scheduler picks the vCPU.
+ *
+ * Load is whatever else runs on the host, plus optionally spinner threads
+ * in this guest (-l), each busy for a given percentage of every 10ms.
+ * The spinners are kept off the sleeper's vCPU, and off the waker's too if
+ * there are other vCPUs for them, so that the sleeper's vCPU still blocks.
+ * To compare schedulers or runqueue implementations, run this in one guest
+ * while enough other vCPUs are runnable to keep the runqueues long.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LOAD_PERIOD_NS  10000000ULL
+
+static unsigned long nr_samples = 10000;
+static unsigned long interval_us = 1000;
+static unsigned int nr_load;
+static unsigned int duty = 100;
+static int waker_cpu = 0, sleeper_cpu = 1;
+
+static int wake_pipe[2], ack_pipe[2];
+static volatile uint64_t wake_stamp;
+static uint64_t *samples;
+static volatile int stop;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void sleep_ns(uint64_t ns)
+{
+    struct timespec ts = {
+        .tv_sec = ns / 1000000000ULL,
+        .tv_nsec = ns % 1000000000ULL,
+    };
+
+    while ( nanosleep(&ts, &ts) && errno == EINTR )
+        continue;
+}
+
+static void pin(int cpu)
+{
+    cpu_set_t set;
+
+    if ( cpu < 0 )
+        return;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if ( pthread_setaffinity_np(pthread_self(), sizeof(set), &set) )
+        fprintf(stderr, "warning: can't pin to cpu %d\n", cpu);
+}
+
+/* The vCPUs the spinners may run on: any but the sleeper's and waker's. */
+static int load_cpus(cpu_set_t *set)
+{
+    cpu_set_t others;
+
+    if ( sched_getaffinity(0, sizeof(*set), set) )
+        return -1;
+    if ( sleeper_cpu >= 0 && sleeper_cpu < CPU_SETSIZE )
+        CPU_CLR(sleeper_cpu, set);
+
+    others = *set;
+    if ( waker_cpu >= 0 && waker_cpu < CPU_SETSIZE )
+        CPU_CLR(waker_cpu, &others);
+    if ( CPU_COUNT(&others) )
+        *set = others;
+
+    return CPU_COUNT(set) ? 0 : -1;
+}
+
+static void *sleeper(void *arg)
+{
+    unsigned long i;
+    char c;
+
+    pin(sleeper_cpu);
+    for ( i = 0; i < nr_samples; i++ )
+    {
+        if ( read(wake_pipe[0], &c, 1) != 1 )
+            break;
+        samples[i] = now_ns() - wake_stamp;
+        if ( write(ack_pipe[1], &c, 1) != 1 )
+            break;
+    }
+
+    return NULL;
+}
+
+static void *load(void *arg)
+{
+    uint64_t busy = LOAD_PERIOD_NS * duty / 100, start;
+
+    while ( !stop )
+    {
+        start = now_ns();
+        while ( now_ns() - start < busy )
+            continue;
+        if ( busy < LOAD_PERIOD_NS )
+            sleep_ns(LOAD_PERIOD_NS - busy);
+    }
+
+    return NULL;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+static double pct(double p)
+{
+    return samples[(unsigned long)(p * (nr_samples - 1) / 100)] / 1000.0;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [-n samples] [-i interval_us] [-l threads] [-d duty%%]\n"
+            "          [-w cpu] [-s cpu]\n"
+            "  -n  wakeups to measure (default %lu)\n"
+            "  -i  time between wakeups, in us (default %lu)\n"
+            "  -l  spinner threads to run alongside (default 0)\n"
+            "  -d  percentage of each 10ms the spinners are busy (default 100)\n"
+            "  -w  cpu to pin the waker to, -1 for none (default 0)\n"
+            "  -s  cpu to pin the sleeper to, -1 for none (default 1)\n",
+            prog, nr_samples, interval_us);
+    exit(2);
+}
+
+int main(int argc, char *argv[])
+{
+    pthread_t sleeper_thread, *load_threads;
+    pthread_attr_t load_attr;
+    cpu_set_t set;
+    unsigned long i;
+    uint64_t sum = 0;
+    int opt;
+    char c = 0;
+
+    while ( (opt = getopt(argc, argv, "n:i:l:d:w:s:h")) != -1 )
+    {
+        switch ( opt )
+        {
+        case 'n':
+            nr_samples = strtoul(optarg, NULL, 0);
+            break;
+        case 'i':
+            interval_us = strtoul(optarg, NULL, 0);
+            break;
+        case 'l':
+            nr_load = strtoul(optarg, NULL, 0);
+            break;
+        case 'd':
+            duty = strtoul(optarg, NULL, 0);
+            break;
+        case 'w':
+            waker_cpu = strtol(optarg, NULL, 0);
+            break;
+        case 's':
+            sleeper_cpu = strtol(optarg, NULL, 0);
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+    if ( !nr_samples || !duty || duty > 100 )
+        usage(argv[0]);
+
+    samples = calloc(nr_samples, sizeof(*samples));
+    load_threads = calloc(nr_load, sizeof(*load_threads));
+    if ( !samples || (nr_load && !load_threads) ||
+         pipe(wake_pipe) || pipe(ack_pipe) )
+    {
+        perror("setting up");
+        return 1;
+    }
+
+    if ( nr_load && load_cpus(&set) )
+    {
+        fprintf(stderr, "no vCPU to run spinners on besides the sleeper's\n");
+        return 1;
+    }
+    if ( pthread_attr_init(&load_attr) ||
+         (nr_load &&
+          pthread_attr_setaffinity_np(&load_attr, sizeof(set), &set)) )
+    {
+        fprintf(stderr, "can't set spinner affinity\n");
+        return 1;
+    }
+
+    for ( i = 0; i < nr_load; i++ )
+        if ( pthread_create(&load_threads[i], &load_attr, load, NULL) )
+        {
+            perror("pthread_create");
+            return 1;
+        }
+    pthread_attr_destroy(&load_attr);
+
+    pin(waker_cpu);
+    if ( pthread_create(&sleeper_thread, NULL, sleeper, NULL) )
+    {
+        perror("pthread_create");
+        return 1;
+    }
+
+    for ( i = 0; i < nr_samples; i++ )
+    {
+        /* Give the sleeper's vCPU time to go idle and block. */
+        sleep_ns(interval_us * 1000ULL);
+        wake_stamp = now_ns();
+        if ( write(wake_pipe[1], &c, 1) != 1 ||
+             read(ack_pipe[0], &c, 1) != 1 )
+        {
+            perror("pipe");
+            return 1;
+        }
+    }
+
+    pthread_join(sleeper_thread, NULL);
+    stop = 1;
+    for ( i = 0; i < nr_load; i++ )
+        pthread_join(load_threads[i], NULL);
+
+    for ( i = 0; i < nr_samples; i++ )
+        sum += samples[i];
+    qsort(samples, nr_samples, sizeof(*samples), cmp_u64);
+
+    printf("%lu wakeups, %u spinners at %u%%\n", nr_samples, nr_load, duty);
+    printf("wake-to-run (us): min %.1f avg %.1f p50 %.1f p90 %.1f "
+           "p99 %.1f p99.9 %.1f max %.1f\n",
+           samples[0] / 1000.0, sum / 1000.0 / nr_samples, pct(50), pct(90),
+           pct(99), pct(99.9), samples[nr_samples - 1] / 1000.0);
+
+    return 0;
+}
@@ -0,0 +1,275 @@
+/*
+ * tmem-bench.c
+ *
+ * Drive tmem ephemeral puts and gets from inside a guest, as fast as the
+ * guest can issue them.
+ *
+ * Run inside a Linux guest with cleancache backed by tmem, on a filesystem
+ * which supports cleancache (ext3/4, btrfs, ocfs2).  Each thread, pinned to
+ * its own vCPU, writes its own file and syncs it.  Every round it then
+ * drops the file from the page cache, which puts each clean page to tmem,
+ * and reads it back, which gets each page from tmem instead of the disk.
+ * The file contents differ page to page so that tmem dedup can't collapse
+ * them.
+ *
+ * Put and get rates are reported for all threads together.  To see LRU and
+ * lock contention in the hypervisor, run with several threads, in several
+ * guests at once, and on vCPUs spread over NUMA nodes.  Keep the files
+ * small enough for tmem to hold, or rounds turn into evictions and disk
+ * reads; the cleancache counters, where the guest kernel has them, show
+ * how many gets missed.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define PAGE_SIZE  4096
+#define CHUNK      (64 * 1024)
+
+static unsigned int nr_threads = 1;
+static unsigned long file_mb = 64;
+static unsigned int nr_rounds = 10;
+static int first_cpu = 0;
+static const char *dir = ".";
+
+static pthread_barrier_t barrier;
+
+struct worker {
+    pthread_t thread;
+    unsigned int id;
+    char path[256];
+    uint64_t put_ns, get_ns;
+    int error;
+};
+
+static const char *cleancache_dirs[] = {
+    "/sys/kernel/mm/cleancache",
+    "/sys/kernel/debug/cleancache",
+};
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void pin(int cpu)
+{
+    cpu_set_t set;
+
+    if ( cpu < 0 )
+        return;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if ( pthread_setaffinity_np(pthread_self(), sizeof(set), &set) )
+        fprintf(stderr, "warning: can't pin to cpu %d\n", cpu);
+}
+
+/* Returns -1 if the guest kernel doesn't export the counter. */
+static long long cleancache_stat(const char *name)
+{
+    char path[256];
+    long long val;
+    unsigned int i;
+    FILE *f;
+
+    for ( i = 0; i < sizeof(cleancache_dirs) / sizeof(cleancache_dirs[0]);
+          i++ )
+    {
+        snprintf(path, sizeof(path), "%s/%s", cleancache_dirs[i], name);
+        if ( (f = fopen(path, "r")) == NULL )
+            continue;
+        if ( fscanf(f, "%lld", &val) != 1 )
+            val = -1;
+        fclose(f);
+        return val;
+    }
+
+    return -1;
+}
+
+static int fill(struct worker *w, int fd)
+{
+    char *buf = malloc(CHUNK);
+    unsigned long off, i;
+    int rc = 0;
+
+    if ( buf == NULL )
+        return -1;
+    for ( off = 0; off < file_mb << 20 && !rc; off += CHUNK )
+    {
+        for ( i = 0; i < CHUNK; i += sizeof(uint64_t) )
+            *(uint64_t *)(buf + i) =
+                ((uint64_t)w->id << 48) ^ (off + i) ^ 0x5a5a5a5a5a5a5a5aULL;
+        if ( pwrite(fd, buf, CHUNK, off) != CHUNK )
+            rc = -1;
+    }
+    free(buf);
+
+    return rc ? rc : fsync(fd);
+}
+
+static void *worker(void *arg)
+{
+    struct worker *w = arg;
+    char *buf = NULL;
+    unsigned long off;
+    unsigned int round;
+    uint64_t start;
+    int fd;
+
+    if ( first_cpu >= 0 )
+        pin(first_cpu + w->id);
+
+    fd = open(w->path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if ( fd < 0 || fill(w, fd) || (buf = malloc(CHUNK)) == NULL )
+        w->error = errno ? : EIO;
+
+    for ( round = 0; round < nr_rounds; round++ )
+    {
+        pthread_barrier_wait(&barrier);
+        if ( w->error )
+            continue;
+
+        start = now_ns();
+        if ( posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) )
+            w->error = EIO;
+        w->put_ns += now_ns() - start;
+
+        start = now_ns();
+        for ( off = 0; off < file_mb << 20; off += CHUNK )
+            if ( pread(fd, buf, CHUNK, off) != CHUNK )
+            {
+                w->error = errno ? : EIO;
+                break;
+            }
+        w->get_ns += now_ns() - start;
+    }
+
+    free(buf);
+    if ( fd >= 0 )
+        close(fd);
+    unlink(w->path);
+
+    return NULL;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [-t threads] [-s size_mb] [-n rounds] [-c cpu] [-d dir]\n"
+            "  -t  threads, each with its own file (default %u)\n"
+            "  -s  file size per thread, in MB (default %lu)\n"
+            "  -n  put/get rounds over each file (default %u)\n"
+            "  -c  cpu to pin the first thread to, the others follow; -1 for\n"
+            "      no pinning (default 0)\n"
+            "  -d  directory for the files (default .)\n",
+            prog, nr_threads, file_mb, nr_rounds);
+    exit(2);
+}
+
+int main(int argc, char *argv[])
+{
+    static const char *stats[] = { "puts", "succ_gets", "failed_gets" };
+    long long before[3], after[3];
+    struct worker *workers;
+    uint64_t put_ns = 0, get_ns = 0, pages;
+    unsigned int i;
+    int opt, rc = 0;
+
+    while ( (opt = getopt(argc, argv, "t:s:n:c:d:h")) != -1 )
+    {
+        switch ( opt )
+        {
+        case 't':
+            nr_threads = strtoul(optarg, NULL, 0);
+            break;
+        case 's':
+            file_mb = strtoul(optarg, NULL, 0);
+            break;
+        case 'n':
+            nr_rounds = strtoul(optarg, NULL, 0);
+            break;
+        case 'c':
+            first_cpu = strtol(optarg, NULL, 0);
+            break;
+        case 'd':
+            dir = optarg;
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+    if ( !nr_threads || !file_mb || !nr_rounds )
+        usage(argv[0]);
+
+    workers = calloc(nr_threads, sizeof(*workers));
+    if ( workers == NULL ||
+         pthread_barrier_init(&barrier, NULL, nr_threads) )
+    {
+        perror("setting up");
+        return 1;
+    }
+
+    for ( i = 0; i < 3; i++ )
+        before[i] = cleancache_stat(stats[i]);
+
+    for ( i = 0; i < nr_threads; i++ )
+    {
+        workers[i].id = i;
+        snprintf(workers[i].path, sizeof(workers[i].path),
+                 "%s/tmem-bench.%d.%u", dir, getpid(), i);
+        if ( pthread_create(&workers[i].thread, NULL, worker, &workers[i]) )
+        {
+            perror("pthread_create");
+            return 1;
+        }
+    }
+
+    for ( i = 0; i < nr_threads; i++ )
+    {
+        pthread_join(workers[i].thread, NULL);
+        if ( workers[i].error )
+        {
+            fprintf(stderr, "thread %u: %s: %s\n", i, workers[i].path,
+                    strerror(workers[i].error));
+            rc = 1;
+        }
+        put_ns += workers[i].put_ns;
+        get_ns += workers[i].get_ns;
+    }
+    if ( rc )
+        return rc;
+
+    for ( i = 0; i < 3; i++ )
+        after[i] = cleancache_stat(stats[i]);
+
+    /* Per-thread times summed, so divide by threads for the wall rate. */
+    pages = (uint64_t)nr_rounds * nr_threads * (file_mb << 20) / PAGE_SIZE;
+    printf("%u threads, %lu MB each, %u rounds\n",
+           nr_threads, file_mb, nr_rounds);
+    printf("put: %.0f pages/s (%.2f us/page/thread)\n",
+           pages * 1e9 * nr_threads / put_ns, put_ns / 1000.0 / pages);
+    printf("get: %.0f pages/s (%.2f us/page/thread)\n",
+           pages * 1e9 * nr_threads / get_ns, get_ns / 1000.0 / pages);
+    if ( before[0] >= 0 && after[0] >= 0 )
+        printf("cleancache: %lld puts, %lld gets hit, %lld gets missed\n",
+               after[0] - before[0], after[1] - before[1],
+               after[2] - before[2]);
+    else
+        printf("cleancache: no counters in this kernel\n");
+
+    return 0;
+}
@@ -4,6 +4,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <time.h>
 #include <xen/xen.h>
 #include <sys/mman.h>
 
@@ -135,21 +136,169 @@ static struct x86_emulate_ops emulops = {
     .get_fpu    = get_fpu,
 };
 
+/*
+ * Decode cache for the blowfish runs.  The code isn't modified while it
+ * runs, so the address and mode are enough of a key.
+ */
+#define DECODE_CACHE_ENTRIES 1024
+
+static struct decode_cache_entry {
+    unsigned long eip;
+    unsigned int addr_size;
+    struct x86_emulate_decode decode;
+} decode_cache[DECODE_CACHE_ENTRIES];
+
+static unsigned long decode_cache_hits, decode_cache_misses;
+
+static struct x86_emulate_decode *decode_cache_slot(
+    struct x86_emulate_ctxt *ctxt)
+{
+    unsigned long eip = ctxt->regs->eip;
+    struct decode_cache_entry *ent =
+        &decode_cache[(eip ^ (eip >> 10)) % DECODE_CACHE_ENTRIES];
+
+    if ( ent->decode.len && (ent->eip == eip) &&
+         (ent->addr_size == ctxt->addr_size) )
+    {
+        decode_cache_hits++;
+        return &ent->decode;
+    }
+
+    decode_cache_misses++;
+    ent->eip = eip;
+    ent->addr_size = ctxt->addr_size;
+    ent->decode.len = 0;
+    return &ent->decode;
+}
+
+/*
+ * Emulate the blowfish code at @code (copied there already) from start to
+ * finish, optionally through the decode cache.  Returns the number of
+ * instructions emulated, or 0 on failure.
+ */
+static unsigned long run_blowfish(
+    struct x86_emulate_ctxt *ctxt, void *code, unsigned int bits,
+    bool use_cache, bool verbose)
+{
+    struct cpu_user_regs *regs = ctxt->regs;
+    unsigned long i = 0;
+    int rc;
+
+    regs->eax = 2;
+    regs->edx = 1;
+    regs->eip = (unsigned long)code;
+    regs->esp = (unsigned long)code + MMAP_SZ - 4;
+    ctxt->addr_size = ctxt->sp_size = bits;
+    if ( bits == 64 )
+    {
+        *(uint32_t *)(unsigned long)regs->esp = 0;
+        regs->esp -= 4;
+    }
+    *(uint32_t *)(unsigned long)regs->esp = 0x12345678;
+    regs->eflags = 2;
+
+    while ( regs->eip != 0x12345678 )
+    {
+        if ( verbose && (i & 8191) == 0 )
+            printf(".");
+        i++;
+        ctxt->decode = use_cache ? decode_cache_slot(ctxt) : NULL;
+        rc = x86_emulate(ctxt, &emulops);
+        if ( rc != X86EMUL_OKAY )
+        {
+            printf("failed at %%eip == %08x\n", (unsigned int)regs->eip);
+            ctxt->decode = NULL;
+            return 0;
+        }
+    }
+    ctxt->decode = NULL;
+
+    if ( (regs->esp != ((unsigned long)code + MMAP_SZ)) ||
+         (regs->eax != 2) || (regs->edx != 1) )
+        return 0;
+
+    return i;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Benchmark mode: emulations per second through the blowfish code, with
+ * and without the decode cache.
+ */
+static int bench(struct x86_emulate_ctxt *ctxt, void *code,
+                 unsigned int iterations)
+{
+    unsigned int bits, i, use_cache;
+    unsigned long insns;
+    double start, secs;
+
+    for ( bits = 32; bits <= 64; bits += 32 )
+    {
+#if defined(__i386__)
+        if ( bits == 64 )
+            break;
+        memcpy(code, blowfish32_code, sizeof(blowfish32_code));
+#else
+        memcpy(code, (bits == 32) ? blowfish32_code : blowfish64_code,
+               (bits == 32) ? sizeof(blowfish32_code)
+                            : sizeof(blowfish64_code));
+#endif
+        for ( use_cache = 0; use_cache <= 1; use_cache++ )
+        {
+            memset(decode_cache, 0, sizeof(decode_cache));
+            decode_cache_hits = decode_cache_misses = 0;
+            insns = 0;
+            start = now();
+            for ( i = 0; i < iterations; i++ )
+            {
+                unsigned long n = run_blowfish(ctxt, code, bits,
+                                               use_cache, false);
+
+                if ( n == 0 )
+                {
+                    printf("blowfish %u-bit code sequence failed\n", bits);
+                    return 1;
+                }
+                insns += n;
+            }
+            secs = now() - start;
+            printf("blowfish %u-bit, %-14s %10.0f emulations/s",
+                   bits, use_cache ? "decode cache:" : "no cache:",
+                   insns / secs);
+            if ( use_cache )
+                printf(" (%.2f%% hits)",
+                       100.0 * decode_cache_hits /
+                       (decode_cache_hits + decode_cache_misses));
+            printf("\n");
+        }
+    }
+
+    return 0;
+}
+
 int main(int argc, char **argv)
 {
     struct x86_emulate_ctxt ctxt;
     struct cpu_user_regs regs;
     char *instr;
-    unsigned int *res, i, j;
+    unsigned int *res, j;
     unsigned long sp;
     bool stack_exec;
     int rc;
 #ifndef __x86_64__
-    unsigned int bcdres_native, bcdres_emul;
+    unsigned int i, bcdres_native, bcdres_emul;
 #endif
 
     ctxt.regs = &regs;
     ctxt.force_writeback = 0;
+    ctxt.decode = NULL;
     ctxt.addr_size = 32;
     ctxt.sp_size   = 32;
 
@@ -172,6 +321,9 @@ int main(int argc, char **argv)
     if ( !stack_exec )
         printf("Warning: Stack could not be made executable (%d).\n", errno);
 
+    if ( (argc > 1) && !strcmp(argv[1], "bench") )
+        return bench(&ctxt, res, (argc > 2) ? strtoul(argv[2], NULL, 0) : 100);
+
     printf("%-40s", "Testing addl %%ecx,(%%eax)...");
     instr[0] = 0x01; instr[1] = 0x08;
     regs.eflags = 0x200;
@@ -683,42 +835,24 @@ int main(int argc, char **argv)
     else
         printf("skipped\n");
 
-    for ( j = 1; j <= 2; j++ )
+    for ( j = 1; j <= 4; j++ )
     {
+        unsigned int bits = (j & 1) ? 32 : 64;
+        bool use_cache = j > 2;
+
 #if defined(__i386__)
-        if ( j == 2 ) break;
+        if ( bits == 64 ) continue;
         memcpy(res, blowfish32_code, sizeof(blowfish32_code));
 #else
-        memcpy(res, (j == 1) ? blowfish32_code : blowfish64_code,
-               (j == 1) ? sizeof(blowfish32_code) : sizeof(blowfish64_code));
+        memcpy(res, (bits == 32) ? blowfish32_code : blowfish64_code,
+               (bits == 32) ? sizeof(blowfish32_code)
+                            : sizeof(blowfish64_code));
 #endif
-        printf("Testing blowfish %u-bit code sequence", j*32);
-        regs.eax = 2;
-        regs.edx = 1;
-        regs.eip = (unsigned long)res;
-        regs.esp = (unsigned long)res + MMAP_SZ - 4;
-        if ( j == 2 )
-        {
-            ctxt.addr_size = ctxt.sp_size = 64;
-            *(uint32_t *)(unsigned long)regs.esp = 0;
-            regs.esp -= 4;
-        }
-        *(uint32_t *)(unsigned long)regs.esp = 0x12345678;
-        regs.eflags = 2;
-        i = 0;
-        while ( regs.eip != 0x12345678 )
-        {
-            if ( (i++ & 8191) == 0 )
-                printf(".");
-            rc = x86_emulate(&ctxt, &emulops);
-            if ( rc != X86EMUL_OKAY )
-            {
-                printf("failed at %%eip == %08x\n", (unsigned int)regs.eip);
-                return 1;
-            }
-        }
-        if ( (regs.esp != ((unsigned long)res + MMAP_SZ)) ||
-             (regs.eax != 2) || (regs.edx != 1) )
+        printf("Testing blowfish %u-bit code sequence%s", bits,
+               use_cache ? " (decode cache)" : "");
+        if ( use_cache )
+            memset(decode_cache, 0, sizeof(decode_cache));
+        if ( !run_blowfish(&ctxt, res, bits, use_cache, true) )
             goto fail;
         printf("okay\n");
     }
@@ -0,0 +1,293 @@
+/*
+ * policy-replay.c
+ *
+ * Replay synthetic guest memory access traces through the xenpaging
+ * victim selection policy, and report the resulting fault rate.
+ *
+ * The guest starts with all of its pages resident and is then held to a
+ * memory target.  Every sampling period a batch of accesses is generated
+ * from the chosen trace; an access to a paged-out page is a fault, which
+ * pages it back in and makes the policy choose a victim to keep the guest
+ * at its target, just as xenpaging would.  At the end of each period the
+ * policy is told which pages were written to, as log-dirty mode would, and
+ * ages the rest.
+ *
+ * Each trace is run with log-dirty information covering all, some and none
+ * of the accesses (only writes show up in the dirty bitmap).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "xc_bitops.h"
+#include "policy.h"
+
+/* The policy only logs through DPRINTF(), which we don't want to see. */
+void xc_report(xc_interface *xch, xentoollog_logger *lg,
+               xentoollog_level level, int code, const char *fmt, ...)
+{
+}
+
+struct trace {
+    const char *name;
+    const char *desc;
+    unsigned long (*next)(unsigned long period);
+};
+
+static unsigned long nr_pages = 32768;
+static unsigned long target = 8192;
+static unsigned long nr_periods = 100;
+static unsigned long nr_accesses = 10000;
+static unsigned long warmup = 10;
+static unsigned long mru_size = 1024;
+static unsigned int ws_periods = 4;
+static unsigned long long rng = 88172645463325252ULL;
+
+/* xorshift64 */
+static unsigned long rnd(unsigned long range)
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    return rng % range;
+}
+
+/* 90% of accesses to a fixed hot tenth of memory, the rest anywhere. */
+static unsigned long next_hotcold(unsigned long period)
+{
+    unsigned long hot = nr_pages / 10;
+
+    return rnd(10) ? rnd(hot) : rnd(nr_pages);
+}
+
+/* A working set of an eighth of memory which moves every 50 periods. */
+static unsigned long next_phases(unsigned long period)
+{
+    unsigned long ws = nr_pages / 8;
+
+    return ((period / 50) * ws + rnd(ws)) % nr_pages;
+}
+
+/* A hot set, plus a sequential scan over all of memory. */
+static unsigned long next_scan(unsigned long period)
+{
+    static unsigned long pos;
+
+    if ( rnd(4) )
+        return rnd(nr_pages / 16);
+    pos = (pos + 1) % nr_pages;
+    return pos;
+}
+
+static const struct trace traces[] = {
+    { "hotcold", "90% of accesses to 10% of memory", next_hotcold },
+    { "phases",  "12.5% working set moving every 50 periods", next_phases },
+    { "scan",    "6% hot set plus a sequential scan", next_scan },
+};
+
+struct result {
+    unsigned long faults;        /* after warm-up */
+    unsigned long est_ws, real_ws; /* summed over periods after warm-up */
+};
+
+static void replay(const struct trace *t, unsigned int writes_pct,
+                   struct result *res)
+{
+    struct xc_interface_core xch;
+    struct xenpaging paging;
+    unsigned long *resident, *dirty;
+    unsigned long *last_use;
+    unsigned long period, i, gfn, nr_resident, nr_out, ws;
+
+    memset(&xch, 0, sizeof(xch));
+    memset(&paging, 0, sizeof(paging));
+    memset(res, 0, sizeof(*res));
+    paging.xc_handle = &xch;
+    paging.max_pages = nr_pages;
+    paging.policy_mru_size = mru_size;
+
+    resident = bitmap_alloc(nr_pages);
+    dirty = bitmap_alloc(nr_pages);
+    last_use = calloc(nr_pages, sizeof(*last_use));
+    if ( !resident || !dirty || !last_use || policy_init(&paging) )
+    {
+        perror("allocating state");
+        exit(1);
+    }
+
+    for ( gfn = 0; gfn < nr_pages; gfn++ )
+        set_bit(gfn, resident);
+    nr_resident = nr_pages;
+    nr_out = 0;
+
+    for ( period = 0; period < nr_periods; period++ )
+    {
+        for ( i = 0; i <= nr_accesses; i++ )
+        {
+            /* Get down to the target before (and after) each access. */
+            while ( nr_resident > target )
+            {
+                gfn = policy_choose_victim(&paging);
+                if ( gfn == INVALID_MFN )
+                    break;
+                policy_notify_paged_out(gfn);
+                clear_bit(gfn, resident);
+                nr_resident--;
+                nr_out++;
+            }
+
+            if ( i == nr_accesses )
+                break;
+
+            gfn = t->next(period);
+            last_use[gfn] = period + 1;
+
+            if ( !test_bit(gfn, resident) )
+            {
+                if ( period >= warmup )
+                    res->faults++;
+                set_bit(gfn, resident);
+                nr_resident++;
+                /* As xenpaging_resume_page() does */
+                if ( nr_out > paging.policy_mru_size )
+                    policy_notify_paged_in(gfn);
+                else
+                    policy_notify_paged_in_nomru(gfn);
+                nr_out--;
+            }
+
+            if ( rnd(100) < writes_pct )
+                set_bit(gfn, dirty);
+        }
+
+        policy_age(&paging, writes_pct ? dirty : NULL);
+        bitmap_clear(dirty, nr_pages);
+
+        if ( period < warmup )
+            continue;
+
+        for ( ws = gfn = 0; gfn < nr_pages; gfn++ )
+            if ( last_use[gfn] && period + 1 - last_use[gfn] < ws_periods )
+                ws++;
+        res->real_ws += ws;
+        res->est_ws += policy_working_set();
+    }
+
+    free(resident);
+    free(dirty);
+    free(last_use);
+}
+
+static void usage(const char *prog)
+{
+    unsigned int i;
+
+    fprintf(stderr,
+            "usage: %s [-n pages] [-t target] [-p periods] [-a accesses]\n"
+            "          [-m mru_size] [-w warmup] [-s seed] [trace...]\n"
+            "  -n  guest pages (default %lu)\n"
+            "  -t  memory target in pages (default %lu)\n"
+            "  -p  sampling periods to replay (default %lu)\n"
+            "  -a  accesses per period (default %lu)\n"
+            "  -m  paged-in pages kept from being paged out again, a power\n"
+            "      of two (default %lu)\n"
+            "  -w  periods before faults are counted (default %lu)\n"
+            "  -s  random seed\n"
+            "traces:\n",
+            prog, nr_pages, target, nr_periods, nr_accesses, mru_size,
+            warmup);
+    for ( i = 0; i < sizeof(traces) / sizeof(traces[0]); i++ )
+        fprintf(stderr, "  %-8s %s\n", traces[i].name, traces[i].desc);
+    exit(2);
+}
+
+int main(int argc, char *argv[])
+{
+    static const unsigned int writes[] = { 100, 30, 0 };
+    const struct trace *t;
+    struct result res;
+    unsigned int i, j;
+    int opt, status;
+    pid_t pid;
+
+    while ( (opt = getopt(argc, argv, "n:t:p:a:m:w:s:h")) != -1 )
+    {
+        switch ( opt )
+        {
+        case 'n':
+            nr_pages = strtoul(optarg, NULL, 0);
+            break;
+        case 't':
+            target = strtoul(optarg, NULL, 0);
+            break;
+        case 'p':
+            nr_periods = strtoul(optarg, NULL, 0);
+            break;
+        case 'a':
+            nr_accesses = strtoul(optarg, NULL, 0);
+            break;
+        case 'm':
+            mru_size = strtoul(optarg, NULL, 0);
+            break;
+        case 'w':
+            warmup = strtoul(optarg, NULL, 0);
+            break;
+        case 's':
+            rng = strtoull(optarg, NULL, 0) ? : rng;
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+    if ( !nr_pages || !target || target >= nr_pages ||
+         nr_periods <= warmup || !mru_size ||
+         (mru_size & (mru_size - 1)) )
+        usage(argv[0]);
+
+    printf("%lu pages, target %lu, %lu periods of %lu accesses\n\n",
+           nr_pages, target, nr_periods, nr_accesses);
+    printf("%-8s %7s %12s %10s %10s\n",
+           "trace", "dirty%", "faults/per", "est ws", "real ws");
+
+    for ( i = 0; i < sizeof(traces) / sizeof(traces[0]); i++ )
+    {
+        t = &traces[i];
+        if ( optind < argc )
+        {
+            for ( j = optind; j < argc; j++ )
+                if ( !strcmp(argv[j], t->name) )
+                    break;
+            if ( j == argc )
+                continue;
+        }
+
+        /* The policy keeps its state in globals: one process per run. */
+        for ( j = 0; j < sizeof(writes) / sizeof(writes[0]); j++ )
+        {
+            fflush(stdout);
+            pid = fork();
+            if ( pid < 0 )
+            {
+                perror("fork");
+                return 1;
+            }
+            if ( pid == 0 )
+            {
+                replay(t, writes[j], &res);
+                printf("%-8s %7u %12.1f %10lu %10lu\n", t->name, writes[j],
+                       (double)res.faults / (nr_periods - warmup),
+                       res.est_ws / (nr_periods - warmup),
+                       res.real_ws / (nr_periods - warmup));
+                exit(0);
+            }
+            if ( waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) ||
+                 WEXITSTATUS(status) )
+                return 1;
+        }
+    }
+
+    return 0;
+}
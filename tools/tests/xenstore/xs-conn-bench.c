@@ -0,0 +1,177 @@
+/*
+ * xs-conn-bench.c
+ *
+ * Load xenstored with many simultaneous socket connections.
+ *
+ * Connections are opened up to each of the requested counts in turn; at
+ * every count a fixed number of write-then-read requests is issued,
+ * spread round-robin over all open connections.  With a readiness-based
+ * event loop the request rate should not depend on the number of idle
+ * connections, and xenstored must keep working past FD_SETSIZE.
+ *
+ * Run against a xenstored you don't care about, e.g.:
+ *   xenstored --no-domain-init --internal-db
+ * with a file descriptor limit large enough for the connections.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include <xenstore.h>
+
+#define CONN_DIR "/bench/conn"
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [-c count,count,...] [-r requests] [-k]\n"
+            "  -c  connection counts to measure at (default 10,500,2000)\n"
+            "  -r  requests per measurement (default 20000)\n"
+            "  -k  keep the benchmark nodes in the store afterwards\n",
+            prog);
+    exit(2);
+}
+
+static double now(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/* Make room for the connections, plus a few descriptors to spare. */
+static void raise_fd_limit(unsigned int nr)
+{
+    struct rlimit rl;
+
+    if ( getrlimit(RLIMIT_NOFILE, &rl) )
+        return;
+    if ( rl.rlim_cur >= nr + 16 )
+        return;
+    rl.rlim_cur = nr + 16;
+    if ( rl.rlim_max != RLIM_INFINITY && rl.rlim_cur > rl.rlim_max )
+        rl.rlim_cur = rl.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &rl);
+}
+
+static void request(struct xs_handle *xsh, unsigned int conn,
+                    unsigned int seq)
+{
+    char path[64], val[16], *got;
+    unsigned int len;
+
+    snprintf(path, sizeof(path), CONN_DIR "/%u", conn);
+    snprintf(val, sizeof(val), "%u", seq);
+
+    if ( !xs_write(xsh, XBT_NULL, path, val, strlen(val)) )
+    {
+        fprintf(stderr, "connection %u: xs_write: %s\n",
+                conn, strerror(errno));
+        exit(1);
+    }
+
+    got = xs_read(xsh, XBT_NULL, path, &len);
+    if ( !got || len != strlen(val) || memcmp(got, val, len) )
+    {
+        fprintf(stderr, "connection %u: read back %s, expected %s\n",
+                conn, got ? got : "nothing", val);
+        exit(1);
+    }
+    free(got);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *counts = "10,500,2000";
+    unsigned int nr_requests = 20000, nr_conns = 0, max_conns = 0;
+    unsigned int count, i;
+    bool keep = false;
+    struct xs_handle **xsh = NULL;
+    char *p, *end;
+    double start, elapsed;
+    int opt;
+
+    while ( (opt = getopt(argc, argv, "c:r:kh")) != -1 )
+    {
+        switch ( opt )
+        {
+        case 'c':
+            counts = optarg;
+            break;
+        case 'r':
+            nr_requests = strtoul(optarg, NULL, 0);
+            break;
+        case 'k':
+            keep = true;
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+    if ( optind != argc || !nr_requests )
+        usage(argv[0]);
+
+    printf("%10s %10s %12s %12s\n",
+           "conns", "requests", "requests/sec", "connect ms");
+
+    for ( p = (char *)counts; *p; p = end )
+    {
+        count = strtoul(p, &end, 0);
+        if ( end == p || !count || (*end && *end != ',') )
+            usage(argv[0]);
+        if ( *end == ',' )
+            end++;
+
+        if ( count > max_conns )
+        {
+            xsh = realloc(xsh, count * sizeof(*xsh));
+            if ( !xsh )
+            {
+                perror("realloc");
+                return 1;
+            }
+            max_conns = count;
+            raise_fd_limit(count);
+        }
+
+        start = now();
+        for ( ; nr_conns < count; nr_conns++ )
+        {
+            xsh[nr_conns] = xs_open(0);
+            if ( !xsh[nr_conns] )
+            {
+                fprintf(stderr, "xs_open of connection %u: %s\n",
+                        nr_conns, strerror(errno));
+                return 1;
+            }
+        }
+        elapsed = now() - start;
+
+        /* Every connection must still be serviced... */
+        for ( i = 0; i < nr_conns; i++ )
+            request(xsh[i], i, 0);
+
+        /* ...and the rate should not depend on how many there are. */
+        start = now();
+        for ( i = 0; i < nr_requests; i++ )
+            request(xsh[i % nr_conns], i % nr_conns, i);
+
+        printf("%10u %10u %12.0f %12.1f\n", nr_conns, nr_requests,
+               nr_requests / (now() - start), elapsed * 1000);
+    }
+
+    if ( !keep && nr_conns )
+        xs_rm(xsh[0], XBT_NULL, CONN_DIR);
+
+    for ( i = 0; i < nr_conns; i++ )
+        xs_close(xsh[i]);
+    free(xsh);
+
+    return 0;
+}
@@ -0,0 +1,187 @@
+/*
+ * xs-trans-bench.c
+ *
+ * Measure xenstored transaction throughput as the store grows.
+ *
+ * The store is filled with dummy nodes under /bench/fill up to each of the
+ * requested sizes in turn; at every size a fixed number of small
+ * transactions (read and rewrite a handful of nodes under /bench/txn) is
+ * timed.  Transaction cost should depend on the number of nodes touched,
+ * not on the number of nodes in the store.
+ *
+ * Run against a xenstored you don't care about, e.g.:
+ *   xenstored --no-domain-init --internal-db
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include <xenstore.h>
+
+#define FILL_DIR  "/bench/fill"
+#define TXN_DIR   "/bench/txn"
+#define FILL_FANOUT 100
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [-s size,size,...] [-t transactions] [-w writes] [-k]\n"
+            "  -s  store sizes (nodes) to measure at (default 1000,10000,50000)\n"
+            "  -t  transactions per measurement (default 1000)\n"
+            "  -w  nodes read and written per transaction (default 4)\n"
+            "  -k  keep the benchmark nodes in the store afterwards\n",
+            prog);
+    exit(2);
+}
+
+static double now(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static void fill_store(struct xs_handle *xsh, unsigned int from,
+                       unsigned int to)
+{
+    char path[64], val[16];
+    unsigned int i;
+
+    for ( i = from; i < to; i++ )
+    {
+        snprintf(path, sizeof(path), FILL_DIR "/%u/%u",
+                 i / FILL_FANOUT, i % FILL_FANOUT);
+        snprintf(val, sizeof(val), "%u", i);
+        if ( !xs_write(xsh, XBT_NULL, path, val, strlen(val)) )
+        {
+            perror("xs_write");
+            exit(1);
+        }
+    }
+}
+
+/* One read-modify-write transaction over nr nodes; returns retries taken. */
+static unsigned int run_transaction(struct xs_handle *xsh, unsigned int seq,
+                                    unsigned int nr)
+{
+    char path[64], val[16];
+    unsigned int i, len, retries = 0;
+    xs_transaction_t t;
+    char *old;
+
+ again:
+    t = xs_transaction_start(xsh);
+    if ( t == XBT_NULL )
+    {
+        perror("xs_transaction_start");
+        exit(1);
+    }
+
+    for ( i = 0; i < nr; i++ )
+    {
+        snprintf(path, sizeof(path), TXN_DIR "/%u", i);
+        old = xs_read(xsh, t, path, &len);
+        free(old);
+        snprintf(val, sizeof(val), "%u", seq);
+        if ( !xs_write(xsh, t, path, val, strlen(val)) )
+        {
+            perror("xs_write");
+            exit(1);
+        }
+    }
+
+    if ( !xs_transaction_end(xsh, t, false) )
+    {
+        if ( errno != EAGAIN )
+        {
+            perror("xs_transaction_end");
+            exit(1);
+        }
+        retries++;
+        goto again;
+    }
+
+    return retries;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *sizes = "1000,10000,50000";
+    unsigned int nr_txns = 1000, nr_writes = 4, filled = 0;
+    unsigned int size, i, retries;
+    bool keep = false;
+    struct xs_handle *xsh;
+    char *p, *end;
+    double start, elapsed;
+    int opt;
+
+    while ( (opt = getopt(argc, argv, "s:t:w:kh")) != -1 )
+    {
+        switch ( opt )
+        {
+        case 's':
+            sizes = optarg;
+            break;
+        case 't':
+            nr_txns = strtoul(optarg, NULL, 0);
+            break;
+        case 'w':
+            nr_writes = strtoul(optarg, NULL, 0);
+            break;
+        case 'k':
+            keep = true;
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+    if ( optind != argc || !nr_txns || !nr_writes )
+        usage(argv[0]);
+
+    xsh = xs_open(0);
+    if ( !xsh )
+    {
+        perror("xs_open");
+        return 1;
+    }
+
+    xs_rm(xsh, XBT_NULL, "/bench");
+
+    printf("%10s %10s %12s %10s\n", "nodes", "txns", "txns/sec", "retries");
+
+    for ( p = (char *)sizes; *p; p = end )
+    {
+        size = strtoul(p, &end, 0);
+        if ( end == p || (*end && *end != ',') )
+            usage(argv[0]);
+        if ( *end == ',' )
+            end++;
+
+        if ( size > filled )
+        {
+            fill_store(xsh, filled, size);
+            filled = size;
+        }
+
+        retries = 0;
+        start = now();
+        for ( i = 0; i < nr_txns; i++ )
+            retries += run_transaction(xsh, i, nr_writes);
+        elapsed = now() - start;
+
+        printf("%10u %10u %12.0f %10u\n", filled, nr_txns,
+               nr_txns / elapsed, retries);
+    }
+
+    if ( !keep )
+        xs_rm(xsh, XBT_NULL, "/bench");
+
+    xs_close(xsh);
+
+    return 0;
+}
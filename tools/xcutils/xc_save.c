@@ -170,8 +170,8 @@ main(int argc, char **argv)
     int io_fd, ret, port;
     struct save_callbacks callbacks;
 
-    if (argc != 6)
-        errx(1, "usage: %s iofd domid maxit maxf flags", argv[0]);
+    if (argc != 6 && argc != 7)
+        errx(1, "usage: %s iofd domid maxit maxf flags [workers]", argv[0]);
 
     si.xch = xc_interface_open(0,0,0);
     if (!si.xch)
@@ -182,6 +182,8 @@ main(int argc, char **argv)
     maxit = atoi(argv[3]);
     max_f = atoi(argv[4]);
     si.flags = atoi(argv[5]);
+    if (argc == 7)
+        si.flags |= XCFLAGS_WORKERS(atoi(argv[6]));
 
     si.suspend_evtchn = -1;
 
@@ -0,0 +1,719 @@
+/******************************************************************************
+ * xendedup.c
+ *
+ * Background page deduplication.
+ *
+ * Scans the memory of running HVM guests through read-only foreign
+ * mappings, hashes the content of every page and shares pages with
+ * identical content, within and across domains, using the mem_sharing
+ * nominate/share interface.  All zero pages, by far the most common
+ * duplicates, are recognised without being hashed.
+ *
+ * The hash only selects candidates.  Nothing is shared until both pages
+ * have been nominated and then compared byte for byte: a write to a page
+ * after its nomination invalidates its handle, so the hypervisor refuses
+ * to share a page which changed after the comparison.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#define _GNU_SOURCE
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include <xenctrl.h>
+
+#define PAGE_SHIFT        XC_PAGE_SHIFT
+#define PAGE_SIZE         XC_PAGE_SIZE
+
+#define MAX_DOMS          256
+#define MAX_THREADS       64
+/* Pages mapped, hashed and unmapped at a time by a scanner thread. */
+#define CHUNK_PAGES       256
+/* The hash table is split into shards, each with its own lock. */
+#define NR_SHARDS         64
+#define SHARD_MIN_SIZE    1024
+
+/* Key of all zero pages.  page_hash() never returns it. */
+#define ZERO_KEY          0
+
+struct dom {
+    domid_t domid;
+    unsigned long max_gfn;
+};
+
+/*
+ * One representative page per content hash.  A handle of 0 means the page
+ * has not been nominated yet.
+ */
+struct entry {
+    uint64_t key;
+    uint64_t handle;
+    unsigned long gfn;
+    domid_t domid;                      /* DOMID_INVALID if unused */
+};
+
+struct shard {
+    pthread_mutex_t lock;
+    struct entry *tab;
+    unsigned long size, used;           /* size is a power of two */
+};
+
+struct stats {
+    uint64_t scanned;                   /* pages mapped and hashed */
+    uint64_t zero;                      /* ... of which were all zero */
+    uint64_t shared;                    /* newly shared pages */
+    uint64_t already;                   /* pages found already shared */
+    uint64_t mismatch;                  /* hash collisions and stale entries */
+    uint64_t failed;                    /* nominate or share failures */
+};
+
+struct worker {
+    pthread_t thread;
+    xc_interface *xch;
+    struct stats stats;
+};
+
+static int verbose;
+static int interrupted;
+static unsigned long rate;              /* pages per second, 0 = unlimited */
+
+static struct shard shards[NR_SHARDS];
+
+static struct dom doms[MAX_DOMS];
+static unsigned int nr_doms;
+
+/* Next chunk to scan: doms[cur_dom], starting at cur_gfn. */
+static pthread_mutex_t cursor_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned int cur_dom;
+static unsigned long cur_gfn;
+
+static pthread_mutex_t rate_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t rate_next;
+
+static void close_handler(int sig)
+{
+    interrupted = sig;
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*
+ * Limit the scan to rate pages per second over all threads.  Each chunk
+ * reserves its share of time on a common clock, and the thread sleeps
+ * until its slot comes up.  Idle time is not saved up for later bursts.
+ */
+static void rate_limit(unsigned int nr_pages)
+{
+    uint64_t now, slot;
+    struct timespec ts;
+
+    if ( !rate )
+        return;
+
+    pthread_mutex_lock(&rate_lock);
+    now = now_ns();
+    slot = rate_next > now ? rate_next : now;
+    rate_next = slot + nr_pages * 1000000000ULL / rate;
+    pthread_mutex_unlock(&rate_lock);
+
+    if ( slot > now )
+    {
+        ts.tv_sec = (slot - now) / 1000000000ULL;
+        ts.tv_nsec = (slot - now) % 1000000000ULL;
+        nanosleep(&ts, NULL);
+    }
+}
+
+static int page_is_zero(const void *page)
+{
+    const uint64_t *p = page;
+    unsigned int i;
+
+    for ( i = 0; i < PAGE_SIZE / sizeof(*p); i++ )
+        if ( p[i] )
+            return 0;
+    return 1;
+}
+
+/* 64-bit multiply-xorshift hash, a word at a time. */
+static uint64_t page_hash(const void *page)
+{
+    const uint64_t *p = page;
+    uint64_t h = 0x9e3779b97f4a7c15ULL;
+    unsigned int i;
+
+    for ( i = 0; i < PAGE_SIZE / sizeof(*p); i++ )
+    {
+        h ^= p[i];
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 32;
+    }
+    h ^= h >> 29;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 32;
+
+    return h != ZERO_KEY ? h : 1;
+}
+
+static struct shard *key_shard(uint64_t key)
+{
+    return &shards[(key >> 58) % NR_SHARDS];
+}
+
+static int shard_alloc(struct shard *s, unsigned long size)
+{
+    unsigned long i;
+
+    s->tab = malloc(size * sizeof(*s->tab));
+    if ( !s->tab )
+        return -1;
+    for ( i = 0; i < size; i++ )
+        s->tab[i].domid = DOMID_INVALID;
+    s->size = size;
+    s->used = 0;
+    return 0;
+}
+
+static struct entry *shard_slot(struct shard *s, uint64_t key)
+{
+    unsigned long i = key & (s->size - 1);
+
+    while ( s->tab[i].domid != DOMID_INVALID && s->tab[i].key != key )
+        i = (i + 1) & (s->size - 1);
+    return &s->tab[i];
+}
+
+/*
+ * Rebuild a shard at the given size, keeping only the entries which belong
+ * to domains being scanned.  Called with the shard locked, or before the
+ * scanner threads start.
+ */
+static int shard_rebuild(struct shard *s, unsigned long size)
+{
+    struct entry *old = s->tab;
+    unsigned long i, old_size = s->size;
+    unsigned int d;
+
+    if ( shard_alloc(s, size) )
+    {
+        s->tab = old;
+        s->size = old_size;
+        return -1;
+    }
+
+    for ( i = 0; i < old_size; i++ )
+    {
+        if ( old[i].domid == DOMID_INVALID )
+            continue;
+        for ( d = 0; d < nr_doms; d++ )
+            if ( doms[d].domid == old[i].domid )
+                break;
+        if ( d == nr_doms )
+            continue;
+        *shard_slot(s, old[i].key) = old[i];
+        s->used++;
+    }
+
+    free(old);
+    return 0;
+}
+
+static int compare_pages(xc_interface *xch, const struct entry *a,
+                         domid_t domid, unsigned long gfn)
+{
+    void *pa, *pb;
+    int rc = -1;
+
+    pa = xc_map_foreign_range(xch, a->domid, PAGE_SIZE, PROT_READ, a->gfn);
+    pb = xc_map_foreign_range(xch, domid, PAGE_SIZE, PROT_READ, gfn);
+    if ( pa && pb )
+        rc = memcmp(pa, pb, PAGE_SIZE);
+    if ( pa )
+        munmap(pa, PAGE_SIZE);
+    if ( pb )
+        munmap(pb, PAGE_SIZE);
+
+    return rc;
+}
+
+/*
+ * Try to share domid:gfn, whose content hashed to key, with the page
+ * already in the table for that key, or make it the table's page for key
+ * if there is none.  Called with the key's shard locked.
+ */
+static void dedup_page(struct worker *w, struct shard *s, uint64_t key,
+                       domid_t domid, unsigned long gfn)
+{
+    xc_interface *xch = w->xch;
+    struct entry *e = shard_slot(s, key);
+    uint64_t handle;
+
+    if ( e->domid == DOMID_INVALID )
+    {
+        e->key = key;
+        e->handle = 0;
+        e->gfn = gfn;
+        e->domid = domid;
+        s->used++;
+        return;
+    }
+
+    if ( e->domid == domid && e->gfn == gfn )
+        return;
+
+    /* No mapping of either page may be held while they are nominated. */
+    if ( !e->handle && xc_memshr_nominate_gfn(xch, e->domid, e->gfn,
+                                              &e->handle) )
+    {
+        /* The table's page has gone, or can't be shared: replace it. */
+        e->handle = 0;
+        e->gfn = gfn;
+        e->domid = domid;
+        return;
+    }
+
+    if ( xc_memshr_nominate_gfn(xch, domid, gfn, &handle) )
+    {
+        w->stats.failed++;
+        return;
+    }
+
+    if ( handle == e->handle )
+    {
+        w->stats.already++;
+        return;
+    }
+
+    /*
+     * Both handles are now live.  If either page is written after this
+     * comparison its handle goes stale and the share below fails.
+     */
+    if ( compare_pages(xch, e, domid, gfn) )
+    {
+        /* The newer page is the more likely one to be matched again. */
+        w->stats.mismatch++;
+        e->handle = handle;
+        e->gfn = gfn;
+        e->domid = domid;
+        return;
+    }
+
+    if ( !xc_memshr_share_gfns(xch, e->domid, e->gfn, e->handle,
+                               domid, gfn, handle) )
+    {
+        w->stats.shared++;
+        return;
+    }
+
+    if ( errno == -XENMEM_SHARING_OP_S_HANDLE_INVALID )
+    {
+        /* The table's page changed since it was nominated. */
+        e->handle = handle;
+        e->gfn = gfn;
+        e->domid = domid;
+    }
+    else if ( verbose )
+        fprintf(stderr, "share dom%u:%lx with dom%u:%lx: %s\n",
+                e->domid, e->gfn, domid, gfn, strerror(errno));
+    w->stats.failed++;
+}
+
+static void dedup_key(struct worker *w, uint64_t key, domid_t domid,
+                      unsigned long gfn)
+{
+    struct shard *s = key_shard(key);
+
+    pthread_mutex_lock(&s->lock);
+
+    /* Keep the load factor below 3/4. */
+    if ( (s->used + 1) * 4 > s->size * 3 &&
+         shard_rebuild(s, s->size * 2) )
+    {
+        pthread_mutex_unlock(&s->lock);
+        w->stats.failed++;
+        return;
+    }
+
+    dedup_page(w, s, key, domid, gfn);
+
+    pthread_mutex_unlock(&s->lock);
+}
+
+/* Take the next chunk to scan.  Returns 0 when the pass is complete. */
+static unsigned int next_chunk(domid_t *domid, xen_pfn_t *gfns)
+{
+    unsigned int i, n = 0;
+
+    pthread_mutex_lock(&cursor_lock);
+    while ( cur_dom < nr_doms && cur_gfn > doms[cur_dom].max_gfn )
+    {
+        cur_dom++;
+        cur_gfn = 0;
+    }
+    if ( cur_dom < nr_doms )
+    {
+        *domid = doms[cur_dom].domid;
+        for ( i = 0; i < CHUNK_PAGES && cur_gfn <= doms[cur_dom].max_gfn;
+              i++ )
+            gfns[n++] = cur_gfn++;
+    }
+    pthread_mutex_unlock(&cursor_lock);
+
+    return n;
+}
+
+static void *scan_thread(void *arg)
+{
+    struct worker *w = arg;
+    xen_pfn_t gfns[CHUNK_PAGES];
+    uint64_t keys[CHUNK_PAGES];
+    int err[CHUNK_PAGES];
+    unsigned int i, n;
+    domid_t domid;
+    char *map;
+
+    while ( !interrupted && (n = next_chunk(&domid, gfns)) )
+    {
+        rate_limit(n);
+
+        map = xc_map_foreign_bulk(w->xch, domid, PROT_READ, gfns, err, n);
+        if ( !map )
+            continue;
+
+        for ( i = 0; i < n; i++ )
+        {
+            if ( err[i] )
+                continue;
+            w->stats.scanned++;
+            if ( page_is_zero(map + i * PAGE_SIZE) )
+            {
+                w->stats.zero++;
+                keys[i] = ZERO_KEY;
+            }
+            else
+                keys[i] = page_hash(map + i * PAGE_SIZE);
+        }
+
+        munmap(map, n * PAGE_SIZE);
+
+        for ( i = 0; i < n && !interrupted; i++ )
+            if ( !err[i] )
+                dedup_key(w, keys[i], domid, gfns[i]);
+    }
+
+    return NULL;
+}
+
+static int find_domains(xc_interface *xch, const domid_t *only,
+                        unsigned int nr_only, int enable)
+{
+    xc_dominfo_t info[MAX_DOMS];
+    unsigned int i, j;
+    int n, max_gfn;
+
+    n = xc_domain_getinfo(xch, 1, MAX_DOMS, info);
+    if ( n < 0 )
+    {
+        perror("xc_domain_getinfo");
+        return -1;
+    }
+
+    nr_doms = 0;
+    for ( i = 0; i < n; i++ )
+    {
+        /* Sharing needs HAP, so only HVM guests can take part. */
+        if ( !info[i].hvm || info[i].dying || info[i].shutdown )
+            continue;
+        if ( nr_only )
+        {
+            for ( j = 0; j < nr_only; j++ )
+                if ( only[j] == info[i].domid )
+                    break;
+            if ( j == nr_only )
+                continue;
+        }
+
+        if ( enable && xc_memshr_control(xch, info[i].domid, 1) )
+        {
+            fprintf(stderr, "enabling sharing for dom%u: %s\n",
+                    info[i].domid, strerror(errno));
+            continue;
+        }
+
+        max_gfn = xc_domain_maximum_gpfn(xch, info[i].domid);
+        if ( max_gfn < 0 )
+            continue;
+
+        doms[nr_doms].domid = info[i].domid;
+        doms[nr_doms].max_gfn = max_gfn;
+        nr_doms++;
+    }
+
+    return 0;
+}
+
+static void write_stats(const char *path, const struct stats *total,
+                        unsigned long passes, double scan_rate,
+                        long saved, long cow_breaks)
+{
+    char tmp[256];
+    FILE *f;
+
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    f = fopen(tmp, "w");
+    if ( !f )
+    {
+        perror(tmp);
+        return;
+    }
+
+    fprintf(f, "passes=%lu\n", passes);
+    fprintf(f, "scanned_pages=%"PRIu64"\n", total->scanned);
+    fprintf(f, "zero_pages=%"PRIu64"\n", total->zero);
+    fprintf(f, "shared_pages=%"PRIu64"\n", total->shared);
+    fprintf(f, "already_shared_pages=%"PRIu64"\n", total->already);
+    fprintf(f, "mismatches=%"PRIu64"\n", total->mismatch);
+    fprintf(f, "failures=%"PRIu64"\n", total->failed);
+    fprintf(f, "scan_rate=%.0f\n", scan_rate);
+    fprintf(f, "saved_pages=%ld\n", saved);
+    fprintf(f, "cow_breaks=%ld\n", cow_breaks);
+
+    /* Readers never see a partially written file. */
+    if ( fclose(f) || rename(tmp, path) )
+        perror(path);
+}
+
+static void usage(void)
+{
+    printf("usage: xendedup [options]\n"
+           "\n"
+           "Share identical pages of running HVM guests.\n"
+           "\n"
+           "  -d <domid>[,<domid>...]   only scan these domains (default: all)\n"
+           "  -e                        enable sharing on the scanned domains\n"
+           "  -r <pages>                scan at most this many pages per second\n"
+           "                            (default: unlimited)\n"
+           "  -t <threads>              scanner threads (default: 1)\n"
+           "  -i <seconds>              pause between passes (default: 60)\n"
+           "  -S <file>                 write statistics to file after each pass\n"
+           "  -o                        make one pass and exit\n"
+           "  -v                        verbose\n"
+           "  -h                        this help\n"
+           "\n"
+           "A domain without a sharing ENOMEM ring may crash if breaking the\n"
+           "sharing of a page fails for lack of memory.\n");
+}
+
+int main(int argc, char *argv[])
+{
+    static struct worker workers[MAX_THREADS];
+    domid_t only[MAX_DOMS];
+    unsigned int nr_only = 0, nr_threads = 1, interval = 60;
+    unsigned int i;
+    unsigned long passes = 0;
+    int enable = 0, once = 0, ch;
+    const char *stats_file = NULL;
+    struct stats total, pass;
+    struct sigaction act;
+    xc_interface *xch;
+    uint64_t start, ns;
+    double scan_rate;
+    long saved, cow_breaks, last_cow_breaks;
+    char *p;
+
+    while ( (ch = getopt(argc, argv, "d:er:t:i:S:ovh")) != -1 )
+    {
+        switch ( ch )
+        {
+        case 'd':
+            for ( p = optarg; *p && nr_only < MAX_DOMS; )
+            {
+                only[nr_only++] = strtoul(p, &p, 0);
+                if ( *p == ',' )
+                    p++;
+                else if ( *p )
+                {
+                    usage();
+                    return 1;
+                }
+            }
+            break;
+        case 'e':
+            enable = 1;
+            break;
+        case 'r':
+            rate = strtoul(optarg, NULL, 0);
+            break;
+        case 't':
+            nr_threads = strtoul(optarg, NULL, 0);
+            if ( !nr_threads || nr_threads > MAX_THREADS )
+            {
+                fprintf(stderr, "threads must be 1 to %u\n", MAX_THREADS);
+                return 1;
+            }
+            break;
+        case 'i':
+            interval = strtoul(optarg, NULL, 0);
+            break;
+        case 'S':
+            stats_file = optarg;
+            break;
+        case 'o':
+            once = 1;
+            break;
+        case 'v':
+            verbose = 1;
+            break;
+        case 'h':
+            usage();
+            return 0;
+        default:
+            usage();
+            return 1;
+        }
+    }
+
+    xch = xc_interface_open(NULL, NULL, 0);
+    if ( !xch )
+    {
+        fprintf(stderr, "failed to open xc interface\n");
+        return 1;
+    }
+    for ( i = 0; i < nr_threads; i++ )
+    {
+        workers[i].xch = xc_interface_open(NULL, NULL, 0);
+        if ( !workers[i].xch )
+        {
+            fprintf(stderr, "failed to open xc interface\n");
+            return 1;
+        }
+    }
+
+    for ( i = 0; i < NR_SHARDS; i++ )
+    {
+        pthread_mutex_init(&shards[i].lock, NULL);
+        if ( shard_alloc(&shards[i], SHARD_MIN_SIZE) )
+        {
+            perror("allocating hash table");
+            return 1;
+        }
+    }
+
+    act.sa_handler = close_handler;
+    act.sa_flags = 0;
+    sigemptyset(&act.sa_mask);
+    sigaction(SIGTERM, &act, NULL);
+    sigaction(SIGINT,  &act, NULL);
+
+    memset(&total, 0, sizeof(total));
+    last_cow_breaks = xc_sharing_cow_breaks(xch);
+
+    while ( !interrupted )
+    {
+        if ( find_domains(xch, only, nr_only, enable) )
+            return 1;
+        /* Only the first pass needs to turn sharing on. */
+        enable = 0;
+
+        /* Forget the pages of domains which have gone away. */
+        for ( i = 0; i < NR_SHARDS; i++ )
+            if ( shard_rebuild(&shards[i], shards[i].size) )
+            {
+                perror("rebuilding hash table");
+                return 1;
+            }
+
+        cur_dom = 0;
+        cur_gfn = 0;
+        start = now_ns();
+
+        for ( i = 0; i < nr_threads; i++ )
+        {
+            memset(&workers[i].stats, 0, sizeof(workers[i].stats));
+            if ( pthread_create(&workers[i].thread, NULL, scan_thread,
+                                &workers[i]) )
+            {
+                perror("pthread_create");
+                return 1;
+            }
+        }
+
+        memset(&pass, 0, sizeof(pass));
+        for ( i = 0; i < nr_threads; i++ )
+        {
+            pthread_join(workers[i].thread, NULL);
+            pass.scanned += workers[i].stats.scanned;
+            pass.zero += workers[i].stats.zero;
+            pass.shared += workers[i].stats.shared;
+            pass.already += workers[i].stats.already;
+            pass.mismatch += workers[i].stats.mismatch;
+            pass.failed += workers[i].stats.failed;
+        }
+        total.scanned += pass.scanned;
+        total.zero += pass.zero;
+        total.shared += pass.shared;
+        total.already += pass.already;
+        total.mismatch += pass.mismatch;
+        total.failed += pass.failed;
+        passes++;
+
+        ns = now_ns() - start;
+        scan_rate = ns ? pass.scanned * 1e9 / ns : 0;
+        saved = xc_sharing_freed_pages(xch);
+        cow_breaks = xc_sharing_cow_breaks(xch);
+
+        printf("pass %lu: %u domains, %"PRIu64" pages (%"PRIu64" zero) "
+               "in %.1fs, %.0f pages/s; shared %"PRIu64", already %"PRIu64
+               ", mismatched %"PRIu64", failed %"PRIu64"; saving %ld pages "
+               "(%ld MB), %ld CoW breaks since last pass\n",
+               passes, nr_doms, pass.scanned, pass.zero, ns / 1e9,
+               scan_rate, pass.shared, pass.already, pass.mismatch,
+               pass.failed, saved, saved >> (20 - PAGE_SHIFT),
+               cow_breaks - last_cow_breaks);
+        fflush(stdout);
+        last_cow_breaks = cow_breaks;
+
+        if ( stats_file )
+            write_stats(stats_file, &total, passes, scan_rate, saved,
+                        cow_breaks);
+
+        if ( once )
+            break;
+        for ( i = 0; i < interval && !interrupted; i++ )
+            sleep(1);
+    }
+
+    for ( i = 0; i < nr_threads; i++ )
+        xc_interface_close(workers[i].xch);
+    xc_interface_close(xch);
+
+    return 0;
+}
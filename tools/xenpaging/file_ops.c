@@ -21,24 +21,108 @@
 
 
 #include <unistd.h>
+#include <pthread.h>
+#include <zlib.h>
 #include <xc_private.h>
 
-static int file_op(int fd, void *page, int i,
-                   ssize_t (*fn)(int, void *, size_t))
+#include "xc_bitops.h"
+#include "file_ops.h"
+#include "xenpaging.h"
+
+/*
+ * The paging file is allocated in units of PAGEFILE_UNIT_SIZE bytes, so
+ * that compressed pages can be packed together.  Every batch of pages
+ * paged out together is written to one contiguous run of units with a
+ * single write, and is read back the same way when any page of it is
+ * needed again, which prefetches its neighbours.
+ *
+ * Batches are held in a small cache while they are being written, read,
+ * or were read recently; page-ins are served from there when possible.
+ * Reads and writes are done by a pool of I/O threads, and completed by
+ * the main thread in pagefile_reap(), so only the main thread changes the
+ * state of a batch or the slot allocation.  A batch's pages may be evicted
+ * before its write completes, so a failed write is retried every second
+ * for as long as it takes, and the batch stays cached meanwhile.
+ */
+#define PAGEFILE_UNIT_SHIFT  8
+#define PAGEFILE_UNIT_SIZE   (1UL << PAGEFILE_UNIT_SHIFT)
+#define PAGEFILE_PAGE_UNITS  (PAGE_SIZE >> PAGEFILE_UNIT_SHIFT)
+
+#define PAGEFILE_CACHE_SIZE  64
+#define PAGEFILE_IO_THREADS  4
+
+/* Pages which don't compress better than this are stored as they are */
+#define PAGEFILE_MAX_COMPRESSED (PAGE_SIZE - PAGE_SIZE / 8)
+
+enum batch_state {
+    BATCH_FREE,
+    BATCH_WRITING,      /* queued or being written out */
+    BATCH_READING,      /* queued or being read back */
+    BATCH_CACHED,       /* on disk, and the data is valid */
+};
+
+struct page_batch {
+    enum batch_state state;
+    uint32_t id;
+    uint32_t extent;            /* first unit */
+    unsigned int units;
+    unsigned long last_use;
+    /* Pages written in this batch, for freeing their units once written */
+    unsigned int nr;
+    unsigned long gfn[XENPAGING_BATCH_SIZE];
+    uint16_t off[XENPAGING_BATCH_SIZE];
+    uint16_t len[XENPAGING_BATCH_SIZE];
+    char *data;
+    /* Protected by io_lock */
+    struct page_batch *io_next;
+    int io_done;
+    int io_error;
+    unsigned int io_retries;
+};
+
+static struct page_batch cache[PAGEFILE_CACHE_SIZE];
+static unsigned long use_clock;
+static uint32_t next_batch_id = 1;
+
+static unsigned long *units_map;
+static unsigned long nr_units;
+static unsigned long unit_cursor;
+
+static int compress_pages;
+static char *scratch;
+static unsigned long stat_pages, stat_units;
+
+static int io_fd;
+static int io_exit;
+static struct page_batch *io_head, *io_tail;
+static pthread_mutex_t io_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t io_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t io_done_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t io_threads[PAGEFILE_IO_THREADS];
+static int nr_io_threads;
+
+static unsigned int len_to_units(unsigned int len)
 {
-    off_t offset = i;
-    int total = 0;
-    int bytes;
+    return (len + PAGEFILE_UNIT_SIZE - 1) >> PAGEFILE_UNIT_SHIFT;
+}
 
-    offset = lseek(fd, offset << PAGE_SHIFT, SEEK_SET);
-    if ( offset == (off_t)-1 )
-        return -1;
+static int file_op(int fd, void *buf, size_t count, off_t offset,
+                   ssize_t (*fn)(int, void *, size_t, off_t))
+{
+    size_t total = 0;
+    ssize_t bytes;
 
-    while ( total < PAGE_SIZE )
+    while ( total < count )
     {
-        bytes = fn(fd, page + total, PAGE_SIZE - total);
+        bytes = fn(fd, buf + total, count - total, offset + total);
+        if ( bytes < 0 && errno == EINTR )
+            continue;
         if ( bytes <= 0 )
+        {
+            if ( bytes == 0 )
+                errno = EIO;
             return -1;
+        }
 
         total += bytes;
     }
@@ -46,19 +130,598 @@ static int file_op(int fd, void *page, int i,
     return 0;
 }
 
-static ssize_t my_write(int fd, void *buf, size_t count)
+static ssize_t my_pwrite(int fd, void *buf, size_t count, off_t offset)
+{
+    return pwrite(fd, buf, count, offset);
+}
+
+static int batch_io(struct page_batch *b)
+{
+    off_t offset = (off_t)b->extent << PAGEFILE_UNIT_SHIFT;
+    size_t count = (size_t)b->units << PAGEFILE_UNIT_SHIFT;
+
+    if ( b->state == BATCH_WRITING )
+        return file_op(io_fd, b->data, count, offset, &my_pwrite);
+    return file_op(io_fd, b->data, count, offset, &pread);
+}
+
+static void *io_thread(void *arg)
+{
+    struct page_batch *b;
+    unsigned int retry;
+    int rc;
+
+    for ( ; ; )
+    {
+        pthread_mutex_lock(&io_lock);
+        while ( !io_head && !io_exit )
+            pthread_cond_wait(&io_cond, &io_lock);
+        if ( io_exit )
+        {
+            pthread_mutex_unlock(&io_lock);
+            break;
+        }
+        b = io_head;
+        io_head = b->io_next;
+        if ( !io_head )
+            io_tail = NULL;
+        retry = b->io_retries;
+        pthread_mutex_unlock(&io_lock);
+
+        if ( retry )
+            sleep(1);
+        rc = batch_io(b);
+
+        pthread_mutex_lock(&io_lock);
+        b->io_done = 1;
+        b->io_error = rc ? errno : 0;
+        pthread_cond_broadcast(&io_done_cond);
+        pthread_mutex_unlock(&io_lock);
+    }
+
+    return NULL;
+}
+
+/*
+ * Hand a batch to the I/O threads, or do the I/O here if there are none,
+ * with io_lock held
+ */
+static void queue_io(struct page_batch *b)
+{
+    int rc;
+
+    if ( !nr_io_threads )
+    {
+        if ( b->io_retries )
+            sleep(1);
+        rc = batch_io(b);
+        b->io_done = 1;
+        b->io_error = rc ? errno : 0;
+        return;
+    }
+
+    b->io_next = NULL;
+    b->io_done = 0;
+    if ( io_tail )
+        io_tail->io_next = b;
+    else
+        io_head = b;
+    io_tail = b;
+    pthread_cond_signal(&io_cond);
+}
+
+static void submit_io(struct page_batch *b)
+{
+    pthread_mutex_lock(&io_lock);
+    queue_io(b);
+    pthread_mutex_unlock(&io_lock);
+}
+
+static void mark_units(unsigned long start, unsigned long nr, int used)
+{
+    unsigned long u;
+
+    for ( u = start; u < start + nr; u++ )
+    {
+        if ( used )
+            set_bit(u, units_map);
+        else
+            clear_bit(u, units_map);
+    }
+}
+
+/* Find a free run of at least min units in [from, to), and at most want */
+static long find_units(unsigned long from, unsigned long to,
+                       unsigned int min, unsigned int want,
+                       unsigned int *got)
+{
+    unsigned long u = from, start;
+
+    while ( u < to )
+    {
+        if ( (u & (BITS_PER_LONG - 1)) == 0 && u + BITS_PER_LONG <= to &&
+             units_map[u >> ORDER_LONG] == ~0UL )
+        {
+            u += BITS_PER_LONG;
+            continue;
+        }
+
+        if ( test_bit(u, units_map) )
+        {
+            u++;
+            continue;
+        }
+
+        start = u;
+        while ( u < to && u - start < want && !test_bit(u, units_map) )
+            u++;
+        if ( u - start >= min )
+        {
+            *got = u - start;
+            return start;
+        }
+    }
+
+    return -1;
+}
+
+/*
+ * Allocate up to want units, and at least min of them, next-fit so that
+ * batches are laid out in the order they were written.  The file grows
+ * when no run is big enough.
+ */
+static long alloc_units(struct xenpaging *paging, unsigned int min,
+                        unsigned int want, unsigned int *got)
+{
+    xc_interface *xch = paging->xc_handle;
+    unsigned long *map, old = nr_units;
+    long start;
+
+    start = find_units(unit_cursor, nr_units, min, want, got);
+    if ( start < 0 )
+        start = find_units(0, unit_cursor, min, want, got);
+    if ( start < 0 )
+    {
+        map = realloc(units_map, bitmap_size(nr_units * 2));
+        if ( !map )
+        {
+            PERROR("Error growing paging file to %lu units", nr_units * 2);
+            return -1;
+        }
+        units_map = map;
+        nr_units *= 2;
+        memset((char *)units_map + bitmap_size(old), 0,
+               bitmap_size(nr_units) - bitmap_size(old));
+        start = find_units(old, nr_units, min, want, got);
+        if ( start < 0 )
+        {
+            ERROR("No run of %u units in paging file of %lu units",
+                  min, nr_units);
+            errno = ENOSPC;
+            return -1;
+        }
+    }
+
+    mark_units(start, *got, 1);
+    unit_cursor = start + *got;
+
+    return start;
+}
+
+static struct page_batch *find_batch(uint32_t id)
+{
+    int i;
+
+    for ( i = 0; i < PAGEFILE_CACHE_SIZE; i++ )
+        if ( cache[i].state != BATCH_FREE && cache[i].id == id )
+            return &cache[i];
+
+    return NULL;
+}
+
+/* Complete one batch's I/O, with io_lock held */
+static int complete_batch(struct xenpaging *paging, struct page_batch *b)
+{
+    xc_interface *xch = paging->xc_handle;
+    struct xenpaging_slot *slot;
+    unsigned int i;
+
+    b->io_done = 0;
+    if ( b->io_error && b->state == BATCH_WRITING )
+    {
+        /* Its pages may be evicted already: this is their only copy */
+        errno = b->io_error;
+        if ( !b->io_retries++ )
+            PERROR("Error writing paging file at unit %u, retrying",
+                   b->extent);
+        b->io_error = 0;
+        queue_io(b);
+        return 0;
+    }
+    if ( b->io_error )
+    {
+        errno = b->io_error;
+        PERROR("Error reading paging file at unit %u", b->extent);
+        b->state = BATCH_FREE;
+        return -1;
+    }
+    b->io_retries = 0;
+
+    /* The units of pages paged in meanwhile can be used again now */
+    if ( b->state == BATCH_WRITING )
+    {
+        for ( i = 0; i < b->nr; i++ )
+        {
+            slot = &paging->slots[b->gfn[i]];
+            if ( slot->batch != b->id )
+                mark_units(b->extent + b->off[i], len_to_units(b->len[i]), 0);
+        }
+        /* It was just paged out, so make it the first to drop */
+        b->last_use = 0;
+    }
+
+    b->state = BATCH_CACHED;
+
+    return 0;
+}
+
+int pagefile_reap(struct xenpaging *paging)
 {
-    return write(fd, buf, count);
+    int i, rc = 0;
+
+    pthread_mutex_lock(&io_lock);
+    for ( i = 0; i < PAGEFILE_CACHE_SIZE; i++ )
+        if ( cache[i].io_done && complete_batch(paging, &cache[i]) )
+            rc = -1;
+    pthread_mutex_unlock(&io_lock);
+
+    return rc;
 }
 
-int read_page(int fd, void *page, int i)
+/* Wait for the I/O on a batch to complete */
+static int wait_batch(struct xenpaging *paging, struct page_batch *b)
 {
-    return file_op(fd, page, i, &read);
+    pthread_mutex_lock(&io_lock);
+    while ( !b->io_done )
+        pthread_cond_wait(&io_done_cond, &io_lock);
+    pthread_mutex_unlock(&io_lock);
+
+    return pagefile_reap(paging);
 }
 
-int write_page(int fd, void *page, int i)
+/*
+ * Get a cache entry for a new batch, dropping the least recently used
+ * cached one if need be.  If all of them are busy with I/O, wait for that
+ * if asked to, else give up.
+ */
+static struct page_batch *get_batch(struct xenpaging *paging, int wait)
 {
-    return file_op(fd, page, i, &my_write);
+    struct page_batch *b;
+    int i;
+
+    for ( ; ; )
+    {
+        b = NULL;
+        for ( i = 0; i < PAGEFILE_CACHE_SIZE; i++ )
+        {
+            if ( cache[i].state == BATCH_FREE )
+            {
+                b = &cache[i];
+                break;
+            }
+            if ( cache[i].state == BATCH_CACHED &&
+                 (!b || cache[i].last_use < b->last_use) )
+                b = &cache[i];
+        }
+        if ( b || !wait )
+            break;
+
+        pthread_mutex_lock(&io_lock);
+        for ( i = 0; i < PAGEFILE_CACHE_SIZE; i++ )
+            if ( cache[i].io_done )
+                break;
+        if ( i == PAGEFILE_CACHE_SIZE )
+            pthread_cond_wait(&io_done_cond, &io_lock);
+        pthread_mutex_unlock(&io_lock);
+
+        if ( pagefile_reap(paging) )
+            return NULL;
+    }
+
+    if ( b )
+    {
+        b->state = BATCH_FREE;
+        b->nr = 0;
+    }
+
+    return b;
+}
+
+static int page_is_zero(const void *page)
+{
+    const unsigned long *p = page;
+    unsigned int i;
+
+    for ( i = 0; i < PAGE_SIZE / sizeof(*p); i++ )
+        if ( p[i] )
+            return 0;
+
+    return 1;
+}
+
+int pagefile_write_batch(struct xenpaging *paging, unsigned long *gfns,
+                         void **pages, int nr)
+{
+    const void *data[XENPAGING_BATCH_SIZE];
+    uint16_t len[XENPAGING_BATCH_SIZE];
+    struct xenpaging_slot *slot;
+    struct page_batch *b;
+    unsigned int need, min, got, off, units;
+    uLongf clen;
+    long extent;
+    int i, j;
+
+    /* Zero pages take no room, others as little as they compress to */
+    for ( i = 0; i < nr; i++ )
+    {
+        data[i] = pages[i];
+        len[i] = PAGE_SIZE;
+        if ( page_is_zero(pages[i]) )
+            len[i] = 0;
+        else if ( compress_pages )
+        {
+            clen = PAGE_SIZE;
+            if ( compress2((Bytef *)scratch + i * PAGE_SIZE, &clen,
+                           pages[i], PAGE_SIZE, Z_BEST_SPEED) == Z_OK &&
+                 clen <= PAGEFILE_MAX_COMPRESSED )
+            {
+                data[i] = scratch + i * PAGE_SIZE;
+                len[i] = clen;
+            }
+        }
+    }
+
+    /* Split the pages over as few runs of free units as possible */
+    for ( i = 0; i < nr; )
+    {
+        b = get_batch(paging, 1);
+        if ( !b )
+            return -1;
+
+        for ( need = min = 0, j = i; j < nr; j++ )
+        {
+            need += len_to_units(len[j]);
+            if ( !min )
+                min = len_to_units(len[j]);
+        }
+
+        extent = 0;
+        got = 0;
+        if ( need )
+        {
+            extent = alloc_units(paging, min, need, &got);
+            if ( extent < 0 )
+                return -1;
+        }
+
+        b->id = next_batch_id++;
+        if ( !next_batch_id )
+            next_batch_id = 1;
+        b->extent = extent;
+
+        for ( off = 0; i < nr; i++ )
+        {
+            units = len_to_units(len[i]);
+            if ( off + units > got )
+                break;
+
+            memcpy(b->data + (off << PAGEFILE_UNIT_SHIFT), data[i], len[i]);
+            memset(b->data + (off << PAGEFILE_UNIT_SHIFT) + len[i], 0,
+                   (units << PAGEFILE_UNIT_SHIFT) - len[i]);
+
+            b->gfn[b->nr] = gfns[i];
+            b->off[b->nr] = off;
+            b->len[b->nr] = len[i];
+            b->nr++;
+
+            slot = &paging->slots[gfns[i]];
+            slot->batch = b->id;
+            slot->unit = extent + off;
+            slot->len = len[i];
+
+            off += units;
+        }
+
+        /* Give back what the next page did not fit in */
+        mark_units(extent + off, got - off, 0);
+        b->units = off;
+
+        for ( j = 0; j < b->nr; j++ )
+        {
+            slot = &paging->slots[b->gfn[j]];
+            slot->extent = b->extent;
+            slot->extent_units = b->units;
+        }
+
+        stat_pages += b->nr;
+        stat_units += b->units;
+
+        /* Only zero pages: nothing to write */
+        if ( !b->units )
+            continue;
+
+        b->state = BATCH_WRITING;
+        submit_io(b);
+    }
+
+    return 0;
+}
+
+int pagefile_read_page(struct xenpaging *paging, unsigned long gfn,
+                       void *page)
+{
+    xc_interface *xch = paging->xc_handle;
+    struct xenpaging_slot *slot = &paging->slots[gfn];
+    struct page_batch *b;
+    const char *data;
+    uLongf dlen;
+
+    if ( !slot->batch )
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    if ( !slot->len )
+    {
+        memset(page, 0, PAGE_SIZE);
+        return 0;
+    }
+
+    b = find_batch(slot->batch);
+    if ( !b )
+    {
+        /* Read the whole batch: its other pages are likely to follow */
+        b = get_batch(paging, 1);
+        if ( !b )
+            return -1;
+        b->id = slot->batch;
+        b->extent = slot->extent;
+        b->units = slot->extent_units;
+        b->state = BATCH_READING;
+        if ( batch_io(b) )
+        {
+            b->state = BATCH_FREE;
+            return -1;
+        }
+        b->state = BATCH_CACHED;
+    }
+    else if ( b->state == BATCH_READING && wait_batch(paging, b) )
+        return -1;
+
+    b->last_use = ++use_clock;
+    data = b->data + ((slot->unit - b->extent) << PAGEFILE_UNIT_SHIFT);
+
+    if ( slot->len == PAGE_SIZE )
+    {
+        memcpy(page, data, PAGE_SIZE);
+        return 0;
+    }
+
+    dlen = PAGE_SIZE;
+    if ( uncompress(page, &dlen, (const Bytef *)data, slot->len) != Z_OK ||
+         dlen != PAGE_SIZE )
+    {
+        ERROR("Error decompressing gfn %lx", gfn);
+        errno = EIO;
+        return -1;
+    }
+
+    return 0;
+}
+
+void pagefile_free_page(struct xenpaging *paging, unsigned long gfn)
+{
+    struct xenpaging_slot *slot = &paging->slots[gfn];
+    struct page_batch *b;
+
+    /* Batches still being written give back their units when done */
+    b = find_batch(slot->batch);
+    if ( !b || b->state != BATCH_WRITING )
+        mark_units(slot->unit, len_to_units(slot->len), 0);
+
+    memset(slot, 0, sizeof(*slot));
+}
+
+void pagefile_prefetch(struct xenpaging *paging, unsigned long gfn)
+{
+    struct xenpaging_slot *slot = &paging->slots[gfn];
+    struct page_batch *b;
+
+    if ( !slot->batch || !slot->len || find_batch(slot->batch) )
+        return;
+
+    /* Read-ahead is not worth waiting for */
+    b = get_batch(paging, 0);
+    if ( !b )
+        return;
+
+    b->id = slot->batch;
+    b->extent = slot->extent;
+    b->units = slot->extent_units;
+    b->last_use = ++use_clock;
+    b->state = BATCH_READING;
+    submit_io(b);
+}
+
+int pagefile_init(struct xenpaging *paging, int deflate)
+{
+    xc_interface *xch = paging->xc_handle;
+    int i;
+
+    io_fd = paging->fd;
+    compress_pages = deflate;
+
+    /* Room for every page uncompressed; grown if fragmented */
+    nr_units = (unsigned long)paging->max_pages * PAGEFILE_PAGE_UNITS;
+    units_map = bitmap_alloc(nr_units);
+    scratch = malloc(XENPAGING_BATCH_SIZE * PAGE_SIZE);
+    if ( !units_map || !scratch )
+        goto err;
+
+    for ( i = 0; i < PAGEFILE_CACHE_SIZE; i++ )
+    {
+        cache[i].data = malloc(XENPAGING_BATCH_SIZE * PAGE_SIZE);
+        if ( !cache[i].data )
+            goto err;
+    }
+
+    for ( i = 0; i < PAGEFILE_IO_THREADS; i++ )
+    {
+        if ( pthread_create(&io_threads[i], NULL, io_thread, NULL) )
+        {
+            /* Carry on with what we have; with none, I/O is synchronous */
+            PERROR("Error creating I/O thread");
+            break;
+        }
+        nr_io_threads++;
+    }
+
+    return 0;
+
+ err:
+    PERROR("Error allocating paging file state");
+    pagefile_teardown(paging);
+    return -1;
+}
+
+void pagefile_teardown(struct xenpaging *paging)
+{
+    xc_interface *xch = paging->xc_handle;
+    int i;
+
+    pthread_mutex_lock(&io_lock);
+    io_exit = 1;
+    pthread_cond_broadcast(&io_cond);
+    pthread_mutex_unlock(&io_lock);
+
+    for ( i = 0; i < nr_io_threads; i++ )
+        pthread_join(io_threads[i], NULL);
+    nr_io_threads = 0;
+
+    if ( stat_pages )
+        DPRINTF("paged out %lu pages into %lu KiB of paging file\n",
+                stat_pages, stat_units * PAGEFILE_UNIT_SIZE / 1024);
+
+    for ( i = 0; i < PAGEFILE_CACHE_SIZE; i++ )
+    {
+        free(cache[i].data);
+        cache[i].data = NULL;
+    }
+    free(scratch);
+    scratch = NULL;
+    free(units_map);
+    units_map = NULL;
 }
 
 
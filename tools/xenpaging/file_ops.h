@@ -25,8 +25,37 @@
 #define __FILE_OPS_H__
 
 
-int read_page(int fd, void *page, int i);
-int write_page(int fd, void *page, int i);
+struct xenpaging;
+
+/*
+ * Set up the paging file in paging->fd; with deflate set, pages are
+ * stored deflated.
+ */
+int pagefile_init(struct xenpaging *paging, int deflate);
+void pagefile_teardown(struct xenpaging *paging);
+
+/*
+ * Store a batch of pages, which must not have been evicted yet.  The
+ * pages are copied before returning, and written in the background.
+ */
+int pagefile_write_batch(struct xenpaging *paging, unsigned long *gfns,
+                         void **pages, int nr);
+
+/* Get back a page, from memory if its batch is cached */
+int pagefile_read_page(struct xenpaging *paging, unsigned long gfn,
+                       void *page);
+
+/* Forget a page which has been paged in, or could not be evicted */
+void pagefile_free_page(struct xenpaging *paging, unsigned long gfn);
+
+/* Start reading the batch a page was written in, if it isn't cached */
+void pagefile_prefetch(struct xenpaging *paging, unsigned long gfn);
+
+/*
+ * Finish off background writes and reads; < 0 if a read failed.  Failed
+ * writes are retried.
+ */
+int pagefile_reap(struct xenpaging *paging);
 
 
 #endif
@@ -35,6 +35,14 @@ void policy_notify_paged_in(unsigned long gfn);
 void policy_notify_paged_in_nomru(unsigned long gfn);
 void policy_notify_dropped(unsigned long gfn);
 
+/*
+ * Called once per sampling period with the gfns which the guest used during
+ * it, or with NULL if that is not known and only page-ins should count.
+ */
+void policy_age(struct xenpaging *paging, unsigned long *used);
+/* Number of pages used in the last few sampling periods */
+unsigned long policy_working_set(void);
+
 #endif // __XEN_PAGING_POLICY_H__
 
 
@@ -26,6 +26,18 @@
 
 #define DEFAULT_MRU_SIZE (1024 * 16)
 
+/*
+ * Every gfn has an age: the number of sampling periods since the guest was
+ * last seen using it, either by dirtying it or by faulting it back in.
+ * Pages used within the last WS_AGE periods make up the working set.
+ * Victims are picked CLOCK-style: the hand sweeps over the gfns and takes
+ * the first one outside the working set or, failing that, the oldest of
+ * the next SCAN_WINDOW candidates.
+ */
+#define MAX_AGE     255
+#define WS_AGE      4
+#define SCAN_WINDOW 1024
+
 
 static unsigned long *mru;
 static unsigned int i_mru;
@@ -35,6 +47,9 @@ static unsigned long *unconsumed;
 static unsigned int unconsumed_cleared;
 static unsigned long current_gfn;
 static unsigned long max_pages;
+static unsigned char *age;
+static unsigned long working_set;
+static unsigned long page_ins;
 
 
 int policy_init(struct xenpaging *paging)
@@ -63,6 +78,12 @@ int policy_init(struct xenpaging *paging)
     if ( mru == NULL )
         goto out;
 
+    /* Nothing is known about any page yet: treat them all as just cold */
+    age = malloc(max_pages);
+    if ( age == NULL )
+        goto out;
+    memset(age, WS_AGE, max_pages);
+
     for ( i = 0; i < mru_size; i++ )
         mru[i] = INVALID_MFN;
 
@@ -80,7 +101,8 @@ int policy_init(struct xenpaging *paging)
 unsigned long policy_choose_victim(struct xenpaging *paging)
 {
     xc_interface *xch = paging->xc_handle;
-    unsigned long i;
+    unsigned long i, victim = INVALID_MFN;
+    unsigned int candidates = 0;
 
     /* One iteration over all possible gfns */
     for ( i = 0; i < max_pages; i++ )
@@ -111,12 +133,15 @@ unsigned long policy_choose_victim(struct xenpaging *paging)
         if ( test_bit(current_gfn, unconsumed) )
             continue;
 
-        /* gfn found */
-        break;
+        /* gfn found: take it if cold, else keep looking for an older one */
+        if ( victim == INVALID_MFN || age[current_gfn] > age[victim] )
+            victim = current_gfn;
+        if ( age[victim] >= WS_AGE || ++candidates >= SCAN_WINDOW )
+            break;
     }
 
     /* Could not nominate any gfn */
-    if ( i >= max_pages )
+    if ( victim == INVALID_MFN )
     {
         /* No more pages, wait in poll */
         paging->use_poll_timeout = 1;
@@ -133,8 +158,35 @@ unsigned long policy_choose_victim(struct xenpaging *paging)
         return INVALID_MFN;
     }
 
-    set_bit(current_gfn, unconsumed);
-    return current_gfn;
+    set_bit(victim, unconsumed);
+    return victim;
+}
+
+void policy_age(struct xenpaging *paging, unsigned long *used)
+{
+    xc_interface *xch = paging->xc_handle;
+    unsigned long gfn;
+
+    working_set = 0;
+    for ( gfn = 0; gfn < max_pages; gfn++ )
+    {
+        if ( used && test_bit(gfn, used) )
+            age[gfn] = 0;
+        else if ( age[gfn] < MAX_AGE )
+            age[gfn]++;
+
+        if ( age[gfn] < WS_AGE )
+            working_set++;
+    }
+
+    DPRINTF("working set %lu pages, %lu page-ins in last period\n",
+            working_set, page_ins);
+    page_ins = 0;
+}
+
+unsigned long policy_working_set(void)
+{
+    return working_set;
 }
 
 void policy_notify_paged_out(unsigned long gfn)
@@ -147,6 +199,10 @@ static void policy_handle_paged_in(unsigned long gfn, int do_mru)
 {
     unsigned long old_gfn = mru[i_mru & (mru_size - 1)];
 
+    /* Faulting it back in is as good a use of the page as any */
+    age[gfn] = 0;
+    page_ins++;
+
     if ( old_gfn != INVALID_MFN )
         clear_bit(old_gfn, bitmap);
     
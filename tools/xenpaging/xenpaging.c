@@ -210,6 +210,9 @@ static void usage(void)
     printf(" -f <file>      --pagefile=<file>        pagefile to use. This option is required.\n");
     printf(" -m <max_memkb> --max_memkb=<max_memkb>  maximum amount of memory to handle.\n");
     printf(" -r <num>       --mru_size=<num>         number of paged-in pages to keep in memory.\n");
+    printf(" -l             --logdirty               track the working set through log-dirty mode\n"
+           "                                         (the guest must not be migrated meanwhile).\n");
+    printf(" -z             --compress               compress pages in the pagefile.\n");
     printf(" -v             --verbose                enable debug output.\n");
     printf(" -h             --help                   this output.\n");
 }
@@ -217,13 +220,15 @@ static void usage(void)
 static int xenpaging_getopts(struct xenpaging *paging, int argc, char *argv[])
 {
     int ch;
-    static const char sopts[] = "hvd:f:m:r:";
+    static const char sopts[] = "hvlzd:f:m:r:";
     static const struct option lopts[] = {
         {"help", 0, NULL, 'h'},
         {"verbose", 0, NULL, 'v'},
         {"domain", 1, NULL, 'd'},
         {"pagefile", 1, NULL, 'f'},
         {"mru_size", 1, NULL, 'm'},
+        {"logdirty", 0, NULL, 'l'},
+        {"compress", 0, NULL, 'z'},
         { }
     };
 
@@ -246,6 +251,12 @@ static int xenpaging_getopts(struct xenpaging *paging, int argc, char *argv[])
         case 'v':
             paging->debug = 1;
             break;
+        case 'l':
+            paging->use_logdirty = 1;
+            break;
+        case 'z':
+            paging->compress = 1;
+            break;
         case 'h':
         case '?':
             usage();
@@ -448,15 +459,9 @@ static struct xenpaging *xenpaging_init(int argc, char *argv[])
     }
     DPRINTF("max_pages = %d\n", paging->max_pages);
 
-    /* Allocate indicies for pagefile slots */
-    paging->slot_to_gfn = calloc(paging->max_pages, sizeof(*paging->slot_to_gfn));
-    paging->gfn_to_slot = calloc(paging->max_pages, sizeof(*paging->gfn_to_slot));
-    if ( !paging->slot_to_gfn || !paging->gfn_to_slot )
-        goto err;
-
-    /* Allocate stack for known free slots in pagefile */
-    paging->free_slot_stack = calloc(paging->max_pages, sizeof(*paging->free_slot_stack));
-    if ( !paging->free_slot_stack )
+    /* Allocate index of where paged out gfns are in the pagefile */
+    paging->slots = calloc(paging->max_pages, sizeof(*paging->slots));
+    if ( !paging->slots )
         goto err;
 
     /* Initialise policy */
@@ -467,6 +472,16 @@ static struct xenpaging *xenpaging_init(int argc, char *argv[])
         goto err;
     }
 
+    /* Let the policy see which pages the guest writes to */
+    if ( paging->use_logdirty &&
+         xc_shadow_control(xch, paging->mem_event.domain_id,
+                           XEN_DOMCTL_SHADOW_OP_ENABLE_LOGDIRTY,
+                           NULL, 0, NULL, 0, NULL) < 0 )
+    {
+        PERROR("Error enabling log-dirty mode, ageing on page-ins only");
+        paging->use_logdirty = 0;
+    }
+
     paging->paging_buffer = init_page();
     if ( !paging->paging_buffer )
     {
@@ -482,6 +497,9 @@ static struct xenpaging *xenpaging_init(int argc, char *argv[])
         goto err;
     }
 
+    if ( pagefile_init(paging, paging->compress) )
+        goto err;
+
     return paging;
 
  err:
@@ -504,9 +522,7 @@ static struct xenpaging *xenpaging_init(int argc, char *argv[])
 
         free(dom_path);
         free(watch_target_tot_pages);
-        free(paging->free_slot_stack);
-        free(paging->slot_to_gfn);
-        free(paging->gfn_to_slot);
+        free(paging->slots);
         free(paging->bitmap);
         free(paging);
     }
@@ -523,6 +539,13 @@ static void xenpaging_teardown(struct xenpaging *paging)
     xs_unwatch(paging->xs_handle, "@releaseDomain", watch_token);
 
     paging->xc_handle = NULL;
+
+    if ( paging->use_logdirty &&
+         xc_shadow_control(xch, paging->mem_event.domain_id,
+                           XEN_DOMCTL_SHADOW_OP_OFF,
+                           NULL, 0, NULL, 0, NULL) < 0 )
+        PERROR("Error disabling log-dirty mode");
+
     /* Tear down domain paging in Xen */
     munmap(paging->mem_event.ring_page, PAGE_SIZE);
     rc = xc_mem_paging_disable(xch, paging->mem_event.domain_id);
@@ -592,85 +615,6 @@ static void put_response(struct mem_event *mem_event, mem_event_response_t *rsp)
     RING_PUSH_RESPONSES(back_ring);
 }
 
-/* Evict a given gfn
- * Returns < 0 on fatal error
- * Returns 0 on successful evict
- * Returns > 0 if gfn can not be evicted
- */
-static int xenpaging_evict_page(struct xenpaging *paging, unsigned long gfn, int slot)
-{
-    xc_interface *xch = paging->xc_handle;
-    void *page;
-    xen_pfn_t victim = gfn;
-    int ret;
-
-    DECLARE_DOMCTL;
-
-    /* Nominate page */
-    ret = xc_mem_paging_nominate(xch, paging->mem_event.domain_id, gfn);
-    if ( ret < 0 )
-    {
-        /* unpageable gfn is indicated by EBUSY */
-        if ( errno == EBUSY )
-            ret = 1;
-        else
-            PERROR("Error nominating page %lx", gfn);
-        goto out;
-    }
-
-    /* Map page */
-    page = xc_map_foreign_pages(xch, paging->mem_event.domain_id, PROT_READ, &victim, 1);
-    if ( page == NULL )
-    {
-        PERROR("Error mapping page %lx", gfn);
-        ret = -1;
-        goto out;
-    }
-
-    /* Copy page */
-    ret = write_page(paging->fd, page, slot);
-    if ( ret < 0 )
-    {
-        PERROR("Error copying page %lx", gfn);
-        munmap(page, PAGE_SIZE);
-        ret = -1;
-        goto out;
-    }
-
-    /* Release page */
-    munmap(page, PAGE_SIZE);
-
-    /* Tell Xen to evict page */
-    ret = xc_mem_paging_evict(xch, paging->mem_event.domain_id, gfn);
-    if ( ret < 0 )
-    {
-        /* A gfn in use is indicated by EBUSY */
-        if ( errno == EBUSY )
-        {
-                ret = 1;
-                DPRINTF("Nominated page %lx busy", gfn);
-        } else
-            PERROR("Error evicting page %lx", gfn);
-        goto out;
-    }
-
-    DPRINTF("evict_page > gfn %lx pageslot %d\n", gfn, slot);
-    /* Notify policy of page being paged out */
-    policy_notify_paged_out(gfn);
-
-    /* Update index */
-    paging->slot_to_gfn[slot] = gfn;
-    paging->gfn_to_slot[gfn] = slot;
-
-    /* Record number of evicted pages */
-    paging->num_paged_out++;
-
-    ret = 0;
-
- out:
-    return ret;
-}
-
 static int xenpaging_resume_page(struct xenpaging *paging, mem_event_response_t *rsp, int notify_policy)
 {
     /* Put the page info on the ring */
@@ -696,16 +640,17 @@ static int xenpaging_resume_page(struct xenpaging *paging, mem_event_response_t
     return xc_evtchn_notify(paging->mem_event.xce_handle, paging->mem_event.port);
 }
 
-static int xenpaging_populate_page(struct xenpaging *paging, unsigned long gfn, int i)
+static int xenpaging_populate_page(struct xenpaging *paging, unsigned long gfn)
 {
     xc_interface *xch = paging->xc_handle;
     int ret;
     unsigned char oom = 0;
 
-    DPRINTF("populate_page < gfn %lx pageslot %d\n", gfn, i);
+    DPRINTF("populate_page < gfn %lx pageslot %u\n", gfn,
+            paging->slots[gfn].unit);
 
     /* Read page */
-    ret = read_page(paging->fd, paging->paging_buffer, i);
+    ret = pagefile_read_page(paging, gfn, paging->paging_buffer);
     if ( ret != 0 )
     {
         PERROR("Error reading page");
@@ -747,6 +692,8 @@ static void resume_pages(struct xenpaging *paging, int num_pages)
     {
         if ( test_bit(i, paging->bitmap) )
         {
+            /* Have the page's batch read in by the time it's asked for */
+            pagefile_prefetch(paging, i);
             paging->pagein_queue[num] = i;
             num++;
             if ( num == XENPAGING_PAGEIN_QUEUE_SIZE )
@@ -758,19 +705,58 @@ static void resume_pages(struct xenpaging *paging, int num_pages)
         page_in_trigger();
 }
 
-/* Evict one gfn and write it to the given slot
+/* Tell the policy which pages the guest used since the last sample */
+static void sample_page_use(struct xenpaging *paging)
+{
+    xc_interface *xch = paging->xc_handle;
+    DECLARE_HYPERCALL_BUFFER(unsigned long, dirty);
+
+    if ( paging->use_logdirty )
+    {
+        dirty = xc_hypercall_buffer_alloc(xch, dirty,
+                                          bitmap_size(paging->max_pages));
+        if ( !dirty )
+            PERROR("Error allocating dirty bitmap");
+        else if ( xc_shadow_control(xch, paging->mem_event.domain_id,
+                                    XEN_DOMCTL_SHADOW_OP_CLEAN,
+                                    HYPERCALL_BUFFER(dirty), paging->max_pages,
+                                    NULL, 0, NULL) < 0 )
+        {
+            PERROR("Error reading dirty bitmap");
+            xc_hypercall_buffer_free(xch, dirty);
+            dirty = NULL;
+        }
+    }
+
+    policy_age(paging, dirty);
+
+    if ( dirty )
+        xc_hypercall_buffer_free(xch, dirty);
+}
+
+/* Evict a batch of up to num_pages gfns and write them to the paging file
  * Returns < 0 on fatal error
- * Returns 0 on successful evict
- * Returns > 0 if no gfn can be evicted
+ * Returns 0 if no gfn can be evicted
+ * Returns > 0 if gfns were tried, with the number evicted in *evicted
  */
-static int evict_victim(struct xenpaging *paging, int slot)
+static int evict_batch(struct xenpaging *paging, int num_pages, int *evicted)
 {
     xc_interface *xch = paging->xc_handle;
-    unsigned long gfn;
+    xen_mem_paging_batch_t batch[XENPAGING_BATCH_SIZE];
+    xen_pfn_t gfns[XENPAGING_BATCH_SIZE];
+    unsigned long victims[XENPAGING_BATCH_SIZE];
+    void *pages[XENPAGING_BATCH_SIZE];
+    int err[XENPAGING_BATCH_SIZE];
     static int num_paged_out;
-    int ret;
+    unsigned long gfn;
+    char *mapping;
+    int i, num = 0, nominated = 0, ret = -1;
 
-    do
+    *evicted = 0;
+    if ( num_pages > XENPAGING_BATCH_SIZE )
+        num_pages = XENPAGING_BATCH_SIZE;
+
+    while ( num < num_pages && !interrupted )
     {
         gfn = policy_choose_victim(paging);
         if ( gfn == INVALID_MFN )
@@ -786,70 +772,132 @@ static int evict_victim(struct xenpaging *paging, int slot)
                 xenpaging_mem_paging_flush_ioemu_cache(paging);
                 num_paged_out = paging->num_paged_out;
             }
-            ret = ENOSPC;
-            goto out;
+            break;
         }
+        batch[num].gfn = gfn;
+        num++;
+    }
+    if ( !num )
+        return 0;
 
-        if ( interrupted )
+    /* Nominate pages */
+    if ( xc_mem_paging_nominate_batch(xch, paging->mem_event.domain_id,
+                                      batch, num) < 0 )
+    {
+        PERROR("Error nominating %d pages", num);
+        return -1;
+    }
+    for ( i = 0; i < num; i++ )
+    {
+        /* unpageable gfn is indicated by EBUSY */
+        if ( batch[i].rc == -EBUSY )
+            continue;
+        if ( batch[i].rc )
         {
-            ret = EINTR;
-            goto out;
+            errno = -batch[i].rc;
+            PERROR("Error nominating page %"PRIx64, batch[i].gfn);
+            return -1;
         }
+        gfns[nominated] = victims[nominated] = batch[i].gfn;
+        nominated++;
+    }
+    if ( !nominated )
+        return num;
 
-        ret = xenpaging_evict_page(paging, gfn, slot);
-        if ( ret < 0 )
-            goto out;
+    /* Map pages, copy them out, and let go of them before evicting */
+    mapping = xc_map_foreign_bulk(xch, paging->mem_event.domain_id, PROT_READ,
+                                  gfns, err, nominated);
+    if ( mapping == NULL )
+    {
+        PERROR("Error mapping %d pages", nominated);
+        return -1;
+    }
+    for ( i = 0; i < nominated; i++ )
+    {
+        if ( err[i] )
+        {
+            errno = -err[i];
+            PERROR("Error mapping page %lx", victims[i]);
+            goto out_unmap;
+        }
+        pages[i] = mapping + i * PAGE_SIZE;
+    }
+    if ( pagefile_write_batch(paging, victims, pages, nominated) < 0 )
+    {
+        PERROR("Error copying %d pages", nominated);
+        goto out_unmap;
+    }
+    munmap(mapping, nominated * PAGE_SIZE);
+    mapping = NULL;
+
+    /* Tell Xen to evict pages */
+    for ( i = 0; i < nominated; i++ )
+        batch[i].gfn = victims[i];
+    if ( xc_mem_paging_evict_batch(xch, paging->mem_event.domain_id,
+                                   batch, nominated) < 0 )
+    {
+        PERROR("Error evicting %d pages", nominated);
+        return -1;
     }
-    while ( ret );
+    for ( i = 0; i < nominated; i++ )
+    {
+        gfn = victims[i];
+        if ( batch[i].rc )
+        {
+            /* The copy is of no use if the page was not evicted */
+            pagefile_free_page(paging, gfn);
 
-    if ( test_and_set_bit(gfn, paging->bitmap) )
-        ERROR("Page %lx has been evicted before", gfn);
+            /* A gfn in use is indicated by EBUSY */
+            if ( batch[i].rc == -EBUSY )
+            {
+                DPRINTF("Nominated page %lx busy", gfn);
+                continue;
+            }
+            errno = -batch[i].rc;
+            PERROR("Error evicting page %lx", gfn);
+            return -1;
+        }
 
-    ret = 0;
+        DPRINTF("evict_page > gfn %lx pageslot %u\n", gfn,
+                paging->slots[gfn].unit);
+        /* Notify policy of page being paged out */
+        policy_notify_paged_out(gfn);
 
- out:
+        if ( test_and_set_bit(gfn, paging->bitmap) )
+            ERROR("Page %lx has been evicted before", gfn);
+
+        /* Record number of evicted pages */
+        paging->num_paged_out++;
+        (*evicted)++;
+    }
+
+    ret = num;
+
+ out_unmap:
+    if ( mapping )
+        munmap(mapping, nominated * PAGE_SIZE);
     return ret;
 }
 
-/* Evict a batch of pages and write them to a free slot in the paging file
+/* Evict a number of pages and write them to the paging file
  * Returns < 0 on fatal error
  * Returns 0 if no gfn can be evicted
  * Returns > 0 on successful evict
  */
 static int evict_pages(struct xenpaging *paging, int num_pages)
 {
-    xc_interface *xch = paging->xc_handle;
-    int rc, slot, num = 0;
-
-    /* Reuse known free slots */
-    while ( paging->stack_count > 0 && num < num_pages )
-    {
-        slot = paging->free_slot_stack[--paging->stack_count];
-        rc = evict_victim(paging, slot);
-        if ( rc )
-        {
-            num = rc < 0 ? -1 : num;
-            return num;
-        }
-        num++;
-    }
+    int rc, evicted, num = 0;
 
-    /* Scan all slots slots for remainders */
-    for ( slot = 0; slot < paging->max_pages && num < num_pages; slot++ )
+    while ( num < num_pages )
     {
-        /* Slot is allocated */
-        if ( paging->slot_to_gfn[slot] )
-            continue;
-
-        rc = evict_victim(paging, slot);
-        if ( rc )
-        {
-            num = rc < 0 ? -1 : num;
+        rc = evict_batch(paging, num_pages - num, &evicted);
+        if ( rc < 0 )
+            return -1;
+        if ( rc == 0 )
             break;
-        }
-
-        num++;
+        num += evicted;
     }
+
     return num;
 }
 
@@ -860,9 +908,9 @@ int main(int argc, char *argv[])
     mem_event_request_t req;
     mem_event_response_t rsp;
     int num, prev_num = 0;
-    int slot;
     int tot_pages;
     int rc;
+    time_t now, last_sample = 0;
     xc_interface *xch;
 
     /* Initialise domain paging */
@@ -919,26 +967,23 @@ int main(int argc, char *argv[])
             /* Check if the page has already been paged in */
             if ( test_and_clear_bit(req.gfn, paging->bitmap) )
             {
-                /* Find where in the paging file to read from */
-                slot = paging->gfn_to_slot[req.gfn];
-
                 /* Sanity check */
-                if ( paging->slot_to_gfn[slot] != req.gfn )
+                if ( !paging->slots[req.gfn].batch )
                 {
-                    ERROR("Expected gfn %"PRIx64" in slot %d, but found gfn %lx\n", req.gfn, slot, paging->slot_to_gfn[slot]);
+                    ERROR("Expected gfn %"PRIx64" in the pagefile, but found none\n", req.gfn);
                     goto out;
                 }
 
                 if ( req.flags & MEM_EVENT_FLAG_DROP_PAGE )
                 {
-                    DPRINTF("drop_page ^ gfn %"PRIx64" pageslot %d\n", req.gfn, slot);
+                    DPRINTF("drop_page ^ gfn %"PRIx64" pageslot %u\n", req.gfn, paging->slots[req.gfn].unit);
                     /* Notify policy of page being dropped */
                     policy_notify_dropped(req.gfn);
                 }
                 else
                 {
                     /* Populate the page */
-                    if ( xenpaging_populate_page(paging, req.gfn, slot) < 0 )
+                    if ( xenpaging_populate_page(paging, req.gfn) < 0 )
                     {
                         ERROR("Error populating page %"PRIx64"", req.gfn);
                         goto out;
@@ -957,10 +1002,7 @@ int main(int argc, char *argv[])
                 }
 
                 /* Clear this pagefile slot */
-                paging->slot_to_gfn[slot] = 0;
-
-                /* Record this free slot */
-                paging->free_slot_stack[paging->stack_count++] = slot;
+                pagefile_free_page(paging, req.gfn);
             }
             else
             {
@@ -988,6 +1030,10 @@ int main(int argc, char *argv[])
             }
         }
 
+        /* Complete pagefile writes and read-ahead done meanwhile */
+        if ( pagefile_reap(paging) < 0 )
+            goto out;
+
         /* If interrupted, write all pages back into the guest */
         if ( interrupted == SIGTERM || interrupted == SIGINT )
         {
@@ -1009,6 +1055,14 @@ int main(int argc, char *argv[])
         /* Indicate possible error */
         rc = 1;
 
+        /* Age the guest's pages about once a second */
+        now = time(NULL);
+        if ( now != last_sample )
+        {
+            sample_page_use(paging);
+            last_sample = now;
+        }
+
         /* Check if the target has been reached already */
         tot_pages = xenpaging_get_tot_pages(paging);
         if ( tot_pages < 0 )
@@ -1030,10 +1084,10 @@ int main(int argc, char *argv[])
                 prev_num = num;
             }
             /* Limit the number of evicts to be able to process page-in requests */
-            if ( num > 42 )
+            if ( num > 4 * XENPAGING_BATCH_SIZE )
             {
                 paging->use_poll_timeout = 0;
-                num = 42;
+                num = 4 * XENPAGING_BATCH_SIZE;
             }
             if ( evict_pages(paging, num) < 0 )
                 goto out;
@@ -1063,6 +1117,7 @@ int main(int argc, char *argv[])
     DPRINTF("xenpaging got signal %d\n", interrupted);
 
  out:
+    pagefile_teardown(paging);
     close(paging->fd);
     unlink_pagefile();
 
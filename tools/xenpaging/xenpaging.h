@@ -31,6 +31,9 @@
 
 #define XENPAGING_PAGEIN_QUEUE_SIZE 64
 
+/* Pages nominated, evicted and written out together */
+#define XENPAGING_BATCH_SIZE 64
+
 struct mem_event {
     domid_t domain_id;
     xc_evtchn *xce_handle;
@@ -40,14 +43,22 @@ struct mem_event {
     void *ring_page;
 };
 
+/* Where a paged out gfn is kept in the paging file */
+struct xenpaging_slot {
+    uint32_t batch;             /* batch it was written in, 0 if none */
+    uint32_t unit;              /* offset of its data, in units */
+    uint32_t extent;            /* first unit of the batch */
+    uint16_t extent_units;      /* size of the batch */
+    uint16_t len;               /* bytes; 0 for a zero page */
+};
+
 struct xenpaging {
     xc_interface *xc_handle;
     struct xs_handle *xs_handle;
 
     unsigned long *bitmap;
 
-    unsigned long *slot_to_gfn;
-    int *gfn_to_slot;
+    struct xenpaging_slot *slots;
 
     void *paging_buffer;
 
@@ -59,9 +70,9 @@ struct xenpaging {
     int target_tot_pages;
     int policy_mru_size;
     int use_poll_timeout;
+    int use_logdirty;
+    int compress;
     int debug;
-    int stack_count;
-    int *free_slot_stack;
     unsigned long pagein_queue[XENPAGING_PAGEIN_QUEUE_SIZE];
 };
 
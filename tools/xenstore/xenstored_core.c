@@ -20,6 +20,9 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/select.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
 #ifndef NO_SOCKETS
 #include <sys/socket.h>
 #include <sys/un.h>
@@ -65,6 +68,8 @@ static int reopen_log_pipe[2];
 static char *tracefile = NULL;
 static TDB_CONTEXT *tdb_ctx = NULL;
 
+uint64_t generation;
+
 static void corrupt(struct connection *conn, const char *fmt, ...);
 static void check_store(void);
 
@@ -82,22 +87,9 @@ int quota_nb_watch_per_domain = 128;
 int quota_max_entry_size = 2048; /* 2K */
 int quota_max_transaction = 10;
 
-TDB_CONTEXT *tdb_context(struct connection *conn)
-{
-	/* conn = NULL used in manual_node at setup. */
-	if (!conn || !conn->transaction)
-		return tdb_ctx;
-	return tdb_transaction_context(conn->transaction);
-}
-
-bool replace_tdb(const char *newname, TDB_CONTEXT *newtdb)
+TDB_CONTEXT *tdb_context(void)
 {
-	if (!(tdb_ctx->flags & TDB_INTERNAL))
-		if (rename(newname, xs_daemon_tdb()) != 0)
-			return false;
-	tdb_close(tdb_ctx);
-	tdb_ctx = talloc_steal(talloc_autofree_context(), newtdb);
-	return true;
+	return tdb_ctx;
 }
 
 static char *sockmsg_string(enum xsd_sockmsg_type type)
@@ -199,7 +191,7 @@ void trace_destroy(const void *data, const char *type)
 /**
  * Signal handler for SIGHUP, which requests that the trace log is reopened
  * (in the main loop).  A single byte is written to reopen_log_pipe, to awaken
- * the select() in the main loop.
+ * the event loop.
  */
 static void trigger_reopen_log(int signal __attribute__((unused)))
 {
@@ -273,79 +265,202 @@ static bool write_messages(struct connection *conn)
 	return true;
 }
 
-static int destroy_conn(void *_conn)
+/*
+ * File descriptor readiness.  On Linux this is epoll, edge-triggered for
+ * client sockets; elsewhere it is select() over sets which are kept up to
+ * date as descriptors come and go, rather than rebuilt on every pass.
+ */
+#define READY_IN	1
+#define READY_OUT	2
+
+typedef void poll_fn_t(int fd, unsigned int events);
+
+#ifdef __linux__
+static int epoll_fd = -1;
+
+static void poll_init(void)
 {
-	struct connection *conn = _conn;
+	epoll_fd = epoll_create(64);
+	if (epoll_fd < 0)
+		barf_perror("Could not create epoll instance");
+	fcntl(epoll_fd, F_SETFD, FD_CLOEXEC);
+}
 
-	/* Flush outgoing if possible, but don't block. */
-	if (!conn->domain) {
-		fd_set set;
-		struct timeval none;
+static void poll_add(int fd, bool edge)
+{
+	struct epoll_event ev = { .data.fd = fd };
 
-		FD_ZERO(&set);
-		FD_SET(conn->fd, &set);
-		none.tv_sec = none.tv_usec = 0;
+	ev.events = edge ? EPOLLIN | EPOLLOUT | EPOLLET : EPOLLIN;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0)
+		barf_perror("Could not add fd %d to epoll", fd);
+}
 
-		while (!list_empty(&conn->out_list)
-		       && select(conn->fd+1, NULL, &set, NULL, &none) == 1)
-			if (!write_messages(conn))
-				break;
-		close(conn->fd);
+static void poll_del(int fd)
+{
+	epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+}
+
+/* Edge-triggered descriptors always report writability. */
+static void poll_want_write(int fd, bool want)
+{
+}
+
+static void poll_wait(int timeout, poll_fn_t *fn)
+{
+	struct epoll_event evs[64];
+	unsigned int events;
+	int i, nr;
+
+	nr = epoll_wait(epoll_fd, evs, ARRAY_SIZE(evs), timeout);
+	if (nr < 0) {
+		if (errno == EINTR)
+			return;
+		barf_perror("epoll_wait failed");
 	}
-        if (conn->target)
-                talloc_unlink(conn, conn->target);
-	list_del(&conn->list);
-	trace_destroy(conn, "connection");
-	return 0;
+
+	for (i = 0; i < nr; i++) {
+		events = 0;
+		if (evs[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+			events |= READY_IN;
+		if (evs[i].events & EPOLLOUT)
+			events |= READY_OUT;
+		fn(evs[i].data.fd, events);
+	}
+}
+#else
+static fd_set poll_inset, poll_outset;
+static int poll_max = -1;
+
+static void poll_init(void)
+{
+	FD_ZERO(&poll_inset);
+	FD_ZERO(&poll_outset);
 }
 
+static void poll_add(int fd, bool edge)
+{
+	if (fd >= FD_SETSIZE)
+		barf("fd %d too large for select", fd);
+	FD_SET(fd, &poll_inset);
+	if (fd > poll_max)
+		poll_max = fd;
+}
 
-static void set_fd(int fd, fd_set *set, int *max)
+static void poll_del(int fd)
 {
-	if (fd < 0)
-		return;
-	FD_SET(fd, set);
-	if (fd > *max)
-		*max = fd;
+	FD_CLR(fd, &poll_inset);
+	FD_CLR(fd, &poll_outset);
 }
 
+static void poll_want_write(int fd, bool want)
+{
+	if (want)
+		FD_SET(fd, &poll_outset);
+	else
+		FD_CLR(fd, &poll_outset);
+}
 
-static int initialize_set(fd_set *inset, fd_set *outset, int sock, int ro_sock,
-			  struct timeval **ptimeout)
+static void poll_wait(int timeout, poll_fn_t *fn)
 {
-	static struct timeval zero_timeout = { 0 };
-	struct connection *conn;
-	int max = -1;
+	fd_set inset = poll_inset, outset = poll_outset;
+	struct timeval tv, *ptv = NULL;
+	unsigned int events;
+	int fd;
 
-	*ptimeout = NULL;
+	if (timeout >= 0) {
+		tv.tv_sec = timeout / 1000;
+		tv.tv_usec = (timeout % 1000) * 1000;
+		ptv = &tv;
+	}
 
-	FD_ZERO(inset);
-	FD_ZERO(outset);
+	if (select(poll_max + 1, &inset, &outset, NULL, ptv) < 0) {
+		if (errno == EINTR)
+			return;
+		barf_perror("Select failed");
+	}
 
-	if (sock != -1)
-		set_fd(sock, inset, &max);
-	if (ro_sock != -1)
-		set_fd(ro_sock, inset, &max);
-	if (reopen_log_pipe[0] != -1)
-		set_fd(reopen_log_pipe[0], inset, &max);
+	for (fd = 0; fd <= poll_max; fd++) {
+		events = 0;
+		if (FD_ISSET(fd, &inset))
+			events |= READY_IN;
+		if (FD_ISSET(fd, &outset))
+			events |= READY_OUT;
+		if (events)
+			fn(fd, events);
+	}
+}
+#endif
 
-	if (xce_handle != NULL)
-		set_fd(xc_evtchn_fd(xce_handle), inset, &max);
-
-	list_for_each_entry(conn, &connections, list) {
-		if (conn->domain) {
-			if (domain_can_read(conn) ||
-			    (domain_can_write(conn) &&
-			     !list_empty(&conn->out_list)))
-				*ptimeout = &zero_timeout;
-		} else {
-			set_fd(conn->fd, inset, &max);
-			if (!list_empty(&conn->out_list))
-				FD_SET(conn->fd, outset);
-		}
+/* Socket connections by file descriptor, for the event loop. */
+static struct connection **fd_conns;
+static unsigned int nr_fd_conns;
+
+/* Connections which can make progress without waiting. */
+static LIST_HEAD(active_connections);
+
+static bool fd_conn_set(int fd, struct connection *conn)
+{
+	struct connection **new;
+	unsigned int nr;
+
+	if (fd >= nr_fd_conns) {
+		nr = nr_fd_conns ? nr_fd_conns : 64;
+		while (nr <= fd)
+			nr *= 2;
+		new = realloc(fd_conns, nr * sizeof(*new));
+		if (!new)
+			return false;
+		memset(new + nr_fd_conns, 0,
+		       (nr - nr_fd_conns) * sizeof(*new));
+		fd_conns = new;
+		nr_fd_conns = nr;
 	}
+	fd_conns[fd] = conn;
+	return true;
+}
+
+void conn_update_active(struct connection *conn)
+{
+	bool pending = !list_empty(&conn->out_list);
+	bool active;
+
+	if (conn->domain) {
+		active = domain_can_read(conn) ||
+			 (domain_can_write(conn) && pending);
+	} else {
+		if (conn->fd < 0)
+			return;
+		poll_want_write(conn->fd, pending && !conn->pollout);
+		active = conn->pollin || (conn->pollout && pending);
+	}
+
+	if (active && list_empty(&conn->active))
+		list_add_tail(&conn->active, &active_connections);
+	else if (!active && !list_empty(&conn->active))
+		list_del_init(&conn->active);
+}
+
+static int destroy_conn(void *_conn)
+{
+	struct connection *conn = _conn;
 
-	return max;
+	/* Flush outgoing if possible, but don't block. */
+	if (!conn->domain) {
+		while (!list_empty(&conn->out_list) && conn->pollout)
+			if (!write_messages(conn))
+				break;
+		if (conn->fd >= 0) {
+			poll_del(conn->fd);
+			fd_conns[conn->fd] = NULL;
+		}
+		close(conn->fd);
+	}
+        if (conn->target)
+                talloc_unlink(conn, conn->target);
+	list_del(&conn->list);
+	list_del(&conn->active);
+	trace_destroy(conn, "connection");
+	return 0;
 }
 
 /* Is child a subnode of parent, or equal? */
@@ -368,38 +483,44 @@ bool is_child(const char *child, const char *parent)
 static struct node *read_node(struct connection *conn, const char *name)
 {
 	TDB_DATA key, data;
-	uint32_t *p;
+	struct xs_tdb_record_hdr *hdr;
 	struct node *node;
-	TDB_CONTEXT * context = tdb_context(conn);
+	struct transaction *trans = conn ? conn->transaction : NULL;
 
-	key.dptr = (void *)name;
-	key.dsize = strlen(name);
-	data = tdb_fetch(context, key);
+	/* Deleted within this transaction? */
+	if (!transaction_read_key(trans, name, &key)) {
+		errno = ENOENT;
+		return NULL;
+	}
+	data = tdb_fetch(tdb_ctx, key);
 
 	if (data.dptr == NULL) {
-		if (tdb_error(context) == TDB_ERR_NOEXIST)
+		if (tdb_error(tdb_ctx) == TDB_ERR_NOEXIST) {
+			transaction_node_read(trans, name, NO_GENERATION);
 			errno = ENOENT;
-		else {
-			log("TDB error on read: %s", tdb_errorstr(context));
+		} else {
+			log("TDB error on read: %s", tdb_errorstr(tdb_ctx));
 			errno = EIO;
 		}
 		return NULL;
 	}
 
+	hdr = (void *)data.dptr;
+	transaction_node_read(trans, name, hdr->generation);
+
 	node = talloc(name, struct node);
 	node->name = talloc_strdup(node, name);
 	node->parent = NULL;
-	node->tdb = tdb_context(conn);
+	node->trans = trans;
 	talloc_steal(node, data.dptr);
 
 	/* Datalen, childlen, number of permissions */
-	p = (uint32_t *)data.dptr;
-	node->num_perms = p[0];
-	node->datalen = p[1];
-	node->childlen = p[2];
+	node->num_perms = hdr->num_perms;
+	node->datalen = hdr->datalen;
+	node->childlen = hdr->childlen;
 
 	/* Permissions are struct xs_permissions. */
-	node->perms = (void *)&p[3];
+	node->perms = hdr->perms;
 	/* Data is binary blob (usually ascii, no nul). */
 	node->data = node->perms + node->num_perms;
 	/* Children is strings, nul separated. */
@@ -412,27 +533,31 @@ static bool write_node(struct connection *conn, const struct node *node)
 {
 	/*
 	 * conn will be null when this is called from manual_node.
-	 * tdb_context copes with this.
 	 */
 
 	TDB_DATA key, data;
+	struct xs_tdb_record_hdr *hdr;
 	void *p;
 
-	key.dptr = (void *)node->name;
-	key.dsize = strlen(node->name);
-
-	data.dsize = 3*sizeof(uint32_t)
+	data.dsize = sizeof(*hdr)
 		+ node->num_perms*sizeof(node->perms[0])
 		+ node->datalen + node->childlen;
 
 	if (domain_is_unprivileged(conn) && data.dsize >= quota_max_entry_size)
 		goto error;
 
+	/* Inside a transaction this is the transaction's private copy. */
+	if (!transaction_write_key(conn ? conn->transaction : NULL,
+				   node->name, &key))
+		goto error;
+
 	data.dptr = talloc_size(node, data.dsize);
-	((uint32_t *)data.dptr)[0] = node->num_perms;
-	((uint32_t *)data.dptr)[1] = node->datalen;
-	((uint32_t *)data.dptr)[2] = node->childlen;
-	p = data.dptr + 3 * sizeof(uint32_t);
+	hdr = (void *)data.dptr;
+	hdr->generation = ++generation;
+	hdr->num_perms = node->num_perms;
+	hdr->datalen = node->datalen;
+	hdr->childlen = node->childlen;
+	p = hdr->perms;
 
 	memcpy(p, node->perms, node->num_perms*sizeof(node->perms[0]));
 	p += node->num_perms*sizeof(node->perms[0]);
@@ -441,7 +566,7 @@ static bool write_node(struct connection *conn, const struct node *node)
 	memcpy(p, node->children, node->childlen);
 
 	/* TDB should set errno, but doesn't even set ecode AFAICT. */
-	if (tdb_store(tdb_context(conn), key, data, TDB_REPLACE) != 0) {
+	if (tdb_store(tdb_ctx, key, data, TDB_REPLACE) != 0) {
 		corrupt(conn, "Write of %s failed", key.dptr);
 		goto error;
 	}
@@ -618,6 +743,7 @@ void send_reply(struct connection *conn, enum xsd_sockmsg_type type,
 
 	/* Queue for later transmission. */
 	list_add_tail(&bdata->list, &conn->out_list);
+	conn_update_active(conn);
 }
 
 /* Some routines (write, mkdir, etc) just need a non-error return */
@@ -749,14 +875,22 @@ static void do_read(struct connection *conn, const char *name)
 	send_reply(conn, XS_READ, node->data, node->datalen);
 }
 
-static void delete_node_single(struct connection *conn, struct node *node)
+/* Delete a node's record from the store, or from the transaction's view. */
+static int delete_record(struct transaction *trans, const char *name)
 {
 	TDB_DATA key;
 
-	key.dptr = (void *)node->name;
-	key.dsize = strlen(node->name);
+	if (trans)
+		return transaction_delete(trans, name);
 
-	if (tdb_delete(tdb_context(conn), key) != 0) {
+	key.dptr = (void *)name;
+	key.dsize = strlen(name);
+	return tdb_delete(tdb_ctx, key);
+}
+
+static void delete_node_single(struct connection *conn, struct node *node)
+{
+	if (delete_record(conn ? conn->transaction : NULL, node->name) != 0) {
 		corrupt(conn, "Could not delete '%s'", node->name);
 		return;
 	}
@@ -797,7 +931,7 @@ static struct node *construct_node(struct connection *conn, const char *name)
 
 	/* Allocate node */
 	node = talloc(name, struct node);
-	node->tdb = tdb_context(conn);
+	node->trans = conn ? conn->transaction : NULL;
 	node->name = talloc_strdup(node, name);
 
 	/* Inherit permissions, except unprivileged domains own what they create */
@@ -818,15 +952,11 @@ static struct node *construct_node(struct connection *conn, const char *name)
 static int destroy_node(void *_node)
 {
 	struct node *node = _node;
-	TDB_DATA key;
 
 	if (streq(node->name, "/"))
 		corrupt(NULL, "Destroying root node!");
 
-	key.dptr = (void *)node->name;
-	key.dsize = strlen(node->name);
-
-	tdb_delete(node->tdb, key);
+	delete_record(node->trans, node->name);
 	return 0;
 }
 
@@ -1149,6 +1279,17 @@ static void do_debug(struct connection *conn, struct buffered_data *in)
 	if (streq(in->buffer, "check"))
 		check_store();
 
+	if (streq(in->buffer, "watch-stats")) {
+		char *stats = watch_stats(in);
+
+		if (!stats) {
+			send_error(conn, ENOMEM);
+			return;
+		}
+		send_reply(conn, XS_DEBUG, stats, strlen(stats) + 1);
+		return;
+	}
+
 	send_ack(conn, XS_DEBUG);
 }
 
@@ -1337,6 +1478,7 @@ struct connection *new_connection(connwritefn_t *write, connreadfn_t *read)
 	INIT_LIST_HEAD(&new->out_list);
 	INIT_LIST_HEAD(&new->watches);
 	INIT_LIST_HEAD(&new->transaction_list);
+	INIT_LIST_HEAD(&new->active);
 
 	new->in = new_buffer(new);
 	if (new->in == NULL) {
@@ -1361,6 +1503,7 @@ static int writefd(struct connection *conn, const void *data, unsigned int len)
 
 	while ((rc = write(conn->fd, data, len)) < 0) {
 		if (errno == EAGAIN) {
+			conn->pollout = false;
 			rc = 0;
 			break;
 		}
@@ -1377,8 +1520,9 @@ static int readfd(struct connection *conn, void *data, unsigned int len)
 
 	while ((rc = read(conn->fd, data, len)) < 0) {
 		if (errno == EAGAIN) {
-			rc = 0;
-			break;
+			/* Wait for the event loop to tell us there is more. */
+			conn->pollin = false;
+			return 0;
 		}
 		if (errno != EINTR)
 			break;
@@ -1402,12 +1546,23 @@ static void accept_connection(int sock, bool canwrite)
 	if (fd < 0)
 		return;
 
-	conn = new_connection(writefd, readfd);
-	if (conn) {
-		conn->fd = fd;
-		conn->can_write = canwrite;
-	} else
+	/* We are told when there is more to read, so never block. */
+	if (fcntl(fd, F_SETFL, O_NONBLOCK) != 0 ||
+	    !(conn = new_connection(writefd, readfd))) {
+		close(fd);
+		return;
+	}
+
+	if (!fd_conn_set(fd, conn)) {
+		talloc_free(conn);
 		close(fd);
+		return;
+	}
+
+	conn->fd = fd;
+	conn->can_write = canwrite;
+	conn->pollout = true;
+	poll_add(fd, true);
 }
 #endif
 
@@ -1483,7 +1638,7 @@ static void setup_structure(void)
 }
 
 
-static unsigned int hash_from_key_fn(void *k)
+unsigned int hash_from_key_fn(void *k)
 {
 	char *str = k;
 	unsigned int hash = 5381;
@@ -1496,7 +1651,7 @@ static unsigned int hash_from_key_fn(void *k)
 }
 
 
-static int keys_equal_fn(void *key1, void *key2)
+int keys_equal_fn(void *key1, void *key2)
 {
 	return 0 == strcmp((char *)key1, (char *)key2);
 }
@@ -1598,15 +1753,28 @@ static void check_store_(const char *name, struct hashtable *reachable)
 
 
 /**
- * Helper to clean_store below.
+ * Helper to clean_store below.  Also makes sure the generation count is
+ * ahead of every record found in the store.
  */
 static int clean_store_(TDB_CONTEXT *tdb, TDB_DATA key, TDB_DATA val,
 			void *private)
 {
 	struct hashtable *reachable = private;
+	struct xs_tdb_record_hdr *hdr = (void *)val.dptr;
 	char * name = talloc_strndup(NULL, key.dptr, key.dsize);
 
-	if (!hashtable_search(reachable, name)) {
+	if (val.dsize >= sizeof(*hdr) && hdr->generation != NO_GENERATION &&
+	    hdr->generation > generation)
+		generation = hdr->generation;
+
+	/* Private copies of nodes belong to their transaction. */
+	if (!strstarts(name, "/")) {
+		if (!transaction_key_active(name)) {
+			log("clean_store: '%s' is a stale transaction node",
+			    name);
+			tdb_delete(tdb, key);
+		}
+	} else if (!hashtable_search(reachable, name)) {
 		log("clean_store: '%s' is orphaned!", name);
 		if (recovery) {
 			tdb_delete(tdb, key);
@@ -1768,16 +1936,70 @@ extern void dump_conn(struct connection *conn);
 int dom0_event = 0;
 int priv_domid = 0;
 
+static int *sock, *ro_sock;
+static int evtchn_fd = -1;
+
+static void handle_fd(int fd, unsigned int events)
+{
+	struct connection *conn;
+
+	if (fd == reopen_log_pipe[0]) {
+		char c;
+		if (read(reopen_log_pipe[0], &c, 1) != 1)
+			barf_perror("read failed");
+		reopen_log();
+	} else if (fd == *sock) {
+		accept_connection(*sock, true);
+	} else if (fd == *ro_sock) {
+		accept_connection(*ro_sock, false);
+	} else if (fd == evtchn_fd) {
+		handle_event();
+	} else if (fd < nr_fd_conns && (conn = fd_conns[fd])) {
+		if (events & READY_IN)
+			conn->pollin = true;
+		if (events & READY_OUT)
+			conn->pollout = true;
+		conn_update_active(conn);
+	}
+}
+
+/* Give each connection which is ready one turn. */
+static void handle_connections(void)
+{
+	struct connection *conn;
+	LIST_HEAD(ready);
+
+	/* Anything which becomes ready meanwhile waits for the next pass. */
+	list_splice_init(&active_connections, &ready);
+
+	while (!list_empty(&ready)) {
+		conn = list_entry(ready.next, typeof(*conn), active);
+		list_del_init(&conn->active);
+
+		talloc_increase_ref_count(conn);
+		if (conn->domain ? domain_can_read(conn) : conn->pollin)
+			handle_input(conn);
+		if (talloc_free(conn) == 0)
+			continue;
+
+		talloc_increase_ref_count(conn);
+		if ((conn->domain ? domain_can_write(conn) : conn->pollout) &&
+		    !list_empty(&conn->out_list))
+			handle_output(conn);
+		if (talloc_free(conn) == 0)
+			continue;
+
+		conn_update_active(conn);
+	}
+}
+
 int main(int argc, char *argv[])
 {
-	int opt, *sock, *ro_sock, max;
-	fd_set inset, outset;
+	int opt;
 	bool dofork = true;
 	bool outputpid = false;
 	bool no_domain_init = false;
 	const char *pidfile = NULL;
-	int evtchn_fd = -1;
-	struct timeval *timeout;
 
 	while ((opt = getopt_long(argc, argv, "DE:F:HNPS:t:T:RLVW:", options,
 				  NULL)) != -1) {
@@ -1884,76 +2106,25 @@ int main(int argc, char *argv[])
 		evtchn_fd = xc_evtchn_fd(xce_handle);
 
 	/* Get ready to listen to the tools. */
-	max = initialize_set(&inset, &outset, *sock, *ro_sock, &timeout);
+	poll_init();
+	if (*sock != -1)
+		poll_add(*sock, false);
+	if (*ro_sock != -1)
+		poll_add(*ro_sock, false);
+	if (reopen_log_pipe[0] != -1)
+		poll_add(reopen_log_pipe[0], false);
+	if (evtchn_fd != -1)
+		poll_add(evtchn_fd, false);
 
 	/* Tell the kernel we're up and running. */
 	xenbus_notify_running();
 
 	/* Main loop. */
 	for (;;) {
-		struct connection *conn, *next;
-
-		if (select(max+1, &inset, &outset, NULL, timeout) < 0) {
-			if (errno == EINTR)
-				continue;
-			barf_perror("Select failed");
-		}
-
-		if (reopen_log_pipe[0] != -1 && FD_ISSET(reopen_log_pipe[0], &inset)) {
-			char c;
-			if (read(reopen_log_pipe[0], &c, 1) != 1)
-				barf_perror("read failed");
-			reopen_log();
-		}
-
-		if (*sock != -1 && FD_ISSET(*sock, &inset))
-			accept_connection(*sock, true);
-
-		if (*ro_sock != -1 && FD_ISSET(*ro_sock, &inset))
-			accept_connection(*ro_sock, false);
-
-		if (evtchn_fd != -1 && FD_ISSET(evtchn_fd, &inset))
-			handle_event();
-
-		next = list_entry(connections.next, typeof(*conn), list);
-		if (&next->list != &connections)
-			talloc_increase_ref_count(next);
-		while (&next->list != &connections) {
-			conn = next;
-
-			next = list_entry(conn->list.next,
-					  typeof(*conn), list);
-			if (&next->list != &connections)
-				talloc_increase_ref_count(next);
-
-			if (conn->domain) {
-				if (domain_can_read(conn))
-					handle_input(conn);
-				if (talloc_free(conn) == 0)
-					continue;
-
-				talloc_increase_ref_count(conn);
-				if (domain_can_write(conn) &&
-				    !list_empty(&conn->out_list))
-					handle_output(conn);
-				if (talloc_free(conn) == 0)
-					continue;
-			} else {
-				if (FD_ISSET(conn->fd, &inset))
-					handle_input(conn);
-				if (talloc_free(conn) == 0)
-					continue;
-
-				talloc_increase_ref_count(conn);
-				if (FD_ISSET(conn->fd, &outset))
-					handle_output(conn);
-				if (talloc_free(conn) == 0)
-					continue;
-			}
-		}
+		/* Don't sleep while there is work we already know about. */
+		poll_wait(list_empty(&active_connections) ? -1 : 0, handle_fd);
 
-		max = initialize_set(&inset, &outset, *sock, *ro_sock,
-				     &timeout);
+		handle_connections();
 	}
 }
 
@@ -90,17 +90,37 @@ struct connection
 	/* My watches. */
 	struct list_head watches;
 
+	/* Socket readiness, as last reported by the event loop.  Cleared
+	 * when a read or write would block. */
+	bool pollin, pollout;
+
+	/* On the list of connections with work to do. */
+	struct list_head active;
+
 	/* Methods for communicating over this connection: write can be NULL */
 	connwritefn_t *write;
 	connreadfn_t *read;
 };
 extern struct list_head connections;
 
+/* Header of a node record in the TDB. */
+struct xs_tdb_record_hdr {
+	/* Generation of the store when the node was last written. */
+	uint64_t generation;
+	uint32_t num_perms;
+	uint32_t datalen;
+	uint32_t childlen;
+	struct xs_permissions perms[0];
+};
+
+/* Generation of a node which doesn't exist. */
+#define NO_GENERATION ~((uint64_t)0)
+
 struct node {
 	const char *name;
 
-	/* Database I came from */
-	TDB_CONTEXT *tdb;
+	/* Transaction I was read or created in (NULL for the store itself) */
+	struct transaction *trans;
 
 	/* Parent (optional) */
 	struct node *parent;
@@ -145,17 +165,21 @@ struct node *get_node(struct connection *conn,
 		      const char *name,
 		      enum xs_perm_type perm);
 
-/* Get TDB context for this connection */
-TDB_CONTEXT *tdb_context(struct connection *conn);
+/* Get the TDB context of the store */
+TDB_CONTEXT *tdb_context(void);
 
-/* Destructor for tdbs: required for transaction code */
-int destroy_tdb(void *_tdb);
+/* Generation count of the store: bumped on every node write. */
+extern uint64_t generation;
 
-/* Replace the tdb: required for transaction code */
-bool replace_tdb(const char *newname, TDB_CONTEXT *newtdb);
+/* Hash functions for hashtables keyed by node name. */
+unsigned int hash_from_key_fn(void *k);
+int keys_equal_fn(void *key1, void *key2);
 
 struct connection *new_connection(connwritefn_t *write, connreadfn_t *read);
 
+/* Put a connection on, or take it off, the list of those with work to do. */
+void conn_update_active(struct connection *conn);
+
 
 /* Is this a valid node name? */
 bool is_valid_nodename(const char *node);
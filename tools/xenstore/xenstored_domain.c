@@ -240,6 +240,7 @@ static void domain_cleanup(void)
 void handle_event(void)
 {
 	evtchn_port_t port;
+	struct domain *domain;
 
 	if ((port = xc_evtchn_pending(xce_handle)) == -1)
 		barf_perror("Failed to read from event fd");
@@ -247,6 +248,14 @@ void handle_event(void)
 	if (port == virq_port)
 		domain_cleanup();
 
+	/* The domain has put requests on, or taken replies off, its ring. */
+	list_for_each_entry(domain, &domains, list) {
+		if (domain->port == port) {
+			conn_update_active(domain->conn);
+			break;
+		}
+	}
+
 	if (xc_evtchn_unmask(xce_handle, port) == -1)
 		barf_perror("Failed to write to event fd");
 }
@@ -404,6 +413,7 @@ void do_introduce(struct connection *conn, struct buffered_data *in)
 	}
 
 	domain_conn_reset(domain);
+	conn_update_active(domain->conn);
 
 	send_ack(conn, XS_INTRODUCE);
 }
@@ -616,6 +626,7 @@ static int dom0_init(void)
 
 	talloc_steal(dom0->conn, dom0); 
 
+	conn_update_active(dom0->conn);
 	xc_evtchn_notify(xce_handle, dom0->port); 
 
 	return 0; 
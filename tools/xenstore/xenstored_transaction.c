@@ -35,6 +35,49 @@
 #include "xenstored_domain.h"
 #include "xenstore_lib.h"
 #include "utils.h"
+#include "hashtable.h"
+
+/*
+ * Transactions don't copy the store.  Every node a transaction touches is
+ * remembered together with the generation it had in the store at the time;
+ * nodes written by the transaction live in the store under a private key
+ * ("<tid>/path") until commit.  Committing checks that none of the
+ * accessed nodes has changed generation since, then moves the private
+ * copies into place.  Start, commit and abort therefore cost in proportion
+ * to the nodes touched, not the size of the store.
+ *
+ * A commit is all or nothing: every private copy, and the store's current
+ * record of each node the transaction changes, is read before the store is
+ * touched, so that a failure part way through can be rolled back.
+ */
+
+struct accessed_node
+{
+	/* List of all nodes accessed in the context of this transaction. */
+	struct list_head list;
+
+	/* The name of the node. */
+	char *node;
+
+	/* Key of the transaction's private copy of the node. */
+	char *trans_name;
+
+	/* Generation of the node in the store on first access. */
+	uint64_t generation;
+
+	/* Does the transaction hold a private copy of the node? */
+	bool modified;
+
+	/* Or has it deleted the node? */
+	bool deleted;
+
+	/* Staged by transaction_commit(): the data to write, and the store's
+	 * record of the node before the commit, to roll back to. */
+	TDB_DATA new_data, old_data;
+
+	/* Is it on the list of changes (for firing watches)? */
+	bool changed;
+};
 
 struct changed_node
 {
@@ -68,12 +111,12 @@ struct transaction
 	/* Connection-local identifier for this transaction. */
 	uint32_t id;
 
-	/* Generation when transaction started. */
-	unsigned int generation;
+	/* Global identifier, used as the prefix of private node keys. */
+	uint64_t tid;
 
-	/* TDB to work on, and filename */
-	TDB_CONTEXT *tdb;
-	char *tdb_name;
+	/* List of accessed nodes, and an index of them by name. */
+	struct list_head accessed;
+	struct hashtable *accessed_index;
 
 	/* List of changed nodes. */
 	struct list_head changes;
@@ -83,29 +126,167 @@ struct transaction
 };
 
 extern int quota_max_transaction;
-static unsigned int generation;
+static uint64_t next_tid;
+
+static struct accessed_node *find_accessed_node(struct transaction *trans,
+						const char *name)
+{
+	return hashtable_search(trans->accessed_index, (void *)name);
+}
 
-/* Return tdb context to use for this connection. */
-TDB_CONTEXT *tdb_transaction_context(struct transaction *trans)
+/* Generation of the node in the store proper. */
+static uint64_t store_generation(const char *name)
 {
-	return trans->tdb;
+	TDB_DATA key, data;
+	uint64_t gen;
+
+	key.dptr = (void *)name;
+	key.dsize = strlen(name);
+	data = tdb_fetch(tdb_context(), key);
+	if (data.dptr == NULL)
+		return NO_GENERATION;
+
+	gen = ((struct xs_tdb_record_hdr *)data.dptr)->generation;
+	talloc_free(data.dptr);
+	return gen;
+}
+
+/* Remember the node, with the generation it has in the store. */
+static struct accessed_node *add_accessed_node(struct transaction *trans,
+					       const char *name, uint64_t gen)
+{
+	struct accessed_node *i;
+	char *key;
+
+	i = talloc_zero(trans, struct accessed_node);
+	if (!i)
+		return NULL;
+	i->node = talloc_strdup(i, name);
+	i->trans_name = talloc_asprintf(i, "%llu%s",
+					(unsigned long long)trans->tid, name);
+	key = strdup(name);
+	if (!i->node || !i->trans_name || !key ||
+	    !hashtable_insert(trans->accessed_index, key, i)) {
+		free(key);
+		talloc_free(i);
+		return NULL;
+	}
+	i->generation = gen;
+	list_add_tail(&i->list, &trans->accessed);
+	return i;
+}
+
+static struct accessed_node *get_accessed_node(struct transaction *trans,
+					       const char *name)
+{
+	struct accessed_node *i = find_accessed_node(trans, name);
+
+	if (!i)
+		i = add_accessed_node(trans, name, store_generation(name));
+	return i;
+}
+
+static void delete_private_copy(struct accessed_node *i)
+{
+	TDB_DATA key;
+
+	if (!i->modified)
+		return;
+
+	key.dptr = (void *)i->trans_name;
+	key.dsize = strlen(i->trans_name);
+	tdb_delete(tdb_context(), key);
+	i->modified = false;
+}
+
+bool transaction_read_key(struct transaction *trans, const char *name,
+			  TDB_DATA *key)
+{
+	struct accessed_node *i = trans ? find_accessed_node(trans, name) : NULL;
+
+	if (i && i->deleted)
+		return false;
+
+	key->dptr = (void *)((i && i->modified) ? i->trans_name : name);
+	key->dsize = strlen((char *)key->dptr);
+	return true;
+}
+
+void transaction_node_read(struct transaction *trans, const char *name,
+			   uint64_t gen)
+{
+	if (trans && !find_accessed_node(trans, name))
+		add_accessed_node(trans, name, gen);
+}
+
+bool transaction_write_key(struct transaction *trans, const char *name,
+			   TDB_DATA *key)
+{
+	struct accessed_node *i;
+
+	if (!trans) {
+		key->dptr = (void *)name;
+		key->dsize = strlen(name);
+		return true;
+	}
+
+	i = get_accessed_node(trans, name);
+	if (!i)
+		return false;
+
+	i->modified = true;
+	i->deleted = false;
+	key->dptr = (void *)i->trans_name;
+	key->dsize = strlen(i->trans_name);
+	return true;
+}
+
+int transaction_delete(struct transaction *trans, const char *name)
+{
+	struct accessed_node *i = get_accessed_node(trans, name);
+
+	if (!i)
+		return -1;
+
+	delete_private_copy(i);
+	i->deleted = true;
+	return 0;
+}
+
+bool transaction_key_active(const char *key)
+{
+	unsigned long long tid;
+	struct connection *conn;
+	struct transaction *trans;
+	char *end;
+
+	tid = strtoull(key, &end, 10);
+	if (end == key || *end != '/')
+		return false;
+
+	list_for_each_entry(conn, &connections, list)
+		list_for_each_entry(trans, &conn->transaction_list, list)
+			if (trans->tid == tid)
+				return true;
+
+	return false;
 }
 
 /* Callers get a change node (which can fail) and only commit after they've
  * finished.  This way they don't have to unwind eg. a write. */
 void add_change_node(struct transaction *trans, const char *node, bool recurse)
 {
+	struct accessed_node *a;
 	struct changed_node *i;
 
-	if (!trans) {
-		/* They're changing the global database. */
-		generation++;
+	/* They're changing the global database: nothing to remember. */
+	if (!trans)
 		return;
-	}
 
-	list_for_each_entry(i, &trans->changes, list)
-		if (streq(i->node, node))
-			return;
+	a = get_accessed_node(trans, node);
+	if (!a || a->changed)
+		return;
+	a->changed = true;
 
 	i = talloc(trans, struct changed_node);
 	i->node = talloc_strdup(i, node);
@@ -113,14 +294,121 @@ void add_change_node(struct transaction *trans, const char *node, bool recurse)
 	list_add_tail(&i->list, &trans->changes);
 }
 
+/* Has any node we accessed been changed in the store behind our back? */
+static bool transaction_conflicts(struct transaction *trans)
+{
+	struct accessed_node *i;
+
+	list_for_each_entry(i, &trans->accessed, list)
+		if (store_generation(i->node) != i->generation)
+			return true;
+
+	return false;
+}
+
+/* Read everything needed to commit, or roll back, a changed node. */
+static bool stage_node(struct accessed_node *i)
+{
+	TDB_DATA key;
+
+	key.dptr = (void *)i->node;
+	key.dsize = strlen(i->node);
+	i->old_data = tdb_fetch(tdb_context(), key);
+	if (i->old_data.dptr == NULL && tdb_exists(tdb_context(), key)) {
+		errno = ENOMEM;
+		return false;
+	}
+	talloc_steal(i, i->old_data.dptr);
+
+	if (i->modified) {
+		key.dptr = (void *)i->trans_name;
+		key.dsize = strlen(i->trans_name);
+		i->new_data = tdb_fetch(tdb_context(), key);
+		if (i->new_data.dptr == NULL) {
+			errno = EIO;
+			return false;
+		}
+		talloc_steal(i, i->new_data.dptr);
+	}
+
+	return true;
+}
+
+/* Put back the store's record of the node from before the commit. */
+static void rollback_node(struct accessed_node *i)
+{
+	TDB_DATA key;
+
+	key.dptr = (void *)i->node;
+	key.dsize = strlen(i->node);
+	if (i->old_data.dptr)
+		tdb_store(tdb_context(), key, i->old_data, TDB_REPLACE);
+	else
+		tdb_delete(tdb_context(), key);
+}
+
+/* Move our private copies into the store, and perform our deletions. */
+static bool transaction_commit(struct transaction *trans)
+{
+	struct accessed_node *i, *failed;
+	TDB_DATA key;
+	int saved_errno;
+
+	list_for_each_entry(i, &trans->accessed, list)
+		if ((i->modified || i->deleted) && !stage_node(i))
+			return false;
+
+	list_for_each_entry(i, &trans->accessed, list) {
+		key.dptr = (void *)i->node;
+		key.dsize = strlen(i->node);
+
+		if (i->modified) {
+			if (tdb_store(tdb_context(), key, i->new_data,
+				      TDB_REPLACE) != 0) {
+				errno = ENOSPC;
+				goto rollback;
+			}
+		} else if (i->deleted && i->old_data.dptr) {
+			/* Nodes that never existed outside the transaction
+			 * have nothing to delete. */
+			if (tdb_delete(tdb_context(), key) != 0) {
+				errno = EIO;
+				goto rollback;
+			}
+		}
+	}
+
+	list_for_each_entry(i, &trans->accessed, list)
+		delete_private_copy(i);
+
+	return true;
+
+ rollback:
+	/* A failed store may already have dropped the old record, so the
+	 * failing node is restored too. */
+	saved_errno = errno;
+	failed = i;
+	list_for_each_entry(i, &trans->accessed, list) {
+		if (i->modified || i->deleted)
+			rollback_node(i);
+		if (i == failed)
+			break;
+	}
+	errno = saved_errno;
+	return false;
+}
+
 static int destroy_transaction(void *_transaction)
 {
 	struct transaction *trans = _transaction;
+	struct accessed_node *i;
 
 	trace_destroy(trans, "transaction");
-	if (trans->tdb)
-		tdb_close(trans->tdb);
-	unlink(trans->tdb_name);
+	list_for_each_entry(i, &trans->accessed, list)
+		delete_private_copy(i);
+	if (trans->accessed_index)
+		hashtable_destroy(trans->accessed_index, 0 /* Don't free values
+							      (talloced) */);
 	return 0;
 }
 
@@ -155,19 +443,18 @@ void do_transaction_start(struct connection *conn, struct buffered_data *in)
 	}
 
 	/* Attach transaction to input for autofree until it's complete */
-	trans = talloc(in, struct transaction);
+	trans = talloc_zero(in, struct transaction);
+	INIT_LIST_HEAD(&trans->accessed);
 	INIT_LIST_HEAD(&trans->changes);
 	INIT_LIST_HEAD(&trans->changed_domains);
-	trans->generation = generation;
-	trans->tdb_name = talloc_asprintf(trans, "%s.%p",
-					  xs_daemon_tdb(), trans);
-	trans->tdb = tdb_copy(tdb_context(conn), trans->tdb_name);
-	if (!trans->tdb) {
-		send_error(conn, errno);
+	trans->tid = next_tid++;
+	trans->accessed_index = create_hashtable(16, hash_from_key_fn,
+						 keys_equal_fn);
+	if (!trans->accessed_index) {
+		send_error(conn, ENOMEM);
 		return;
 	}
-	/* Make it close if we go away. */
-	talloc_steal(trans, trans->tdb);
+	talloc_set_destructor(trans, destroy_transaction);
 
 	/* Pick an unused transaction identifier. */
 	do {
@@ -178,7 +465,6 @@ void do_transaction_start(struct connection *conn, struct buffered_data *in)
 	/* Now we own it. */
 	list_add_tail(&trans->list, &conn->transaction_list);
 	talloc_steal(conn, trans);
-	talloc_set_destructor(trans, destroy_transaction);
 	conn->transaction_started++;
 
 	snprintf(id_str, sizeof(id_str), "%u", trans->id);
@@ -209,17 +495,14 @@ void do_transaction_end(struct connection *conn, const char *arg)
 	talloc_steal(arg, trans);
 
 	if (streq(arg, "T")) {
-		/* FIXME: Merge, rather failing on any change. */
-		if (trans->generation != generation) {
+		if (transaction_conflicts(trans)) {
 			send_error(conn, EAGAIN);
 			return;
 		}
-		if (!replace_tdb(trans->tdb_name, trans->tdb)) {
+		if (!transaction_commit(trans)) {
 			send_error(conn, errno);
 			return;
 		}
-		/* Don't close this: we won! */
-		trans->tdb = NULL;
 
 		/* fix domain entry for each changed domain */
 		list_for_each_entry(d, &trans->changed_domains, list)
@@ -228,7 +511,6 @@ void do_transaction_end(struct connection *conn, const char *arg)
 		/* Fire off the watches for everything that changed. */
 		list_for_each_entry(i, &trans->changes, list)
 			fire_watches(conn, i->node, i->recurse);
-		generation++;
 	}
 	send_ack(conn, XS_TRANSACTION_END);
 }
@@ -35,8 +35,27 @@ void transaction_entry_dec(struct transaction *trans, unsigned int domid);
 void add_change_node(struct transaction *trans, const char *node,
                      bool recurse);
 
-/* Return tdb context to use for this connection. */
-TDB_CONTEXT *tdb_transaction_context(struct transaction *trans);
+/*
+ * Node access within a transaction (trans may be NULL for none).
+ *
+ * Set key to the TDB key to read node name from: false if the transaction
+ * has deleted it.  Then report the generation read (NO_GENERATION if the
+ * node doesn't exist), which is checked again at commit time.
+ */
+bool transaction_read_key(struct transaction *trans, const char *name,
+			  TDB_DATA *key);
+void transaction_node_read(struct transaction *trans, const char *name,
+			   uint64_t gen);
+
+/* Set key to the TDB key to write node name to: false if out of memory. */
+bool transaction_write_key(struct transaction *trans, const char *name,
+			   TDB_DATA *key);
+
+/* Delete node name as far as the transaction is concerned. */
+int transaction_delete(struct transaction *trans, const char *name);
+
+/* Does this TDB key belong to a transaction in progress? */
+bool transaction_key_active(const char *key);
 
 void conn_delete_all_transactions(struct connection *conn);
 
@@ -30,14 +30,44 @@
 #include "xenstore_lib.h"
 #include "utils.h"
 #include "xenstored_domain.h"
+#include "hashtable.h"
 
 extern int quota_nb_watch_per_domain;
 
+/*
+ * Watches are indexed by a trie of path components, so that a change only
+ * has to look at the watches on its ancestors (and, for rm, descendants)
+ * rather than every watch of every connection.
+ */
+struct watch_node
+{
+	/* Siblings under the same parent. */
+	struct list_head list;
+	struct watch_node *parent;
+
+	/* Path component (NULL for the roots). */
+	char *name;
+
+	/* Children, and an index of them by name. */
+	struct list_head children;
+	struct hashtable *index;
+
+	/* Watches on exactly this path. */
+	struct list_head watches;
+};
+
 struct watch
 {
 	/* Watches on this connection */
 	struct list_head list;
 
+	/* Watches on the same path, and the trie node for it. */
+	struct list_head node_list;
+	struct watch_node *wnode;
+
+	/* Connection which owns this watch. */
+	struct connection *conn;
+
 	/* Current outstanding events applying to this watch. */
 	struct list_head events;
 
@@ -48,7 +78,109 @@ struct watch
 	char *node;
 };
 
-static void add_event(struct connection *conn,
+/* "/" and its children, and the special "@" event nodes. */
+static struct watch_node watch_root = {
+	.children = LIST_HEAD_INIT(watch_root.children),
+	.watches = LIST_HEAD_INIT(watch_root.watches),
+};
+static struct watch_node event_root = {
+	.children = LIST_HEAD_INIT(event_root.children),
+	.watches = LIST_HEAD_INIT(event_root.watches),
+};
+
+/* Statistics, reported by the "watch-stats" debug command. */
+static unsigned int nr_watches;
+static unsigned long long nr_fires, nr_scanned, nr_fired;
+static unsigned int max_scanned, max_fired;
+
+static struct watch_node *find_child(struct watch_node *parent,
+				     const char *name)
+{
+	if (!parent->index)
+		return NULL;
+	return hashtable_search(parent->index, (void *)name);
+}
+
+static struct watch_node *add_child(struct watch_node *parent,
+				    const char *name)
+{
+	struct watch_node *child;
+	char *key;
+
+	if (!parent->index) {
+		parent->index = create_hashtable(16, hash_from_key_fn,
+						 keys_equal_fn);
+		if (!parent->index)
+			return NULL;
+	}
+
+	child = talloc_zero(talloc_autofree_context(), struct watch_node);
+	key = strdup(name);
+	if (!child || !key) {
+		talloc_free(child);
+		free(key);
+		return NULL;
+	}
+	child->name = talloc_strdup(child, name);
+	child->parent = parent;
+	INIT_LIST_HEAD(&child->children);
+	INIT_LIST_HEAD(&child->watches);
+	if (!child->name || !hashtable_insert(parent->index, key, child)) {
+		talloc_free(child);
+		free(key);
+		return NULL;
+	}
+	list_add_tail(&child->list, &parent->children);
+	return child;
+}
+
+/* Drop trie nodes which no longer lead to any watch. */
+static void prune_watch_node(struct watch_node *wnode)
+{
+	struct watch_node *parent;
+
+	while ((parent = wnode->parent) &&
+	       list_empty(&wnode->watches) && list_empty(&wnode->children)) {
+		hashtable_remove(parent->index, wnode->name);
+		list_del(&wnode->list);
+		if (wnode->index)
+			hashtable_destroy(wnode->index, 0);
+		talloc_free(wnode);
+		wnode = parent;
+	}
+}
+
+/* Find the trie node for this path, creating it if asked to. */
+static struct watch_node *get_watch_node(const char *path, bool create)
+{
+	struct watch_node *wnode, *child;
+	char *copy, *name, *save;
+
+	wnode = strstarts(path, "/") ? &watch_root : &event_root;
+
+	copy = talloc_strdup(NULL, path);
+	if (!copy)
+		return NULL;
+
+	for (name = strtok_r(copy, "/", &save); name;
+	     name = strtok_r(NULL, "/", &save)) {
+		child = find_child(wnode, name);
+		if (!child && create)
+			child = add_child(wnode, name);
+		if (!child) {
+			if (create)
+				prune_watch_node(wnode);
+			wnode = NULL;
+			break;
+		}
+		wnode = child;
+	}
+
+	talloc_free(copy);
+	return wnode;
+}
+
+static bool add_event(struct connection *conn,
 		      struct watch *watch,
 		      const char *name)
 {
@@ -69,7 +201,7 @@ static void add_event(struct connection *conn,
 		 * Really we should fix this better...
 		 */
 		if (!node && errno != ENOENT && errno != EACCES)
-			return;
+			return false;
 	}
 
 	if (watch->relative_path) {
@@ -84,31 +216,99 @@ static void add_event(struct connection *conn,
 	strcpy(data + strlen(name) + 1, watch->token);
 	send_reply(conn, XS_WATCH_EVENT, data, len);
 	talloc_free(data);
+	return true;
 }
 
-void fire_watches(struct connection *conn, const char *name, bool recurse)
+/* Fire the watches on this trie node; name NULL means use their own path. */
+static void fire_node_watches(struct watch_node *wnode, const char *name,
+			      unsigned int *scanned, unsigned int *fired)
 {
-	struct connection *i;
 	struct watch *watch;
 
+	list_for_each_entry(watch, &wnode->watches, node_list) {
+		(*scanned)++;
+		if (add_event(watch->conn, watch, name ? name : watch->node))
+			(*fired)++;
+	}
+}
+
+/* Fire every watch strictly below this trie node. */
+static void fire_subtree_watches(struct watch_node *wnode,
+				 unsigned int *scanned, unsigned int *fired)
+{
+	struct watch_node *child;
+
+	list_for_each_entry(child, &wnode->children, list) {
+		fire_node_watches(child, NULL, scanned, fired);
+		fire_subtree_watches(child, scanned, fired);
+	}
+}
+
+void fire_watches(struct connection *conn, const char *name, bool recurse)
+{
+	struct watch_node *wnode, *child;
+	unsigned int scanned = 0, fired = 0;
+	char *copy, *comp, *save;
+
 	/* During transactions, don't fire watches. */
 	if (conn && conn->transaction)
 		return;
 
-	/* Create an event for each watch. */
-	list_for_each_entry(i, &connections, list) {
-		list_for_each_entry(watch, &i->watches, list) {
-			if (is_child(name, watch->node))
-				add_event(i, watch, name);
-			else if (recurse && is_child(watch->node, name))
-				add_event(i, watch, watch->node);
-		}
+	/* A watch on / sees everything, even the special event nodes. */
+	if (strstarts(name, "/")) {
+		wnode = &watch_root;
+	} else {
+		fire_node_watches(&watch_root, name, &scanned, &fired);
+		wnode = &event_root;
+	}
+
+	/* Create an event for each watch on the node or its ancestors... */
+	copy = talloc_strdup(NULL, name);
+	fire_node_watches(wnode, name, &scanned, &fired);
+	for (comp = strtok_r(copy, "/", &save); comp && wnode;
+	     comp = strtok_r(NULL, "/", &save)) {
+		child = find_child(wnode, comp);
+		if (child)
+			fire_node_watches(child, name, &scanned, &fired);
+		wnode = child;
 	}
+	talloc_free(copy);
+
+	/* ...and if its children went too, for each watch below it. */
+	if (recurse && wnode)
+		fire_subtree_watches(wnode, &scanned, &fired);
+
+	nr_fires++;
+	nr_scanned += scanned;
+	nr_fired += fired;
+	if (scanned > max_scanned)
+		max_scanned = scanned;
+	if (fired > max_fired)
+		max_fired = fired;
+}
+
+char *watch_stats(const void *ctx)
+{
+	return talloc_asprintf(ctx,
+		"watches: %u\n"
+		"changes: %llu\n"
+		"watches scanned: %llu (%.2f per change, max %u)\n"
+		"watches fired: %llu (%.2f per change, max %u)\n",
+		nr_watches, nr_fires,
+		nr_scanned, nr_fires ? (double)nr_scanned / nr_fires : 0.0,
+		max_scanned,
+		nr_fired, nr_fires ? (double)nr_fired / nr_fires : 0.0,
+		max_fired);
 }
 
 static int destroy_watch(void *_watch)
 {
-	trace_destroy(_watch, "watch");
+	struct watch *watch = _watch;
+
+	trace_destroy(watch, "watch");
+	list_del(&watch->node_list);
+	prune_watch_node(watch->wnode);
+	nr_watches--;
 	return 0;
 }
 
@@ -156,6 +356,13 @@ void do_watch(struct connection *conn, struct buffered_data *in)
 	watch = talloc(conn, struct watch);
 	watch->node = talloc_strdup(watch, vec[0]);
 	watch->token = talloc_strdup(watch, vec[1]);
+	watch->wnode = get_watch_node(watch->node, true);
+	if (!watch->wnode) {
+		talloc_free(watch);
+		send_error(conn, ENOMEM);
+		return;
+	}
+	watch->conn = conn;
 	if (relative)
 		watch->relative_path = get_implicit_path(conn);
 	else
@@ -165,6 +372,8 @@ void do_watch(struct connection *conn, struct buffered_data *in)
 
 	domain_watch_inc(conn);
 	list_add_tail(&watch->list, &conn->watches);
+	list_add_tail(&watch->node_list, &watch->wnode->watches);
+	nr_watches++;
 	trace_create(watch, "watch");
 	talloc_set_destructor(watch, destroy_watch);
 	send_ack(conn, XS_WATCH);
@@ -11,6 +11,7 @@
 #include "utils.h"
 
 struct record_hdr {
+	uint64_t generation;
 	uint32_t num_perms;
 	uint32_t datalen;
 	uint32_t childlen;
@@ -63,7 +64,8 @@ int main(int argc, char *argv[])
 			unsigned int i;
 			char *p;
 
-			printf("%.*s: ", (int)key.dsize, key.dptr);
+			printf("%.*s: (gen %llu) ", (int)key.dsize, key.dptr,
+			       (unsigned long long)hdr->generation);
 			for (i = 0; i < hdr->num_perms; i++)
 				printf("%s%c%i",
 				       i == 0 ? "" : ",",
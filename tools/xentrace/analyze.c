@@ -0,0 +1,1158 @@
+/******************************************************************************
+ * tools/xentrace/analyze.c
+ *
+ * Summarise trace data written by xentrace: run time and wakeup latency
+ * for each vCPU, the cost of each HVM exit reason, memory events for each
+ * domain, and how often every event occurred.
+ *
+ * The data is read in one pass, from a file or standard input, so that
+ * xentrace can be piped straight into it on a busy host.  xentrace writes
+ * each CPU's trace buffer as a window of records preceded by a
+ * TRC_TRACE_CPU_CHANGE record; the records of each CPU are in TSC order,
+ * and the windows are merged back into a single TSC-ordered stream.  A
+ * CPU which has gone quiet would stall the merge, so once more than the
+ * reorder limit (-b) is buffered the oldest record is taken regardless.
+ * Records of classes which are only counted never enter the merge.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <xen/trace.h>
+
+#define DOMID_IDLE_VCPU 32767
+
+#define RUNSTATE_running  0
+#define RUNSTATE_runnable 1
+#define RUNSTATE_blocked  2
+#define RUNSTATE_offline  3
+
+#define NR_EXIT_REASONS 0x410
+#define NR_BUCKETS      24
+#define INBUF_SIZE      (4 << 20)
+
+struct rec {
+    uint64_t tsc;
+    uint32_t event;
+    unsigned int cpu, nr;
+    uint32_t d[TRACE_EXTRA_MAX];
+};
+
+/* log2 histogram of durations, in microseconds (or kcycles without -c). */
+struct hist {
+    unsigned long count;
+    uint64_t sum, max;
+    unsigned long bucket[NR_BUCKETS];
+};
+
+struct vcpu_stats {
+    uint32_t key;                 /* domid << 16 | vcpu id */
+    int state;                    /* -1 until the first runstate change */
+    uint64_t state_tsc;
+    uint64_t time[4];             /* cycles in each runstate */
+    uint64_t wake_tsc;
+    unsigned long runs, wakeups;
+    struct hist wake;
+    unsigned long exits;
+    uint64_t exit_cycles;
+};
+
+struct pcpu {
+    /* Ring of decoded records waiting to be merged. */
+    struct rec *q;
+    unsigned int head, count, size;
+    int heap_idx;
+
+    uint64_t last_tsc;
+    unsigned long records, lost;
+
+    struct vcpu_stats *cur;
+    int in_exit;
+    unsigned int exit_reason;
+    uint64_t exit_tsc;
+};
+
+struct exit_info {
+    unsigned long count, desched;
+    uint64_t total, max;
+};
+
+#define NR_MEM_EVENTS 8
+
+struct mem_info {
+    unsigned long count[NR_MEM_EVENTS];
+    uint64_t pages[NR_MEM_EVENTS];
+};
+
+struct event_count {
+    uint32_t event;
+    unsigned long count;
+};
+
+static struct {
+    unsigned long mhz;
+    unsigned long reorder_limit;
+    int histograms;
+    const char *file;
+} opts = {
+    .reorder_limit = 1000000,
+};
+
+static volatile int interrupted;
+
+static struct pcpu *pcpus;
+static unsigned int nr_pcpus, nr_pcpus_seen;
+static struct pcpu **heap;
+static unsigned int heap_nr;
+static unsigned long buffered;
+
+static struct vcpu_stats **vcpus;
+static unsigned int vcpus_size, nr_vcpus;
+
+static struct event_count *events;
+static unsigned int events_size, nr_events;
+
+static struct exit_info exits[NR_EXIT_REASONS];
+static unsigned int max_exit_reason;
+static struct mem_info *mem[32768];
+
+static uint64_t first_tsc, last_tsc;
+static unsigned long long nr_bytes, nr_records, nr_lost, nr_merged;
+static unsigned long nr_out_of_order;
+
+static void *xrealloc(void *p, size_t size)
+{
+    p = realloc(p, size);
+    if ( p == NULL )
+    {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    return p;
+}
+
+static void *xzalloc(size_t size)
+{
+    void *p = calloc(1, size);
+
+    if ( p == NULL )
+    {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    return p;
+}
+
+/*
+ * Input, read in large blocks.
+ */
+
+static int infd;
+static unsigned char *inbuf;
+static size_t in_pos, in_len;
+
+static size_t in_read(void *dst, size_t n)
+{
+    size_t done = 0, chunk;
+    ssize_t r;
+
+    while ( done < n )
+    {
+        if ( in_pos == in_len )
+        {
+            if ( interrupted )
+                break;
+            r = read(infd, inbuf, INBUF_SIZE);
+            if ( r < 0 && errno == EINTR )
+                continue;
+            if ( r <= 0 )
+                break;
+            in_pos = 0;
+            in_len = r;
+        }
+        chunk = in_len - in_pos;
+        if ( chunk > n - done )
+            chunk = n - done;
+        memcpy((unsigned char *)dst + done, inbuf + in_pos, chunk);
+        in_pos += chunk;
+        done += chunk;
+    }
+
+    nr_bytes += done;
+    return done;
+}
+
+/*
+ * Time and histograms.
+ */
+
+static uint64_t to_units(uint64_t cycles)
+{
+    return opts.mhz ? cycles / opts.mhz : cycles / 1000;
+}
+
+static double to_units_f(uint64_t cycles)
+{
+    return opts.mhz ? (double)cycles / opts.mhz : (double)cycles / 1000;
+}
+
+static const char *unit(void)
+{
+    return opts.mhz ? "us" : "kcyc";
+}
+
+static void hist_add(struct hist *h, uint64_t cycles)
+{
+    uint64_t v = to_units(cycles);
+    unsigned int b = 0;
+
+    h->count++;
+    h->sum += cycles;
+    if ( cycles > h->max )
+        h->max = cycles;
+
+    while ( v && b < NR_BUCKETS - 1 )
+    {
+        v >>= 1;
+        b++;
+    }
+    h->bucket[b]++;
+}
+
+static void hist_print(const struct hist *h, const char *indent)
+{
+    unsigned int b, first = NR_BUCKETS, last = 0, n = 0;
+
+    for ( b = 0; b < NR_BUCKETS; b++ )
+        if ( h->bucket[b] )
+        {
+            if ( first == NR_BUCKETS )
+                first = b;
+            last = b;
+        }
+
+    for ( b = first; b <= last && first < NR_BUCKETS; b++ )
+    {
+        if ( n++ % 4 == 0 )
+            printf("%s%s", b == first ? "" : "\n", indent);
+        if ( b == 0 )
+            printf("  %8s <1: %-8lu", "", h->bucket[b]);
+        else
+            printf("  %7llu-%-4llu: %-8lu",
+                   1ULL << (b - 1), 1ULL << b, h->bucket[b]);
+    }
+    if ( n )
+        printf("  (%s)\n", unit());
+}
+
+/*
+ * Event names.
+ */
+
+static const struct {
+    uint32_t event;
+    const char *name;
+} event_names[] = {
+    { TRC_LOST_RECORDS,              "lost_records" },
+    { TRC_TRACE_WRAP_BUFFER,         "wrap_buffer" },
+    { TRC_TRACE_CPU_CHANGE,          "cpu_change" },
+    { TRC_SCHED_CONTINUE_RUNNING,    "continue_running" },
+    { TRC_SCHED_DOM_ADD,             "dom_add" },
+    { TRC_SCHED_DOM_REM,             "dom_rem" },
+    { TRC_SCHED_SLEEP,               "sleep" },
+    { TRC_SCHED_WAKE,                "wake" },
+    { TRC_SCHED_YIELD,               "yield" },
+    { TRC_SCHED_BLOCK,               "block" },
+    { TRC_SCHED_SHUTDOWN,            "shutdown" },
+    { TRC_SCHED_CTL,                 "sched_ctl" },
+    { TRC_SCHED_ADJDOM,              "adjdom" },
+    { TRC_SCHED_SWITCH,              "switch" },
+    { TRC_SCHED_S_TIMER_FN,          "s_timer_fn" },
+    { TRC_SCHED_T_TIMER_FN,          "t_timer_fn" },
+    { TRC_SCHED_DOM_TIMER_FN,        "dom_timer_fn" },
+    { TRC_SCHED_SWITCH_INFPREV,      "switch_infprev" },
+    { TRC_SCHED_SWITCH_INFNEXT,      "switch_infnext" },
+    { TRC_SCHED_SHUTDOWN_CODE,       "shutdown_code" },
+    { TRC_MEM_PAGE_GRANT_MAP,        "grant_map" },
+    { TRC_MEM_PAGE_GRANT_UNMAP,      "grant_unmap" },
+    { TRC_MEM_PAGE_GRANT_TRANSFER,   "grant_transfer" },
+    { TRC_MEM_SET_P2M_ENTRY,         "set_p2m_entry" },
+    { TRC_MEM_DECREASE_RESERVATION,  "decrease_reservation" },
+    { TRC_MEM_POD_POPULATE,          "pod_populate" },
+    { TRC_MEM_POD_ZERO_RECLAIM,      "pod_zero_reclaim" },
+    { TRC_MEM_POD_SUPERPAGE_SPLINTER, "pod_superpage_splinter" },
+    { TRC_HVM_VMENTRY,               "vmentry" },
+    { TRC_HVM_VMEXIT,                "vmexit" },
+    { TRC_HVM_VMEXIT64,              "vmexit64" },
+    { TRC_HVM_PF_XEN,                "pf_xen" },
+    { TRC_HVM_PF_XEN64,              "pf_xen64" },
+    { TRC_HVM_PF_INJECT,             "pf_inject" },
+    { TRC_HVM_PF_INJECT64,           "pf_inject64" },
+    { TRC_HVM_INJ_EXC,               "inj_exc" },
+    { TRC_HVM_INJ_VIRQ,              "inj_virq" },
+    { TRC_HVM_REINJ_VIRQ,            "reinj_virq" },
+    { TRC_HVM_IO_READ,               "io_read" },
+    { TRC_HVM_IO_WRITE,              "io_write" },
+    { TRC_HVM_CR_READ,               "cr_read" },
+    { TRC_HVM_CR_READ64,             "cr_read64" },
+    { TRC_HVM_CR_WRITE,              "cr_write" },
+    { TRC_HVM_CR_WRITE64,            "cr_write64" },
+    { TRC_HVM_DR_READ,               "dr_read" },
+    { TRC_HVM_DR_WRITE,              "dr_write" },
+    { TRC_HVM_MSR_READ,              "msr_read" },
+    { TRC_HVM_MSR_WRITE,             "msr_write" },
+    { TRC_HVM_CPUID,                 "cpuid" },
+    { TRC_HVM_INTR,                  "intr" },
+    { TRC_HVM_NMI,                   "nmi" },
+    { TRC_HVM_SMI,                   "smi" },
+    { TRC_HVM_VMMCALL,               "vmmcall" },
+    { TRC_HVM_HLT,                   "hlt" },
+    { TRC_HVM_INVLPG,                "invlpg" },
+    { TRC_HVM_INVLPG64,              "invlpg64" },
+    { TRC_HVM_MCE,                   "mce" },
+    { TRC_HVM_IOPORT_READ,           "ioport_read" },
+    { TRC_HVM_IOMEM_READ,            "iomem_read" },
+    { TRC_HVM_CLTS,                  "clts" },
+    { TRC_HVM_LMSW,                  "lmsw" },
+    { TRC_HVM_LMSW64,                "lmsw64" },
+    { TRC_HVM_RDTSC,                 "rdtsc" },
+    { TRC_HVM_INTR_WINDOW,           "intr_window" },
+    { TRC_HVM_NPF,                   "npf" },
+    { TRC_HVM_REALMODE_EMULATE,      "realmode_emulate" },
+    { TRC_HVM_TRAP,                  "trap" },
+    { TRC_HVM_TRAP_DEBUG,            "trap_debug" },
+    { TRC_HVM_VLAPIC,                "vlapic" },
+    { TRC_HVM_IOPORT_WRITE,          "ioport_write" },
+    { TRC_HVM_IOMEM_WRITE,           "iomem_write" },
+};
+
+static const char *event_name(uint32_t event)
+{
+    unsigned int i;
+
+    if ( (event & 0x0ffff00f) == TRC_SCHED_RUNSTATE_CHANGE )
+        return "runstate_change";
+    if ( (event & TRC_HVM) == TRC_HVM )
+        event &= ~TRC_HVM_NESTEDFLAG;
+    for ( i = 0; i < sizeof(event_names) / sizeof(event_names[0]); i++ )
+        if ( event_names[i].event == event )
+            return event_names[i].name;
+    return "";
+}
+
+static const char *vmx_exit_names[] = {
+    [0] = "EXCEPTION_NMI", [1] = "EXTERNAL_INTERRUPT",
+    [2] = "TRIPLE_FAULT", [3] = "INIT", [4] = "SIPI", [5] = "IO_SMI",
+    [6] = "OTHER_SMI", [7] = "PENDING_VIRT_INTR", [8] = "PENDING_VIRT_NMI",
+    [9] = "TASK_SWITCH", [10] = "CPUID", [11] = "GETSEC", [12] = "HLT",
+    [13] = "INVD", [14] = "INVLPG", [15] = "RDPMC", [16] = "RDTSC",
+    [17] = "RSM", [18] = "VMCALL", [19] = "VMCLEAR", [20] = "VMLAUNCH",
+    [21] = "VMPTRLD", [22] = "VMPTRST", [23] = "VMREAD", [24] = "VMRESUME",
+    [25] = "VMWRITE", [26] = "VMXOFF", [27] = "VMXON", [28] = "CR_ACCESS",
+    [29] = "DR_ACCESS", [30] = "IO_INSTRUCTION", [31] = "MSR_READ",
+    [32] = "MSR_WRITE", [33] = "INVALID_GUEST_STATE", [34] = "MSR_LOADING",
+    [36] = "MWAIT_INSTRUCTION", [37] = "MONITOR_TRAP_FLAG",
+    [39] = "MONITOR_INSTRUCTION", [40] = "PAUSE_INSTRUCTION",
+    [41] = "MCE_DURING_VMENTRY", [43] = "TPR_BELOW_THRESHOLD",
+    [44] = "APIC_ACCESS", [45] = "EOI_INDUCED", [46] = "ACCESS_GDTR_OR_IDTR",
+    [47] = "ACCESS_LDTR_OR_TR", [48] = "EPT_VIOLATION",
+    [49] = "EPT_MISCONFIG", [50] = "INVEPT", [51] = "RDTSCP",
+    [52] = "VMX_PREEMPTION_TIMER", [53] = "INVVPID", [54] = "WBINVD",
+    [55] = "XSETBV", [56] = "APIC_WRITE", [58] = "INVPCID",
+};
+
+static const char *svm_exit_name(unsigned int reason)
+{
+    static char buf[16];
+    static const char *names[] = {
+        [0x60] = "INTR", [0x61] = "NMI", [0x62] = "SMI", [0x63] = "INIT",
+        [0x64] = "VINTR", [0x65] = "CR0_SEL_WRITE", [0x66] = "IDTR_READ",
+        [0x6e] = "RDTSC", [0x6f] = "RDPMC", [0x70] = "PUSHF",
+        [0x71] = "POPF", [0x72] = "CPUID", [0x73] = "RSM", [0x74] = "IRET",
+        [0x75] = "SWINT", [0x76] = "INVD", [0x77] = "PAUSE", [0x78] = "HLT",
+        [0x79] = "INVLPG", [0x7a] = "INVLPGA", [0x7b] = "IOIO",
+        [0x7c] = "MSR", [0x7d] = "TASK_SWITCH", [0x7e] = "FERR_FREEZE",
+        [0x7f] = "SHUTDOWN", [0x80] = "VMRUN", [0x81] = "VMMCALL",
+        [0x82] = "VMLOAD", [0x83] = "VMSAVE", [0x84] = "STGI",
+        [0x85] = "CLGI", [0x86] = "SKINIT", [0x87] = "RDTSCP",
+        [0x88] = "ICEBP", [0x89] = "WBINVD", [0x8a] = "MONITOR",
+        [0x8b] = "MWAIT", [0x8c] = "MWAIT_CONDITIONAL", [0x8d] = "XSETBV",
+    };
+
+    if ( reason < 0x10 )
+        snprintf(buf, sizeof(buf), "CR%u_READ", reason);
+    else if ( reason < 0x20 )
+        snprintf(buf, sizeof(buf), "CR%u_WRITE", reason - 0x10);
+    else if ( reason < 0x30 )
+        snprintf(buf, sizeof(buf), "DR%u_READ", reason - 0x20);
+    else if ( reason < 0x40 )
+        snprintf(buf, sizeof(buf), "DR%u_WRITE", reason - 0x30);
+    else if ( reason < 0x60 )
+        snprintf(buf, sizeof(buf), "EXCEPTION_%u", reason - 0x40);
+    else if ( reason == 0x400 )
+        return "NPF";
+    else if ( reason < sizeof(names) / sizeof(names[0]) && names[reason] )
+        return names[reason];
+    else
+        return "";
+    return buf;
+}
+
+static const char *exit_name(unsigned int reason)
+{
+    /* VMX basic exit reasons are all below 64, most SVM ones above. */
+    if ( max_exit_reason >= 64 )
+        return svm_exit_name(reason);
+    if ( reason < sizeof(vmx_exit_names) / sizeof(vmx_exit_names[0]) &&
+         vmx_exit_names[reason] )
+        return vmx_exit_names[reason];
+    return "";
+}
+
+/*
+ * Per-event counts, in an open-addressed hash.
+ */
+
+static void count_event(uint32_t event)
+{
+    unsigned int i, mask;
+    struct event_count *old;
+    unsigned int old_size;
+
+    if ( nr_events * 2 >= events_size )
+    {
+        old = events;
+        old_size = events_size;
+        events_size = events_size ? events_size * 2 : 256;
+        events = xzalloc(events_size * sizeof(*events));
+        nr_events = 0;
+        for ( i = 0; i < old_size; i++ )
+            if ( old[i].count )
+            {
+                unsigned int j = (old[i].event * 2654435761u) &
+                                 (events_size - 1);
+
+                while ( events[j].count )
+                    j = (j + 1) & (events_size - 1);
+                events[j] = old[i];
+                nr_events++;
+            }
+        free(old);
+    }
+
+    mask = events_size - 1;
+    for ( i = (event * 2654435761u) & mask; events[i].count;
+          i = (i + 1) & mask )
+        if ( events[i].event == event )
+        {
+            events[i].count++;
+            return;
+        }
+
+    events[i].event = event;
+    events[i].count = 1;
+    nr_events++;
+}
+
+/*
+ * vCPUs, in an open-addressed hash keyed by domid and vcpu id.
+ */
+
+static struct vcpu_stats *get_vcpu(unsigned int domid, unsigned int vcpuid)
+{
+    uint32_t key = (domid << 16) | (vcpuid & 0xffff);
+    unsigned int i, mask;
+    struct vcpu_stats **old;
+    unsigned int old_size;
+
+    if ( nr_vcpus * 2 >= vcpus_size )
+    {
+        old = vcpus;
+        old_size = vcpus_size;
+        vcpus_size = vcpus_size ? vcpus_size * 2 : 64;
+        vcpus = xzalloc(vcpus_size * sizeof(*vcpus));
+        for ( i = 0; i < old_size; i++ )
+            if ( old[i] )
+            {
+                unsigned int j = (old[i]->key * 2654435761u) &
+                                 (vcpus_size - 1);
+
+                while ( vcpus[j] )
+                    j = (j + 1) & (vcpus_size - 1);
+                vcpus[j] = old[i];
+            }
+        free(old);
+    }
+
+    mask = vcpus_size - 1;
+    for ( i = (key * 2654435761u) & mask; vcpus[i]; i = (i + 1) & mask )
+        if ( vcpus[i]->key == key )
+            return vcpus[i];
+
+    vcpus[i] = xzalloc(sizeof(*vcpus[i]));
+    vcpus[i]->key = key;
+    vcpus[i]->state = -1;
+    nr_vcpus++;
+
+    return vcpus[i];
+}
+
+static struct mem_info *get_mem(unsigned int domid)
+{
+    domid &= 0x7fff;
+    if ( mem[domid] == NULL )
+        mem[domid] = xzalloc(sizeof(*mem[domid]));
+    return mem[domid];
+}
+
+/*
+ * Analyses, fed with records in TSC order.
+ */
+
+static void end_exit(struct pcpu *p, uint64_t tsc, int desched)
+{
+    struct exit_info *e = &exits[p->exit_reason];
+    uint64_t cost = tsc - p->exit_tsc;
+
+    p->in_exit = 0;
+    if ( desched )
+    {
+        /* Includes time spent descheduled: not a cost of the exit. */
+        e->desched++;
+        return;
+    }
+
+    e->count++;
+    e->total += cost;
+    if ( cost > e->max )
+        e->max = cost;
+    if ( p->cur )
+    {
+        p->cur->exits++;
+        p->cur->exit_cycles += cost;
+    }
+}
+
+static void runstate_change(struct pcpu *p, const struct rec *r)
+{
+    unsigned int old = (r->event >> 8) & 3, new = (r->event >> 4) & 3;
+    struct vcpu_stats *v;
+
+    if ( r->nr < 1 )
+        return;
+    v = get_vcpu(r->d[0] >> 16, r->d[0] & 0xffff);
+
+    if ( v->state >= 0 )
+    {
+        if ( r->tsc >= v->state_tsc )
+            v->time[v->state] += r->tsc - v->state_tsc;
+        else
+            nr_out_of_order++;
+    }
+    v->state = new;
+    v->state_tsc = r->tsc;
+
+    if ( new == RUNSTATE_runnable &&
+         (old == RUNSTATE_blocked || old == RUNSTATE_offline) )
+    {
+        v->wakeups++;
+        v->wake_tsc = r->tsc;
+    }
+
+    if ( new == RUNSTATE_running )
+    {
+        v->runs++;
+        if ( v->wake_tsc && r->tsc >= v->wake_tsc )
+            hist_add(&v->wake, r->tsc - v->wake_tsc);
+        v->wake_tsc = 0;
+        p->cur = v;
+    }
+    else if ( old == RUNSTATE_running && p->cur == v )
+    {
+        if ( p->in_exit )
+            end_exit(p, r->tsc, 1);
+        p->cur = NULL;
+    }
+}
+
+/*
+ * Which word of each memory event holds the domain: the grant events carry
+ * only the domain, the others trace a struct with the domain in the bottom
+ * half of a word after the u64 frame numbers, and the order (if any) in the
+ * top half.  Those structs are padded, so the last word isn't the one.
+ */
+static const uint32_t mem_events[NR_MEM_EVENTS] = {
+    TRC_MEM_PAGE_GRANT_MAP, TRC_MEM_PAGE_GRANT_UNMAP,
+    TRC_MEM_PAGE_GRANT_TRANSFER, TRC_MEM_SET_P2M_ENTRY,
+    TRC_MEM_DECREASE_RESERVATION, TRC_MEM_POD_POPULATE,
+    TRC_MEM_POD_ZERO_RECLAIM, TRC_MEM_POD_SUPERPAGE_SPLINTER,
+};
+
+static const unsigned int mem_domain_word[NR_MEM_EVENTS] = {
+    0, 0, 0, 5, 2, 4, 4, 2,
+};
+
+static void mem_event(const struct rec *r)
+{
+    unsigned int type, order = 0;
+    uint32_t word;
+    struct mem_info *m;
+
+    for ( type = 0; type < NR_MEM_EVENTS; type++ )
+        if ( mem_events[type] == r->event )
+            break;
+    if ( type == NR_MEM_EVENTS || r->nr <= mem_domain_word[type] )
+        return;
+
+    word = r->d[mem_domain_word[type]];
+    if ( r->event == TRC_MEM_POD_SUPERPAGE_SPLINTER )
+        order = 9;
+    else if ( r->event > TRC_MEM_PAGE_GRANT_TRANSFER )
+        order = word >> 16;
+    if ( order > 18 )
+        return;
+
+    m = get_mem(word & 0xffff);
+    m->count[type]++;
+    m->pages[type] += 1UL << order;
+}
+
+static void process(const struct rec *r)
+{
+    struct pcpu *p = &pcpus[r->cpu];
+    uint32_t ev;
+
+    if ( !first_tsc || r->tsc < first_tsc )
+        first_tsc = r->tsc;
+    if ( r->tsc > last_tsc )
+        last_tsc = r->tsc;
+    nr_merged++;
+
+    if ( (r->event & 0x0ffff00f) == TRC_SCHED_RUNSTATE_CHANGE )
+    {
+        runstate_change(p, r);
+        return;
+    }
+
+    if ( (r->event & TRC_MEM) == TRC_MEM )
+    {
+        mem_event(r);
+        return;
+    }
+
+    ev = r->event & ~(TRC_HVM_NESTEDFLAG | TRC_64_FLAG);
+    if ( ev == TRC_HVM_VMEXIT && r->nr >= 1 )
+    {
+        /* VMX sets bit 31 for failed VM entries; keep the basic reason. */
+        p->exit_reason = r->d[0] & 0xffff;
+        if ( p->exit_reason >= NR_EXIT_REASONS )
+            p->exit_reason = NR_EXIT_REASONS - 1;
+        if ( p->exit_reason > max_exit_reason )
+            max_exit_reason = p->exit_reason;
+        p->exit_tsc = r->tsc;
+        p->in_exit = 1;
+    }
+    else if ( ev == TRC_HVM_VMENTRY && p->in_exit )
+        end_exit(p, r->tsc, 0);
+}
+
+/*
+ * Merging the CPUs' records: a min-heap of CPUs with queued records, keyed
+ * by the TSC of each one's oldest record.
+ */
+
+#define HEAD_TSC(p) ((p)->q[(p)->head].tsc)
+
+static void heap_swap(unsigned int a, unsigned int b)
+{
+    struct pcpu *t = heap[a];
+
+    heap[a] = heap[b];
+    heap[b] = t;
+    heap[a]->heap_idx = a;
+    heap[b]->heap_idx = b;
+}
+
+static void heap_up(unsigned int i)
+{
+    while ( i && HEAD_TSC(heap[(i - 1) / 2]) > HEAD_TSC(heap[i]) )
+    {
+        heap_swap(i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+static void heap_down(unsigned int i)
+{
+    unsigned int c;
+
+    for ( ; (c = 2 * i + 1) < heap_nr; i = c )
+    {
+        if ( c + 1 < heap_nr && HEAD_TSC(heap[c + 1]) < HEAD_TSC(heap[c]) )
+            c++;
+        if ( HEAD_TSC(heap[i]) <= HEAD_TSC(heap[c]) )
+            break;
+        heap_swap(i, c);
+    }
+}
+
+static void merge_one(void)
+{
+    struct pcpu *p = heap[0];
+
+    process(&p->q[p->head]);
+    p->head = (p->head + 1) % p->size;
+    p->count--;
+    buffered--;
+
+    if ( p->count )
+    {
+        heap_down(0);
+        return;
+    }
+
+    p->heap_idx = -1;
+    if ( --heap_nr )
+    {
+        heap[0] = heap[heap_nr];
+        heap[0]->heap_idx = 0;
+        heap_down(0);
+    }
+}
+
+static void merge(int all)
+{
+    while ( heap_nr &&
+            (all || heap_nr == nr_pcpus_seen ||
+             buffered > opts.reorder_limit) )
+        merge_one();
+}
+
+static struct pcpu *get_pcpu(unsigned int cpu)
+{
+    unsigned int i;
+
+    if ( cpu >= nr_pcpus )
+    {
+        unsigned int n = cpu + 1;
+        struct pcpu *old = pcpus;
+
+        pcpus = xrealloc(pcpus, n * sizeof(*pcpus));
+        memset(&pcpus[nr_pcpus], 0, (n - nr_pcpus) * sizeof(*pcpus));
+        for ( i = nr_pcpus; i < n; i++ )
+            pcpus[i].heap_idx = -2;   /* never seen */
+        heap = xrealloc(heap, n * sizeof(*heap));
+        /* Moving pcpus[] leaves heap[] pointing at the old array. */
+        for ( i = 0; i < heap_nr; i++ )
+            heap[i] = pcpus + (heap[i] - old);
+        nr_pcpus = n;
+    }
+
+    if ( pcpus[cpu].heap_idx == -2 )
+    {
+        pcpus[cpu].heap_idx = -1;
+        nr_pcpus_seen++;
+    }
+
+    return &pcpus[cpu];
+}
+
+static void enqueue(struct pcpu *p, const struct rec *r)
+{
+    if ( p->count == p->size )
+    {
+        unsigned int n = p->size ? p->size * 2 : 1024;
+
+        p->q = xrealloc(p->q, n * sizeof(*p->q));
+        /* Unwrap: move the records before head to after the old end. */
+        if ( p->head )
+            memcpy(&p->q[p->size], p->q, p->head * sizeof(*p->q));
+        p->size = n;
+    }
+
+    p->q[(p->head + p->count) % p->size] = *r;
+    p->count++;
+    buffered++;
+
+    if ( p->heap_idx < 0 )
+    {
+        p->heap_idx = heap_nr;
+        heap[heap_nr++] = p;
+        heap_up(p->heap_idx);
+    }
+}
+
+/* Records which need ordering against other CPUs' go into the merge. */
+static int wanted(uint32_t event)
+{
+    uint32_t ev = event & ~(TRC_HVM_NESTEDFLAG | TRC_64_FLAG);
+
+    return (event & 0x0ffff00f) == TRC_SCHED_RUNSTATE_CHANGE ||
+           (event & TRC_MEM) == TRC_MEM ||
+           ev == TRC_HVM_VMEXIT || ev == TRC_HVM_VMENTRY;
+}
+
+/* Decode one CPU's window of records. */
+static void decode_window(unsigned int cpu, const unsigned char *buf,
+                          size_t size)
+{
+    struct pcpu *p = get_pcpu(cpu);
+    struct rec r;
+    uint32_t hdr, lo, hi;
+    size_t pos = 0, len;
+
+    r.cpu = cpu;
+    while ( pos + sizeof(hdr) <= size )
+    {
+        memcpy(&hdr, buf + pos, sizeof(hdr));
+        r.event = TRC_HD_TO_EVENT(hdr);
+        r.nr = TRC_HD_EXTRA(hdr);
+        len = sizeof(hdr) + r.nr * sizeof(uint32_t) +
+              (TRC_HD_INCLUDES_CYCLE_COUNT(hdr) ? 2 * sizeof(uint32_t) : 0);
+        if ( pos + len > size )
+        {
+            fprintf(stderr, "cpu %u: record truncated at end of window\n",
+                    cpu);
+            break;
+        }
+        pos += sizeof(hdr);
+
+        /* Records without a TSC happened at the previous record's. */
+        if ( TRC_HD_INCLUDES_CYCLE_COUNT(hdr) )
+        {
+            memcpy(&lo, buf + pos, sizeof(lo));
+            memcpy(&hi, buf + pos + sizeof(lo), sizeof(hi));
+            p->last_tsc = ((uint64_t)hi << 32) | lo;
+            pos += 2 * sizeof(uint32_t);
+        }
+        r.tsc = p->last_tsc;
+        memcpy(r.d, buf + pos, r.nr * sizeof(uint32_t));
+        pos += r.nr * sizeof(uint32_t);
+
+        p->records++;
+        nr_records++;
+        count_event(r.event);
+
+        if ( r.event == TRC_LOST_RECORDS && r.nr >= 1 )
+        {
+            p->lost += r.d[0];
+            nr_lost += r.d[0];
+        }
+        else if ( wanted(r.event) )
+            enqueue(p, &r);
+    }
+}
+
+static int read_trace(void)
+{
+    struct {
+        uint32_t header;
+        struct {
+            int cpu;
+            unsigned window_size;
+        } data;
+    } cc;
+    unsigned char *window = NULL;
+    size_t window_max = 0;
+
+    while ( !interrupted )
+    {
+        if ( in_read(&cc, sizeof(cc)) != sizeof(cc) )
+            break;
+
+        if ( TRC_HD_TO_EVENT(cc.header) != TRC_TRACE_CPU_CHANGE ||
+             cc.data.cpu < 0 || cc.data.cpu > 65535 )
+        {
+            fprintf(stderr, "Bad cpu change record at offset %llu: "
+                    "is this xentrace output?\n",
+                    nr_bytes - sizeof(cc));
+            return 1;
+        }
+
+        if ( cc.data.window_size > window_max )
+        {
+            window_max = cc.data.window_size;
+            window = xrealloc(window, window_max);
+        }
+        if ( in_read(window, cc.data.window_size) != cc.data.window_size )
+        {
+            fprintf(stderr, "Trace ends in the middle of a window\n");
+            break;
+        }
+
+        decode_window(cc.data.cpu, window, cc.data.window_size);
+        merge(0);
+    }
+
+    merge(1);
+    free(window);
+
+    return 0;
+}
+
+/*
+ * Reports.
+ */
+
+static int cmp_vcpu(const void *a, const void *b)
+{
+    const struct vcpu_stats *x = *(struct vcpu_stats * const *)a;
+    const struct vcpu_stats *y = *(struct vcpu_stats * const *)b;
+
+    return x->key < y->key ? -1 : x->key > y->key;
+}
+
+static int cmp_event(const void *a, const void *b)
+{
+    const struct event_count *x = a, *y = b;
+
+    return x->count < y->count ? 1 : x->count > y->count ? -1 : 0;
+}
+
+static void report_summary(void)
+{
+    unsigned int i;
+
+    printf("%llu bytes, %llu records (%llu merged), %u cpus",
+           nr_bytes, nr_records, nr_merged, nr_pcpus_seen);
+    if ( last_tsc > first_tsc )
+        printf(", %" PRIu64 " %s", to_units(last_tsc - first_tsc), unit());
+    printf("\n");
+
+    if ( nr_lost )
+    {
+        printf("warning: %llu records lost:", nr_lost);
+        for ( i = 0; i < nr_pcpus; i++ )
+            if ( pcpus[i].lost )
+                printf(" cpu%u %lu", i, pcpus[i].lost);
+        printf("\n");
+    }
+    if ( nr_out_of_order )
+        printf("warning: %lu records out of TSC order (raise -b?)\n",
+               nr_out_of_order);
+}
+
+static void report_vcpus(void)
+{
+    struct vcpu_stats **v = xzalloc((nr_vcpus + 1) * sizeof(*v));
+    unsigned int i, n = 0;
+    uint64_t total;
+
+    for ( i = 0; i < vcpus_size; i++ )
+        if ( vcpus[i] )
+            v[n++] = vcpus[i];
+    qsort(v, n, sizeof(*v), cmp_vcpu);
+
+    if ( !n )
+        return;
+
+    printf("\nvCPU run states (%s)\n", unit());
+    printf("  %-10s %12s %12s %12s %9s %9s %10s %10s %9s %12s\n",
+           "vcpu", "running", "runnable", "blocked", "runs", "wakeups",
+           "wake avg", "wake max", "exits", "exit time");
+
+    for ( i = 0; i < n; i++ )
+    {
+        struct vcpu_stats *x = v[i];
+        unsigned int domid = x->key >> 16, vcpuid = x->key & 0xffff;
+        char name[16];
+
+        /* Close off the state the vCPU was in when the trace ended. */
+        if ( x->state >= 0 && last_tsc > x->state_tsc )
+            x->time[x->state] += last_tsc - x->state_tsc;
+
+        if ( domid == DOMID_IDLE_VCPU )
+            snprintf(name, sizeof(name), "idle v%u", vcpuid);
+        else
+            snprintf(name, sizeof(name), "d%uv%u", domid, vcpuid);
+
+        total = x->wake.count ? x->wake.sum / x->wake.count : 0;
+        printf("  %-10s %12" PRIu64 " %12" PRIu64 " %12" PRIu64
+               " %9lu %9lu %10" PRIu64 " %10" PRIu64 " %9lu %12" PRIu64 "\n",
+               name, to_units(x->time[RUNSTATE_running]),
+               to_units(x->time[RUNSTATE_runnable]),
+               to_units(x->time[RUNSTATE_blocked]),
+               x->runs, x->wakeups, to_units(total), to_units(x->wake.max),
+               x->exits, to_units(x->exit_cycles));
+    }
+
+    if ( opts.histograms )
+    {
+        printf("\nWakeup latency histograms\n");
+        for ( i = 0; i < n; i++ )
+        {
+            if ( !v[i]->wake.count )
+                continue;
+            printf("  d%uv%u:\n", v[i]->key >> 16, v[i]->key & 0xffff);
+            hist_print(&v[i]->wake, "   ");
+        }
+    }
+
+    free(v);
+}
+
+static void report_exits(void)
+{
+    unsigned int i, any = 0;
+
+    for ( i = 0; i < NR_EXIT_REASONS; i++ )
+    {
+        struct exit_info *e = &exits[i];
+
+        if ( !e->count && !e->desched )
+            continue;
+        if ( !any++ )
+        {
+            printf("\nHVM exits by reason (%s, VM exit to next VM entry)\n",
+                   max_exit_reason >= 64 ? "SVM" : "VMX");
+            printf("  %-6s %-22s %10s %12s %9s %9s %9s\n", "reason", "",
+                   "count", "total", "avg", "max", "desched");
+        }
+        printf("  %#-6x %-22s %10lu %12" PRIu64 " %9.2f %9.2f %9lu\n",
+               i, exit_name(i), e->count, to_units(e->total),
+               e->count ? to_units_f(e->total) / e->count : 0.0,
+               to_units_f(e->max), e->desched);
+    }
+}
+
+static void report_mem(void)
+{
+    unsigned int d, t, any = 0;
+
+    for ( d = 0; d < 32768; d++ )
+    {
+        if ( mem[d] == NULL )
+            continue;
+        if ( !any++ )
+        {
+            printf("\nMemory events per domain (count/pages)\n");
+            printf("  %-6s", "dom");
+            for ( t = 0; t < NR_MEM_EVENTS; t++ )
+                printf(" %17.17s", event_name(mem_events[t]));
+            printf("\n");
+        }
+        printf("  %-6u", d);
+        for ( t = 0; t < NR_MEM_EVENTS; t++ )
+            printf(" %8lu/%-8" PRIu64, mem[d]->count[t], mem[d]->pages[t]);
+        printf("\n");
+    }
+}
+
+static void report_events(void)
+{
+    struct event_count *e = xzalloc((nr_events + 1) * sizeof(*e));
+    unsigned int i, n = 0;
+
+    for ( i = 0; i < events_size; i++ )
+        if ( events[i].count )
+            e[n++] = events[i];
+    qsort(e, n, sizeof(*e), cmp_event);
+
+    printf("\nEvents\n");
+    for ( i = 0; i < n; i++ )
+        printf("  %#010x %-24s %12lu\n", e[i].event, event_name(e[i].event),
+               e[i].count);
+
+    free(e);
+}
+
+static void sighand(int sig)
+{
+    interrupted = 1;
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+"Usage: xentrace_analyze [OPTION...] [FILE]\n"
+"Summarise trace data written by xentrace, from FILE or standard input.\n"
+"\n"
+"  -c, --cpu-mhz=MHZ      TSC frequency, to report times in microseconds\n"
+"                         rather than thousands of cycles.\n"
+"  -b, --reorder=N        Records to buffer while waiting for other CPUs'\n"
+"                         before merging anyway [default 1000000].\n"
+"  -H, --histograms       Print wakeup latency histograms.\n"
+"  -h, --help             Show this help message.\n");
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    static const struct option long_options[] = {
+        { "cpu-mhz",    required_argument, NULL, 'c' },
+        { "reorder",    required_argument, NULL, 'b' },
+        { "histograms", no_argument,       NULL, 'H' },
+        { "help",       no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+    struct sigaction act;
+    int c, rc;
+
+    while ( (c = getopt_long(argc, argv, "c:b:Hh", long_options, NULL)) != -1 )
+    {
+        switch ( c )
+        {
+        case 'c':
+            opts.mhz = strtoul(optarg, NULL, 0);
+            break;
+        case 'b':
+            opts.reorder_limit = strtoul(optarg, NULL, 0);
+            break;
+        case 'H':
+            opts.histograms = 1;
+            break;
+        default:
+            usage();
+        }
+    }
+    if ( optind < argc - 1 )
+        usage();
+
+    if ( optind == argc - 1 && strcmp(argv[optind], "-") )
+    {
+        opts.file = argv[optind];
+        infd = open(opts.file, O_RDONLY);
+        if ( infd < 0 )
+        {
+            fprintf(stderr, "%s: %s\n", opts.file, strerror(errno));
+            return 1;
+        }
+    }
+    else
+        infd = STDIN_FILENO;
+
+    /* Stop reading on a signal, but still report what was read so far. */
+    memset(&act, 0, sizeof(act));
+    act.sa_handler = sighand;
+    sigaction(SIGHUP,  &act, NULL);
+    sigaction(SIGTERM, &act, NULL);
+    sigaction(SIGINT,  &act, NULL);
+
+    inbuf = xzalloc(INBUF_SIZE);
+    rc = read_trace();
+
+    report_summary();
+    report_vcpus();
+    report_exits();
+    report_mem();
+    report_events();
+
+    return rc;
+}
+
+/*
+ * Local variables:
+ * mode: C
+ * c-set-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -25,10 +25,14 @@ void idle_loop(void)
         if ( cpu_is_offline(smp_processor_id()) )
             stop_cpu();
 
-        local_irq_disable();
-        if ( cpu_is_haltable(smp_processor_id()) )
-            asm volatile ("dsb; wfi");
-        local_irq_enable();
+        /* Scrub memory freed by dead domains in preference to sleeping. */
+        if ( !scrub_free_pages() )
+        {
+            local_irq_disable();
+            if ( cpu_is_haltable(smp_processor_id()) )
+                asm volatile ("dsb; wfi");
+            local_irq_enable();
+        }
 
         do_tasklet();
         do_softirq();
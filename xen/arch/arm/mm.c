@@ -525,7 +525,7 @@ static int xenmem_add_to_physmap_one(
     switch ( space )
     {
     case XENMAPSPACE_grant_table:
-        spin_lock(&d->grant_table->lock);
+        write_lock(&d->grant_table->lock);
 
         if ( d->grant_table->gt_version == 0 )
             d->grant_table->gt_version = 1;
@@ -547,7 +547,7 @@ static int xenmem_add_to_physmap_one(
                 mfn = virt_to_mfn(d->grant_table->shared_raw[idx]);
         }
 
-        spin_unlock(&d->grant_table->lock);
+        write_unlock(&d->grant_table->lock);
         break;
     case XENMAPSPACE_shared_info:
         if ( idx == 0 )
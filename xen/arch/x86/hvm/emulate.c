@@ -202,7 +202,7 @@ static int hvmemul_do_io(
     case X86EMUL_RETRY:
         *reps = p->count;
         p->state = STATE_IORESP_READY;
-        hvm_io_assist();
+        hvm_io_assist(p);
         vio->io_state = HVMIO_none;
         break;
     case X86EMUL_UNHANDLEABLE:
@@ -1022,6 +1022,182 @@ static const struct x86_emulate_ops hvm_emulate_ops = {
     .invlpg        = hvmemul_invlpg
 };
 
+static bool_t __read_mostly opt_insn_cache = 1;
+boolean_param("hvm_insn_cache", opt_insn_cache);
+
+int hvm_insn_cache_init(struct vcpu *v)
+{
+    if ( !opt_insn_cache )
+        return 0;
+
+    v->arch.hvm_vcpu.insn_cache = xzalloc(struct hvm_insn_cache);
+    if ( v->arch.hvm_vcpu.insn_cache == NULL )
+        return -ENOMEM;
+    /* Entries start at generation 0: make them all empty. */
+    v->arch.hvm_vcpu.insn_cache->gen = 1;
+
+    return 0;
+}
+
+void hvm_insn_cache_destroy(struct vcpu *v)
+{
+    xfree(v->arch.hvm_vcpu.insn_cache);
+    v->arch.hvm_vcpu.insn_cache = NULL;
+}
+
+void hvm_insn_cache_flush(struct vcpu *v)
+{
+    if ( v->arch.hvm_vcpu.insn_cache != NULL )
+        v->arch.hvm_vcpu.insn_cache->gen++;
+}
+
+/* Do @len bytes at @off in guest frame @gfn still read @insn? */
+static bool_t insn_cache_match_frame(
+    struct domain *d, unsigned long gfn, unsigned int off,
+    const uint8_t *insn, unsigned int len)
+{
+    struct page_info *page;
+    p2m_type_t p2mt;
+    char *p;
+    bool_t match;
+
+    page = get_page_from_gfn(d, gfn, &p2mt, P2M_ALLOC);
+    if ( page == NULL )
+        return 0;
+    if ( !p2m_is_ram(p2mt) )
+    {
+        put_page(page);
+        return 0;
+    }
+
+    p = __map_domain_page(page);
+    match = !memcmp(p + off, insn, len);
+    unmap_domain_page(p);
+    put_page(page);
+
+    return match;
+}
+
+/*
+ * Does @linear still translate to the frames @ent was filled from?  With
+ * HAP the guest can edit its page tables, INVLPG or reload CR3 without
+ * exiting, so a hit can't rely on Xen having seen a TLB flush.
+ */
+static bool_t insn_cache_match_gfns(
+    struct vcpu *v, const struct hvm_insn_cache_entry *ent,
+    unsigned long linear, unsigned int first, unsigned int len,
+    uint32_t pfec)
+{
+    uint32_t walk_pfec = pfec;
+
+    if ( paging_gva_to_gfn(v, linear, &walk_pfec) != ent->gfn[0] )
+        return 0;
+    if ( first == len )
+        return 1;
+
+    walk_pfec = pfec;
+    return paging_gva_to_gfn(v, linear + first, &walk_pfec) == ent->gfn[1];
+}
+
+/*
+ * Fetch the instruction at @linear into the emulation context's buffer,
+ * and point x86_emulate() at its decode cache slot.  If hardware already
+ * gave us the instruction bytes, only the decode is looked up.
+ */
+static void hvmemul_fetch_insn(
+    struct hvm_emulate_ctxt *hvmemul_ctxt, unsigned long linear,
+    uint32_t pfec)
+{
+    struct vcpu *curr = current;
+    struct hvm_insn_cache *cache = curr->arch.hvm_vcpu.insn_cache;
+    struct hvm_insn_cache_entry *ent;
+    unsigned int len = sizeof(hvmemul_ctxt->insn_buf);
+    unsigned int off = linear & ~PAGE_MASK;
+    unsigned int first = min_t(unsigned int, len, PAGE_SIZE - off);
+    unsigned long cr3 = curr->arch.hvm_vcpu.guest_cr[3];
+    bool_t user = !!(pfec & PFEC_user_mode);
+    uint32_t walk_pfec;
+
+    if ( cache == NULL )
+    {
+        if ( hvmemul_ctxt->insn_buf_bytes )
+            return;
+        goto fetch;
+    }
+
+    ent = &cache->ent[(linear ^ (linear >> 4) ^ (linear >> 12)) %
+                      HVM_INSN_CACHE_ENTRIES];
+    if ( (ent->gen == cache->gen) && (ent->linear == linear) &&
+         (ent->cr3 == cr3) && (ent->user == user) &&
+         (ent->addr_size == hvmemul_ctxt->ctxt.addr_size) &&
+         ent->decode.len )
+    {
+        if ( hvmemul_ctxt->insn_buf_bytes )
+        {
+            /* Only the decoded bytes need to match. */
+            if ( (hvmemul_ctxt->insn_buf_bytes >= ent->decode.len) &&
+                 !memcmp(hvmemul_ctxt->insn_buf, ent->insn, ent->decode.len) )
+                goto hit;
+        }
+        else if ( (ent->nr_bytes == len) &&
+                  insn_cache_match_gfns(curr, ent, linear, first, len, pfec) &&
+                  insn_cache_match_frame(curr->domain, ent->gfn[0], off,
+                                         ent->insn, first) &&
+                  ((first == len) ||
+                   insn_cache_match_frame(curr->domain, ent->gfn[1], 0,
+                                          ent->insn + first, len - first)) )
+        {
+            memcpy(hvmemul_ctxt->insn_buf, ent->insn, len);
+            hvmemul_ctxt->insn_buf_bytes = len;
+            goto hit;
+        }
+    }
+
+    perfc_incr(hvm_insn_cache_miss);
+    ent->gen = 0;
+
+    if ( hvmemul_ctxt->insn_buf_bytes )
+    {
+        /* Decode only: no frames to check the bytes against. */
+        ent->nr_bytes = hvmemul_ctxt->insn_buf_bytes;
+        ent->gfn[0] = ent->gfn[1] = INVALID_GFN;
+        goto fill;
+    }
+
+ fetch:
+    if ( hvm_fetch_from_guest_virt_nofault(hvmemul_ctxt->insn_buf, linear,
+                                           len, pfec) != HVMCOPY_okay )
+        return;
+    hvmemul_ctxt->insn_buf_bytes = len;
+
+    if ( cache == NULL )
+        return;
+
+    walk_pfec = pfec;
+    ent->gfn[0] = paging_gva_to_gfn(curr, linear, &walk_pfec);
+    walk_pfec = pfec;
+    ent->gfn[1] = (first == len) ? ent->gfn[0]
+        : paging_gva_to_gfn(curr, linear + first, &walk_pfec);
+    if ( (ent->gfn[0] == INVALID_GFN) || (ent->gfn[1] == INVALID_GFN) )
+        return;
+    ent->nr_bytes = len;
+
+ fill:
+    memcpy(ent->insn, hvmemul_ctxt->insn_buf, ent->nr_bytes);
+    ent->cr3 = cr3;
+    ent->linear = linear;
+    ent->user = user;
+    ent->addr_size = hvmemul_ctxt->ctxt.addr_size;
+    ent->decode.len = 0;
+    ent->gen = cache->gen;
+    hvmemul_ctxt->ctxt.decode = &ent->decode;
+    return;
+
+ hit:
+    perfc_incr(hvm_insn_cache_hit);
+    hvmemul_ctxt->ctxt.decode = &ent->decode;
+}
+
 int hvm_emulate_one(
     struct hvm_emulate_ctxt *hvmemul_ctxt)
 {
@@ -1050,16 +1226,13 @@ int hvm_emulate_one(
 
     hvmemul_ctxt->insn_buf_eip = regs->eip;
     hvmemul_ctxt->insn_buf_bytes =
-        hvm_get_insn_bytes(curr, hvmemul_ctxt->insn_buf)
-        ? :
-        (hvm_virtual_to_linear_addr(
-            x86_seg_cs, &hvmemul_ctxt->seg_reg[x86_seg_cs],
-            regs->eip, sizeof(hvmemul_ctxt->insn_buf),
-            hvm_access_insn_fetch, hvmemul_ctxt->ctxt.addr_size, &addr) &&
-         !hvm_fetch_from_guest_virt_nofault(
-             hvmemul_ctxt->insn_buf, addr,
-             sizeof(hvmemul_ctxt->insn_buf), pfec))
-        ? sizeof(hvmemul_ctxt->insn_buf) : 0;
+        hvm_get_insn_bytes(curr, hvmemul_ctxt->insn_buf);
+    hvmemul_ctxt->ctxt.decode = NULL;
+    if ( hvm_virtual_to_linear_addr(
+             x86_seg_cs, &hvmemul_ctxt->seg_reg[x86_seg_cs],
+             regs->eip, sizeof(hvmemul_ctxt->insn_buf),
+             hvm_access_insn_fetch, hvmemul_ctxt->ctxt.addr_size, &addr) )
+        hvmemul_fetch_insn(hvmemul_ctxt, addr, pfec);
 
     hvmemul_ctxt->exn_pending = 0;
 
@@ -1107,6 +1280,7 @@ void hvm_emulate_prepare(
     hvmemul_ctxt->intr_shadow = hvm_funcs.get_interrupt_shadow(current);
     hvmemul_ctxt->ctxt.regs = regs;
     hvmemul_ctxt->ctxt.force_writeback = 1;
+    hvmemul_ctxt->ctxt.decode = NULL;
     hvmemul_ctxt->seg_reg_accessed = 0;
     hvmemul_ctxt->seg_reg_dirty = 0;
     hvmemul_get_seg_reg(x86_seg_cs, hvmemul_ctxt);
@@ -600,6 +600,9 @@ void hpet_init(struct vcpu *v)
         h->hpet.timers[i].cmp = ~0ULL;
         h->pt[i].source = PTSRC_isa;
     }
+
+    register_mmio_handler(v->domain, &hpet_mmio_handler,
+                          HPET_BASE_ADDRESS, HPET_MMAP_SIZE);
 }
 
 void hpet_deinit(struct domain *d)
@@ -615,6 +618,9 @@ void hpet_deinit(struct domain *d)
                 hpet_stop_timer(h, i);
 
     spin_unlock(&h->lock);
+
+    unregister_mmio_handler(d, &hpet_mmio_handler,
+                            HPET_BASE_ADDRESS, HPET_MMAP_SIZE);
 }
 
 void hpet_reset(struct domain *d)
@@ -327,36 +327,58 @@ void hvm_migrate_pirqs(struct vcpu *v)
     spin_unlock(&d->event_lock);
 }
 
-void hvm_do_resume(struct vcpu *v)
+static ioreq_t *hvm_ioreq_server_slot(
+    struct hvm_ioreq_server *s, struct vcpu *v)
 {
-    ioreq_t *p;
-
-    pt_restore_timer(v);
+    shared_iopage_t *p = s->ioreq.va;
 
-    check_wakeup_from_wait();
+    return &p->vcpu_ioreq[v->vcpu_id];
+}
 
+/* Wait for the emulator to finish with one of the vcpu's ioreq slots. */
+static bool_t hvm_wait_for_io(struct vcpu *v, ioreq_t *p, int port)
+{
     /* NB. Optimised for common case (p->state == STATE_IOREQ_NONE). */
-    p = get_ioreq(v);
     while ( p->state != STATE_IOREQ_NONE )
     {
         switch ( p->state )
         {
         case STATE_IORESP_READY: /* IORESP_READY -> NONE */
-            hvm_io_assist();
+            hvm_io_assist(p);
             break;
         case STATE_IOREQ_READY:  /* IOREQ_{READY,INPROCESS} -> IORESP_READY */
         case STATE_IOREQ_INPROCESS:
-            wait_on_xen_event_channel(v->arch.hvm_vcpu.xen_port,
+            wait_on_xen_event_channel(port,
                                       (p->state != STATE_IOREQ_READY) &&
                                       (p->state != STATE_IOREQ_INPROCESS));
             break;
         default:
             gdprintk(XENLOG_ERR, "Weird HVM iorequest state %d.\n", p->state);
             domain_crash(v->domain);
-            return; /* bail */
+            return 0; /* bail */
         }
     }
 
+    return 1;
+}
+
+void hvm_do_resume(struct vcpu *v)
+{
+    struct hvm_ioreq_server *s;
+
+    pt_restore_timer(v);
+
+    check_wakeup_from_wait();
+
+    if ( !hvm_wait_for_io(v, get_ioreq(v), v->arch.hvm_vcpu.xen_port) ||
+         !hvm_wait_for_io(v, &v->arch.hvm_vcpu.hvm_io.orphaned_ioreq, 0) )
+        return;
+    list_for_each_entry ( s, &v->domain->arch.hvm_domain.ioreq_server_list,
+                          list_entry )
+        if ( !hvm_wait_for_io(v, hvm_ioreq_server_slot(s, v),
+                              s->ioreq_evtchn[v->vcpu_id]) )
+            return;
+
     /* Inject pending hw/sw trap */
     if ( v->arch.hvm_vcpu.inject_trap.vector != -1 ) 
     {
@@ -471,6 +493,362 @@ static int hvm_set_ioreq_page(
     return 0;
 }
 
+static int hvm_alloc_ioreq_gmfn(struct domain *d, unsigned long *gmfn)
+{
+    unsigned long base = d->arch.hvm_domain.params[HVM_PARAM_IOREQ_SERVER_PFN];
+    unsigned long nr =
+        d->arch.hvm_domain.params[HVM_PARAM_NR_IOREQ_SERVER_PAGES];
+    unsigned int i;
+
+    for ( i = 0; i < nr; i++ )
+        if ( !test_and_set_bit(i, &d->arch.hvm_domain.ioreq_gmfn_mask) )
+        {
+            *gmfn = base + i;
+            return 0;
+        }
+
+    return -ENOSPC;
+}
+
+static void hvm_free_ioreq_gmfn(struct domain *d, unsigned long gmfn)
+{
+    unsigned long base = d->arch.hvm_domain.params[HVM_PARAM_IOREQ_SERVER_PFN];
+
+    clear_bit(gmfn - base, &d->arch.hvm_domain.ioreq_gmfn_mask);
+}
+
+static int hvm_map_ioreq_server_page(
+    struct domain *d, struct hvm_ioreq_page *iorp, unsigned long *gmfn)
+{
+    int rc;
+
+    if ( (rc = hvm_alloc_ioreq_gmfn(d, gmfn)) != 0 )
+        return rc;
+
+    if ( (rc = prepare_ring_for_helper(d, *gmfn, &iorp->page,
+                                       &iorp->va)) != 0 )
+    {
+        hvm_free_ioreq_gmfn(d, *gmfn);
+        *gmfn = 0;
+        return rc;
+    }
+
+    /* The page may have been used by an earlier server. */
+    clear_page(iorp->va);
+
+    return 0;
+}
+
+static void hvm_free_ioreq_server(
+    struct domain *d, struct hvm_ioreq_server *s, bool_t free_evtchn)
+{
+    struct vcpu *v;
+    unsigned int i;
+
+    if ( free_evtchn )
+    {
+        for_each_vcpu ( d, v )
+            if ( s->ioreq_evtchn && s->ioreq_evtchn[v->vcpu_id] )
+                free_xen_event_channel(v, s->ioreq_evtchn[v->vcpu_id]);
+        if ( s->bufioreq_evtchn )
+            free_xen_event_channel(d->vcpu[0], s->bufioreq_evtchn);
+    }
+
+    destroy_ring_for_helper(&s->ioreq.va, s->ioreq.page);
+    destroy_ring_for_helper(&s->bufioreq.va, s->bufioreq.page);
+    if ( s->ioreq_gmfn )
+        hvm_free_ioreq_gmfn(d, s->ioreq_gmfn);
+    if ( s->bufioreq_gmfn )
+        hvm_free_ioreq_gmfn(d, s->bufioreq_gmfn);
+
+    for ( i = 0; i < NR_IO_RANGE_TYPES; i++ )
+        if ( s->range[i] )
+            rangeset_destroy(s->range[i]);
+
+    xfree(s->ioreq_evtchn);
+    xfree(s);
+}
+
+static int hvm_create_ioreq_server(
+    struct domain *d, domid_t domid, bool_t bufioreq, ioservid_t *id)
+{
+    static const char *const range_name[NR_IO_RANGE_TYPES] = {
+        [HVMOP_IO_RANGE_PORT]   = "port",
+        [HVMOP_IO_RANGE_MEMORY] = "memory",
+        [HVMOP_IO_RANGE_PCI]    = "pci",
+    };
+    struct hvm_ioreq_server *s;
+    struct vcpu *v;
+    char name[32];
+    unsigned int i;
+    int rc;
+
+    if ( d->vcpu == NULL || d->vcpu[0] == NULL )
+        return -EINVAL;
+
+    s = xzalloc(struct hvm_ioreq_server);
+    if ( s == NULL )
+        return -ENOMEM;
+
+    spin_lock_init(&s->ioreq.lock);
+    spin_lock_init(&s->bufioreq.lock);
+    s->domid = domid;
+
+    spin_lock(&d->arch.hvm_domain.ioreq_server_lock);
+    s->id = ++d->arch.hvm_domain.ioreq_server_id;
+    spin_unlock(&d->arch.hvm_domain.ioreq_server_lock);
+
+    rc = -ENOMEM;
+    s->ioreq_evtchn = xzalloc_array(int, d->max_vcpus);
+    if ( s->ioreq_evtchn == NULL )
+        goto fail;
+
+    for ( i = 0; i < NR_IO_RANGE_TYPES; i++ )
+    {
+        snprintf(name, sizeof(name), "ioreq_server %u %s",
+                 s->id, range_name[i]);
+        s->range[i] = rangeset_new(d, name, RANGESETF_prettyprint_hex);
+        if ( s->range[i] == NULL )
+            goto fail;
+    }
+
+    rc = hvm_map_ioreq_server_page(d, &s->ioreq, &s->ioreq_gmfn);
+    if ( rc != 0 )
+        goto fail;
+
+    if ( bufioreq )
+    {
+        rc = hvm_map_ioreq_server_page(d, &s->bufioreq, &s->bufioreq_gmfn);
+        if ( rc != 0 )
+            goto fail;
+
+        rc = alloc_unbound_xen_event_channel(d->vcpu[0], domid, NULL);
+        if ( rc < 0 )
+            goto fail;
+        s->bufioreq_evtchn = rc;
+    }
+
+    for_each_vcpu ( d, v )
+    {
+        rc = alloc_unbound_xen_event_channel(v, domid, NULL);
+        if ( rc < 0 )
+            goto fail;
+        s->ioreq_evtchn[v->vcpu_id] = rc;
+        hvm_ioreq_server_slot(s, v)->vp_eport = rc;
+    }
+
+    /* The I/O paths walk the list without locking. */
+    domain_pause(d);
+    spin_lock(&d->arch.hvm_domain.ioreq_server_lock);
+    list_add_tail(&s->list_entry, &d->arch.hvm_domain.ioreq_server_list);
+    spin_unlock(&d->arch.hvm_domain.ioreq_server_lock);
+    domain_unpause(d);
+
+    *id = s->id;
+    return 0;
+
+ fail:
+    hvm_free_ioreq_server(d, s, 1);
+    return rc;
+}
+
+/* Called with ioreq_server_lock held. */
+static struct hvm_ioreq_server *hvm_find_ioreq_server(
+    struct domain *d, ioservid_t id)
+{
+    struct hvm_ioreq_server *s;
+
+    list_for_each_entry ( s, &d->arch.hvm_domain.ioreq_server_list,
+                          list_entry )
+        if ( s->id == id )
+            return s;
+
+    return NULL;
+}
+
+/*
+ * Complete any request a vcpu has outstanding with @s, which is going away:
+ * reads return all ones.  The completion is moved somewhere the vcpu will
+ * still look, and the vcpu woken if it is waiting.  The domain is paused.
+ */
+static void hvm_orphan_ioreq_server_requests(
+    struct domain *d, struct hvm_ioreq_server *s)
+{
+    struct vcpu *v;
+    ioreq_t *p, req;
+    uint8_t state;
+
+    for_each_vcpu ( d, v )
+    {
+        p = hvm_ioreq_server_slot(s, v);
+        state = p->state;
+        rmb(); /* see IORESP_READY /then/ read contents of ioreq */
+        req = *p;
+
+        switch ( state )
+        {
+        case STATE_IOREQ_READY:
+        case STATE_IOREQ_INPROCESS:
+            req.data = ~0UL;
+            /* fall through */
+        case STATE_IORESP_READY:
+            break;
+        default:
+            continue;
+        }
+
+        req.state = STATE_IORESP_READY;
+        v->arch.hvm_vcpu.hvm_io.orphaned_ioreq = req;
+        p->state = STATE_IOREQ_NONE;
+
+        if ( test_and_clear_bit(_VPF_blocked_in_xen, &v->pause_flags) )
+            vcpu_wake(v);
+    }
+}
+
+static int hvm_destroy_ioreq_server(struct domain *d, ioservid_t id)
+{
+    struct hvm_ioreq_server *s;
+
+    domain_pause(d);
+    spin_lock(&d->arch.hvm_domain.ioreq_server_lock);
+    s = hvm_find_ioreq_server(d, id);
+    if ( s != NULL )
+        list_del(&s->list_entry);
+    spin_unlock(&d->arch.hvm_domain.ioreq_server_lock);
+    if ( s != NULL )
+        hvm_orphan_ioreq_server_requests(d, s);
+    domain_unpause(d);
+
+    if ( s == NULL )
+        return -ENOENT;
+
+    hvm_free_ioreq_server(d, s, 1);
+    return 0;
+}
+
+static void hvm_destroy_all_ioreq_servers(struct domain *d)
+{
+    struct hvm_ioreq_server *s, *next;
+
+    /* Event channels are already freed by evtchn_destroy(). */
+    list_for_each_entry_safe ( s, next, &d->arch.hvm_domain.ioreq_server_list,
+                               list_entry )
+    {
+        list_del(&s->list_entry);
+        hvm_free_ioreq_server(d, s, 0);
+    }
+}
+
+static int hvm_get_ioreq_server_info(
+    struct domain *d, ioservid_t id, unsigned long *ioreq_gmfn,
+    unsigned long *bufioreq_gmfn, uint32_t *bufioreq_port)
+{
+    struct hvm_ioreq_server *s;
+    int rc = -ENOENT;
+
+    spin_lock(&d->arch.hvm_domain.ioreq_server_lock);
+    s = hvm_find_ioreq_server(d, id);
+    if ( s != NULL )
+    {
+        *ioreq_gmfn = s->ioreq_gmfn;
+        *bufioreq_gmfn = s->bufioreq_gmfn;
+        *bufioreq_port = s->bufioreq_evtchn;
+        rc = 0;
+    }
+    spin_unlock(&d->arch.hvm_domain.ioreq_server_lock);
+
+    return rc;
+}
+
+static int hvm_map_io_range_to_ioreq_server(
+    struct domain *d, ioservid_t id, bool_t map, uint32_t type,
+    uint64_t start, uint64_t end)
+{
+    struct hvm_ioreq_server *s;
+    int rc = -ENOENT;
+
+    if ( type >= NR_IO_RANGE_TYPES || start > end )
+        return -EINVAL;
+
+    spin_lock(&d->arch.hvm_domain.ioreq_server_lock);
+    s = hvm_find_ioreq_server(d, id);
+    if ( s != NULL )
+    {
+        if ( map )
+            rc = rangeset_add_range(s->range[type], start, end);
+        else
+            rc = rangeset_remove_range(s->range[type], start, end);
+    }
+    spin_unlock(&d->arch.hvm_domain.ioreq_server_lock);
+
+    return rc;
+}
+
+#define CF8_BDF(cf8)     (((cf8) & 0x00ffff00) >> 8)
+#define CF8_ADDR_LO(cf8) ((cf8) & 0x000000fc)
+#define CF8_ADDR_HI(cf8) (((cf8) & 0x0f000000) >> 16)
+#define CF8_ENABLED(cf8) (!!((cf8) & 0x80000000))
+
+/*
+ * Find the secondary ioreq server which claimed the target of @p, or NULL
+ * for the default server.  @type and @addr are what the server should see,
+ * which differ from @p for PCI config space accesses.
+ */
+struct hvm_ioreq_server *hvm_select_ioreq_server(
+    struct domain *d, ioreq_t *p, uint8_t *type, uint64_t *addr)
+{
+    struct hvm_ioreq_server *s;
+    unsigned int range;
+    uint64_t start, end;
+    uint32_t cf8;
+
+    if ( (p->type == IOREQ_TYPE_PIO) && (p->dir == IOREQ_WRITE) &&
+         (p->addr == 0xcf8) && (p->size == 4) && !p->data_is_ptr )
+        d->arch.hvm_domain.pci_cf8 = p->data;
+
+    if ( list_empty(&d->arch.hvm_domain.ioreq_server_list) )
+        return NULL;
+
+    *type = p->type;
+    *addr = p->addr;
+    cf8 = d->arch.hvm_domain.pci_cf8;
+
+    switch ( p->type )
+    {
+    case IOREQ_TYPE_PIO:
+        if ( ((p->addr & ~3) == 0xcfc) && CF8_ENABLED(cf8) )
+        {
+            range = HVMOP_IO_RANGE_PCI;
+            start = end = CF8_BDF(cf8); /* segment 0 */
+            *type = IOREQ_TYPE_PCI_CONFIG;
+            *addr = (start << 32) | CF8_ADDR_HI(cf8) | CF8_ADDR_LO(cf8) |
+                    (p->addr & 3);
+            break;
+        }
+        range = HVMOP_IO_RANGE_PORT;
+        start = p->addr;
+        end = start + p->size - 1;
+        break;
+    case IOREQ_TYPE_COPY:
+        range = HVMOP_IO_RANGE_MEMORY;
+        start = p->addr;
+        if ( p->df )
+            start -= (uint64_t)(p->count - 1) * p->size;
+        end = start + (uint64_t)p->count * p->size - 1;
+        break;
+    default:
+        return NULL;
+    }
+
+    list_for_each_entry ( s, &d->arch.hvm_domain.ioreq_server_list,
+                          list_entry )
+        if ( rangeset_contains_range(s->range[range], start, end) )
+            return s;
+
+    return NULL;
+}
+
 static int hvm_print_line(
     int dir, uint32_t port, uint32_t bytes, uint32_t *val)
 {
@@ -519,12 +897,10 @@ int hvm_domain_initialise(struct domain *d)
 
     d->arch.hvm_domain.pbuf = xzalloc_array(char, HVM_PBUF_SIZE);
     d->arch.hvm_domain.params = xzalloc_array(uint64_t, HVM_NR_PARAMS);
-    d->arch.hvm_domain.io_handler = xmalloc(struct hvm_io_handler);
     rc = -ENOMEM;
-    if ( !d->arch.hvm_domain.pbuf || !d->arch.hvm_domain.params ||
-         !d->arch.hvm_domain.io_handler )
+    if ( !d->arch.hvm_domain.pbuf || !d->arch.hvm_domain.params )
         goto fail0;
-    d->arch.hvm_domain.io_handler->num_slot = 0;
+    hvm_io_handler_init(d);
 
     hvm_init_guest_time(d);
 
@@ -548,6 +924,8 @@ int hvm_domain_initialise(struct domain *d)
 
     hvm_init_ioreq_page(d, &d->arch.hvm_domain.ioreq);
     hvm_init_ioreq_page(d, &d->arch.hvm_domain.buf_ioreq);
+    INIT_LIST_HEAD(&d->arch.hvm_domain.ioreq_server_list);
+    spin_lock_init(&d->arch.hvm_domain.ioreq_server_lock);
 
     register_portio_handler(d, 0xe9, 1, hvm_print_line);
 
@@ -564,7 +942,7 @@ int hvm_domain_initialise(struct domain *d)
  fail1:
     hvm_destroy_cacheattr_region_list(d);
  fail0:
-    xfree(d->arch.hvm_domain.io_handler);
+    hvm_io_handler_destroy(d);
     xfree(d->arch.hvm_domain.params);
     xfree(d->arch.hvm_domain.pbuf);
     return rc;
@@ -577,6 +955,7 @@ void hvm_domain_relinquish_resources(struct domain *d)
 
     hvm_destroy_ioreq_page(d, &d->arch.hvm_domain.ioreq);
     hvm_destroy_ioreq_page(d, &d->arch.hvm_domain.buf_ioreq);
+    hvm_destroy_all_ioreq_servers(d);
 
     msixtbl_pt_cleanup(d);
 
@@ -589,7 +968,7 @@ void hvm_domain_relinquish_resources(struct domain *d)
         hpet_deinit(d);
     }
 
-    xfree(d->arch.hvm_domain.io_handler);
+    hvm_io_handler_destroy(d);
     xfree(d->arch.hvm_domain.params);
     xfree(d->arch.hvm_domain.pbuf);
 }
@@ -1105,6 +1484,10 @@ int hvm_vcpu_initialise(struct vcpu *v)
     if ( rc != 0 )
         goto fail5;
 
+    rc = hvm_insn_cache_init(v);
+    if ( rc != 0 )
+        goto fail6;
+
     softirq_tasklet_init(
         &v->arch.hvm_vcpu.assert_evtchn_irq_tasklet,
         (void(*)(unsigned long))hvm_assert_evtchn_irq,
@@ -1129,6 +1512,8 @@ int hvm_vcpu_initialise(struct vcpu *v)
 
     return 0;
 
+ fail6:
+    hvm_vcpu_cacheattr_destroy(v);
  fail5:
     free_compat_arg_xlat(v);
  fail4:
@@ -1149,6 +1534,7 @@ void hvm_vcpu_destroy(struct vcpu *v)
 
     tasklet_kill(&v->arch.hvm_vcpu.assert_evtchn_irq_tasklet);
     hvm_vcpu_cacheattr_destroy(v);
+    hvm_insn_cache_destroy(v);
     vlapic_destroy(v);
     hvm_funcs.vcpu_destroy(v);
 
@@ -1180,34 +1566,84 @@ void hvm_vcpu_down(struct vcpu *v)
     }
 }
 
-bool_t hvm_send_assist_req(struct vcpu *v)
+/*
+ * Requests are always set up in the vcpu's slot of the default ioreq page,
+ * @p, and copied from there to @sp if they go to another server.
+ */
+static bool_t hvm_send_assist_req_to_slot(
+    struct vcpu *v, ioreq_t *p, ioreq_t *sp, uint8_t type, uint64_t addr,
+    int port)
 {
-    ioreq_t *p;
-
-    if ( unlikely(!vcpu_start_shutdown_deferral(v)) )
-        return 0; /* implicitly bins the i/o operation */
-
-    p = get_ioreq(v);
-    if ( unlikely(p->state != STATE_IOREQ_NONE) )
+    if ( unlikely(sp->state != STATE_IOREQ_NONE) )
     {
         /* This indicates a bug in the device model. Crash the domain. */
-        gdprintk(XENLOG_ERR, "Device model set bad IO state %d.\n", p->state);
+        gdprintk(XENLOG_ERR, "Device model set bad IO state %d.\n", sp->state);
         domain_crash(v->domain);
         return 0;
     }
 
-    prepare_wait_on_xen_event_channel(v->arch.hvm_vcpu.xen_port);
+    if ( sp != p )
+    {
+        *sp = *p;
+        sp->type = type;
+        sp->addr = addr;
+        sp->vp_eport = port;
+    }
+
+    prepare_wait_on_xen_event_channel(port);
 
     /*
      * Following happens /after/ blocking and setting up ioreq contents.
      * prepare_wait_on_xen_event_channel() is an implicit barrier.
      */
-    p->state = STATE_IOREQ_READY;
-    notify_via_xen_event_channel(v->domain, v->arch.hvm_vcpu.xen_port);
+    sp->state = STATE_IOREQ_READY;
+    notify_via_xen_event_channel(v->domain, port);
 
     return 1;
 }
 
+bool_t hvm_send_assist_req(struct vcpu *v)
+{
+    struct hvm_ioreq_server *s;
+    ioreq_t *p;
+    uint8_t type;
+    uint64_t addr;
+
+    if ( unlikely(!vcpu_start_shutdown_deferral(v)) )
+        return 0; /* implicitly bins the i/o operation */
+
+    p = get_ioreq(v);
+    s = hvm_select_ioreq_server(v->domain, p, &type, &addr);
+    if ( s == NULL )
+        return hvm_send_assist_req_to_slot(v, p, p, p->type, p->addr,
+                                           v->arch.hvm_vcpu.xen_port);
+
+    return hvm_send_assist_req_to_slot(v, p, hvm_ioreq_server_slot(s, v),
+                                       type, addr,
+                                       s->ioreq_evtchn[v->vcpu_id]);
+}
+
+/* Send a request to every ioreq server, e.g. to invalidate mapcaches. */
+void hvm_broadcast_assist_req(struct vcpu *v)
+{
+    struct hvm_ioreq_server *s;
+    ioreq_t *p;
+
+    if ( unlikely(!vcpu_start_shutdown_deferral(v)) )
+        return;
+
+    p = get_ioreq(v);
+    list_for_each_entry ( s, &v->domain->arch.hvm_domain.ioreq_server_list,
+                          list_entry )
+        if ( !hvm_send_assist_req_to_slot(v, p, hvm_ioreq_server_slot(s, v),
+                                          p->type, p->addr,
+                                          s->ioreq_evtchn[v->vcpu_id]) )
+            return;
+
+    hvm_send_assist_req_to_slot(v, p, p, p->type, p->addr,
+                                v->arch.hvm_vcpu.xen_port);
+}
+
 void hvm_hlt(unsigned long rflags)
 {
     struct vcpu *curr = current;
@@ -3262,6 +3698,7 @@ int hvm_do_hypercall(struct cpu_user_regs *regs)
     struct segment_register sreg;
     int mode = hvm_guest_x86_mode(curr);
     uint32_t eax = regs->eax;
+    cycles_t start;
 
     switch ( mode )
     {
@@ -3289,6 +3726,7 @@ int hvm_do_hypercall(struct cpu_user_regs *regs)
     }
 
     curr->arch.hvm_vcpu.hcall_preempted = 0;
+    start = perfc_time_start();
 
     if ( mode == 8 )
     {
@@ -3320,6 +3758,8 @@ int hvm_do_hypercall(struct cpu_user_regs *regs)
                                                (uint32_t)regs->ebp);
     }
 
+    perfc_time_end(hvm_hypercall_cycles, start);
+
     HVM_DBG_LOG(DBG_LEVEL_HCALL, "hcall%u -> %lx",
                 eax, (unsigned long)regs->eax);
 
@@ -3646,6 +4086,139 @@ static int hvmop_inject_msi(
     return rc;
 }
 
+static int hvmop_create_ioreq_server(
+    XEN_GUEST_HANDLE_PARAM(xen_hvm_create_ioreq_server_t) uop)
+{
+    struct domain *curr_d = current->domain;
+    struct xen_hvm_create_ioreq_server op;
+    struct domain *d;
+    int rc;
+
+    if ( copy_from_guest(&op, uop, 1) )
+        return -EFAULT;
+
+    rc = rcu_lock_remote_target_domain_by_id(op.domid, &d);
+    if ( rc != 0 )
+        return rc;
+
+    rc = -EINVAL;
+    if ( !is_hvm_domain(d) )
+        goto out;
+
+    rc = xsm_hvm_param(d, HVMOP_create_ioreq_server);
+    if ( rc )
+        goto out;
+
+    rc = hvm_create_ioreq_server(d, curr_d->domain_id, !!op.handle_bufioreq,
+                                 &op.id);
+    if ( rc == 0 && copy_to_guest(uop, &op, 1) )
+    {
+        hvm_destroy_ioreq_server(d, op.id);
+        rc = -EFAULT;
+    }
+
+ out:
+    rcu_unlock_domain(d);
+    return rc;
+}
+
+static int hvmop_get_ioreq_server_info(
+    XEN_GUEST_HANDLE_PARAM(xen_hvm_get_ioreq_server_info_t) uop)
+{
+    struct xen_hvm_get_ioreq_server_info op;
+    struct domain *d;
+    unsigned long ioreq_gmfn, bufioreq_gmfn;
+    int rc;
+
+    if ( copy_from_guest(&op, uop, 1) )
+        return -EFAULT;
+
+    rc = rcu_lock_remote_target_domain_by_id(op.domid, &d);
+    if ( rc != 0 )
+        return rc;
+
+    rc = -EINVAL;
+    if ( !is_hvm_domain(d) )
+        goto out;
+
+    rc = xsm_hvm_param(d, HVMOP_get_ioreq_server_info);
+    if ( rc )
+        goto out;
+
+    rc = hvm_get_ioreq_server_info(d, op.id, &ioreq_gmfn, &bufioreq_gmfn,
+                                   &op.bufioreq_port);
+    if ( rc )
+        goto out;
+
+    op.ioreq_pfn = ioreq_gmfn;
+    op.bufioreq_pfn = bufioreq_gmfn;
+    rc = copy_to_guest(uop, &op, 1) ? -EFAULT : 0;
+
+ out:
+    rcu_unlock_domain(d);
+    return rc;
+}
+
+static int hvmop_map_io_range_to_ioreq_server(
+    unsigned long op, XEN_GUEST_HANDLE_PARAM(xen_hvm_io_range_t) uop)
+{
+    struct xen_hvm_io_range r;
+    struct domain *d;
+    int rc;
+
+    if ( copy_from_guest(&r, uop, 1) )
+        return -EFAULT;
+
+    rc = rcu_lock_remote_target_domain_by_id(r.domid, &d);
+    if ( rc != 0 )
+        return rc;
+
+    rc = -EINVAL;
+    if ( !is_hvm_domain(d) )
+        goto out;
+
+    rc = xsm_hvm_param(d, op);
+    if ( rc )
+        goto out;
+
+    rc = hvm_map_io_range_to_ioreq_server(
+        d, r.id, op == HVMOP_map_io_range_to_ioreq_server, r.type,
+        r.start, r.end);
+
+ out:
+    rcu_unlock_domain(d);
+    return rc;
+}
+
+static int hvmop_destroy_ioreq_server(
+    XEN_GUEST_HANDLE_PARAM(xen_hvm_destroy_ioreq_server_t) uop)
+{
+    struct xen_hvm_destroy_ioreq_server op;
+    struct domain *d;
+    int rc;
+
+    if ( copy_from_guest(&op, uop, 1) )
+        return -EFAULT;
+
+    rc = rcu_lock_remote_target_domain_by_id(op.domid, &d);
+    if ( rc != 0 )
+        return rc;
+
+    rc = -EINVAL;
+    if ( !is_hvm_domain(d) )
+        goto out;
+
+    rc = xsm_hvm_param(d, HVMOP_destroy_ioreq_server);
+    if ( rc )
+        goto out;
+
+    rc = hvm_destroy_ioreq_server(d, op.id);
+
+ out:
+    rcu_unlock_domain(d);
+    return rc;
+}
+
 static int hvmop_flush_tlb_all(void)
 {
     struct domain *d = current->domain;
@@ -3889,6 +4462,20 @@ long do_hvm_op(unsigned long op, XEN_GUEST_HANDLE_PARAM(void) arg)
             case HVM_PARAM_BUFIOREQ_EVTCHN:
                 rc = -EINVAL;
                 break;
+            case HVM_PARAM_IOREQ_SERVER_PFN:
+            case HVM_PARAM_NR_IOREQ_SERVER_PAGES:
+                if ( d == current->domain )
+                {
+                    rc = -EPERM;
+                    break;
+                }
+                /* Not while servers hold pages from the current range. */
+                if ( d->arch.hvm_domain.ioreq_gmfn_mask )
+                    rc = -EBUSY;
+                else if ( (a.index == HVM_PARAM_NR_IOREQ_SERVER_PAGES) &&
+                          (a.value > BITS_PER_LONG) )
+                    rc = -EINVAL;
+                break;
             }
 
             if ( rc == 0 ) 
@@ -3953,6 +4540,27 @@ long do_hvm_op(unsigned long op, XEN_GUEST_HANDLE_PARAM(void) arg)
             guest_handle_cast(arg, xen_hvm_inject_msi_t));
         break;
 
+    case HVMOP_create_ioreq_server:
+        rc = hvmop_create_ioreq_server(
+            guest_handle_cast(arg, xen_hvm_create_ioreq_server_t));
+        break;
+
+    case HVMOP_get_ioreq_server_info:
+        rc = hvmop_get_ioreq_server_info(
+            guest_handle_cast(arg, xen_hvm_get_ioreq_server_info_t));
+        break;
+
+    case HVMOP_map_io_range_to_ioreq_server:
+    case HVMOP_unmap_io_range_from_ioreq_server:
+        rc = hvmop_map_io_range_to_ioreq_server(
+            op, guest_handle_cast(arg, xen_hvm_io_range_t));
+        break;
+
+    case HVMOP_destroy_ioreq_server:
+        rc = hvmop_destroy_ioreq_server(
+            guest_handle_cast(arg, xen_hvm_destroy_ioreq_server_t));
+        break;
+
     case HVMOP_set_pci_link_route:
         rc = hvmop_set_pci_link_route(
             guest_handle_cast(arg, xen_hvm_set_pci_link_route_t));
@@ -31,17 +31,212 @@
 #include <io_ports.h>
 #include <xen/event.h>
 #include <xen/iommu.h>
+#include <xen/rcupdate.h>
+#include <xen/symbols.h>
 
-static const struct hvm_mmio_handler *const
-hvm_mmio_handlers[HVM_MMIO_HANDLER_NR] =
-{
-    &hpet_mmio_handler,
-    &vlapic_mmio_handler,
-    &vioapic_mmio_handler,
-    &msixtbl_mmio_handler,
-    &iommu_mmio_handler
+/*
+ * Each domain's handlers live in a single array, sorted by type and then by
+ * start address, so that dispatch is a binary search rather than a walk
+ * over every handler.  Handlers of a type may overlap: lookup tries them
+ * from the highest start address downwards, giving up once the distance
+ * from the access exceeds the largest handler of that type.
+ *
+ * Updates are rare (domain creation, a device or BAR moving) and copy the
+ * whole array under the domain's lock; readers pick up the table under RCU.
+ */
+struct hvm_io_table {
+    struct rcu_head     rcu;
+    unsigned int        nr;
+    unsigned long       max_size[HVM_NR_IO_TYPES];
+    struct io_handler   hdl[];
 };
 
+static DEFINE_RCU_READ_LOCK(hvm_io_rcu_lock);
+
+static int io_handler_cmp(const struct io_handler *h,
+                          int type, unsigned long addr)
+{
+    if ( h->type != type )
+        return h->type < type ? -1 : 1;
+    return h->addr < addr ? -1 : h->addr > addr;
+}
+
+/* Index of the first handler sorting after (type, addr). */
+static unsigned int io_table_upper(const struct hvm_io_table *t,
+                                   int type, unsigned long addr)
+{
+    unsigned int lo = 0, hi = t->nr, mid;
+
+    while ( lo < hi )
+    {
+        mid = (lo + hi) / 2;
+        if ( io_handler_cmp(&t->hdl[mid], type, addr) <= 0 )
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+static struct io_handler *hvm_find_io_handler(
+    struct vcpu *v, struct hvm_io_table *t, int type, const ioreq_t *p)
+{
+    unsigned int i = io_table_upper(t, type, p->addr);
+    struct io_handler *h;
+
+    while ( i-- > 0 )
+    {
+        h = &t->hdl[i];
+        if ( (h->type != type) || (p->addr - h->addr >= t->max_size[type]) )
+            break;
+        if ( !h->refcnt || (p->addr - h->addr >= h->size) )
+            continue;
+        if ( type == HVM_MMIO )
+        {
+            if ( h->action.ops->check_handler(v, p->addr) )
+                return h;
+        }
+        else if ( p->addr + p->size <= h->addr + h->size )
+            return h;
+    }
+
+    return NULL;
+}
+
+/* A live handler registered with exactly these parameters. */
+static struct io_handler *io_table_find(
+    struct hvm_io_table *t, int type, unsigned long addr,
+    unsigned long size, void *action)
+{
+    unsigned int i;
+    struct io_handler *h;
+
+    if ( t == NULL )
+        return NULL;
+
+    for ( i = io_table_upper(t, type, addr); i-- > 0; )
+    {
+        h = &t->hdl[i];
+        if ( io_handler_cmp(h, type, addr) )
+            break;
+        if ( h->refcnt && (h->size == size) &&
+             ((action == NULL) || (h->action.ptr == action)) )
+            return h;
+    }
+
+    return NULL;
+}
+
+static void io_table_free(struct rcu_head *head)
+{
+    xfree(container_of(head, struct hvm_io_table, rcu));
+}
+
+/*
+ * Publish a copy of the table without @del and with @add, if either is
+ * given.  Unregistered entries are dropped from the copy.  Called with the
+ * lock held.
+ */
+static int io_table_replace(struct hvm_io_handler *handler,
+                            const struct io_handler *del,
+                            const struct io_handler *add)
+{
+    struct hvm_io_table *old = handler->table, *new;
+    const struct io_handler *h;
+    unsigned int i, j, nr = old ? old->nr : 0;
+
+    new = xmalloc_bytes(sizeof(*new) + (nr + 1) * sizeof(new->hdl[0]));
+    if ( new == NULL )
+        return -ENOMEM;
+
+    memset(new->max_size, 0, sizeof(new->max_size));
+    for ( i = j = 0; i <= nr; i++ )
+    {
+        if ( add &&
+             ((i == nr) ||
+              (io_handler_cmp(&old->hdl[i], add->type, add->addr) > 0)) )
+        {
+            new->hdl[j++] = *add;
+            add = NULL;
+        }
+        if ( i == nr )
+            break;
+        h = &old->hdl[i];
+        if ( (h != del) && h->refcnt )
+            new->hdl[j++] = *h;
+    }
+    new->nr = j;
+
+    for ( i = 0; i < new->nr; i++ )
+    {
+        h = &new->hdl[i];
+        if ( h->size > new->max_size[h->type] )
+            new->max_size[h->type] = h->size;
+    }
+
+    rcu_assign_pointer(handler->table, new);
+    if ( old )
+        call_rcu(&old->rcu, io_table_free);
+
+    return 0;
+}
+
+/* Drop a reference; called with the lock held. */
+static void io_handler_put(struct hvm_io_handler *handler,
+                           struct io_handler *h)
+{
+    /*
+     * If there's no memory for a copy the entry stays in the table, but
+     * lookups skip it and the next update drops it.
+     */
+    if ( --h->refcnt == 0 )
+        io_table_replace(handler, h, NULL);
+}
+
+void hvm_io_handler_init(struct domain *d)
+{
+    spin_lock_init(&d->arch.hvm_domain.io_handler.lock);
+    d->arch.hvm_domain.io_handler.table = NULL;
+}
+
+void hvm_io_handler_destroy(struct domain *d)
+{
+    struct hvm_io_table *t = d->arch.hvm_domain.io_handler.table;
+
+    d->arch.hvm_domain.io_handler.table = NULL;
+    if ( t )
+        call_rcu(&t->rcu, io_table_free);
+}
+
+void hvm_io_handler_dump(struct domain *d)
+{
+    static const char *const names[HVM_NR_IO_TYPES] = {
+        [HVM_PORTIO] = "port", [HVM_MMIO] = "mmio", [HVM_BUFFERED_IO] = "buf"
+    };
+    struct hvm_io_table *t;
+    const struct io_handler *h;
+    unsigned int i;
+
+    rcu_read_lock(&hvm_io_rcu_lock);
+
+    t = rcu_dereference(d->arch.hvm_domain.io_handler.table);
+    printk("I/O handlers: %u\n", t ? t->nr : 0);
+    for ( i = 0; t && (i < t->nr); i++ )
+    {
+        h = &t->hdl[i];
+        if ( !h->refcnt )
+            continue;
+        printk("  %-4s %08lx-%08lx hits %-10lu ", names[h->type],
+               h->addr, h->addr + h->size - 1, h->hits);
+        print_symbol("%s\n", (h->type == HVM_MMIO)
+                     ? (unsigned long)h->action.ops->read_handler
+                     : (unsigned long)h->action.ptr);
+    }
+
+    rcu_read_unlock(&hvm_io_rcu_lock);
+}
+
 static int hvm_mmio_access(struct vcpu *v,
                            ioreq_t *p,
                            hvm_mmio_read_t read_handler,
@@ -117,16 +312,27 @@ static int hvm_mmio_access(struct vcpu *v,
 int hvm_mmio_intercept(ioreq_t *p)
 {
     struct vcpu *v = current;
-    int i;
+    struct hvm_io_table *t;
+    struct io_handler *h = NULL;
+    const struct hvm_mmio_handler *ops = NULL;
 
-    for ( i = 0; i < HVM_MMIO_HANDLER_NR; i++ )
-        if ( hvm_mmio_handlers[i]->check_handler(v, p->addr) )
-            return hvm_mmio_access(
-                v, p,
-                hvm_mmio_handlers[i]->read_handler,
-                hvm_mmio_handlers[i]->write_handler);
+    rcu_read_lock(&hvm_io_rcu_lock);
 
-    return X86EMUL_UNHANDLEABLE;
+    t = rcu_dereference(v->domain->arch.hvm_domain.io_handler.table);
+    if ( t )
+        h = hvm_find_io_handler(v, t, HVM_MMIO, p);
+    if ( h )
+    {
+        h->hits++;
+        ops = h->action.ops;
+    }
+
+    rcu_read_unlock(&hvm_io_rcu_lock);
+
+    if ( ops == NULL )
+        return X86EMUL_UNHANDLEABLE;
+
+    return hvm_mmio_access(v, p, ops->read_handler, ops->write_handler);
 }
 
 static int process_portio_intercept(portio_action_t action, ioreq_t *p)
@@ -189,9 +395,10 @@ static int process_portio_intercept(portio_action_t action, ioreq_t *p)
 int hvm_io_intercept(ioreq_t *p, int type)
 {
     struct vcpu *v = current;
-    struct hvm_io_handler *handler = v->domain->arch.hvm_domain.io_handler;
-    int i;
-    unsigned long addr, size;
+    struct hvm_io_table *t;
+    struct io_handler *h = NULL;
+    portio_action_t portio = NULL;
+    mmio_action_t mmio = NULL;
 
     if ( type == HVM_PORTIO )
     {
@@ -200,53 +407,143 @@ int hvm_io_intercept(ioreq_t *p, int type)
             return rc;
     }
 
-    for ( i = 0; i < handler->num_slot; i++ )
+    rcu_read_lock(&hvm_io_rcu_lock);
+
+    t = rcu_dereference(v->domain->arch.hvm_domain.io_handler.table);
+    if ( t )
+        h = hvm_find_io_handler(v, t, type, p);
+    if ( h )
     {
-        if ( type != handler->hdl_list[i].type )
-            continue;
-        addr = handler->hdl_list[i].addr;
-        size = handler->hdl_list[i].size;
-        if ( (p->addr >= addr) &&
-             ((p->addr + p->size) <= (addr + size)) )
-        {
-            if ( type == HVM_PORTIO )
-                return process_portio_intercept(
-                    handler->hdl_list[i].action.portio, p);
-            return handler->hdl_list[i].action.mmio(p);
-        }
+        h->hits++;
+        if ( type == HVM_PORTIO )
+            portio = h->action.portio;
+        else
+            mmio = h->action.mmio;
     }
 
+    rcu_read_unlock(&hvm_io_rcu_lock);
+
+    if ( portio )
+        return process_portio_intercept(portio, p);
+    if ( mmio )
+        return mmio(p);
+
     return X86EMUL_UNHANDLEABLE;
 }
 
-void register_io_handler(
+int register_io_handler(
+    struct domain *d, unsigned long addr, unsigned long size,
+    void *action, int type)
+{
+    struct hvm_io_handler *handler = &d->arch.hvm_domain.io_handler;
+    struct io_handler *h, new = {
+        .type = type, .addr = addr, .size = size, .action.ptr = action,
+        .refcnt = 1
+    };
+    int rc = 0;
+
+    ASSERT((type >= 0) && (type < HVM_NR_IO_TYPES) && size);
+
+    spin_lock(&handler->lock);
+    h = io_table_find(handler->table, type, addr, size, action);
+    if ( h )
+        h->refcnt++;
+    else
+        rc = io_table_replace(handler, NULL, &new);
+    spin_unlock(&handler->lock);
+
+    if ( rc )
+        printk(XENLOG_G_ERR "d%d: no memory for I/O handler %d:%lx+%lx\n",
+               d->domain_id, type, addr, size);
+
+    return rc;
+}
+
+void unregister_io_handler(
     struct domain *d, unsigned long addr, unsigned long size,
     void *action, int type)
 {
-    struct hvm_io_handler *handler = d->arch.hvm_domain.io_handler;
-    int num = handler->num_slot;
+    struct hvm_io_handler *handler = &d->arch.hvm_domain.io_handler;
+    struct io_handler *h;
+
+    spin_lock(&handler->lock);
+    h = io_table_find(handler->table, type, addr, size, action);
+    if ( h )
+        io_handler_put(handler, h);
+    spin_unlock(&handler->lock);
+}
+
+/*
+ * Move one reference from old_addr to new_addr.  With no action given, any
+ * handler of the right type and size at old_addr is moved, and nothing
+ * happens if there is none; otherwise the handler is registered at new_addr
+ * regardless.
+ */
+static int relocate_handler(
+    struct domain *d, unsigned long old_addr, unsigned long new_addr,
+    unsigned long size, void *action, int type)
+{
+    struct hvm_io_handler *handler = &d->arch.hvm_domain.io_handler;
+    struct io_handler *old, *cur, new = {
+        .type = type, .addr = new_addr, .size = size, .action.ptr = action,
+        .refcnt = 1
+    };
+    int rc = 0;
 
-    BUG_ON(num >= MAX_IO_HANDLER);
+    if ( old_addr == new_addr )
+        return 0;
 
-    handler->hdl_list[num].addr = addr;
-    handler->hdl_list[num].size = size;
-    handler->hdl_list[num].action.ptr = action;
-    handler->hdl_list[num].type = type;
-    handler->num_slot++;
+    spin_lock(&handler->lock);
+
+    old = io_table_find(handler->table, type, old_addr, size, action);
+    if ( old )
+        new.action = old->action;
+    else if ( action == NULL )
+        goto out;
+
+    cur = io_table_find(handler->table, type, new_addr, size, new.action.ptr);
+    if ( cur )
+    {
+        cur->refcnt++;
+        if ( old )
+            io_handler_put(handler, old);
+    }
+    else if ( old && (old->refcnt == 1) )
+        /* Swap in one go, so the handler is never missing. */
+        rc = io_table_replace(handler, old, &new);
+    else
+    {
+        rc = io_table_replace(handler, NULL, &new);
+        /* The copy moved the entries: look the old one up again. */
+        if ( !rc && old )
+            io_handler_put(handler, io_table_find(handler->table, type,
+                                                  old_addr, size,
+                                                  new.action.ptr));
+    }
+
+ out:
+    spin_unlock(&handler->lock);
+
+    if ( rc )
+        printk(XENLOG_G_ERR "d%d: no memory to move I/O handler %d:%lx+%lx"
+               " to %lx\n", d->domain_id, type, old_addr, size, new_addr);
+
+    return rc;
 }
 
 void relocate_io_handler(
     struct domain *d, unsigned long old_addr, unsigned long new_addr,
     unsigned long size, int type)
 {
-    struct hvm_io_handler *handler = d->arch.hvm_domain.io_handler;
-    int i;
-
-    for ( i = 0; i < handler->num_slot; i++ )
-        if ( (handler->hdl_list[i].addr == old_addr) &&
-             (handler->hdl_list[i].size == size) &&
-             (handler->hdl_list[i].type == type) )
-            handler->hdl_list[i].addr = new_addr;
+    relocate_handler(d, old_addr, new_addr, size, NULL, type);
+}
+
+int relocate_mmio_handler(
+    struct domain *d, const struct hvm_mmio_handler *ops,
+    unsigned long old_addr, unsigned long new_addr, unsigned long size)
+{
+    return relocate_handler(d, old_addr, new_addr, size, (void *)ops,
+                            HVM_MMIO);
 }
 
 /*
@@ -49,9 +49,14 @@
 int hvm_buffered_io_send(ioreq_t *p)
 {
     struct vcpu *v = current;
-    struct hvm_ioreq_page *iorp = &v->domain->arch.hvm_domain.buf_ioreq;
-    buffered_iopage_t *pg = iorp->va;
+    struct domain *d = v->domain;
+    struct hvm_ioreq_page *iorp = &d->arch.hvm_domain.buf_ioreq;
+    int port = d->arch.hvm_domain.params[HVM_PARAM_BUFIOREQ_EVTCHN];
+    struct hvm_ioreq_server *s;
+    buffered_iopage_t *pg;
     buf_ioreq_t bp;
+    uint8_t type;
+    uint64_t addr;
     /* Timeoffset sends 64b data, but no address. Use two consecutive slots. */
     int qw = 0;
 
@@ -69,6 +74,17 @@ int hvm_buffered_io_send(ioreq_t *p)
     if ( (p->addr > 0xffffful) || p->data_is_ptr || (p->count != 1) )
         return 0;
 
+    s = hvm_select_ioreq_server(d, p, &type, &addr);
+    if ( s != NULL )
+    {
+        /* A server without a buffered ioreq page gets it synchronously. */
+        if ( s->bufioreq.va == NULL )
+            return 0;
+        iorp = &s->bufioreq;
+        port = s->bufioreq_evtchn;
+    }
+    pg = iorp->va;
+
     bp.type = p->type;
     bp.dir  = p->dir;
     switch ( p->size )
@@ -118,8 +134,7 @@ int hvm_buffered_io_send(ioreq_t *p)
     wmb();
     pg->write_pointer += qw ? 2 : 1;
 
-    notify_via_xen_event_channel(v->domain,
-            v->domain->arch.hvm_domain.params[HVM_PARAM_BUFIOREQ_EVTCHN]);
+    notify_via_xen_event_channel(d, port);
     spin_unlock(&iorp->lock);
     
     return 1;
@@ -165,7 +180,7 @@ void send_invalidate_req(void)
     p->dir = IOREQ_WRITE;
     p->data = ~0UL; /* flush all */
 
-    (void)hvm_send_assist_req(v);
+    hvm_broadcast_assist_req(v);
 }
 
 int handle_mmio(void)
@@ -255,11 +270,10 @@ int handle_pio(uint16_t port, int size, int dir)
     return 1;
 }
 
-void hvm_io_assist(void)
+void hvm_io_assist(ioreq_t *p)
 {
     struct vcpu *curr = current;
     struct hvm_vcpu_io *vio = &curr->arch.hvm_vcpu.hvm_io;
-    ioreq_t *p = get_ioreq(curr);
     enum hvm_io_state io_state;
 
     rmb(); /* see IORESP_READY /then/ read contents of ioreq */
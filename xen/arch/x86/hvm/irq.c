@@ -497,13 +497,16 @@ static void dump_irq_info(unsigned char key)
 {
     struct domain *d;
 
-    printk("'%c' pressed -> dumping HVM irq info\n", key);
+    printk("'%c' pressed -> dumping HVM irq and I/O handler info\n", key);
 
     rcu_read_lock(&domlist_read_lock);
 
     for_each_domain ( d )
         if ( is_hvm_domain(d) )
+        {
             irq_dump(d);
+            hvm_io_handler_dump(d);
+        }
 
     rcu_read_unlock(&domlist_read_lock);
 }
@@ -511,7 +514,7 @@ static void dump_irq_info(unsigned char key)
 static struct keyhandler dump_irq_info_keyhandler = {
     .diagnostic = 1,
     .u.fn = dump_irq_info,
-    .desc = "dump HVM irq info"
+    .desc = "dump HVM irq and I/O handler info"
 };
 
 static int __init dump_irq_info_key_init(void)
@@ -1957,6 +1957,7 @@ static void svm_invlpg_intercept(unsigned long vaddr)
 {
     struct vcpu *curr = current;
     HVMTRACE_LONG_2D(INVLPG, 0, TRC_PAR_LONG(vaddr));
+    hvm_insn_cache_flush(curr);
     paging_invlpg(curr, vaddr);
     svm_asid_g_invlpg(curr, vaddr);
 }
@@ -2019,6 +2020,7 @@ void svm_vmexit_handler(struct cpu_user_regs *regs)
     int inst_len, rc;
     vintr_t intr;
     bool_t vcpu_guestmode = 0;
+    cycles_t start = perfc_time_start();
 
     if ( paging_mode_hap(v->domain) )
         v->arch.hvm_vcpu.guest_cr[3] = v->arch.hvm_vcpu.hw_cr[3] =
@@ -2404,6 +2406,8 @@ void svm_vmexit_handler(struct cpu_user_regs *regs)
     }
 
   out:
+    perfc_time_end(vmexit_cycles, start);
+
     if ( vcpu_guestmode )
         /* Don't clobber TPR of the nested guest. */
         return;
@@ -426,7 +426,15 @@ static int ioapic_save(struct domain *d, hvm_domain_context_t *h)
 static int ioapic_load(struct domain *d, hvm_domain_context_t *h)
 {
     struct hvm_hw_vioapic *s = domain_vioapic(d);
-    return hvm_load_entry(IOAPIC, h, s);
+    unsigned long old_base = s->base_address;
+
+    if ( hvm_load_entry(IOAPIC, h, s) )
+        return -EINVAL;
+
+    relocate_mmio_handler(d, &vioapic_mmio_handler, old_base,
+                          s->base_address, VIOAPIC_MEM_LENGTH);
+
+    return 0;
 }
 
 HVM_REGISTER_SAVE_RESTORE(IOAPIC, ioapic_save, ioapic_load, 1, HVMSR_PER_DOM);
@@ -434,18 +442,23 @@ HVM_REGISTER_SAVE_RESTORE(IOAPIC, ioapic_save, ioapic_load, 1, HVMSR_PER_DOM);
 void vioapic_reset(struct domain *d)
 {
     struct hvm_vioapic *vioapic = d->arch.hvm_domain.vioapic;
+    unsigned long old_base = vioapic->hvm_hw_vioapic.base_address;
     int i;
 
     memset(&vioapic->hvm_hw_vioapic, 0, sizeof(vioapic->hvm_hw_vioapic));
     for ( i = 0; i < VIOAPIC_NUM_PINS; i++ )
         vioapic->hvm_hw_vioapic.redirtbl[i].fields.mask = 1;
     vioapic->hvm_hw_vioapic.base_address = VIOAPIC_DEFAULT_BASE_ADDRESS;
+
+    /* On first reset the base is still zero, which registers the handler. */
+    relocate_mmio_handler(d, &vioapic_mmio_handler, old_base,
+                          VIOAPIC_DEFAULT_BASE_ADDRESS, VIOAPIC_MEM_LENGTH);
 }
 
 int vioapic_init(struct domain *d)
 {
     if ( (d->arch.hvm_domain.vioapic == NULL) &&
-         ((d->arch.hvm_domain.vioapic = xmalloc(struct hvm_vioapic)) == NULL) )
+         ((d->arch.hvm_domain.vioapic = xzalloc(struct hvm_vioapic)) == NULL) )
         return -ENOMEM;
 
     d->arch.hvm_domain.vioapic->domain = d;
@@ -876,6 +876,8 @@ const struct hvm_mmio_handler vlapic_mmio_handler = {
 
 void vlapic_msr_set(struct vlapic *vlapic, uint64_t value)
 {
+    unsigned long old_base = vlapic_base_address(vlapic);
+
     if ( (vlapic->hw.apic_base_msr ^ value) & MSR_IA32_APICBASE_ENABLE )
     {
         if ( value & MSR_IA32_APICBASE_ENABLE )
@@ -893,6 +895,9 @@ void vlapic_msr_set(struct vlapic *vlapic, uint64_t value)
 
     vlapic->hw.apic_base_msr = value;
 
+    relocate_mmio_handler(vlapic_domain(vlapic), &vlapic_mmio_handler,
+                          old_base, vlapic_base_address(vlapic), PAGE_SIZE);
+
     if ( vlapic_x2apic_mode(vlapic) )
     {
         u32 id = vlapic_get_reg(vlapic, APIC_ID);
@@ -1160,6 +1165,7 @@ static int lapic_load_hidden(struct domain *d, hvm_domain_context_t *h)
     uint16_t vcpuid;
     struct vcpu *v;
     struct vlapic *s;
+    unsigned long old_base;
     
     /* Which vlapic to load? */
     vcpuid = hvm_load_instance(h); 
@@ -1170,10 +1176,14 @@ static int lapic_load_hidden(struct domain *d, hvm_domain_context_t *h)
         return -EINVAL;
     }
     s = vcpu_vlapic(v);
+    old_base = vlapic_base_address(s);
     
     if ( hvm_load_entry_zeroextend(LAPIC, h, &s->hw) != 0 ) 
         return -EINVAL;
 
+    relocate_mmio_handler(d, &vlapic_mmio_handler, old_base,
+                          vlapic_base_address(s), PAGE_SIZE);
+
     vmx_vlapic_msr_changed(v);
 
     return 0;
@@ -1246,6 +1256,9 @@ int vlapic_init(struct vcpu *v)
     if ( v->vcpu_id == 0 )
         vlapic->hw.apic_base_msr |= MSR_IA32_APICBASE_BSP;
 
+    register_mmio_handler(v->domain, &vlapic_mmio_handler,
+                          vlapic_base_address(vlapic), PAGE_SIZE);
+
     tasklet_init(&vlapic->init_sipi.tasklet,
                  vlapic_init_sipi_action,
                  (unsigned long)v);
@@ -1257,6 +1270,8 @@ void vlapic_destroy(struct vcpu *v)
 {
     struct vlapic *vlapic = vcpu_vlapic(v);
 
+    unregister_mmio_handler(v->domain, &vlapic_mmio_handler,
+                            vlapic_base_address(vlapic), PAGE_SIZE);
     tasklet_kill(&vlapic->init_sipi.tasklet);
     destroy_periodic_time(&vlapic->pt);
     unmap_domain_page_global(vlapic->regs);
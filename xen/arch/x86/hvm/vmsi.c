@@ -368,6 +368,7 @@ int msixtbl_pt_register(struct domain *d, struct pirq *pirq, uint64_t gtable)
     struct msi_desc *msi_desc;
     struct pci_dev *pdev;
     struct msixtbl_entry *entry, *new_entry;
+    unsigned long table = 0, table_len = 0;
     int r = -EINVAL;
 
     ASSERT(spin_is_locked(&pcidevs_lock));
@@ -406,6 +407,8 @@ int msixtbl_pt_register(struct domain *d, struct pirq *pirq, uint64_t gtable)
     entry = new_entry;
     new_entry = NULL;
     add_msixtbl_entry(d, pdev, gtable, entry);
+    table = entry->gtable;
+    table_len = entry->table_len;
 
 found:
     atomic_inc(&entry->refcnt);
@@ -415,6 +418,11 @@ found:
 out:
     spin_unlock_irq(&irq_desc->lock);
     xfree(new_entry);
+
+    /* Not under the irq_desc lock: this may allocate. */
+    if ( table_len )
+        register_mmio_handler(d, &msixtbl_mmio_handler, table, table_len);
+
     return r;
 }
 
@@ -424,6 +432,7 @@ void msixtbl_pt_unregister(struct domain *d, struct pirq *pirq)
     struct msi_desc *msi_desc;
     struct pci_dev *pdev;
     struct msixtbl_entry *entry;
+    unsigned long table = 0, table_len = 0;
 
     ASSERT(spin_is_locked(&pcidevs_lock));
     ASSERT(spin_is_locked(&d->event_lock));
@@ -456,10 +465,17 @@ out:
 
 found:
     if ( !atomic_dec_and_test(&entry->refcnt) )
+    {
+        table = entry->gtable;
+        table_len = entry->table_len;
         del_msixtbl_entry(entry);
+    }
 
     spin_unlock(&d->arch.hvm_domain.msixtbl_list_lock);
     spin_unlock_irq(&irq_desc->lock);
+
+    if ( table_len )
+        unregister_mmio_handler(d, &msixtbl_mmio_handler, table, table_len);
 }
 
 void msixtbl_pt_cleanup(struct domain *d)
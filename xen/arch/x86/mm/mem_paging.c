@@ -25,6 +25,30 @@
 #include <asm/mem_event.h>
 
 
+static int mem_paging_batch(struct domain *d, xen_mem_event_op_t *mec,
+                            int (*op)(struct domain *, unsigned long))
+{
+    xen_mem_paging_batch_t *user_batch = (void *)(unsigned long)mec->buffer;
+    xen_mem_paging_batch_t entry;
+    unsigned long i, nr = mec->gfn;
+
+    if ( nr > XENMEM_paging_batch_max )
+        return -E2BIG;
+    if ( !access_ok(user_batch, nr * sizeof(entry)) )
+        return -EFAULT;
+
+    for ( i = 0; i < nr; i++ )
+    {
+        if ( copy_from_user(&entry, &user_batch[i], sizeof(entry)) )
+            return -EFAULT;
+        entry.rc = op(d, entry.gfn);
+        if ( copy_to_user(&user_batch[i].rc, &entry.rc, sizeof(entry.rc)) )
+            return -EFAULT;
+    }
+
+    return 0;
+}
+
 int mem_paging_memop(struct domain *d, xen_mem_event_op_t *mec)
 {
     if ( unlikely(!d->mem_event->paging.ring_page) )
@@ -53,6 +77,12 @@ int mem_paging_memop(struct domain *d, xen_mem_event_op_t *mec)
     }
     break;
 
+    case XENMEM_paging_op_nominate_batch:
+        return mem_paging_batch(d, mec, p2m_mem_paging_nominate);
+
+    case XENMEM_paging_op_evict_batch:
+        return mem_paging_batch(d, mec, p2m_mem_paging_evict);
+
     default:
         return -ENOSYS;
         break;
@@ -163,6 +163,7 @@ static inline shr_handle_t get_next_handle(void)
 
 static atomic_t nr_saved_mfns   = ATOMIC_INIT(0); 
 static atomic_t nr_shared_mfns  = ATOMIC_INIT(0);
+static atomic_t nr_cow_breaks   = ATOMIC_INIT(0);
 
 /** Reverse map **/
 /* Every shared frame keeps a reverse map (rmap) of <domain, gfn> tuples that
@@ -588,6 +589,11 @@ unsigned int mem_sharing_get_nr_shared_mfns(void)
     return (unsigned int)atomic_read(&nr_shared_mfns);
 }
 
+unsigned int mem_sharing_get_nr_cow_breaks(void)
+{
+    return (unsigned int)atomic_read(&nr_cow_breaks);
+}
+
 int mem_sharing_sharing_resume(struct domain *d)
 {
     mem_event_response_t rsp;
@@ -1230,6 +1236,7 @@ int __mem_sharing_unshare_page(struct domain *d,
     memcpy(t, s, PAGE_SIZE);
     unmap_domain_page(s);
     unmap_domain_page(t);
+    atomic_inc(&nr_cow_breaks);
 
     BUG_ON(set_shared_p2m_entry(d, gfn, page_to_mfn(page)) == 0);
     mem_sharing_gfn_destroy(old_page, d, gfn_info);
@@ -463,8 +463,7 @@ p2m_remove_page(struct p2m_domain *p2m, unsigned long gfn, unsigned long mfn,
     if ( !paging_mode_translate(p2m->domain) )
     {
         if ( need_iommu(p2m->domain) )
-            for ( i = 0; i < (1 << page_order); i++ )
-                iommu_unmap_page(p2m->domain, mfn + i);
+            iommu_unmap_pages(p2m->domain, mfn, page_order);
         return;
     }
 
@@ -511,19 +510,12 @@ guest_physmap_add_entry(struct domain *d, unsigned long gfn,
     {
         if ( need_iommu(d) && t == p2m_ram_rw )
         {
-            for ( i = 0; i < (1 << page_order); i++ )
-            {
-                rc = iommu_map_page(
-                    d, mfn + i, mfn + i, IOMMUF_readable|IOMMUF_writable);
-                if ( rc != 0 )
-                {
-                    while ( i-- > 0 )
-                        iommu_unmap_page(d, mfn + i);
-                    return rc;
-                }
-            }
+            rc = iommu_map_pages(d, mfn, mfn, page_order,
+                                 IOMMUF_readable|IOMMUF_writable);
+            if ( rc != 0 )
+                iommu_unmap_pages(d, mfn, page_order);
         }
-        return 0;
+        return rc;
     }
 
     p2m_lock(p2m);
@@ -208,39 +208,82 @@ void send_IPI_mask_phys(const cpumask_t *mask, int vector)
     local_irq_restore(flags);
 }
 
-static DEFINE_SPINLOCK(flush_lock);
-static cpumask_t flush_cpumask;
-static const void *flush_va;
-static unsigned int flush_flags;
+/*
+ * Each CPU describes its own outstanding remote flush in its flush_request,
+ * and marks itself in the flush_pending mask of every target CPU.  Flushes
+ * issued by different CPUs thus proceed in parallel; a target handles all
+ * requests pending on it from a single IPI.
+ */
+struct flush_request {
+    cpumask_t cpumask;           /* CPUs yet to perform the flush */
+    const void *va;
+    unsigned int flags;
+};
+
+static DEFINE_PER_CPU(struct flush_request, flush_request);
+static DEFINE_PER_CPU(cpumask_t, flush_pending);
 
 void invalidate_interrupt(struct cpu_user_regs *regs)
 {
+    unsigned int cpu = smp_processor_id(), requester;
+    cpumask_t *pending = &per_cpu(flush_pending, cpu);
+    struct flush_request *req;
+    bool_t synced;
+
     ack_APIC_irq();
     perfc_incr(ipis);
-    if ( !__sync_local_execstate() ||
-         (flush_flags & (FLUSH_TLB_GLOBAL | FLUSH_CACHE)) )
-        flush_area_local(flush_va, flush_flags);
-    cpumask_clear_cpu(smp_processor_id(), &flush_cpumask);
+
+    synced = __sync_local_execstate();
+
+    for_each_cpu ( requester, pending )
+    {
+        if ( !cpumask_test_and_clear_cpu(requester, pending) )
+            continue;
+        req = &per_cpu(flush_request, requester);
+        if ( !synced || (req->flags & (FLUSH_TLB_GLOBAL | FLUSH_CACHE)) )
+            flush_area_local(req->va, req->flags);
+        cpumask_clear_cpu(cpu, &req->cpumask);
+    }
 }
 
 void flush_area_mask(const cpumask_t *mask, const void *va, unsigned int flags)
 {
+    unsigned int cpu = smp_processor_id(), target;
+
     ASSERT(local_irq_is_enabled());
 
-    if ( cpumask_test_cpu(smp_processor_id(), mask) )
+    if ( cpumask_test_cpu(cpu, mask) )
         flush_area_local(va, flags);
 
-    if ( !cpumask_subset(mask, cpumask_of(smp_processor_id())) )
+    if ( !cpumask_subset(mask, cpumask_of(cpu)) )
     {
-        spin_lock(&flush_lock);
-        cpumask_and(&flush_cpumask, mask, &cpu_online_map);
-        cpumask_clear_cpu(smp_processor_id(), &flush_cpumask);
-        flush_va      = va;
-        flush_flags   = flags;
-        send_IPI_mask(&flush_cpumask, INVALIDATE_TLB_VECTOR);
-        while ( !cpumask_empty(&flush_cpumask) )
+        struct flush_request *req = &this_cpu(flush_request);
+        cpumask_t targets;
+#ifdef PERF_COUNTERS
+        s_time_t start = NOW();
+#endif
+
+        cpumask_and(&targets, mask, &cpu_online_map);
+        cpumask_clear_cpu(cpu, &targets);
+
+        /* Targets may only see the request once it is complete. */
+        ASSERT(cpumask_empty(&req->cpumask));
+        req->va    = va;
+        req->flags = flags;
+        cpumask_copy(&req->cpumask, &targets);
+        smp_wmb();
+
+        for_each_cpu ( target, &targets )
+            cpumask_set_cpu(cpu, &per_cpu(flush_pending, target));
+        send_IPI_mask(&targets, INVALIDATE_TLB_VECTOR);
+
+        while ( !cpumask_empty(&req->cpumask) )
             cpu_relax();
-        spin_unlock(&flush_lock);
+
+        perfc_incr(remote_tlb_flushes);
+#ifdef PERF_COUNTERS
+        perfc_add(remote_tlb_flush_wait_us, (NOW() - start + 500) / 1000);
+#endif
     }
 }
 
@@ -84,8 +84,10 @@ long arch_do_sysctl(
         pi->max_node_id = MAX_NUMNODES-1;
         pi->max_cpu_id = nr_cpu_ids - 1;
         pi->total_pages = total_pages;
+        /* Pages waiting to be scrubbed are not reported as free. */
+        pi->scrub_pages = avail_scrub_pages();
         pi->free_pages = avail_domheap_pages();
-        pi->scrub_pages = 0;
+        pi->free_pages -= min(pi->free_pages, pi->scrub_pages);
         pi->cpu_khz = cpu_khz;
         memcpy(pi->hw_cap, boot_cpu_data.x86_capability, NCAPINTS*4);
         if ( hvm_enabled )
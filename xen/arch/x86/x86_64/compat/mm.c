@@ -212,6 +212,9 @@ int compat_arch_memory_op(int op, XEN_GUEST_HANDLE_PARAM(void) arg)
     case XENMEM_get_sharing_shared_pages:
         return mem_sharing_get_nr_shared_mfns();
 
+    case XENMEM_get_sharing_cow_breaks:
+        return mem_sharing_get_nr_cow_breaks();
+
     case XENMEM_paging_op:
     case XENMEM_access_op:
     {
@@ -1328,12 +1328,14 @@ x86_emulate(
     /* Shadow copy of register state. Committed on successful emulation. */
     struct cpu_user_regs _regs = *ctxt->regs;
 
-    uint8_t b, d, sib, sib_index, sib_base, twobyte = 0, rex_prefix = 0;
+    uint8_t b, d, sib = 0, sib_index, sib_base, twobyte = 0, rex_prefix = 0;
     uint8_t modrm = 0, modrm_mod = 0, modrm_reg = 0, modrm_rm = 0;
     union vex vex = {};
     unsigned int op_bytes, def_op_bytes, ad_bytes, def_ad_bytes;
-    bool_t lock_prefix = 0;
+    bool_t lock_prefix = 0, cacheable = 1;
     int override_seg = -1, rc = X86EMUL_OKAY;
+    long disp = 0;
+    struct x86_emulate_decode *dc = ctxt->decode;
     struct operand src, dst;
     DECLARE_ALIGNED(mmval_t, mmval);
     /*
@@ -1354,6 +1356,25 @@ x86_emulate(
 #endif
     }
 
+    if ( (dc != NULL) && dc->len )
+    {
+        b = dc->b;
+        d = dc->d;
+        twobyte = dc->twobyte;
+        rex_prefix = dc->rex_prefix;
+        vex.raw[0] = dc->vex[0];
+        vex.raw[1] = dc->vex[1];
+        op_bytes = dc->op_bytes;
+        ad_bytes = dc->ad_bytes;
+        override_seg = dc->override_seg;
+        lock_prefix = dc->lock_prefix;
+        modrm = dc->modrm;
+        sib = dc->sib;
+        disp = dc->disp;
+        _regs.eip += dc->len;
+        goto decoded;
+    }
+
     /* Prefix bytes. */
     for ( ; ; )
     {
@@ -1443,6 +1464,8 @@ x86_emulate(
             default:
                 BUG();
             case 2:
+                /* Depends on more than addr_size: don't cache. */
+                cacheable = 0;
                 if ( in_realmode(ctxt, ops) || (_regs.eflags & EFLG_VM) )
                     break;
                 /* fall through */
@@ -1500,6 +1523,74 @@ x86_emulate(
                 break;
             }
 
+        modrm_rm = modrm & 0x07;
+
+        /* SIB byte and displacement. */
+        if ( modrm_mod == 3 )
+            ;
+        else if ( ad_bytes == 2 )
+        {
+            switch ( modrm_mod )
+            {
+            case 0:
+                if ( modrm_rm == 6 )
+                    disp = insn_fetch_type(int16_t);
+                break;
+            case 1:
+                disp = insn_fetch_type(int8_t);
+                break;
+            case 2:
+                disp = insn_fetch_type(int16_t);
+                break;
+            }
+        }
+        else
+        {
+            if ( modrm_rm == 4 )
+            {
+                sib = insn_fetch_type(uint8_t);
+                if ( (modrm_mod == 0) && ((sib & 7) == 5) )
+                    disp = insn_fetch_type(int32_t);
+            }
+            switch ( modrm_mod )
+            {
+            case 0:
+                if ( modrm_rm == 5 )
+                    disp = insn_fetch_type(int32_t);
+                break;
+            case 1:
+                disp = insn_fetch_type(int8_t);
+                break;
+            case 2:
+                disp = insn_fetch_type(int32_t);
+                break;
+            }
+        }
+    }
+
+    if ( (dc != NULL) && cacheable )
+    {
+        dc->len = _regs.eip - ctxt->regs->eip;
+        dc->b = b;
+        dc->d = d;
+        dc->twobyte = twobyte;
+        dc->rex_prefix = rex_prefix;
+        dc->vex[0] = vex.raw[0];
+        dc->vex[1] = vex.raw[1];
+        dc->op_bytes = op_bytes;
+        dc->ad_bytes = ad_bytes;
+        dc->override_seg = override_seg;
+        dc->lock_prefix = lock_prefix;
+        dc->modrm = modrm;
+        dc->sib = sib;
+        dc->disp = disp;
+    }
+
+ decoded:
+    /* Effective address, from the decoded ModRM, SIB and displacement. */
+    if ( d & ModRM )
+    {
+        modrm_mod = (modrm & 0xc0) >> 6;
         modrm_reg = ((rex_prefix & 4) << 1) | ((modrm & 0x38) >> 3);
         modrm_rm  = modrm & 0x07;
 
@@ -1545,34 +1636,20 @@ x86_emulate(
                 ea.mem.off = _regs.ebx;
                 break;
             }
-            switch ( modrm_mod )
-            {
-            case 0:
-                if ( modrm_rm == 6 )
-                    ea.mem.off = insn_fetch_type(int16_t);
-                break;
-            case 1:
-                ea.mem.off += insn_fetch_type(int8_t);
-                break;
-            case 2:
-                ea.mem.off += insn_fetch_type(int16_t);
-                break;
-            }
-            ea.mem.off = truncate_ea(ea.mem.off);
+            ea.mem.off = truncate_ea(ea.mem.off + disp);
         }
         else
         {
             /* 32/64-bit ModR/M decode. */
             if ( modrm_rm == 4 )
             {
-                sib = insn_fetch_type(uint8_t);
                 sib_index = ((sib >> 3) & 7) | ((rex_prefix << 2) & 8);
                 sib_base  = (sib & 7) | ((rex_prefix << 3) & 8);
                 if ( sib_index != 4 )
                     ea.mem.off = *(long*)decode_register(sib_index, &_regs, 0);
                 ea.mem.off <<= (sib >> 6) & 3;
                 if ( (modrm_mod == 0) && ((sib_base & 7) == 5) )
-                    ea.mem.off += insn_fetch_type(int32_t);
+                    ;
                 else if ( sib_base == 4 )
                 {
                     ea.mem.seg  = x86_seg_ss;
@@ -1593,42 +1670,36 @@ x86_emulate(
             else
             {
                 modrm_rm |= (rex_prefix & 1) << 3;
-                ea.mem.off = *(long *)decode_register(modrm_rm, &_regs, 0);
-                if ( (modrm_rm == 5) && (modrm_mod != 0) )
-                    ea.mem.seg = x86_seg_ss;
-            }
-            switch ( modrm_mod )
-            {
-            case 0:
-                if ( (modrm_rm & 7) != 5 )
-                    break;
-                ea.mem.off = insn_fetch_type(int32_t);
-                if ( !mode_64bit() )
-                    break;
-                /* Relative to RIP of next instruction. Argh! */
-                ea.mem.off += _regs.eip;
-                if ( (d & SrcMask) == SrcImm )
-                    ea.mem.off += (d & ByteOp) ? 1 :
-                        ((op_bytes == 8) ? 4 : op_bytes);
-                else if ( (d & SrcMask) == SrcImmByte )
-                    ea.mem.off += 1;
-                else if ( !twobyte && ((b & 0xfe) == 0xf6) &&
-                          ((modrm_reg & 7) <= 1) )
-                    /* Special case in Grp3: test has immediate operand. */
-                    ea.mem.off += (d & ByteOp) ? 1
-                        : ((op_bytes == 8) ? 4 : op_bytes);
-                else if ( twobyte && ((b & 0xf7) == 0xa4) )
-                    /* SHLD/SHRD with immediate byte third operand. */
-                    ea.mem.off++;
-                break;
-            case 1:
-                ea.mem.off += insn_fetch_type(int8_t);
-                break;
-            case 2:
-                ea.mem.off += insn_fetch_type(int32_t);
-                break;
+                if ( (modrm_mod == 0) && ((modrm_rm & 7) == 5) )
+                {
+                    ea.mem.off = 0;
+                    if ( mode_64bit() )
+                    {
+                        /* Relative to RIP of next instruction. Argh! */
+                        ea.mem.off = _regs.eip;
+                        if ( (d & SrcMask) == SrcImm )
+                            ea.mem.off += (d & ByteOp) ? 1 :
+                                ((op_bytes == 8) ? 4 : op_bytes);
+                        else if ( (d & SrcMask) == SrcImmByte )
+                            ea.mem.off += 1;
+                        else if ( !twobyte && ((b & 0xfe) == 0xf6) &&
+                                  ((modrm_reg & 7) <= 1) )
+                            /* Special case in Grp3: test has immediate operand. */
+                            ea.mem.off += (d & ByteOp) ? 1
+                                : ((op_bytes == 8) ? 4 : op_bytes);
+                        else if ( twobyte && ((b & 0xf7) == 0xa4) )
+                            /* SHLD/SHRD with immediate byte third operand. */
+                            ea.mem.off++;
+                    }
+                }
+                else
+                {
+                    ea.mem.off = *(long *)decode_register(modrm_rm, &_regs, 0);
+                    if ( (modrm_rm == 5) && (modrm_mod != 0) )
+                        ea.mem.seg = x86_seg_ss;
+                }
             }
-            ea.mem.off = truncate_ea(ea.mem.off);
+            ea.mem.off = truncate_ea(ea.mem.off + disp);
         }
     }
 
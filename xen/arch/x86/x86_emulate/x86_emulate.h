@@ -365,6 +365,24 @@ struct x86_emulate_ops
 
 struct cpu_user_regs;
 
+/*
+ * An instruction's prefixes, opcode, ModRM, SIB and displacement, as
+ * decoded by x86_emulate(): everything it works out from the instruction
+ * bytes alone, before it looks at register or memory state.
+ */
+struct x86_emulate_decode
+{
+    /* Instruction bytes covered, from the first prefix. 0 if empty. */
+    uint8_t len;
+
+    uint8_t b, d, twobyte, rex_prefix, vex[2];
+    uint8_t op_bytes, ad_bytes;
+    int8_t override_seg;
+    uint8_t lock_prefix;
+    uint8_t modrm, sib;
+    int32_t disp;
+};
+
 struct x86_emulate_ctxt
 {
     /* Register state before/after emulation. */
@@ -379,6 +397,15 @@ struct x86_emulate_ctxt
     /* Set this if writes may have side effects. */
     uint8_t force_writeback;
 
+    /*
+     * Decoded instruction cache slot, or NULL. If the slot isn't empty,
+     * x86_emulate() skips decoding and fetches only what follows the
+     * displacement; otherwise it fills the slot in. The caller must pass a
+     * filled-in slot back only for the same instruction bytes, decoded with
+     * the same addr_size.
+     */
+    struct x86_emulate_decode *decode;
+
     /* Retirement state, set by the emulator (valid only on X86EMUL_OKAY). */
     union {
         struct {
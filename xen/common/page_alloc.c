@@ -24,6 +24,7 @@
 #include <xen/config.h>
 #include <xen/init.h>
 #include <xen/types.h>
+#include <xen/cpu.h>
 #include <xen/lib.h>
 #include <xen/sched.h>
 #include <xen/spinlock.h>
@@ -233,12 +234,54 @@ static heap_by_zone_and_order_t *_heap[MAX_NUMNODES];
 static unsigned long *avail[MAX_NUMNODES];
 static long total_avail_pages;
 
+/*
+ * Free pages which need scrubbing before reuse, per node.  These are counted
+ * in avail[][] too, and sit at the tail of the free lists (clean blocks are
+ * kept at the head).  Free blocks only merge with buddies of the same kind.
+ */
+static unsigned long node_need_scrub[MAX_NUMNODES];
+
+/* Size of the pieces that dirty free blocks are scrubbed in when idle. */
+#define SCRUB_CHUNK_ORDER 8
+
 /* TMEM: Reserve a fraction of memory for mid-size (0<order<9) allocations.*/
 static long midsize_alloc_zone_pages;
 #define MIDSIZE_ALLOC_FRAC 128
 
 static DEFINE_SPINLOCK(heap_lock);
 
+/*
+ * Per-CPU caches of free order-0 and small-order pages.  Each CPU keeps a
+ * few blocks from its own node, refilled from and drained to the heap in
+ * batches, so that most small allocations and frees do not need heap_lock.
+ *
+ * Cached pages are not in the buddy lists and are not counted in avail[][]
+ * or total_avail_pages.  They stay in PGC_state_inuse, with no owner and no
+ * references, so that the buddy allocator will not merge them and a racing
+ * mark_page_offline() treats them as allocated.  Lock order is a cache's
+ * lock, then heap_lock.
+ */
+#define PAGE_CACHE_MAX_ORDER 3
+#define PAGE_CACHE_BATCH     16 /* Pages moved to or from the heap at once. */
+#define PAGE_CACHE_HIGH      32 /* Pages cached per order before draining. */
+
+#define page_cache_blocks(pages, order) max_t(unsigned int, (pages) >> (order), 1)
+
+struct page_cache {
+    spinlock_t lock;
+    unsigned int node;
+    struct page_list_head list[PAGE_CACHE_MAX_ORDER + 1];
+    unsigned int count[PAGE_CACHE_MAX_ORDER + 1];      /* blocks */
+    unsigned long avail[NR_ZONES];                     /* pages */
+};
+
+static DEFINE_PER_CPU(struct page_cache, page_cache);
+
+/* The caches are only used once boot-time scrubbing is over. */
+#define page_cache_usable(order) \
+    ((order) <= PAGE_CACHE_MAX_ORDER && !opt_tmem && \
+     system_state == SYS_STATE_active)
+
 unsigned long domain_adjust_tot_pages(struct domain *d, long pages)
 {
     ASSERT(spin_is_locked(&d->page_alloc_lock));
@@ -411,18 +454,58 @@ static void check_low_mem_virq(void)
     }
 }
 
+static void heap_list_add(struct page_info *pg, unsigned int node,
+                          unsigned int zone, unsigned int order)
+{
+    if ( pg->count_info & PGC_need_scrub )
+        page_list_add_tail(pg, &heap(node, zone, order));
+    else
+        page_list_add(pg, &heap(node, zone, order));
+}
+
+/* The first block on a free list, if it needs no scrubbing. */
+static struct page_info *first_clean_block(struct page_list_head *list)
+{
+    struct page_info *pg;
+
+    if ( page_list_empty(list) )
+        return NULL;
+    pg = page_list_first(list);
+
+    return (pg->count_info & PGC_need_scrub) ? NULL : pg;
+}
+
+/* Flush TLBs which may still map pages freed at or before @timestamp. */
+static void flush_stale_tlbs(uint32_t tlbflush_timestamp)
+{
+    cpumask_t mask = cpu_online_map;
+
+    tlbflush_filter(mask, tlbflush_timestamp);
+    if ( !cpumask_empty(&mask) )
+    {
+        perfc_incr(need_flush_tlb_flush);
+        flush_tlb_mask(&mask);
+    }
+}
+
+static struct page_info *page_cache_alloc(
+    unsigned int zone_lo, unsigned int zone_hi,
+    unsigned int order, unsigned int node);
+static unsigned long page_cache_drain_all(void);
+static bool_t page_cache_free(struct page_info *pg, unsigned int order);
+
 /* Allocate 2^@order contiguous pages. */
 static struct page_info *alloc_heap_pages(
     unsigned int zone_lo, unsigned int zone_hi,
     unsigned int order, unsigned int memflags,
     struct domain *d)
 {
-    unsigned int first_node, i, j, zone = 0, nodemask_retry = 0;
+    unsigned int first_node, start_node, i, j, zone = 0, nodemask_retry = 0;
     unsigned int node = (uint8_t)((memflags >> _MEMF_node) - 1);
     unsigned long request = 1UL << order;
     struct page_info *pg;
     nodemask_t nodemask = (d != NULL ) ? d->node_affinity : node_online_map;
-    bool_t need_tlbflush = 0;
+    bool_t need_tlbflush = 0, need_scrub = 0, drained = 0;
     uint32_t tlbflush_timestamp = 0;
 
     if ( node == NUMA_NO_NODE )
@@ -437,7 +520,7 @@ static struct page_info *alloc_heap_pages(
         if ( node >= MAX_NUMNODES )
             node = cpu_to_node(smp_processor_id());
     }
-    first_node = node;
+    first_node = start_node = node;
 
     ASSERT(node >= 0);
     ASSERT(zone_lo <= zone_hi);
@@ -446,6 +529,14 @@ static struct page_info *alloc_heap_pages(
     if ( unlikely(order > MAX_ORDER) )
         return NULL;
 
+    if ( (pg = page_cache_alloc(zone_lo, zone_hi, order, node)) != NULL )
+    {
+        if ( d != NULL )
+            d->last_alloc_node = node;
+        return pg;
+    }
+
+ retry:
     spin_lock(&heap_lock);
 
     /*
@@ -474,8 +565,16 @@ static struct page_info *alloc_heap_pages(
 
             /* Find smallest order which can satisfy the request. */
             for ( j = order; j <= MAX_ORDER; j++ )
-                if ( (pg = page_list_remove_head(&heap(node, zone, j))) )
+                if ( (pg = first_clean_block(&heap(node, zone, j))) )
+                    goto found;
+
+            /* Failing that, take a block that we will have to scrub. */
+            for ( j = order; j <= MAX_ORDER; j++ )
+                if ( !page_list_empty(&heap(node, zone, j)) )
+                {
+                    pg = page_list_first(&heap(node, zone, j));
                     goto found;
+                }
         } while ( zone-- > zone_lo ); /* careful: unsigned zone may wrap */
 
         if ( memflags & MEMF_exact_node )
@@ -514,16 +613,29 @@ static struct page_info *alloc_heap_pages(
     }
 
  not_found:
-    /* No suitable memory blocks. Fail the request. */
     spin_unlock(&heap_lock);
+
+    /* Pages held in per-CPU caches may make up the difference. */
+    if ( !drained && page_cache_drain_all() )
+    {
+        drained = 1;
+        first_node = node = start_node;
+        nodemask = (d != NULL ) ? d->node_affinity : node_online_map;
+        nodemask_retry = 0;
+        goto retry;
+    }
+
+    /* No suitable memory blocks. Fail the request. */
     return NULL;
 
  found: 
+    page_list_del(pg, &heap(node, zone, j));
+
     /* We may have to halve the chunk a number of times. */
     while ( j != order )
     {
         PFN_ORDER(pg) = --j;
-        page_list_add_tail(pg, &heap(node, zone, j));
+        heap_list_add(pg, node, zone, j);
         pg += 1 << j;
     }
 
@@ -532,6 +644,13 @@ static struct page_info *alloc_heap_pages(
     total_avail_pages -= request;
     ASSERT(total_avail_pages >= 0);
 
+    if ( pg->count_info & PGC_need_scrub )
+    {
+        need_scrub = 1;
+        ASSERT(node_need_scrub[node] >= request);
+        node_need_scrub[node] -= request;
+    }
+
     check_low_mem_virq();
 
     if ( d != NULL )
@@ -540,7 +659,7 @@ static struct page_info *alloc_heap_pages(
     for ( i = 0; i < (1 << order); i++ )
     {
         /* Reference count must continuously be zero for free pages. */
-        BUG_ON(pg[i].count_info != PGC_state_free);
+        BUG_ON((pg[i].count_info & ~PGC_need_scrub) != PGC_state_free);
         pg[i].count_info = PGC_state_inuse;
 
         if ( pg[i].u.free.need_tlbflush &&
@@ -559,16 +678,12 @@ static struct page_info *alloc_heap_pages(
 
     spin_unlock(&heap_lock);
 
+    if ( need_scrub )
+        for ( i = 0; i < (1 << order); i++ )
+            scrub_one_page(&pg[i]);
+
     if ( need_tlbflush )
-    {
-        cpumask_t mask = cpu_online_map;
-        tlbflush_filter(mask, tlbflush_timestamp);
-        if ( !cpumask_empty(&mask) )
-        {
-            perfc_incr(need_flush_tlb_flush);
-            flush_tlb_mask(&mask);
-        }
-    }
+        flush_stale_tlbs(tlbflush_timestamp);
 
     return pg;
 }
@@ -621,7 +736,7 @@ static int reserve_offlined_page(struct page_info *head)
             {
             merge:
                 /* We don't consider merging outside the head_order. */
-                page_list_add_tail(cur_head, &heap(node, zone, cur_order));
+                heap_list_add(cur_head, node, zone, cur_order);
                 PFN_ORDER(cur_head) = cur_order;
                 cur_head += (1 << cur_order);
                 break;
@@ -638,6 +753,12 @@ static int reserve_offlined_page(struct page_info *head)
         total_avail_pages--;
         ASSERT(total_avail_pages >= 0);
 
+        if ( cur_head->count_info & PGC_need_scrub )
+        {
+            cur_head->count_info &= ~PGC_need_scrub;
+            node_need_scrub[node]--;
+        }
+
         page_list_add_tail(cur_head,
                            test_bit(_PGC_broken, &cur_head->count_info) ?
                            &page_broken_list : &page_offlined_list);
@@ -648,18 +769,28 @@ static int reserve_offlined_page(struct page_info *head)
     return count;
 }
 
-/* Free 2^@order set of pages. */
-static void free_heap_pages(
-    struct page_info *pg, unsigned int order)
+/* Detach a page being freed from its owner, noting any TLB flush needed. */
+static void release_page_owner(struct page_info *pg)
 {
-    unsigned long mask, mfn = page_to_mfn(pg);
+    /* If a page has no owner it will need no safety TLB flush. */
+    pg->u.free.need_tlbflush = (page_get_owner(pg) != NULL);
+    if ( pg->u.free.need_tlbflush )
+        pg->tlbflush_timestamp = tlbflush_current_time();
+
+    /* This page is not a guest frame any more. */
+    page_set_owner(pg, NULL); /* set_gpfn_from_mfn snoops pg owner */
+    set_gpfn_from_mfn(page_to_mfn(pg), INVALID_M2P_ENTRY);
+}
+
+/* Put 2^@order pages, already detached from any owner, in the buddy lists. */
+static void merge_free_pages(
+    struct page_info *pg, unsigned int order, bool_t need_scrub)
+{
+    unsigned long mask;
     unsigned int i, node = phys_to_nid(page_to_maddr(pg)), tainted = 0;
     unsigned int zone = page_to_zone(pg);
 
-    ASSERT(order <= MAX_ORDER);
-    ASSERT(node >= 0);
-
-    spin_lock(&heap_lock);
+    ASSERT(spin_is_locked(&heap_lock));
 
     for ( i = 0; i < (1 << order); i++ )
     {
@@ -678,22 +809,16 @@ static void free_heap_pages(
         pg[i].count_info =
             ((pg[i].count_info & PGC_broken) |
              (page_state_is(&pg[i], offlining)
-              ? PGC_state_offlined : PGC_state_free));
+              ? PGC_state_offlined : PGC_state_free) |
+             (need_scrub ? PGC_need_scrub : 0));
         if ( page_state_is(&pg[i], offlined) )
             tainted = 1;
-
-        /* If a page has no owner it will need no safety TLB flush. */
-        pg[i].u.free.need_tlbflush = (page_get_owner(&pg[i]) != NULL);
-        if ( pg[i].u.free.need_tlbflush )
-            pg[i].tlbflush_timestamp = tlbflush_current_time();
-
-        /* This page is not a guest frame any more. */
-        page_set_owner(&pg[i], NULL); /* set_gpfn_from_mfn snoops pg owner */
-        set_gpfn_from_mfn(mfn + i, INVALID_M2P_ENTRY);
     }
 
     avail[node][zone] += 1 << order;
     total_avail_pages += 1 << order;
+    if ( need_scrub )
+        node_need_scrub[node] += 1 << order;
 
     if ( opt_tmem )
         midsize_alloc_zone_pages = max(
@@ -710,6 +835,7 @@ static void free_heap_pages(
             if ( !mfn_valid(page_to_mfn(pg-mask)) ||
                  !page_state_is(pg-mask, free) ||
                  (PFN_ORDER(pg-mask) != order) ||
+                 (!((pg-mask)->count_info & PGC_need_scrub) != !need_scrub) ||
                  (phys_to_nid(page_to_maddr(pg-mask)) != node) )
                 break;
             pg -= mask;
@@ -721,6 +847,7 @@ static void free_heap_pages(
             if ( !mfn_valid(page_to_mfn(pg+mask)) ||
                  !page_state_is(pg+mask, free) ||
                  (PFN_ORDER(pg+mask) != order) ||
+                 (!((pg+mask)->count_info & PGC_need_scrub) != !need_scrub) ||
                  (phys_to_nid(page_to_maddr(pg+mask)) != node) )
                 break;
             page_list_del(pg + mask, &heap(node, zone, order));
@@ -730,14 +857,354 @@ static void free_heap_pages(
     }
 
     PFN_ORDER(pg) = order;
-    page_list_add_tail(pg, &heap(node, zone, order));
+    heap_list_add(pg, node, zone, order);
 
     if ( tainted )
         reserve_offlined_page(pg);
+}
+
+/*
+ * Free 2^@order set of pages.  If @need_scrub, their contents are scrubbed
+ * later: when idle, or on allocation if that comes first.
+ */
+static void free_heap_pages(
+    struct page_info *pg, unsigned int order, bool_t need_scrub)
+{
+    unsigned int i;
+
+    ASSERT(order <= MAX_ORDER);
+    ASSERT(phys_to_nid(page_to_maddr(pg)) >= 0);
+
+    if ( !need_scrub && page_cache_free(pg, order) )
+        return;
+
+    spin_lock(&heap_lock);
+
+    for ( i = 0; i < (1 << order); i++ )
+        release_page_owner(&pg[i]);
+
+    merge_free_pages(pg, order, need_scrub);
+
+    spin_unlock(&heap_lock);
+}
+
+static void page_cache_init(unsigned int cpu)
+{
+    struct page_cache *pc = &per_cpu(page_cache, cpu);
+    unsigned int order;
+
+    spin_lock_init(&pc->lock);
+    pc->node = cpu_to_node(cpu);
+    for ( order = 0; order <= PAGE_CACHE_MAX_ORDER; order++ )
+    {
+        INIT_PAGE_LIST_HEAD(&pc->list[order]);
+        pc->count[order] = 0;
+    }
+    memset(pc->avail, 0, sizeof(pc->avail));
+}
+
+/* Move up to @nr blocks of 2^@order pages from @pc to its node's heap. */
+static unsigned long page_cache_drain(
+    struct page_cache *pc, unsigned int order, unsigned int nr)
+{
+    struct page_info *pg;
+    unsigned long pages = 0;
+
+    ASSERT(spin_is_locked(&pc->lock));
+
+    spin_lock(&heap_lock);
+
+    /* The least recently freed blocks are at the tail. */
+    for ( ; nr && pc->count[order]; nr--, pc->count[order]-- )
+    {
+        pg = page_list_last(&pc->list[order]);
+        page_list_del(pg, &pc->list[order]);
+        pc->avail[page_to_zone(pg)] -= 1UL << order;
+        merge_free_pages(pg, order, 0);
+        pages += 1UL << order;
+    }
 
     spin_unlock(&heap_lock);
+
+    perfc_incr(page_cache_drain);
+
+    return pages;
 }
 
+static unsigned long page_cache_drain_cpu(unsigned int cpu)
+{
+    struct page_cache *pc = &per_cpu(page_cache, cpu);
+    unsigned long pages = 0;
+    unsigned int order;
+
+    spin_lock(&pc->lock);
+    for ( order = 0; order <= PAGE_CACHE_MAX_ORDER; order++ )
+        if ( pc->count[order] )
+            pages += page_cache_drain(pc, order, pc->count[order]);
+    spin_unlock(&pc->lock);
+
+    return pages;
+}
+
+/* Empty every CPU's cache into the heap, returning the number of pages. */
+static unsigned long page_cache_drain_all(void)
+{
+    unsigned long pages = 0;
+    unsigned int cpu;
+
+    if ( system_state != SYS_STATE_active )
+        return 0;
+
+    for_each_online_cpu ( cpu )
+        pages += page_cache_drain_cpu(cpu);
+
+    return pages;
+}
+
+/*
+ * Move a batch of 2^@order blocks from the heap of @pc's node into @pc,
+ * taking them from zones @zone_lo to @zone_hi.  Returns the number moved.
+ */
+static unsigned int page_cache_refill(
+    struct page_cache *pc, unsigned int zone_lo, unsigned int zone_hi,
+    unsigned int order)
+{
+    unsigned int i, j, zone, node = pc->node;
+    unsigned int nr = page_cache_blocks(PAGE_CACHE_BATCH, order);
+    unsigned long request = 1UL << order;
+    struct page_info *pg;
+
+    ASSERT(spin_is_locked(&pc->lock));
+
+    if ( !avail[node] )
+        return 0;
+
+    spin_lock(&heap_lock);
+
+    for ( i = 0; i < nr; i++ )
+    {
+        /*
+         * As in alloc_heap_pages(), but never looking beyond this node and
+         * leaving blocks which need scrubbing to the heap.
+         */
+        pg = NULL;
+        for ( zone = zone_hi; ; zone-- )
+        {
+            if ( avail[node][zone] >= request )
+                for ( j = order; j <= MAX_ORDER; j++ )
+                    if ( (pg = first_clean_block(&heap(node, zone, j))) )
+                        break;
+            if ( pg || (zone == zone_lo) )
+                break;
+        }
+        if ( !pg )
+            break;
+
+        page_list_del(pg, &heap(node, zone, j));
+
+        while ( j != order )
+        {
+            PFN_ORDER(pg) = --j;
+            heap_list_add(pg, node, zone, j);
+            pg += 1 << j;
+        }
+
+        ASSERT(avail[node][zone] >= request);
+        avail[node][zone] -= request;
+        total_avail_pages -= request;
+        ASSERT(total_avail_pages >= 0);
+
+        for ( j = 0; j < request; j++ )
+        {
+            /* Reference count must continuously be zero for free pages. */
+            BUG_ON(pg[j].count_info != PGC_state_free);
+            pg[j].count_info = PGC_state_inuse;
+        }
+
+        page_list_add_tail(pg, &pc->list[order]);
+        pc->count[order]++;
+        pc->avail[zone] += request;
+    }
+
+    if ( i )
+        check_low_mem_virq();
+
+    spin_unlock(&heap_lock);
+
+    perfc_incr(page_cache_refill);
+
+    return i;
+}
+
+/* Allocate 2^@order pages from this CPU's cache, if it is for @node. */
+static struct page_info *page_cache_alloc(
+    unsigned int zone_lo, unsigned int zone_hi,
+    unsigned int order, unsigned int node)
+{
+    struct page_cache *pc = &this_cpu(page_cache);
+    struct page_info *pg;
+    unsigned int i, zone;
+    bool_t need_tlbflush = 0;
+    uint32_t tlbflush_timestamp = 0;
+
+    if ( !page_cache_usable(order) || (node != pc->node) )
+        return NULL;
+
+    spin_lock(&pc->lock);
+
+    for ( ; ; )
+    {
+        if ( !pc->count[order] &&
+             !page_cache_refill(pc, zone_lo, zone_hi, order) )
+            goto fail;
+
+        /* Leave requests for other zones to the heap. */
+        pg = page_list_first(&pc->list[order]);
+        zone = page_to_zone(pg);
+        if ( (zone < zone_lo) || (zone > zone_hi) )
+            goto fail;
+
+        page_list_del(pg, &pc->list[order]);
+        pc->count[order]--;
+        pc->avail[zone] -= 1UL << order;
+
+        for ( i = 0; i < (1 << order); i++ )
+            if ( pg[i].count_info != PGC_state_inuse )
+                break;
+        if ( i == (1 << order) )
+            break;
+
+        /* Marked for offlining while cached: the heap will take care of it. */
+        spin_lock(&heap_lock);
+        merge_free_pages(pg, order, 0);
+        spin_unlock(&heap_lock);
+    }
+
+    spin_unlock(&pc->lock);
+
+    perfc_incr(page_cache_hit);
+
+    for ( i = 0; i < (1 << order); i++ )
+    {
+        if ( pg[i].u.free.need_tlbflush &&
+             (pg[i].tlbflush_timestamp <= tlbflush_current_time()) &&
+             (!need_tlbflush ||
+              (pg[i].tlbflush_timestamp > tlbflush_timestamp)) )
+        {
+            need_tlbflush = 1;
+            tlbflush_timestamp = pg[i].tlbflush_timestamp;
+        }
+
+        /* Initialise fields which have other uses for free pages. */
+        pg[i].u.inuse.type_info = 0;
+    }
+
+    if ( need_tlbflush )
+        flush_stale_tlbs(tlbflush_timestamp);
+
+    return pg;
+
+ fail:
+    spin_unlock(&pc->lock);
+    return NULL;
+}
+
+/* Free 2^@order pages into this CPU's cache, if it is for their node. */
+static bool_t page_cache_free(struct page_info *pg, unsigned int order)
+{
+    struct page_cache *pc = &this_cpu(page_cache);
+    unsigned long x;
+    unsigned int i, zone;
+
+    if ( !page_cache_usable(order) ||
+         (phys_to_nid(page_to_maddr(pg)) != pc->node) )
+        return 0;
+
+    /*
+     * Pages being offlined, broken or Xen-heap pages go to the heap.  The
+     * others stay in use while cached; the cmpxchg() orders this against a
+     * concurrent mark_page_offline().
+     */
+    for ( i = 0; i < (1 << order); i++ )
+    {
+        x = pg[i].count_info;
+        if ( (x & (PGC_broken | PGC_xen_heap)) ||
+             ((x & PGC_state) != PGC_state_inuse) ||
+             (cmpxchg(&pg[i].count_info, x, PGC_state_inuse) != x) )
+            return 0;
+    }
+
+    for ( i = 0; i < (1 << order); i++ )
+        release_page_owner(&pg[i]);
+
+    zone = page_to_zone(pg);
+
+    spin_lock(&pc->lock);
+
+    page_list_add(pg, &pc->list[order]);
+    pc->count[order]++;
+    pc->avail[zone] += 1UL << order;
+
+    if ( pc->count[order] > page_cache_blocks(PAGE_CACHE_HIGH, order) )
+        page_cache_drain(pc, order, page_cache_blocks(PAGE_CACHE_BATCH, order));
+
+    spin_unlock(&pc->lock);
+
+    return 1;
+}
+
+/* Pages held in the per-CPU caches of online CPUs, for statistics. */
+static unsigned long page_cache_avail(
+    unsigned int zone_lo, unsigned int zone_hi, unsigned int node)
+{
+    unsigned int cpu, zone;
+    unsigned long pages = 0;
+
+    for_each_online_cpu ( cpu )
+    {
+        const struct page_cache *pc = &per_cpu(page_cache, cpu);
+
+        if ( (node == -1) || (node == pc->node) )
+            for ( zone = zone_lo; zone <= zone_hi; zone++ )
+                pages += pc->avail[zone];
+    }
+
+    return pages;
+}
+
+static int cpu_page_cache_callback(
+    struct notifier_block *nfb, unsigned long action, void *hcpu)
+{
+    unsigned int cpu = (unsigned long)hcpu;
+
+    switch ( action )
+    {
+    case CPU_UP_PREPARE:
+        page_cache_init(cpu);
+        break;
+    case CPU_UP_CANCELED:
+    case CPU_DEAD:
+        page_cache_drain_cpu(cpu);
+        break;
+    default:
+        break;
+    }
+
+    return NOTIFY_DONE;
+}
+
+static struct notifier_block cpu_page_cache_nfb = {
+    .notifier_call = cpu_page_cache_callback
+};
+
+static int __init page_cache_presmp_init(void)
+{
+    page_cache_init(smp_processor_id());
+    register_cpu_notifier(&cpu_page_cache_nfb);
+    return 0;
+}
+presmp_initcall(page_cache_presmp_init);
+
 
 /*
  * Following rules applied for page offline:
@@ -845,6 +1312,9 @@ int offline_page(unsigned long mfn, int broken, uint32_t *status)
         return 0;
     }
 
+    /* A free page may be sitting in a per-CPU cache: put it in the heap. */
+    page_cache_drain_all();
+
     spin_lock(&heap_lock);
 
     old_info = mark_page_offline(pg, broken);
@@ -957,8 +1427,9 @@ unsigned int online_page(unsigned long mfn, uint32_t *status)
 
     spin_unlock(&heap_lock);
 
+    /* An offlined page may have been freed without being scrubbed. */
     if ( (y & PGC_state) == PGC_state_offlined )
-        free_heap_pages(pg, 0);
+        free_heap_pages(pg, 0, 1);
 
     return ret;
 }
@@ -1027,7 +1498,7 @@ static void init_heap_pages(
             nr_pages -= n;
         }
 
-        free_heap_pages(pg+i, 0);
+        free_heap_pages(pg+i, 0, 0);
     }
 }
 
@@ -1049,12 +1520,13 @@ static unsigned long avail_heap_pages(
                 free_pages += avail[i][zone];
     }
 
-    return free_pages;
+    return free_pages + page_cache_avail(zone_lo, zone_hi, node);
 }
 
 unsigned long total_free_pages(void)
 {
-    return total_avail_pages - midsize_alloc_zone_pages;
+    return total_avail_pages - midsize_alloc_zone_pages +
+           page_cache_avail(0, NR_ZONES - 1, -1);
 }
 
 void __init end_boot_allocator(void)
@@ -1144,6 +1616,112 @@ void __init scrub_heap_pages(void)
     setup_low_mem_virq();
 }
 
+/*
+ * Take a piece of at most 2^SCRUB_CHUNK_ORDER pages which need scrubbing
+ * off @node's free lists, returning it in use.  The heap gets it back, clean,
+ * from merge_free_pages().
+ */
+static struct page_info *take_scrub_chunk(unsigned int node,
+                                          unsigned int *order)
+{
+    struct page_info *pg;
+    unsigned int i, j, zone;
+
+    ASSERT(spin_is_locked(&heap_lock));
+
+    for ( zone = 0; zone < NR_ZONES; zone++ )
+        for ( j = 0; j <= MAX_ORDER; j++ )
+        {
+            if ( page_list_empty(&heap(node, zone, j)) )
+                continue;
+            pg = page_list_last(&heap(node, zone, j));
+            if ( !(pg->count_info & PGC_need_scrub) )
+                continue;
+
+            page_list_del(pg, &heap(node, zone, j));
+            while ( j > SCRUB_CHUNK_ORDER )
+            {
+                PFN_ORDER(pg) = --j;
+                heap_list_add(pg, node, zone, j);
+                pg += 1 << j;
+            }
+
+            avail[node][zone] -= 1UL << j;
+            total_avail_pages -= 1UL << j;
+            node_need_scrub[node] -= 1UL << j;
+
+            for ( i = 0; i < (1 << j); i++ )
+            {
+                BUG_ON(pg[i].count_info != (PGC_state_free | PGC_need_scrub));
+                pg[i].count_info = PGC_state_inuse;
+            }
+
+            *order = j;
+            return pg;
+        }
+
+    return NULL;
+}
+
+/*
+ * Scrub free pages left dirty by dying domains, starting with this CPU's
+ * node, until the CPU has something else to do.  Called from the idle loop;
+ * returns whether any scrubbing was done.
+ */
+bool_t scrub_free_pages(void)
+{
+    unsigned int cpu = smp_processor_id(), local = cpu_to_node(cpu);
+    unsigned int node = local, order, i;
+    struct page_info *pg;
+    bool_t scrubbed = 0;
+
+    while ( cpu_is_haltable(cpu) )
+    {
+        pg = NULL;
+
+        /* Lockless peek: nothing to do is the common case. */
+        if ( node_need_scrub[node] )
+        {
+            spin_lock(&heap_lock);
+            pg = take_scrub_chunk(node, &order);
+            spin_unlock(&heap_lock);
+        }
+
+        if ( !pg )
+        {
+            if ( (node = next_node(node, node_online_map)) >= MAX_NUMNODES )
+                node = first_node(node_online_map);
+            if ( node == local )
+                break;
+            continue;
+        }
+
+        for ( i = 0; i < (1 << order); i++ )
+            scrub_one_page(&pg[i]);
+
+        spin_lock(&heap_lock);
+        merge_free_pages(pg, order, 0);
+        spin_unlock(&heap_lock);
+
+        perfc_incr(page_scrub_idle);
+        scrubbed = 1;
+    }
+
+    return scrubbed;
+}
+
+/* Free pages still waiting to be scrubbed. */
+unsigned long avail_scrub_pages(void)
+{
+    unsigned long pages = 0;
+    unsigned int node;
+
+    for_each_online_node ( node )
+        pages += node_need_scrub[node];
+
+    return pages;
+}
+
 
 
 /*************************
@@ -1200,7 +1778,7 @@ void free_xenheap_pages(void *v, unsigned int order)
 
     memguard_guard_range(v, 1 << (order + PAGE_SHIFT));
 
-    free_heap_pages(virt_to_page(v), order);
+    free_heap_pages(virt_to_page(v), order, 0);
 }
 
 #else
@@ -1242,7 +1820,7 @@ void free_xenheap_pages(void *v, unsigned int order)
     for ( i = 0; i < (1u << order); i++ )
         pg[i].count_info &= ~PGC_xen_heap;
 
-    free_heap_pages(pg, order);
+    free_heap_pages(pg, order, 0);
 }
 
 #endif
@@ -1343,7 +1921,7 @@ struct page_info *alloc_domheap_pages(
 
     if ( (d != NULL) && assign_pages(d, pg, order, memflags) )
     {
-        free_heap_pages(pg, order);
+        free_heap_pages(pg, order, 0);
         return NULL;
     }
     
@@ -1389,25 +1967,21 @@ void free_domheap_pages(struct page_info *pg, unsigned int order)
         /*
          * Normally we expect a domain to clear pages before freeing them, if 
          * it cares about the secrecy of their contents. However, after a 
-         * domain has died we assume responsibility for erasure.
+         * domain has died we assume responsibility for erasure.  This is
+         * done in the background, so as not to hold up domain destruction.
          */
-        if ( unlikely(d->is_dying) )
-            for ( i = 0; i < (1 << order); i++ )
-                scrub_one_page(&pg[i]);
-
-        free_heap_pages(pg, order);
+        free_heap_pages(pg, order, d->is_dying != DOMDYING_alive);
     }
     else if ( unlikely(d == dom_cow) )
     {
         ASSERT(order == 0); 
-        scrub_one_page(pg);
-        free_heap_pages(pg, 0);
+        free_heap_pages(pg, 0, 1);
         drop_dom_ref = 0;
     }
     else
     {
         /* Freeing anonymous domain-heap pages. */
-        free_heap_pages(pg, order);
+        free_heap_pages(pg, order, 0);
         drop_dom_ref = 0;
     }
 
@@ -1467,6 +2041,10 @@ static void pagealloc_info(unsigned char key)
     }
 
     printk("    Dom heap: %lukB free\n", total << (PAGE_SHIFT-10));
+    printk("    Scrub backlog: %lukB\n",
+           avail_scrub_pages() << (PAGE_SHIFT-10));
+    printk("    Per-CPU caches: %lukB free\n",
+           page_cache_avail(0, NR_ZONES - 1, -1) << (PAGE_SHIFT-10));
 }
 
 static struct keyhandler pagealloc_info_keyhandler = {
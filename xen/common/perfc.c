@@ -14,10 +14,13 @@
 #define PERFCOUNTER_ARRAY( var, name, size )  { name, TYPE_ARRAY,  size },
 #define PERFSTATUS( var, name )               { name, TYPE_S_SINGLE, 0 },
 #define PERFSTATUS_ARRAY( var, name, size )   { name, TYPE_S_ARRAY,  size },
+#define PERFCOUNTER_HISTO( var, name )        \
+    { name, TYPE_HISTO, PERFC_HISTO_BUCKETS },
 static const struct {
     const char *name;
     enum { TYPE_SINGLE, TYPE_ARRAY,
-           TYPE_S_SINGLE, TYPE_S_ARRAY
+           TYPE_S_SINGLE, TYPE_S_ARRAY,
+           TYPE_HISTO
     } type;
     unsigned int nr_elements;
 } perfc_info[] = {
@@ -38,7 +41,7 @@ void perfc_printall(unsigned char key)
 
     for ( i = j = 0; i < NR_PERFCTRS; i++ )
     {
-        unsigned int k, cpu;
+        unsigned int k, cpu, shown;
         unsigned long long sum = 0;
 
         printk("%-32s  ",  perfc_info[i].name);
@@ -111,6 +114,29 @@ void perfc_printall(unsigned char key)
             }
             j += perfc_info[i].nr_elements;
             break;
+        case TYPE_HISTO:
+            for ( k = 0; k < perfc_info[i].nr_elements; k++ )
+                for_each_online_cpu ( cpu )
+                    sum += per_cpu(perfcounters, cpu)[j + k];
+            printk("TOTAL[%12Lu]", sum);
+            /* Only the buckets in use, labelled by their lower bound. */
+            for ( shown = k = 0; sum && k < perfc_info[i].nr_elements; k++ )
+            {
+                unsigned long long bucket = 0;
+
+                for_each_online_cpu ( cpu )
+                    bucket += per_cpu(perfcounters, cpu)[j + k];
+                if ( !bucket )
+                    continue;
+                if ( (shown++ % 4) == 0 )
+                    printk("\n%16s", "");
+                if ( k )
+                    printk("  >=2^%02u[%10Lu]", k - 1, bucket);
+                else
+                    printk("  %6s[%10Lu]", "0", bucket);
+            }
+            j += perfc_info[i].nr_elements;
+            break;
         }
         printk("\n");
     }
@@ -140,6 +166,7 @@ void perfc_reset(unsigned char key)
             ++j;
             break;
         case TYPE_ARRAY:
+        case TYPE_HISTO:
             for_each_online_cpu ( cpu )
                 memset(per_cpu(perfcounters, cpu) + j, 0,
                        perfc_info[i].nr_elements * sizeof(perfc_t));
@@ -174,6 +201,7 @@ static int perfc_copy_info(XEN_GUEST_HANDLE_64(xen_sysctl_perfc_desc_t) desc,
         for ( i = 0; i < NR_PERFCTRS; i++ )
         {
             safe_strcpy(perfc_d[i].name, perfc_info[i].name);
+            perfc_d[i].flags = 0;
 
             switch ( perfc_info[i].type )
             {
@@ -181,6 +209,9 @@ static int perfc_copy_info(XEN_GUEST_HANDLE_64(xen_sysctl_perfc_desc_t) desc,
             case TYPE_S_SINGLE:
                 perfc_d[i].nr_vals = nr_cpus;
                 break;
+            case TYPE_HISTO:
+                perfc_d[i].flags = XEN_SYSCTL_PERFC_histogram;
+                /* fall through */
             case TYPE_ARRAY:
             case TYPE_S_ARRAY:
                 perfc_d[i].nr_vals = perfc_info[i].nr_elements;
@@ -217,6 +248,7 @@ static int perfc_copy_info(XEN_GUEST_HANDLE_64(xen_sysctl_perfc_desc_t) desc,
             break;
         case TYPE_ARRAY:
         case TYPE_S_ARRAY:
+        case TYPE_HISTO:
             memset(perfc_vals + v, 0, perfc_d[i].nr_vals * sizeof(*perfc_vals));
             for_each_cpu ( cpu, &perfc_cpumap )
             {
@@ -10,11 +10,12 @@
 #include <xen/sched.h>
 #include <xen/errno.h>
 #include <xen/rangeset.h>
+#include <xen/rbtree.h>
 #include <xsm/xsm.h>
 
-/* An inclusive range [s,e] and pointer to next range in ascending order. */
+/* An inclusive range [s,e], a node in its rangeset's tree keyed on s. */
 struct range {
-    struct list_head list;
+    struct rb_node node;
     unsigned long s, e;
 };
 
@@ -23,8 +24,8 @@ struct rangeset {
     struct list_head rangeset_list;
     struct domain   *domain;
 
-    /* Ordered list of ranges contained in this set, and protecting lock. */
-    struct list_head range_list;
+    /* Ordered tree of ranges contained in this set, and protecting lock. */
+    struct rb_root   range_tree;
     spinlock_t       lock;
 
     /* Pretty-printing name. */
@@ -35,20 +36,28 @@ struct rangeset {
 };
 
 /*****************************
- * Private range functions hide the underlying linked-list implemnetation.
+ * Private range functions hide the underlying red-black tree implementation.
+ * Ranges in a set never overlap, so ordering by start address orders them
+ * completely.
  */
 
 /* Find highest range lower than or containing s. NULL if no such range. */
 static struct range *find_range(
     struct rangeset *r, unsigned long s)
 {
+    struct rb_node *node = r->range_tree.rb_node;
     struct range *x = NULL, *y;
 
-    list_for_each_entry ( y, &r->range_list, list )
+    while ( node != NULL )
     {
+        y = rb_entry(node, struct range, node);
         if ( y->s > s )
-            break;
-        x = y;
+            node = node->rb_left;
+        else
+        {
+            x = y;
+            node = node->rb_right;
+        }
     }
 
     return x;
@@ -58,32 +67,59 @@ static struct range *find_range(
 static struct range *first_range(
     struct rangeset *r)
 {
-    if ( list_empty(&r->range_list) )
-        return NULL;
-    return list_entry(r->range_list.next, struct range, list);
+    struct rb_node *node = rb_first(&r->range_tree);
+
+    return (node != NULL) ? rb_entry(node, struct range, node) : NULL;
 }
 
 /* Return range following x in ascending order, or NULL if x is the highest. */
 static struct range *next_range(
     struct rangeset *r, struct range *x)
 {
-    if ( x->list.next == &r->range_list )
-        return NULL;
-    return list_entry(x->list.next, struct range, list);
+    struct rb_node *node = rb_next(&x->node);
+
+    return (node != NULL) ? rb_entry(node, struct range, node) : NULL;
 }
 
-/* Insert range y after range x in r. Insert as first range if x is NULL. */
+/*
+ * Insert range y after range x in r. Insert as first range if x is NULL.
+ * y must fall between x and the range following it.
+ */
 static void insert_range(
     struct rangeset *r, struct range *x, struct range *y)
 {
-    list_add(&y->list, (x != NULL) ? &x->list : &r->range_list);
+    struct rb_node **link, *parent;
+
+    if ( x == NULL )
+    {
+        /* New lowest range: leftmost position in the tree. */
+        parent = NULL;
+        for ( link = &r->range_tree.rb_node; *link; link = &(*link)->rb_left )
+            parent = *link;
+    }
+    else if ( x->node.rb_right == NULL )
+    {
+        parent = &x->node;
+        link = &parent->rb_right;
+    }
+    else
+    {
+        /* Leftmost position in x's right subtree, just before x's successor. */
+        parent = x->node.rb_right;
+        while ( parent->rb_left != NULL )
+            parent = parent->rb_left;
+        link = &parent->rb_left;
+    }
+
+    rb_link_node(&y->node, parent, link);
+    rb_insert_color(&y->node, &r->range_tree);
 }
 
-/* Remove a range from its list and free it. */
+/* Remove a range from its tree and free it. */
 static void destroy_range(
-    struct range *x)
+    struct rangeset *r, struct range *x)
 {
-    list_del(&x->list);
+    rb_erase(&x->node, &r->range_tree);
     xfree(x);
 }
 
@@ -143,7 +179,7 @@ int rangeset_add_range(
             y = next_range(r, x);
             if ( (y == NULL) || (y->e > x->e) )
                 break;
-            destroy_range(y);
+            destroy_range(r, y);
         }
     }
 
@@ -151,7 +187,7 @@ int rangeset_add_range(
     if ( (y != NULL) && ((x->e + 1) == y->s) )
     {
         x->e = y->e;
-        destroy_range(y);
+        destroy_range(r, y);
     }
 
  out:
@@ -193,7 +229,7 @@ int rangeset_remove_range(
             insert_range(r, x, y);
         }
         else if ( (x->s == s) && (x->e <= e) )
-            destroy_range(x);
+            destroy_range(r, x);
         else if ( x->s == s )
             x->s = e + 1;
         else if ( x->e <= e )
@@ -206,7 +242,9 @@ int rangeset_remove_range(
 
         if ( x->s < s )
         {
-            x->e = s - 1;
+            /* Trim x only if it reaches into [s,e]. */
+            if ( x->e >= s )
+                x->e = s - 1;
             x = next_range(r, x);
         }
 
@@ -214,12 +252,12 @@ int rangeset_remove_range(
         {
             t = x;
             x = next_range(r, x);
-            destroy_range(t);
+            destroy_range(r, t);
         }
 
         x->s = e + 1;
         if ( x->s > x->e )
-            destroy_range(x);
+            destroy_range(r, x);
     }
 
  out:
@@ -268,7 +306,11 @@ int rangeset_report_ranges(
 
     spin_lock(&r->lock);
 
-    for ( x = find_range(r, s); x && (x->s <= e) && !rc; x = next_range(r, x) )
+    /* Ranges starting within [s,e] count even if none starts below s. */
+    if ( (x = find_range(r, s)) == NULL )
+        x = first_range(r);
+
+    for ( ; x && (x->s <= e) && !rc; x = next_range(r, x) )
         if ( x->e >= s )
             rc = cb(max(x->s, s), min(x->e, e), ctxt);
 
@@ -298,7 +340,7 @@ int rangeset_contains_singleton(
 int rangeset_is_empty(
     struct rangeset *r)
 {
-    return ((r == NULL) || list_empty(&r->range_list));
+    return ((r == NULL) || RB_EMPTY_ROOT(&r->range_tree));
 }
 
 struct rangeset *rangeset_new(
@@ -311,7 +353,7 @@ struct rangeset *rangeset_new(
         return NULL;
 
     spin_lock_init(&r->lock);
-    INIT_LIST_HEAD(&r->range_list);
+    r->range_tree = RB_ROOT;
 
     BUG_ON(flags & ~RANGESETF_prettyprint_hex);
     r->flags = flags;
@@ -351,7 +393,7 @@ void rangeset_destroy(
     }
 
     while ( (x = first_range(r)) != NULL )
-        destroy_range(x);
+        destroy_range(r, x);
 
     xfree(r);
 }
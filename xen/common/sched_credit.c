@@ -32,6 +32,7 @@
 /* Default timeslice: 30ms */
 #define CSCHED_DEFAULT_TSLICE_MS    30
 #define CSCHED_CREDITS_PER_MSEC     10
+#define CSCHED_ACCT_SHARDS          32
 
 
 /*
@@ -122,6 +123,7 @@ integer_param("sched_credit_tslice_ms", sched_credit_tslice_ms);
 struct csched_pcpu {
     struct list_head runq;
     uint32_t runq_sort_last;
+    uint32_t acct_epoch;    /* No shards left to account in this period */
     struct timer ticker;
     unsigned int tick;
     unsigned int idle_bias;
@@ -162,6 +164,38 @@ struct csched_dom {
     uint16_t active_vcpu_count;
     uint16_t weight;
     uint16_t cap;
+    bool_t acct_peaked;     /* Reached its peak credit last period */
+};
+
+/*
+ * Accounting shard
+ *
+ * Active domains are spread over the shards by domain ID.  A shard's lock
+ * covers its list of active domains and their lists of active vcpus, so
+ * that vcpus become active and idle, and are accounted, without the
+ * scheduler-wide lock.  Each accounting period, every shard is accounted
+ * once, by whichever CPU gets to it first.
+ */
+struct csched_acct_shard {
+    spinlock_t lock;
+    struct list_head active_sdom;
+    uint32_t epoch;              /* Last accounting period done */
+    /* Results of that period */
+    int credit_balance;          /* Credit left on the shard's vcpus */
+    uint32_t credit_unused;      /* Fair share beyond domains' peak */
+    uint32_t weight_unpeaked;    /* Weight of domains below their peak */
+    s_time_t time;               /* Time taken to account the shard */
+} __cacheline_aligned;
+
+/*
+ * Inputs to an accounting period, set by the master when it starts one.
+ */
+struct csched_acct_period {
+    uint32_t weight;
+    uint32_t credit;
+    int credit_balance;
+    uint32_t credit_unused;
+    uint32_t weight_unpeaked;
 };
 
 /*
@@ -170,16 +204,20 @@ struct csched_dom {
 struct csched_private {
     /* lock for the whole pluggable scheduler, nests inside cpupool_lock */
     spinlock_t lock;
-    struct list_head active_sdom;
+    struct csched_acct_shard shard[CSCHED_ACCT_SHARDS];
     uint32_t ncpus;
     struct timer  master_ticker;
     unsigned int master;
     cpumask_var_t idlers;
     cpumask_var_t cpus;
-    uint32_t weight;
+    atomic_t weight;
     uint32_t credit;
     int credit_balance;
-    uint32_t runq_sort;
+    atomic_t runq_sort;
+    /* Current accounting period, and the inputs to it (and the last one) */
+    uint32_t acct_epoch;
+    struct csched_acct_period acct[2];
+    s_time_t acct_time_last, acct_time_max;
     unsigned ratelimit_us;
     /* Period of master and tick in milliseconds */
     unsigned tslice_ms, tick_period_us, ticks_per_tslice;
@@ -189,6 +227,12 @@ struct csched_private {
 static void csched_tick(void *_cpu);
 static void csched_acct(void *dummy);
 
+static inline struct csched_acct_shard *
+csched_dom_shard(struct csched_private *prv, const struct csched_dom *sdom)
+{
+    return &prv->shard[sdom->dom->domain_id % CSCHED_ACCT_SHARDS];
+}
+
 static inline int
 __vcpu_on_runq(struct csched_vcpu *svc)
 {
@@ -403,7 +447,8 @@ csched_alloc_pdata(const struct scheduler *ops, int cpu)
     set_timer(&spc->ticker, NOW() + MICROSECS(prv->tick_period_us) );
 
     INIT_LIST_HEAD(&spc->runq);
-    spc->runq_sort_last = prv->runq_sort;
+    spc->runq_sort_last = atomic_read(&prv->runq_sort);
+    spc->acct_epoch = prv->acct_epoch;
     spc->idle_bias = nr_cpu_ids - 1;
     if ( per_cpu(schedule_data, cpu).sched_priv == NULL )
         per_cpu(schedule_data, cpu).sched_priv = spc;
@@ -592,9 +637,10 @@ static inline void
 __csched_vcpu_acct_start(struct csched_private *prv, struct csched_vcpu *svc)
 {
     struct csched_dom * const sdom = svc->sdom;
+    struct csched_acct_shard * const shard = csched_dom_shard(prv, sdom);
     unsigned long flags;
 
-    spin_lock_irqsave(&prv->lock, flags);
+    spin_lock_irqsave(&shard->lock, flags);
 
     if ( list_empty(&svc->active_vcpu_elem) )
     {
@@ -604,17 +650,17 @@ __csched_vcpu_acct_start(struct csched_private *prv, struct csched_vcpu *svc)
         sdom->active_vcpu_count++;
         list_add(&svc->active_vcpu_elem, &sdom->active_vcpu);
         /* Make weight per-vcpu */
-        prv->weight += sdom->weight;
+        atomic_add(sdom->weight, &prv->weight);
         if ( list_empty(&sdom->active_sdom_elem) )
         {
-            list_add(&sdom->active_sdom_elem, &prv->active_sdom);
+            list_add(&sdom->active_sdom_elem, &shard->active_sdom);
         }
     }
 
     TRACE_3D(TRC_CSCHED_ACCOUNT_START, sdom->dom->domain_id,
              svc->vcpu->vcpu_id, sdom->active_vcpu_count);
 
-    spin_unlock_irqrestore(&prv->lock, flags);
+    spin_unlock_irqrestore(&shard->lock, flags);
 }
 
 static inline void
@@ -624,14 +670,15 @@ __csched_vcpu_acct_stop_locked(struct csched_private *prv,
     struct csched_dom * const sdom = svc->sdom;
 
     BUG_ON( list_empty(&svc->active_vcpu_elem) );
+    ASSERT( spin_is_locked(&csched_dom_shard(prv, sdom)->lock) );
 
     SCHED_VCPU_STAT_CRANK(svc, state_idle);
     SCHED_STAT_CRANK(acct_vcpu_idle);
 
-    BUG_ON( prv->weight < sdom->weight );
+    BUG_ON( atomic_read(&prv->weight) < sdom->weight );
     sdom->active_vcpu_count--;
     list_del_init(&svc->active_vcpu_elem);
-    prv->weight -= sdom->weight;
+    atomic_sub(sdom->weight, &prv->weight);
     if ( list_empty(&sdom->active_vcpu) )
     {
         list_del_init(&sdom->active_sdom_elem);
@@ -733,6 +780,7 @@ csched_vcpu_remove(const struct scheduler *ops, struct vcpu *vc)
     struct csched_private *prv = CSCHED_PRIV(ops);
     struct csched_vcpu * const svc = CSCHED_VCPU(vc);
     struct csched_dom * const sdom = svc->sdom;
+    struct csched_acct_shard *shard;
     unsigned long flags;
 
     SCHED_STAT_CRANK(vcpu_destroy);
@@ -740,14 +788,16 @@ csched_vcpu_remove(const struct scheduler *ops, struct vcpu *vc)
     if ( __vcpu_on_runq(svc) )
         __runq_remove(svc);
 
-    spin_lock_irqsave(&(prv->lock), flags);
+    BUG_ON( sdom == NULL );
+    shard = csched_dom_shard(prv, sdom);
+
+    spin_lock_irqsave(&shard->lock, flags);
 
     if ( !list_empty(&svc->active_vcpu_elem) )
         __csched_vcpu_acct_stop_locked(prv, svc);
 
-    spin_unlock_irqrestore(&(prv->lock), flags);
+    spin_unlock_irqrestore(&shard->lock, flags);
 
-    BUG_ON( sdom == NULL );
     BUG_ON( !list_empty(&svc->runq_elem) );
 }
 
@@ -838,11 +888,12 @@ csched_dom_cntl(
 {
     struct csched_dom * const sdom = CSCHED_DOM(d);
     struct csched_private *prv = CSCHED_PRIV(ops);
+    struct csched_acct_shard * const shard = csched_dom_shard(prv, sdom);
     unsigned long flags;
 
-    /* Protect both get and put branches with the pluggable scheduler
-     * lock. Runq lock not needed anywhere in here. */
-    spin_lock_irqsave(&prv->lock, flags);
+    /* Protect both get and put branches with the domain's accounting
+     * shard lock. Runq lock not needed anywhere in here. */
+    spin_lock_irqsave(&shard->lock, flags);
 
     if ( op->cmd == XEN_DOMCTL_SCHEDOP_getinfo )
     {
@@ -856,10 +907,8 @@ csched_dom_cntl(
         if ( op->u.credit.weight != 0 )
         {
             if ( !list_empty(&sdom->active_sdom_elem) )
-            {
-                prv->weight -= sdom->weight * sdom->active_vcpu_count;
-                prv->weight += op->u.credit.weight * sdom->active_vcpu_count;
-            }
+                atomic_add((op->u.credit.weight - sdom->weight) *
+                           sdom->active_vcpu_count, &prv->weight);
             sdom->weight = op->u.credit.weight;
         }
 
@@ -868,7 +917,7 @@ csched_dom_cntl(
 
     }
 
-    spin_unlock_irqrestore(&prv->lock, flags);
+    spin_unlock_irqrestore(&shard->lock, flags);
 
     return 0;
 }
@@ -969,7 +1018,7 @@ csched_runq_sort(struct csched_private *prv, unsigned int cpu)
     unsigned long flags;
     int sort_epoch;
 
-    sort_epoch = prv->runq_sort;
+    sort_epoch = atomic_read(&prv->runq_sort);
     if ( sort_epoch == spc->runq_sort_last )
         return;
 
@@ -1003,63 +1052,48 @@ csched_runq_sort(struct csched_private *prv, unsigned int cpu)
     pcpu_schedule_unlock_irqrestore(cpu, flags);
 }
 
+/*
+ * Account the vcpus of one shard's active domains for an accounting
+ * period, with the inputs the master worked out when it started the
+ * period.  Called with the shard locked.
+ */
 static void
-csched_acct(void* dummy)
+csched_acct_shard(struct csched_private *prv, struct csched_acct_shard *shard,
+                  uint32_t epoch, const struct csched_acct_period *period)
 {
-    struct csched_private *prv = dummy;
-    unsigned long flags;
     struct list_head *iter_vcpu, *next_vcpu;
     struct list_head *iter_sdom, *next_sdom;
     struct csched_vcpu *svc;
     struct csched_dom *sdom;
-    uint32_t credit_total;
+    s_time_t start = NOW();
+    uint32_t weight;
     uint32_t weight_total;
-    uint32_t weight_left;
+    uint32_t weight_unpeaked;
+    uint32_t credit_unused;
     uint32_t credit_fair;
     uint32_t credit_peak;
     uint32_t credit_cap;
     int credit_balance;
-    int credit_xtra;
     int credit;
 
+    ASSERT( spin_is_locked(&shard->lock) );
 
-    spin_lock_irqsave(&prv->lock, flags);
-
-    weight_total = prv->weight;
-    credit_total = prv->credit;
-
-    /* Converge balance towards 0 when it drops negative */
-    if ( prv->credit_balance < 0 )
-    {
-        credit_total -= prv->credit_balance;
-        SCHED_STAT_CRANK(acct_balance);
-    }
-
-    if ( unlikely(weight_total == 0) )
-    {
-        prv->credit_balance = 0;
-        spin_unlock_irqrestore(&prv->lock, flags);
-        SCHED_STAT_CRANK(acct_no_work);
-        goto out;
-    }
-
-    SCHED_STAT_CRANK(acct_run);
-
-    weight_left = weight_total;
     credit_balance = 0;
-    credit_xtra = 0;
+    credit_unused = 0;
+    weight_unpeaked = 0;
     credit_cap = 0U;
 
-    list_for_each_safe( iter_sdom, next_sdom, &prv->active_sdom )
+    list_for_each_safe( iter_sdom, next_sdom, &shard->active_sdom )
     {
         sdom = list_entry(iter_sdom, struct csched_dom, active_sdom_elem);
 
         BUG_ON( is_idle_domain(sdom->dom) );
         BUG_ON( sdom->active_vcpu_count == 0 );
         BUG_ON( sdom->weight == 0 );
-        BUG_ON( (sdom->weight * sdom->active_vcpu_count) > weight_left );
 
-        weight_left -= ( sdom->weight * sdom->active_vcpu_count );
+        weight = sdom->weight * sdom->active_vcpu_count;
+        /* The domain may have become active since the period started. */
+        weight_total = max(period->weight, weight);
 
         /*
          * A domain's fair share is computed using its weight in competition
@@ -1070,11 +1104,9 @@ csched_acct(void* dummy)
          * only when the system-wide credit balance is negative.
          */
         credit_peak = sdom->active_vcpu_count * prv->credits_per_tslice;
-        if ( prv->credit_balance < 0 )
+        if ( period->credit_balance < 0 )
         {
-            credit_peak += ( ( -prv->credit_balance
-                               * sdom->weight
-                               * sdom->active_vcpu_count) +
+            credit_peak += ( ( -period->credit_balance * weight ) +
                              (weight_total - 1)
                            ) / weight_total;
         }
@@ -1090,40 +1122,33 @@ csched_acct(void* dummy)
                          ) / sdom->active_vcpu_count;
         }
 
-        credit_fair = ( ( credit_total
-                          * sdom->weight
-                          * sdom->active_vcpu_count )
-                        + (weight_total - 1)
+        credit_fair = ( ( period->credit * weight ) + (weight_total - 1)
                       ) / weight_total;
 
         if ( credit_fair < credit_peak )
         {
-            credit_xtra = 1;
-        }
-        else
-        {
-            if ( weight_left != 0U )
-            {
-                /* Give other domains a chance at unused credits */
-                credit_total += ( ( ( credit_fair - credit_peak
-                                    ) * weight_total
-                                  ) + ( weight_left - 1 )
-                                ) / weight_left;
-            }
+            weight_unpeaked += weight;
 
-            if ( credit_xtra )
+            /*
+             * Give domains which could use more than their fair share the
+             * credits which domains at their peak could not use last period,
+             * in proportion to their weight.
+             */
+            if ( !sdom->acct_peaked && period->weight_unpeaked != 0 )
             {
-                /*
-                 * Lazily keep domains with extra credits at the head of
-                 * the queue to give others a chance at them in future
-                 * accounting periods.
-                 */
-                SCHED_STAT_CRANK(acct_reorder);
-                list_del(&sdom->active_sdom_elem);
-                list_add(&sdom->active_sdom_elem, &prv->active_sdom);
+                credit_fair += ( ( period->credit_unused * weight ) +
+                                 (period->weight_unpeaked - 1)
+                               ) / period->weight_unpeaked;
+                if ( credit_fair > credit_peak )
+                    credit_fair = credit_peak;
             }
-
+            sdom->acct_peaked = 0;
+        }
+        else
+        {
+            credit_unused += credit_fair - credit_peak;
             credit_fair = credit_peak;
+            sdom->acct_peaked = 1;
         }
 
         /* Compute fair share per VCPU */
@@ -1200,14 +1225,151 @@ csched_acct(void* dummy)
         }
     }
 
-    prv->credit_balance = credit_balance;
+    shard->credit_balance = credit_balance;
+    shard->credit_unused = credit_unused;
+    shard->weight_unpeaked = weight_unpeaked;
+    shard->epoch = epoch;
+    shard->time = NOW() - start;
 
-    spin_unlock_irqrestore(&prv->lock, flags);
+    SCHED_STAT_CRANK(acct_shard);
 
     /* Inform each CPU that its runq needs to be sorted */
-    prv->runq_sort++;
+    atomic_inc(&prv->runq_sort);
+}
+
+/* Get the current accounting period, and its inputs. */
+static uint32_t
+csched_acct_period(const struct csched_private *prv,
+                   struct csched_acct_period *period)
+{
+    uint32_t epoch;
+
+    /*
+     * The master writes the inputs for period n + 1 into acct[(n + 1) & 1]
+     * before it starts the period: if the period is still the same after
+     * the copy, the master has not started on the inputs we copied.
+     */
+    do {
+        epoch = prv->acct_epoch;
+        smp_rmb();
+        *period = prv->acct[epoch & 1];
+        smp_rmb();
+    } while ( epoch != prv->acct_epoch );
+
+    return epoch;
+}
+
+/*
+ * Account shards for the current period, from a CPU's tick.  Each CPU
+ * starts with its own shard and does at most two per tick.  Shards
+ * another CPU is working on are skipped, not waited for.
+ */
+static void
+csched_acct_shards(struct csched_private *prv, unsigned int cpu)
+{
+    struct csched_pcpu * const spc = CSCHED_PCPU(cpu);
+    struct csched_acct_period period;
+    struct csched_acct_shard *shard;
+    uint32_t current_epoch = prv->acct_epoch, epoch;
+    unsigned int i, done = 0;
+    unsigned long flags;
+
+    if ( spc->acct_epoch == current_epoch )
+        return;
+
+    for ( i = 0; i < CSCHED_ACCT_SHARDS && done < 2; i++ )
+    {
+        shard = &prv->shard[(cpu + i) % CSCHED_ACCT_SHARDS];
+        if ( shard->epoch == current_epoch ||
+             !spin_trylock_irqsave(&shard->lock, flags) )
+            continue;
+
+        epoch = csched_acct_period(prv, &period);
+        if ( shard->epoch != epoch )
+        {
+            csched_acct_shard(prv, shard, epoch, &period);
+            done++;
+        }
+
+        spin_unlock_irqrestore(&shard->lock, flags);
+    }
+
+    if ( i == CSCHED_ACCT_SHARDS )
+        spc->acct_epoch = current_epoch;
+}
+
+/*
+ * Start a new accounting period.
+ *
+ * The master only finishes any shards no CPU got round to in the period
+ * just over (when most CPUs are idle, their ticks are stopped), sums up the
+ * shards' results, and works out the inputs to the next period.
+ */
+static void
+csched_acct(void* dummy)
+{
+    struct csched_private *prv = dummy;
+    struct csched_acct_shard *shard;
+    struct csched_acct_period period;
+    uint32_t epoch = prv->acct_epoch;
+    int credit_balance = 0;
+    s_time_t time = 0;
+    unsigned long flags;
+    unsigned int i;
+
+    memset(&period, 0, sizeof(period));
+
+    for ( i = 0; i < CSCHED_ACCT_SHARDS; i++ )
+    {
+        shard = &prv->shard[i];
+
+        spin_lock_irqsave(&shard->lock, flags);
+
+        if ( shard->epoch != epoch )
+        {
+            SCHED_STAT_CRANK(acct_shard_master);
+            csched_acct_shard(prv, shard, epoch, &prv->acct[epoch & 1]);
+        }
+        credit_balance += shard->credit_balance;
+        period.credit_unused += shard->credit_unused;
+        period.weight_unpeaked += shard->weight_unpeaked;
+        time += shard->time;
+
+        spin_unlock_irqrestore(&shard->lock, flags);
+    }
+
+    prv->acct_time_last = time;
+    if ( time > prv->acct_time_max )
+        prv->acct_time_max = time;
+    perfc_add(acct_time_us, time / MICROSECS(1));
+
+    period.weight = atomic_read(&prv->weight);
+    period.credit = prv->credit;
+
+    if ( unlikely(period.weight == 0) )
+    {
+        credit_balance = 0;
+        SCHED_STAT_CRANK(acct_no_work);
+    }
+    else
+    {
+        SCHED_STAT_CRANK(acct_run);
+
+        /* Converge balance towards 0 when it drops negative */
+        if ( credit_balance < 0 )
+        {
+            period.credit -= credit_balance;
+            SCHED_STAT_CRANK(acct_balance);
+        }
+    }
+
+    prv->credit_balance = credit_balance;
+    period.credit_balance = credit_balance;
+
+    prv->acct[(epoch + 1) & 1] = period;
+    smp_wmb();
+    prv->acct_epoch = epoch + 1;
 
-out:
     set_timer( &prv->master_ticker,
                NOW() + MILLISECS(prv->tslice_ms));
 }
@@ -1227,12 +1389,17 @@ csched_tick(void *_cpu)
     if ( !is_idle_vcpu(current) )
         csched_vcpu_acct(prv, cpu);
 
+    /*
+     * Help account this period's shards
+     */
+    csched_acct_shards(prv, cpu);
+
     /*
      * Check if runq needs to be sorted
      *
-     * Every physical CPU resorts the runq after the accounting master has
-     * modified priorities. This is a special O(n) sort and runs at most
-     * once per accounting period (currently 30 milliseconds).
+     * Every physical CPU resorts the runq after shards have been accounted
+     * and priorities modified. This is a special O(n) sort and runs at
+     * most once per tick.
      */
     csched_runq_sort(prv, cpu);
 
@@ -1293,9 +1460,9 @@ csched_load_balance(struct csched_private *prv, int cpu,
     struct csched_vcpu *snext, bool_t *stolen)
 {
     struct csched_vcpu *speer;
-    cpumask_t workers;
+    cpumask_t workers, near;
     cpumask_t *online;
-    int peer_cpu;
+    int peer_cpu, step;
 
     BUG_ON( cpu != snext->vcpu->processor );
     online = cpupool_scheduler_cpumask(per_cpu(cpupool, cpu));
@@ -1312,41 +1479,62 @@ csched_load_balance(struct csched_private *prv, int cpu,
         SCHED_STAT_CRANK(load_balance_other);
 
     /*
-     * Peek at non-idling CPUs in the system, starting with our
-     * immediate neighbour.
+     * Peek at non-idling CPUs in the system, nearest first: our thread
+     * siblings, the rest of our socket, the rest of our node, and then
+     * everyone else.  At each step, start with our immediate neighbour.
      */
     cpumask_andnot(&workers, online, prv->idlers);
     cpumask_clear_cpu(cpu, &workers);
-    peer_cpu = cpu;
 
-    while ( !cpumask_empty(&workers) )
+    for ( step = 0; step < 4 && !cpumask_empty(&workers); step++ )
     {
-        peer_cpu = cpumask_cycle(peer_cpu, &workers);
-        cpumask_clear_cpu(peer_cpu, &workers);
-
-        /*
-         * Get ahold of the scheduler lock for this peer CPU.
-         *
-         * Note: We don't spin on this lock but simply try it. Spinning could
-         * cause a deadlock if the peer CPU is also load balancing and trying
-         * to lock this CPU.
-         */
-        if ( !pcpu_schedule_trylock(peer_cpu) )
+        switch ( step )
         {
-            SCHED_STAT_CRANK(steal_trylock_failed);
-            continue;
+        case 0:
+            cpumask_and(&near, &workers, per_cpu(cpu_sibling_mask, cpu));
+            break;
+        case 1:
+            cpumask_and(&near, &workers, per_cpu(cpu_core_mask, cpu));
+            break;
+        case 2:
+            cpumask_and(&near, &workers, &node_to_cpumask(cpu_to_node(cpu)));
+            break;
+        default:
+            cpumask_copy(&near, &workers);
+            break;
         }
+        cpumask_andnot(&workers, &workers, &near);
+        peer_cpu = cpu;
 
-        /*
-         * Any work over there to steal?
-         */
-        speer = cpumask_test_cpu(peer_cpu, online) ?
-            csched_runq_steal(peer_cpu, cpu, snext->pri) : NULL;
-        pcpu_schedule_unlock(peer_cpu);
-        if ( speer != NULL )
+        while ( !cpumask_empty(&near) )
         {
-            *stolen = 1;
-            return speer;
+            peer_cpu = cpumask_cycle(peer_cpu, &near);
+            cpumask_clear_cpu(peer_cpu, &near);
+
+            /*
+             * Get ahold of the scheduler lock for this peer CPU.
+             *
+             * Note: We don't spin on this lock but simply try it. Spinning
+             * could cause a deadlock if the peer CPU is also load balancing
+             * and trying to lock this CPU.
+             */
+            if ( !pcpu_schedule_trylock(peer_cpu) )
+            {
+                SCHED_STAT_CRANK(steal_trylock_failed);
+                continue;
+            }
+
+            /*
+             * Any work over there to steal?
+             */
+            speer = cpumask_test_cpu(peer_cpu, online) ?
+                csched_runq_steal(peer_cpu, cpu, snext->pri) : NULL;
+            pcpu_schedule_unlock(peer_cpu);
+            if ( speer != NULL )
+            {
+                *stolen = 1;
+                return speer;
+            }
         }
     }
 
@@ -1560,7 +1748,8 @@ csched_dump(const struct scheduler *ops)
 {
     struct list_head *iter_sdom, *iter_svc;
     struct csched_private *prv = CSCHED_PRIV(ops);
-    int loop;
+    struct csched_acct_shard *shard;
+    int loop, i;
     unsigned long flags;
 
     spin_lock_irqsave(&(prv->lock), flags);
@@ -1574,6 +1763,8 @@ csched_dump(const struct scheduler *ops)
            "\tcredit balance     = %d\n"
            "\tweight             = %u\n"
            "\trunq_sort          = %u\n"
+           "\tacct period        = %u\n"
+           "\tacct time          = %"PRI_stime"us (max %"PRI_stime"us)\n"
            "\tdefault-weight     = %d\n"
            "\ttslice             = %dms\n"
            "\tratelimit          = %dus\n"
@@ -1584,8 +1775,11 @@ csched_dump(const struct scheduler *ops)
            prv->master,
            prv->credit,
            prv->credit_balance,
-           prv->weight,
-           prv->runq_sort,
+           atomic_read(&prv->weight),
+           atomic_read(&prv->runq_sort),
+           prv->acct_epoch,
+           prv->acct_time_last / MICROSECS(1),
+           prv->acct_time_max / MICROSECS(1),
            CSCHED_DEFAULT_WEIGHT,
            prv->tslice_ms,
            prv->ratelimit_us,
@@ -1598,19 +1792,27 @@ csched_dump(const struct scheduler *ops)
 
     printk("active vcpus:\n");
     loop = 0;
-    list_for_each( iter_sdom, &prv->active_sdom )
+    for ( i = 0; i < CSCHED_ACCT_SHARDS; i++ )
     {
-        struct csched_dom *sdom;
-        sdom = list_entry(iter_sdom, struct csched_dom, active_sdom_elem);
+        shard = &prv->shard[i];
+        spin_lock(&shard->lock);
 
-        list_for_each( iter_svc, &sdom->active_vcpu )
+        list_for_each( iter_sdom, &shard->active_sdom )
         {
-            struct csched_vcpu *svc;
-            svc = list_entry(iter_svc, struct csched_vcpu, active_vcpu_elem);
+            struct csched_dom *sdom;
+            sdom = list_entry(iter_sdom, struct csched_dom, active_sdom_elem);
 
-            printk("\t%3d: ", ++loop);
-            csched_dump_vcpu(svc);
+            list_for_each( iter_svc, &sdom->active_vcpu )
+            {
+                struct csched_vcpu *svc;
+                svc = list_entry(iter_svc, struct csched_vcpu, active_vcpu_elem);
+
+                printk("\t%3d: ", ++loop);
+                csched_dump_vcpu(svc);
+            }
         }
+
+        spin_unlock(&shard->lock);
     }
 #undef idlers_buf
 
@@ -1621,6 +1823,7 @@ static int
 csched_init(struct scheduler *ops)
 {
     struct csched_private *prv;
+    int i;
 
     prv = xzalloc(struct csched_private);
     if ( prv == NULL )
@@ -1635,7 +1838,11 @@ csched_init(struct scheduler *ops)
 
     ops->sched_data = prv;
     spin_lock_init(&prv->lock);
-    INIT_LIST_HEAD(&prv->active_sdom);
+    for ( i = 0; i < CSCHED_ACCT_SHARDS; i++ )
+    {
+        spin_lock_init(&prv->shard[i].lock);
+        INIT_LIST_HEAD(&prv->shard[i].active_sdom);
+    }
     prv->master = UINT_MAX;
 
     if ( sched_credit_tslice_ms > XEN_SYSCTL_CSCHED_TSLICE_MAX
@@ -25,6 +25,7 @@
 #include <xen/errno.h>
 #include <xen/trace.h>
 #include <xen/cpu.h>
+#include <xen/rbtree.h>
 
 #define d2printk(x...)
 //#define d2printk printk
@@ -203,7 +204,7 @@ struct csched_runqueue_data {
     spinlock_t lock;      /* Lock for this runqueue. */
     cpumask_t active;      /* CPUs enabled for this runqueue */
 
-    struct list_head runq; /* Ordered list of runnable vms */
+    struct rb_root runq;   /* Runnable vms, ordered by credit */
     struct list_head svc;  /* List of all vcpus assigned to this runqueue */
     int max_weight;
 
@@ -237,7 +238,7 @@ struct csched_private {
 struct csched_vcpu {
     struct list_head rqd_elem;  /* On the runqueue data list */
     struct list_head sdom_elem; /* On the domain vcpu list */
-    struct list_head runq_elem; /* On the runqueue         */
+    struct rb_node runq_elem;   /* On the runqueue         */
     struct csched_runqueue_data *rqd; /* Up-pointer to the runqueue */
 
     /* Up-pointers */
@@ -290,13 +291,26 @@ static s_time_t c2t(struct csched_runqueue_data *rqd, s_time_t credit, struct cs
 static /*inline*/ int
 __vcpu_on_runq(struct csched_vcpu *svc)
 {
-    return !list_empty(&svc->runq_elem);
+    return !RB_EMPTY_NODE(&svc->runq_elem);
 }
 
 static /*inline*/ struct csched_vcpu *
-__runq_elem(struct list_head *elem)
+__runq_elem(struct rb_node *elem)
 {
-    return list_entry(elem, struct csched_vcpu, runq_elem);
+    return elem ? rb_entry(elem, struct csched_vcpu, runq_elem) : NULL;
+}
+
+/* Highest credit vcpu on the runqueue, or NULL if it is empty */
+static inline struct csched_vcpu *
+__runq_first(struct csched_runqueue_data *rqd)
+{
+    return __runq_elem(rb_first(&rqd->runq));
+}
+
+static inline struct csched_vcpu *
+__runq_next(struct csched_vcpu *svc)
+{
+    return __runq_elem(rb_next(&svc->runq_elem));
 }
 
 static void
@@ -398,11 +412,16 @@ update_load(const struct scheduler *ops,
         __update_svc_load(ops, svc, change, now);
 }
 
-static int
-__runq_insert(struct list_head *runq, struct csched_vcpu *svc)
+/*
+ * The runqueue is a red-black tree whose in-order walk gives the vcpus in
+ * order of decreasing credit; vcpus with equal credit are kept in the order
+ * in which they were queued.  reset_credit() changes the credit of queued
+ * vcpus, but in a way which never reorders them.
+ */
+static void
+__runq_insert(struct rb_root *runq, struct csched_vcpu *svc)
 {
-    struct list_head *iter;
-    int pos = 0;
+    struct rb_node **node = &runq->rb_node, *parent = NULL;
 
     d2printk("rqi d%dv%d\n",
            svc->vcpu->domain->domain_id,
@@ -414,22 +433,28 @@ __runq_insert(struct list_head *runq, struct csched_vcpu *svc)
     BUG_ON(svc->vcpu->is_running);
     BUG_ON(test_bit(__CSFLAG_scheduled, &svc->flags));
 
-    list_for_each( iter, runq )
+    while ( *node )
     {
-        struct csched_vcpu * iter_svc = __runq_elem(iter);
-
-        if ( svc->credit > iter_svc->credit )
-        {
-            d2printk(" p%d d%dv%d\n",
-                   pos,
-                   iter_svc->vcpu->domain->domain_id,
-                   iter_svc->vcpu->vcpu_id);
-            break;
-        }
-        pos++;
+        parent = *node;
+        if ( svc->credit > __runq_elem(parent)->credit )
+            node = &parent->rb_left;
+        else
+            node = &parent->rb_right;
     }
 
-    list_add_tail(&svc->runq_elem, iter);
+    rb_link_node(&svc->runq_elem, parent, node);
+    rb_insert_color(&svc->runq_elem, runq);
+}
+
+/* Position of a queued vcpu, for tracing: linear in the queue length. */
+static unsigned int
+__runq_pos(struct csched_vcpu *svc)
+{
+    struct rb_node *iter = &svc->runq_elem;
+    unsigned int pos = 0;
+
+    while ( (iter = rb_prev(iter)) != NULL )
+        pos++;
 
     return pos;
 }
@@ -437,16 +462,16 @@ __runq_insert(struct list_head *runq, struct csched_vcpu *svc)
 static void
 runq_insert(const struct scheduler *ops, unsigned int cpu, struct csched_vcpu *svc)
 {
-    struct list_head * runq = &RQD(ops, cpu)->runq;
-    int pos = 0;
+    struct rb_root * runq = &RQD(ops, cpu)->runq;
 
     ASSERT( spin_is_locked(per_cpu(schedule_data, cpu).schedule_lock) );
 
     BUG_ON( __vcpu_on_runq(svc) );
     BUG_ON( c2r(ops, cpu) != c2r(ops, svc->vcpu->processor) );
 
-    pos = __runq_insert(runq, svc);
+    __runq_insert(runq, svc);
 
+    if ( unlikely(tb_init_done) )
     {
         struct {
             unsigned dom:16,vcpu:16;
@@ -454,7 +479,7 @@ runq_insert(const struct scheduler *ops, unsigned int cpu, struct csched_vcpu *s
         } d;
         d.dom = svc->vcpu->domain->domain_id;
         d.vcpu = svc->vcpu->vcpu_id;
-        d.pos = pos;
+        d.pos = __runq_pos(svc);
         trace_var(TRC_CSCHED2_RUNQ_POS, 0,
                   sizeof(d),
                   (unsigned char *)&d);
@@ -467,7 +492,8 @@ static inline void
 __runq_remove(struct csched_vcpu *svc)
 {
     BUG_ON( !__vcpu_on_runq(svc) );
-    list_del_init(&svc->runq_elem);
+    rb_erase(&svc->runq_elem, &svc->rqd->runq);
+    RB_CLEAR_NODE(&svc->runq_elem);
 }
 
 void burn_credits(struct csched_runqueue_data *rqd, struct csched_vcpu *, s_time_t);
@@ -734,7 +760,7 @@ csched_alloc_vdata(const struct scheduler *ops, struct vcpu *vc, void *dd)
 
     INIT_LIST_HEAD(&svc->rqd_elem);
     INIT_LIST_HEAD(&svc->sdom_elem);
-    INIT_LIST_HEAD(&svc->runq_elem);
+    RB_CLEAR_NODE(&svc->runq_elem);
 
     svc->sdom = dd;
     svc->vcpu = vc;
@@ -872,7 +898,7 @@ csched_vcpu_remove(const struct scheduler *ops, struct vcpu *vc)
     struct csched_dom * const sdom = svc->sdom;
 
     BUG_ON( sdom == NULL );
-    BUG_ON( !list_empty(&svc->runq_elem) );
+    BUG_ON( __vcpu_on_runq(svc) );
 
     if ( ! is_idle_vcpu(vc) )
     {
@@ -1507,7 +1533,7 @@ csched_runtime(const struct scheduler *ops, int cpu, struct csched_vcpu *snext)
 {
     s_time_t time = CSCHED_MAX_TIMER;
     struct csched_runqueue_data *rqd = RQD(ops, cpu);
-    struct list_head *runq = &rqd->runq;
+    struct csched_vcpu *svc;
 
     if ( is_idle_vcpu(snext->vcpu) )
         return CSCHED_MAX_TIMER;
@@ -1516,9 +1542,8 @@ csched_runtime(const struct scheduler *ops, int cpu, struct csched_vcpu *snext)
     time = c2t(rqd, snext->credit, snext);
 
     /* Next guy on runqueue */
-    if ( ! list_empty(runq) )
+    if ( (svc = __runq_first(rqd)) != NULL )
     {
-        struct csched_vcpu *svc = __runq_elem(runq->next);
         s_time_t ntime;
 
         if ( ! is_idle_vcpu(svc->vcpu) )
@@ -1549,8 +1574,7 @@ runq_candidate(struct csched_runqueue_data *rqd,
                struct csched_vcpu *scurr,
                int cpu, s_time_t now)
 {
-    struct list_head *iter;
-    struct csched_vcpu *snext = NULL;
+    struct csched_vcpu *svc, *snext = NULL;
 
     /* Default to current if runnable, idle otherwise */
     if ( vcpu_runnable(scurr->vcpu) )
@@ -1558,10 +1582,8 @@ runq_candidate(struct csched_runqueue_data *rqd,
     else
         snext = CSCHED_VCPU(idle_vcpu[cpu]);
 
-    list_for_each( iter, &rqd->runq )
+    for ( svc = __runq_first(rqd); svc != NULL; svc = __runq_next(svc) )
     {
-        struct csched_vcpu * svc = list_entry(iter, struct csched_vcpu, runq_elem);
-
         /* If this is on a different processor, don't pull it unless
          * its credit is at least CSCHED_MIGRATE_RESIST higher. */
         if ( svc->vcpu->processor != cpu
@@ -1760,14 +1782,14 @@ csched_dump_vcpu(struct csched_vcpu *svc)
 static void
 csched_dump_pcpu(const struct scheduler *ops, int cpu)
 {
-    struct list_head *runq, *iter;
+    struct csched_runqueue_data *rqd;
     struct csched_vcpu *svc;
     int loop;
     char cpustr[100];
 
     /* FIXME: Do locking properly for access to runqueue structures */
 
-    runq = &RQD(ops, cpu)->runq;
+    rqd = RQD(ops, cpu);
 
     cpumask_scnprintf(cpustr, sizeof(cpustr), per_cpu(cpu_sibling_mask, cpu));
     printk(" sibling=%s, ", cpustr);
@@ -1783,14 +1805,10 @@ csched_dump_pcpu(const struct scheduler *ops, int cpu)
     }
 
     loop = 0;
-    list_for_each( iter, runq )
+    for ( svc = __runq_first(rqd); svc != NULL; svc = __runq_next(svc) )
     {
-        svc = __runq_elem(iter);
-        if ( svc )
-        {
-            printk("\t%3d: ", ++loop);
-            csched_dump_vcpu(svc);
-        }
+        printk("\t%3d: ", ++loop);
+        csched_dump_vcpu(svc);
     }
 }
 
@@ -1859,7 +1877,7 @@ static void activate_runqueue(struct csched_private *prv, int rqi)
     rqd->max_weight = 1;
     rqd->id = rqi;
     INIT_LIST_HEAD(&rqd->svc);
-    INIT_LIST_HEAD(&rqd->runq);
+    rqd->runq = RB_ROOT;
     spin_lock_init(&rqd->lock);
 
     cpumask_set_cpu(rqi, &prv->active_queues);
@@ -689,11 +689,11 @@ static long do_poll(struct sched_poll *sched_poll)
             goto out;
 
         rc = -EINVAL;
-        if ( port >= MAX_EVTCHNS(d) )
+        if ( !port_is_valid(d, port) )
             goto out;
 
         rc = 0;
-        if ( test_bit(port, &shared_info(d, evtchn_pending)) )
+        if ( evtchn_port_is_pending(d, evtchn_from_port(d, port)) )
             goto out;
     }
 
@@ -1083,6 +1083,7 @@ static void schedule(void)
     struct schedule_data *sd;
     struct task_slice     next_slice;
     int cpu = smp_processor_id();
+    cycles_t start = perfc_time_start();
 
     ASSERT(!in_atomic());
 
@@ -1126,6 +1127,7 @@ static void schedule(void)
     {
         pcpu_schedule_unlock_irq(cpu);
         trace_continue_running(next);
+        perfc_time_end(schedule_cycles, start);
         return continue_running(prev);
     }
 
@@ -1175,6 +1177,9 @@ static void schedule(void)
     update_vcpu_system_time(next);
     vcpu_periodic_timer_work(next);
 
+    /* context_switch() doesn't return: count up to it. */
+    perfc_time_end(schedule_cycles, start);
+
     context_switch(prev, next);
 }
 
@@ -6,6 +6,10 @@
 #include <xen/spinlock.h>
 #include <xen/guest_access.h>
 #include <xen/preempt.h>
+#include <xen/rcupdate.h>
+#include <xen/sched.h>
+#include <xen/symbols.h>
+#include <xen/xmalloc.h>
 #include <public/sysctl.h>
 #include <asm/processor.h>
 #include <asm/atomic.h>
@@ -115,23 +119,239 @@ void spin_debug_disable(void)
 
 #endif
 
+/*
+ * Runtime contention sampling, see XEN_SYSCTL_LOCKPROF_sample_*.  Samples
+ * are kept in a fixed open-addressed table keyed by lock and call site.
+ * Entries are only ever added (under lock_sample_insert_lock), so lookups
+ * need no locking.  A reset swaps in a fresh table and frees the old one
+ * once RCU readers are done with it, never clearing one in use.  The
+ * counters in an entry are
+ * updated by whichever CPU took the sample, without atomics: an update can
+ * occasionally be lost, which is fine for a statistical profile, and
+ * keeps sampling cheap.  When sampling is disabled the lock and unlock
+ * paths only test lock_sample_enabled.
+ */
+#define LOCK_SAMPLE_ENTRIES 1024      /* power of 2 */
+#define LOCK_SAMPLE_PROBES  16
+#define LOCK_SAMPLE_DEPTH   4         /* sampled locks held at once per CPU */
+
+struct lock_sample {
+    bool_t      valid;
+    spinlock_t *lock;
+    void       *site;
+    u64         sampled, contended;
+    u64         hold_time, wait_time;
+    u32         hold_hist[XEN_SYSCTL_LOCKPROF_BUCKETS];
+    u32         wait_hist[XEN_SYSCTL_LOCKPROF_BUCKETS];
+};
+
+struct lock_sample_table {
+    struct rcu_head    rcu;
+    s_time_t           start;
+    unsigned int       dropped;
+    struct lock_sample entry[LOCK_SAMPLE_ENTRIES];
+};
+
+struct lock_sample_held {
+    spinlock_t         *lock;
+    struct lock_sample *entry;
+    s_time_t            locked;
+    unsigned int        gen;
+};
+
+static bool_t __read_mostly lock_sample_enabled;
+static unsigned int __read_mostly lock_sample_period;
+/* Bumped on enable and reset, to forget samples still held at the time. */
+static unsigned int __read_mostly lock_sample_gen;
+static struct lock_sample_table *lock_samples;
+static DEFINE_RCU_READ_LOCK(lock_sample_rcu_lock);
+static raw_spinlock_t lock_sample_insert_lock = _RAW_SPIN_LOCK_UNLOCKED;
+static DEFINE_PER_CPU(unsigned int, lock_sample_countdown);
+static DEFINE_PER_CPU(struct lock_sample_held[LOCK_SAMPLE_DEPTH],
+                      lock_sample_held);
+
+/* Sample one acquisition in every lock_sample_period: boot parameter. */
+static unsigned int __initdata opt_lock_sample;
+integer_param("lock_sample", opt_lock_sample);
+
+static unsigned int lock_sample_bucket(s_time_t t)
+{
+    u64 v = t > 0 ? t : 0;
+    unsigned int b = (v >> 32) ? 32 + fls(v >> 32) : fls((u32)v);
+
+    return min(b, XEN_SYSCTL_LOCKPROF_BUCKETS - 1U);
+}
+
+static struct lock_sample *lock_sample_find(struct lock_sample_table *t,
+                                            spinlock_t *lock, void *site)
+{
+    u32 hash = ((unsigned long)lock >> 2) ^ (unsigned long)site;
+    unsigned int i, idx, start = (hash * 0x9e370001U) >> (32 - 10);
+    struct lock_sample *e;
+    unsigned long flags;
+
+    BUILD_BUG_ON(LOCK_SAMPLE_ENTRIES != 1 << 10);
+
+    for ( i = 0; i < LOCK_SAMPLE_PROBES; i++ )
+    {
+        e = &t->entry[(start + i) & (LOCK_SAMPLE_ENTRIES - 1)];
+        if ( !e->valid )
+            break;
+        smp_rmb();
+        if ( e->lock == lock && e->site == site )
+            return e;
+    }
+    if ( i == LOCK_SAMPLE_PROBES )
+        return NULL;
+
+    /* Not there: insert it, unless another CPU just did. */
+    local_irq_save(flags);
+    while ( !_raw_spin_trylock(&lock_sample_insert_lock) )
+        cpu_relax();
+    for ( e = NULL; i < LOCK_SAMPLE_PROBES; i++ )
+    {
+        idx = (start + i) & (LOCK_SAMPLE_ENTRIES - 1);
+        if ( !t->entry[idx].valid )
+        {
+            e = &t->entry[idx];
+            e->lock = lock;
+            e->site = site;
+            smp_wmb();
+            e->valid = 1;
+            break;
+        }
+        if ( t->entry[idx].lock == lock && t->entry[idx].site == site )
+        {
+            e = &t->entry[idx];
+            break;
+        }
+    }
+    _raw_spin_unlock(&lock_sample_insert_lock);
+    local_irq_restore(flags);
+
+    return e;
+}
+
+static void lock_sample_got(spinlock_t *lock, s_time_t wait, void *site)
+{
+    unsigned int *countdown = &this_cpu(lock_sample_countdown);
+    struct lock_sample_held *held = this_cpu(lock_sample_held);
+    struct lock_sample_table *t;
+    struct lock_sample *e;
+    bool_t sample = 0;
+    s_time_t now;
+    unsigned long flags;
+    unsigned int i;
+
+    if ( *countdown > 1 )
+        --*countdown;
+    else
+    {
+        *countdown = lock_sample_period;
+        sample = 1;
+    }
+    if ( !sample && !wait )
+        return;
+
+    now = NOW();
+    rcu_read_lock(&lock_sample_rcu_lock);
+    t = rcu_dereference(lock_samples);
+    if ( t == NULL )
+        goto out;
+    e = lock_sample_find(t, lock, site);
+    if ( e == NULL )
+    {
+        t->dropped++;
+        goto out;
+    }
+
+    if ( wait )
+    {
+        e->contended++;
+        e->wait_time += now - wait;
+        e->wait_hist[lock_sample_bucket(now - wait)]++;
+    }
+
+    if ( !sample )
+        goto out;
+
+    /* Interrupts may sample locks of their own on this CPU. */
+    local_irq_save(flags);
+    for ( i = 0; i < LOCK_SAMPLE_DEPTH; i++ )
+        if ( held[i].lock == NULL || held[i].gen != lock_sample_gen )
+        {
+            held[i].entry = e;
+            held[i].locked = now;
+            held[i].gen = lock_sample_gen;
+            held[i].lock = lock;
+            break;
+        }
+    local_irq_restore(flags);
+
+ out:
+    rcu_read_unlock(&lock_sample_rcu_lock);
+}
+
+static void lock_sample_rel(spinlock_t *lock)
+{
+    struct lock_sample_held *held = this_cpu(lock_sample_held);
+    struct lock_sample *e;
+    s_time_t hold;
+    unsigned int i;
+
+    for ( i = 0; i < LOCK_SAMPLE_DEPTH; i++ )
+        if ( held[i].lock == lock )
+            break;
+    if ( i == LOCK_SAMPLE_DEPTH )
+        return;
+
+    held[i].lock = NULL;
+
+    /* A reset since the lock was taken may be freeing the entry's table. */
+    rcu_read_lock(&lock_sample_rcu_lock);
+    if ( held[i].gen == lock_sample_gen )
+    {
+        e = held[i].entry;
+        hold = NOW() - held[i].locked;
+        e->sampled++;
+        e->hold_time += hold;
+        e->hold_hist[lock_sample_bucket(hold)]++;
+    }
+    rcu_read_unlock(&lock_sample_rcu_lock);
+}
+
+#define LOCK_SAMPLE_VAR    s_time_t wait = 0
+#define LOCK_SAMPLE_BLOCK                                                    \
+    if ( unlikely(lock_sample_enabled) && !wait )                            \
+        wait = NOW()
+#define LOCK_SAMPLE_GOT                                                      \
+    if ( unlikely(lock_sample_enabled) )                                     \
+        lock_sample_got(lock, wait, __builtin_return_address(0))
+#define LOCK_SAMPLE_REL                                                      \
+    if ( unlikely(lock_sample_enabled) )                                     \
+        lock_sample_rel(lock)
+
 void _spin_lock(spinlock_t *lock)
 {
+    LOCK_SAMPLE_VAR;
     LOCK_PROFILE_VAR;
 
     check_lock(&lock->debug);
     while ( unlikely(!_raw_spin_trylock(&lock->raw)) )
     {
         LOCK_PROFILE_BLOCK;
+        LOCK_SAMPLE_BLOCK;
         while ( likely(_raw_spin_is_locked(&lock->raw)) )
             cpu_relax();
     }
     LOCK_PROFILE_GOT;
+    LOCK_SAMPLE_GOT;
     preempt_disable();
 }
 
 void _spin_lock_irq(spinlock_t *lock)
 {
+    LOCK_SAMPLE_VAR;
     LOCK_PROFILE_VAR;
 
     ASSERT(local_irq_is_enabled());
@@ -140,18 +360,21 @@ void _spin_lock_irq(spinlock_t *lock)
     while ( unlikely(!_raw_spin_trylock(&lock->raw)) )
     {
         LOCK_PROFILE_BLOCK;
+        LOCK_SAMPLE_BLOCK;
         local_irq_enable();
         while ( likely(_raw_spin_is_locked(&lock->raw)) )
             cpu_relax();
         local_irq_disable();
     }
     LOCK_PROFILE_GOT;
+    LOCK_SAMPLE_GOT;
     preempt_disable();
 }
 
 unsigned long _spin_lock_irqsave(spinlock_t *lock)
 {
     unsigned long flags;
+    LOCK_SAMPLE_VAR;
     LOCK_PROFILE_VAR;
 
     local_irq_save(flags);
@@ -159,12 +382,14 @@ unsigned long _spin_lock_irqsave(spinlock_t *lock)
     while ( unlikely(!_raw_spin_trylock(&lock->raw)) )
     {
         LOCK_PROFILE_BLOCK;
+        LOCK_SAMPLE_BLOCK;
         local_irq_restore(flags);
         while ( likely(_raw_spin_is_locked(&lock->raw)) )
             cpu_relax();
         local_irq_save(flags);
     }
     LOCK_PROFILE_GOT;
+    LOCK_SAMPLE_GOT;
     preempt_disable();
     return flags;
 }
@@ -173,6 +398,7 @@ void _spin_unlock(spinlock_t *lock)
 {
     preempt_enable();
     LOCK_PROFILE_REL;
+    LOCK_SAMPLE_REL;
     _raw_spin_unlock(&lock->raw);
 }
 
@@ -180,6 +406,7 @@ void _spin_unlock_irq(spinlock_t *lock)
 {
     preempt_enable();
     LOCK_PROFILE_REL;
+    LOCK_SAMPLE_REL;
     _raw_spin_unlock(&lock->raw);
     local_irq_enable();
 }
@@ -188,6 +415,7 @@ void _spin_unlock_irqrestore(spinlock_t *lock, unsigned long flags)
 {
     preempt_enable();
     LOCK_PROFILE_REL;
+    LOCK_SAMPLE_REL;
     _raw_spin_unlock(&lock->raw);
     local_irq_restore(flags);
 }
@@ -207,6 +435,8 @@ int _spin_trylock(spinlock_t *lock)
     if (lock->profile)
         lock->profile->time_locked = NOW();
 #endif
+    if ( unlikely(lock_sample_enabled) )
+        lock_sample_got(lock, 0, __builtin_return_address(0));
     preempt_disable();
     return 1;
 }
@@ -531,33 +761,6 @@ static void spinlock_profile_ucopy_elem(struct lock_profile *data,
         p->pc->nr_elem++;
 }
 
-/* Dom0 control of lock profiling */
-int spinlock_profile_control(xen_sysctl_lockprof_op_t *pc)
-{
-    int rc = 0;
-    spinlock_profile_ucopy_t par;
-
-    switch ( pc->cmd )
-    {
-    case XEN_SYSCTL_LOCKPROF_reset:
-        spinlock_profile_reset('\0');
-        break;
-    case XEN_SYSCTL_LOCKPROF_query:
-        pc->nr_elem = 0;
-        par.rc = 0;
-        par.pc = pc;
-        spinlock_profile_iterate(spinlock_profile_ucopy_elem, &par);
-        pc->time = NOW() - lock_profile_start;
-        rc = par.rc;
-        break;
-    default:
-        rc = -EINVAL;
-        break;
-    }
-
-    return rc;
-}
-
 void _lock_profile_register_struct(
     int32_t type, struct lock_profile_qhead *qhead, int32_t idx, char *name)
 {
@@ -606,3 +809,194 @@ static int __init lock_prof_init(void)
 __initcall(lock_prof_init);
 
 #endif /* LOCK_PROFILE */
+
+static void lock_sample_free(struct rcu_head *rcu)
+{
+    xfree(container_of(rcu, struct lock_sample_table, rcu));
+}
+
+static int lock_sample_reset(void)
+{
+    struct lock_sample_table *t = xzalloc(struct lock_sample_table);
+
+    if ( t == NULL )
+        return -ENOMEM;
+    t->start = NOW();
+
+    /*
+     * Other CPUs may still be updating the old table: they don't pass a
+     * quiescent state while doing so.  Samples of locks held across the
+     * swap are dropped, by the generation no longer matching.  Hide the
+     * pointer's origin, or gcc takes xchg()'s dummy access to overrun it.
+     */
+    t = xchg(RELOC_HIDE(&lock_samples, 0), t);
+    smp_wmb();
+    lock_sample_gen++;
+    if ( t != NULL )
+        call_rcu(&t->rcu, lock_sample_free);
+
+    return 0;
+}
+
+static int lock_sample_enable(unsigned int period)
+{
+    int rc;
+
+    if ( !period )
+        return -EINVAL;
+
+    lock_sample_period = period;
+    if ( !lock_sample_enabled )
+    {
+        rc = lock_sample_reset();
+        if ( rc )
+            return rc;
+        smp_wmb();
+        lock_sample_enabled = 1;
+    }
+
+    return 0;
+}
+
+/* Which domain (or vcpu of a domain) is the lock part of, if any? */
+static domid_t lock_sample_domain(const void *lock)
+{
+    const struct domain *d;
+    const struct vcpu *v;
+    domid_t domid = DOMID_INVALID;
+
+#define CONTAINS(s, p) ((const void *)(p) >= (const void *)(s) &&           \
+                        (const void *)(p) < (const void *)((s) + 1))
+    rcu_read_lock(&domlist_read_lock);
+    for_each_domain ( d )
+    {
+        if ( CONTAINS(d, lock) )
+            domid = d->domain_id;
+        else
+            for_each_vcpu ( d, v )
+                if ( CONTAINS(v, lock) )
+                    domid = d->domain_id;
+        if ( domid != DOMID_INVALID )
+            break;
+    }
+    rcu_read_unlock(&domlist_read_lock);
+#undef CONTAINS
+
+    return domid;
+}
+
+static int lock_sample_query(xen_sysctl_lockprof_op_t *pc)
+{
+    xen_sysctl_lock_sample_t elem;
+    const struct lock_sample_table *t;
+    const struct lock_sample *e;
+    char namebuf[KSYM_NAME_LEN + 1];
+    unsigned long size, offset;
+    const char *sym;
+    unsigned int i;
+    int rc = 0;
+
+    rcu_read_lock(&lock_sample_rcu_lock);
+    t = rcu_dereference(lock_samples);
+
+    pc->nr_elem = 0;
+    pc->period = lock_sample_enabled ? lock_sample_period : 0;
+    pc->dropped = t ? t->dropped : 0;
+    pc->time = t ? NOW() - t->start : 0;
+
+    for ( i = 0; t && i < LOCK_SAMPLE_ENTRIES; i++ )
+    {
+        e = &t->entry[i];
+        if ( !e->valid )
+            continue;
+
+        if ( pc->nr_elem < pc->max_elem )
+        {
+            memset(&elem, 0, sizeof(elem));
+            elem.lock = (unsigned long)e->lock;
+            elem.site = (unsigned long)e->site;
+            sym = symbols_lookup(elem.site, &size, &offset, namebuf);
+            if ( sym )
+                snprintf(elem.site_name, sizeof(elem.site_name), "%s+%#lx",
+                         sym, offset);
+            else
+                snprintf(elem.site_name, sizeof(elem.site_name), "%p",
+                         e->site);
+            elem.domid = lock_sample_domain(e->lock);
+            elem.sampled = e->sampled;
+            elem.contended = e->contended;
+            elem.hold_time = e->hold_time;
+            elem.wait_time = e->wait_time;
+            memcpy(elem.hold_hist, e->hold_hist, sizeof(elem.hold_hist));
+            memcpy(elem.wait_hist, e->wait_hist, sizeof(elem.wait_hist));
+            if ( copy_to_guest_offset(pc->samples, pc->nr_elem, &elem, 1) )
+            {
+                rc = -EFAULT;
+                break;
+            }
+        }
+        pc->nr_elem++;
+    }
+
+    rcu_read_unlock(&lock_sample_rcu_lock);
+
+    return rc;
+}
+
+/* Dom0 control of lock profiling */
+int spinlock_profile_control(xen_sysctl_lockprof_op_t *pc)
+{
+    int rc = 0;
+#ifdef LOCK_PROFILE
+    spinlock_profile_ucopy_t par;
+#endif
+
+    switch ( pc->cmd )
+    {
+#ifdef LOCK_PROFILE
+    case XEN_SYSCTL_LOCKPROF_reset:
+        spinlock_profile_reset('\0');
+        break;
+    case XEN_SYSCTL_LOCKPROF_query:
+        pc->nr_elem = 0;
+        par.rc = 0;
+        par.pc = pc;
+        spinlock_profile_iterate(spinlock_profile_ucopy_elem, &par);
+        pc->time = NOW() - lock_profile_start;
+        rc = par.rc;
+        break;
+#else
+    case XEN_SYSCTL_LOCKPROF_reset:
+    case XEN_SYSCTL_LOCKPROF_query:
+        rc = -EOPNOTSUPP;
+        break;
+#endif
+    case XEN_SYSCTL_LOCKPROF_sample_enable:
+        rc = lock_sample_enable(pc->period);
+        break;
+    case XEN_SYSCTL_LOCKPROF_sample_disable:
+        lock_sample_enabled = 0;
+        break;
+    case XEN_SYSCTL_LOCKPROF_sample_reset:
+        if ( lock_samples )
+            rc = lock_sample_reset();
+        break;
+    case XEN_SYSCTL_LOCKPROF_sample_query:
+        rc = lock_sample_query(pc);
+        break;
+    default:
+        rc = -EINVAL;
+        break;
+    }
+
+    return rc;
+}
+
+static int __init lock_sample_init(void)
+{
+    if ( opt_lock_sample && lock_sample_enable(opt_lock_sample) )
+        printk(XENLOG_WARNING "Could not enable lock sampling\n");
+
+    return 0;
+}
+__initcall(lock_sample_init);
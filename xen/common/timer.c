@@ -25,14 +25,38 @@
 #include <asm/desc.h>
 #include <asm/atomic.h>
 
-/* We program the time hardware this far behind the closest deadline. */
+/*
+ * Timers expiring within the same tick are run together, and the time
+ * hardware is programmed for the end of the earliest pending tick.  A tick
+ * is timer_slop rounded down to a power of two, so no timer runs more than
+ * timer_slop late.  The tick is never shorter than 1024ns, though: with a
+ * timer_slop below that, timers may run up to 1024ns late.
+ */
 static unsigned int timer_slop __read_mostly = 50000; /* 50 us */
 integer_param("timer_slop", timer_slop);
 
+static unsigned int timer_shift __read_mostly; /* log2 of the tick, in ns */
+
+/*
+ * Hierarchical timer wheel.  Level 0 has a slot for each of the next
+ * WHEEL_SIZE ticks; each slot of level n covers WHEEL_SIZE slots of level
+ * n-1.  A level n slot is cascaded into the levels below when the wheel
+ * reaches the first tick it covers.  Timers further away than the wheel
+ * reaches sit in the last slot of the top level, and are placed again when
+ * it is cascaded.
+ */
+#define WHEEL_BITS   (BITS_PER_LONG == 64 ? 6 : 5)
+#define WHEEL_SIZE   (1 << WHEEL_BITS)
+#define WHEEL_MASK   (WHEEL_SIZE - 1)
+#define WHEEL_LEVELS 5
+#define WHEEL_RANGE  ((s_time_t)1 << (WHEEL_BITS * WHEEL_LEVELS))
+
 struct timers {
     spinlock_t     lock;
-    struct timer **heap;
-    struct timer  *list;
+    struct list_head *wheel;    /* WHEEL_LEVELS * WHEEL_SIZE slots */
+    unsigned long  pending[WHEEL_LEVELS]; /* Non-empty slots of each level */
+    s_time_t       clk;         /* Next tick to process */
+    s_time_t       next;        /* Tick the time hardware is programmed for */
     struct timer  *running;
     struct list_head inactive;
 } __cacheline_aligned;
@@ -45,125 +69,118 @@ static DEFINE_RCU_READ_LOCK(timer_cpu_read_lock);
 DEFINE_PER_CPU(s_time_t, timer_deadline);
 
 /****************************************************************************
- * HEAP OPERATIONS.
+ * WHEEL OPERATIONS.
  */
 
-#define GET_HEAP_SIZE(_h)     ((int)(((u16 *)(_h))[0]))
-#define SET_HEAP_SIZE(_h,_v)  (((u16 *)(_h))[0] = (u16)(_v))
-
-#define GET_HEAP_LIMIT(_h)    ((int)(((u16 *)(_h))[1]))
-#define SET_HEAP_LIMIT(_h,_v) (((u16 *)(_h))[1] = (u16)(_v))
-
-/* Sink down element @pos of @heap. */
-static void down_heap(struct timer **heap, int pos)
+static inline s_time_t wheel_tick(s_time_t time)
 {
-    int sz = GET_HEAP_SIZE(heap), nxt;
-    struct timer *t = heap[pos];
-
-    while ( (nxt = (pos << 1)) <= sz )
-    {
-        if ( ((nxt+1) <= sz) && (heap[nxt+1]->expires < heap[nxt]->expires) )
-            nxt++;
-        if ( heap[nxt]->expires > t->expires )
-            break;
-        heap[pos] = heap[nxt];
-        heap[pos]->heap_offset = pos;
-        pos = nxt;
-    }
-
-    heap[pos] = t;
-    t->heap_offset = pos;
+    return time >> timer_shift;
 }
 
-/* Float element @pos up @heap. */
-static void up_heap(struct timer **heap, int pos)
+/* Add @t to the wheel. Return TRUE if it is due before the time hardware. */
+static int add_to_wheel(struct timers *ts, struct timer *t)
 {
-    struct timer *t = heap[pos];
+    s_time_t tick = wheel_tick(t->expires), delta = tick - ts->clk, due;
+    unsigned int level = 0, shift = 0, slot;
 
-    while ( (pos > 1) && (t->expires < heap[pos>>1]->expires) )
+    if ( delta < 0 )
     {
-        heap[pos] = heap[pos>>1];
-        heap[pos]->heap_offset = pos;
-        pos >>= 1;
+        tick = ts->clk;
+        delta = 0;
     }
-
-    heap[pos] = t;
-    t->heap_offset = pos;
-}
-
-
-/* Delete @t from @heap. Return TRUE if new top of heap. */
-static int remove_from_heap(struct timer **heap, struct timer *t)
-{
-    int sz = GET_HEAP_SIZE(heap);
-    int pos = t->heap_offset;
-
-    if ( unlikely(pos == sz) )
+    else if ( delta >= WHEEL_RANGE )
     {
-        SET_HEAP_SIZE(heap, sz-1);
-        goto out;
+        tick = ts->clk + WHEEL_RANGE - 1;
+        delta = WHEEL_RANGE - 1;
     }
 
-    heap[pos] = heap[sz];
-    heap[pos]->heap_offset = pos;
-
-    SET_HEAP_SIZE(heap, --sz);
+    while ( (level < WHEEL_LEVELS - 1) &&
+            (delta >= ((s_time_t)WHEEL_SIZE << shift)) )
+    {
+        level++;
+        shift += WHEEL_BITS;
+    }
 
-    if ( (pos > 1) && (heap[pos]->expires < heap[pos>>1]->expires) )
-        up_heap(heap, pos);
-    else
-        down_heap(heap, pos);
+    slot = (tick >> shift) & WHEEL_MASK;
+    list_add_tail(&t->wheel, &ts->wheel[level * WHEEL_SIZE + slot]);
+    __set_bit(slot, &ts->pending[level]);
 
- out:
-    return (pos == 1);
+    /* Above level 0, the slot is next looked at when it gets cascaded. */
+    due = (tick >> shift) << shift;
+    if ( due >= ts->next )
+        return 0;
+    ts->next = due;
+    return 1;
 }
 
-
-/* Add new entry @t to @heap. Return TRUE if new top of heap. */
-static int add_to_heap(struct timer **heap, struct timer *t)
+static void remove_from_wheel(struct timers *ts, struct timer *t)
 {
-    int sz = GET_HEAP_SIZE(heap);
-
-    /* Fail if the heap is full. */
-    if ( unlikely(sz == GET_HEAP_LIMIT(heap)) )
-        return 0;
+    unsigned int slot;
 
-    SET_HEAP_SIZE(heap, ++sz);
-    heap[sz] = t;
-    t->heap_offset = sz;
-    up_heap(heap, sz);
-
-    return (t->heap_offset == 1);
+    /* If @t is alone in its slot, its neighbour is the slot's list head. */
+    if ( t->wheel.next == t->wheel.prev )
+    {
+        slot = t->wheel.next - ts->wheel;
+        __clear_bit(slot & WHEEL_MASK, &ts->pending[slot / WHEEL_SIZE]);
+    }
+    list_del(&t->wheel);
 }
 
-
-/****************************************************************************
- * LINKED LIST OPERATIONS.
+/*
+ * Earliest tick at which the wheel has timers to run or cascade.  Above level
+ * 0, the slot of the current block holds timers for that block only while the
+ * clock is on its first tick, waiting to cascade them.  Once past it, the
+ * slot can only have been filled by timers a full rotation ahead.
  */
-
-static int remove_from_list(struct timer **pprev, struct timer *t)
+static s_time_t wheel_next(const struct timers *ts)
 {
-    struct timer *curr, **_pprev = pprev;
-
-    while ( (curr = *_pprev) != t )
-        _pprev = &curr->list_next;
+    s_time_t next = STIME_MAX, due, block;
+    unsigned long pending;
+    unsigned int level, shift, pos, offset;
 
-    *_pprev = t->list_next;
+    for ( level = 0; level < WHEEL_LEVELS; level++ )
+    {
+        if ( !ts->pending[level] )
+            continue;
+        shift = level * WHEEL_BITS;
+        block = ts->clk >> shift;
+        pos = block & WHEEL_MASK;
+        pending = ts->pending[level] >> pos;
+        if ( pos )
+            pending |= ts->pending[level] << (WHEEL_SIZE - pos);
+        if ( level && (ts->clk != (block << shift)) && (pending & 1) )
+            offset = (pending & ~1UL) ? find_first_set_bit(pending & ~1UL)
+                                      : WHEEL_SIZE;
+        else
+            offset = find_first_set_bit(pending);
+        due = (block + offset) << shift;
+        if ( due < next )
+            next = due;
+    }
 
-    return (_pprev == pprev);
+    return next;
 }
 
-static int add_to_list(struct timer **pprev, struct timer *t)
+/* Move the timers of the level-@level slot now reached into lower levels. */
+static void cascade(struct timers *ts, unsigned int level)
 {
-    struct timer *curr, **_pprev = pprev;
+    unsigned int slot = (ts->clk >> (level * WHEEL_BITS)) & WHEEL_MASK;
+    struct list_head list;
+    struct timer *t;
 
-    while ( ((curr = *_pprev) != NULL) && (curr->expires <= t->expires) )
-        _pprev = &curr->list_next;
+    if ( !test_bit(slot, &ts->pending[level]) )
+        return;
 
-    t->list_next = curr;
-    *_pprev = t;
+    INIT_LIST_HEAD(&list);
+    list_splice_init(&ts->wheel[level * WHEEL_SIZE + slot], &list);
+    __clear_bit(slot, &ts->pending[level]);
 
-    return (_pprev == pprev);
+    while ( !list_empty(&list) )
+    {
+        t = list_entry(list.next, struct timer, wheel);
+        list_del(&t->wheel);
+        add_to_wheel(ts, t);
+    }
 }
 
 
@@ -171,45 +188,18 @@ static int add_to_list(struct timer **pprev, struct timer *t)
  * TIMER OPERATIONS.
  */
 
-static int remove_entry(struct timer *t)
+static void remove_entry(struct timer *t)
 {
-    struct timers *timers = &per_cpu(timers, t->cpu);
-    int rc;
-
-    switch ( t->status )
-    {
-    case TIMER_STATUS_in_heap:
-        rc = remove_from_heap(timers->heap, t);
-        break;
-    case TIMER_STATUS_in_list:
-        rc = remove_from_list(&timers->list, t);
-        break;
-    default:
-        rc = 0;
-        BUG();
-    }
-
+    BUG_ON(t->status != TIMER_STATUS_in_wheel);
+    remove_from_wheel(&per_cpu(timers, t->cpu), t);
     t->status = TIMER_STATUS_invalid;
-    return rc;
 }
 
 static int add_entry(struct timer *t)
 {
-    struct timers *timers = &per_cpu(timers, t->cpu);
-    int rc;
-
     ASSERT(t->status == TIMER_STATUS_invalid);
-
-    /* Try to add to heap. t->heap_offset indicates whether we succeed. */
-    t->heap_offset = 0;
-    t->status = TIMER_STATUS_in_heap;
-    rc = add_to_heap(timers->heap, t);
-    if ( t->heap_offset != 0 )
-        return rc;
-
-    /* Fall back to adding to the slower linked list. */
-    t->status = TIMER_STATUS_in_list;
-    return add_to_list(&timers->list, t);
+    t->status = TIMER_STATUS_in_wheel;
+    return add_to_wheel(&per_cpu(timers, t->cpu), t);
 }
 
 static inline void activate_timer(struct timer *timer)
@@ -222,10 +212,14 @@ static inline void activate_timer(struct timer *timer)
         cpu_raise_softirq(timer->cpu, TIMER_SOFTIRQ);
 }
 
+/*
+ * Stopping the earliest timer leaves the time hardware programmed for it: the
+ * softirq then finds nothing to run and reprograms, which is cheaper than
+ * an IPI to do so now.
+ */
 static inline void deactivate_timer(struct timer *timer)
 {
-    if ( remove_entry(timer) )
-        cpu_raise_softirq(timer->cpu, TIMER_SOFTIRQ);
+    remove_entry(timer);
 
     timer->status = TIMER_STATUS_inactive;
     list_add(&timer->inactive, &per_cpu(timers, timer->cpu).inactive);
@@ -277,8 +271,8 @@ static inline void timer_unlock(struct timer *timer)
 static bool_t active_timer(struct timer *timer)
 {
     ASSERT(timer->status >= TIMER_STATUS_inactive);
-    ASSERT(timer->status <= TIMER_STATUS_in_list);
-    return (timer->status >= TIMER_STATUS_in_heap);
+    ASSERT(timer->status <= TIMER_STATUS_in_wheel);
+    return (timer->status == TIMER_STATUS_in_wheel);
 }
 
 
@@ -428,72 +422,57 @@ static void execute_timer(struct timers *ts, struct timer *t)
 }
 
 
-static void timer_softirq_action(void)
+/* Run the timers of every tick before @tick, skipping empty ones. */
+static void run_wheel(struct timers *ts, s_time_t tick)
 {
-    struct timer  *t, **heap, *next;
-    struct timers *ts;
-    s_time_t       now, deadline;
-
-    ts = &this_cpu(timers);
-    heap = ts->heap;
+    struct timer    *t;
+    struct list_head *slot;
+    s_time_t         next;
+    unsigned int     level;
 
-    /* If we overflowed the heap, try to allocate a larger heap. */
-    if ( unlikely(ts->list != NULL) )
+    while ( ts->clk < tick )
     {
-        /* old_limit == (2^n)-1; new_limit == (2^(n+4))-1 */
-        int old_limit = GET_HEAP_LIMIT(heap);
-        int new_limit = ((old_limit + 1) << 4) - 1;
-        struct timer **newheap = xmalloc_array(struct timer *, new_limit + 1);
-        if ( newheap != NULL )
+        next = wheel_next(ts);
+        if ( next >= tick )
         {
-            spin_lock_irq(&ts->lock);
-            memcpy(newheap, heap, (old_limit + 1) * sizeof(*heap));
-            SET_HEAP_LIMIT(newheap, new_limit);
-            ts->heap = newheap;
-            spin_unlock_irq(&ts->lock);
-            if ( old_limit != 0 )
-                xfree(heap);
-            heap = newheap;
+            ts->clk = tick;
+            break;
         }
-    }
-
-    spin_lock_irq(&ts->lock);
+        ts->clk = next;
 
-    now = NOW();
+        for ( level = 1; level < WHEEL_LEVELS; level++ )
+        {
+            if ( ts->clk & (((s_time_t)1 << (level * WHEEL_BITS)) - 1) )
+                break;
+            cascade(ts, level);
+        }
 
-    /* Execute ready heap timers. */
-    while ( (GET_HEAP_SIZE(heap) != 0) &&
-            ((t = heap[1])->expires < now) )
-    {
-        remove_from_heap(heap, t);
-        execute_timer(ts, t);
+        /*
+         * Leave the clock on this tick until its slot is empty, so that
+         * timers set by the handlers can't wrap around into it.
+         */
+        slot = &ts->wheel[ts->clk & WHEEL_MASK];
+        while ( !list_empty(slot) )
+        {
+            t = list_entry(slot->next, struct timer, wheel);
+            remove_from_wheel(ts, t);
+            execute_timer(ts, t);
+        }
+        ts->clk++;
     }
+}
 
-    /* Execute ready list timers. */
-    while ( ((t = ts->list) != NULL) && (t->expires < now) )
-    {
-        ts->list = t->list_next;
-        execute_timer(ts, t);
-    }
+static void timer_softirq_action(void)
+{
+    struct timers *ts = &this_cpu(timers);
 
-    /* Try to move timers from linked list to more efficient heap. */
-    next = ts->list;
-    ts->list = NULL;
-    while ( unlikely((t = next) != NULL) )
-    {
-        next = t->list_next;
-        t->status = TIMER_STATUS_invalid;
-        add_entry(t);
-    }
+    spin_lock_irq(&ts->lock);
 
-    /* Find earliest deadline from head of linked list and top of heap. */
-    deadline = STIME_MAX;
-    if ( GET_HEAP_SIZE(heap) != 0 )
-        deadline = heap[1]->expires;
-    if ( (ts->list != NULL) && (ts->list->expires < deadline) )
-        deadline = ts->list->expires;
+    run_wheel(ts, wheel_tick(NOW()));
+
+    ts->next = wheel_next(ts);
     this_cpu(timer_deadline) =
-        (deadline == STIME_MAX) ? 0 : deadline + timer_slop;
+        (ts->next == STIME_MAX) ? 0 : (ts->next + 1) << timer_shift;
 
     if ( !reprogram_timer(this_cpu(timer_deadline)) )
         raise_softirq(TIMER_SOFTIRQ);
@@ -524,7 +503,7 @@ static void dump_timerq(unsigned char key)
     s_time_t       now = NOW();
     int            i, j;
 
-    printk("Dumping timer queues:\n");
+    printk("Dumping timer queues (tick %uns):\n", 1u << timer_shift);
 
     for_each_online_cpu( i )
     {
@@ -532,10 +511,9 @@ static void dump_timerq(unsigned char key)
 
         printk("CPU%02d:\n", i);
         spin_lock_irqsave(&ts->lock, flags);
-        for ( j = 1; j <= GET_HEAP_SIZE(ts->heap); j++ )
-            dump_timer(ts->heap[j], now);
-        for ( t = ts->list, j = 0; t != NULL; t = t->list_next, j++ )
-            dump_timer(t, now);
+        for ( j = 0; j < WHEEL_LEVELS * WHEEL_SIZE; j++ )
+            list_for_each_entry ( t, &ts->wheel[j], wheel )
+                dump_timer(t, now);
         spin_unlock_irqrestore(&ts->lock, flags);
     }
 }
@@ -546,12 +524,163 @@ static struct keyhandler dump_timerq_keyhandler = {
     .desc = "dump timer queues"
 };
 
+static void timer_bench_fn(void *unused)
+{
+}
+
+static void timer_test_fn(void *data)
+{
+    ++*(unsigned int *)data;
+}
+
+/*
+ * Drive a private wheel through timers up to the furthest a guest can arm,
+ * starting at several points in a rotation.  Each must either fire on its own
+ * tick or, if out of reach, let the wheel sleep for most of a rotation per
+ * wakeup rather than look due on every tick.
+ */
+static bool_t timer_wheel_selftest(void)
+{
+    static const s_time_t offsets[] = {
+        MILLISECS(10), SECONDS(100000), (s_time_t)1 << 50, STIME_MAX
+    };
+    static const s_time_t phases[] = {
+        0, 1, WHEEL_SIZE / 2, WHEEL_SIZE - 1, WHEEL_SIZE * WHEEL_SIZE + 3
+    };
+    const unsigned int top = (WHEEL_LEVELS - 1) * WHEEL_BITS;
+    const unsigned int max_wakeups = 64;
+    struct timers ts;
+    struct timer t;
+    s_time_t base, start, ticks;
+    unsigned int i, j, fired, wakeups;
+    bool_t ok = 1, reachable;
+
+    memset(&ts, 0, sizeof(ts));
+    ts.wheel = xmalloc_array(struct list_head, WHEEL_LEVELS * WHEEL_SIZE);
+    if ( ts.wheel == NULL )
+    {
+        printk("Cannot allocate timer wheel\n");
+        return 0;
+    }
+    for ( i = 0; i < WHEEL_LEVELS * WHEEL_SIZE; i++ )
+        INIT_LIST_HEAD(&ts.wheel[i]);
+    INIT_LIST_HEAD(&ts.inactive);
+    spin_lock_init(&ts.lock);
+
+    base = (wheel_tick(NOW()) >> top) << top;
+
+    spin_lock_irq(&ts.lock);
+
+    for ( i = 0; i < ARRAY_SIZE(offsets); i++ )
+        for ( j = 0; j < ARRAY_SIZE(phases); j++ )
+        {
+            ts.clk = start = base + phases[j];
+            ts.next = STIME_MAX;
+
+            memset(&t, 0, sizeof(t));
+            t.function = timer_test_fn;
+            t.data = &fired;
+            t.status = TIMER_STATUS_in_wheel;
+            t.expires = (offsets[i] > STIME_MAX - (start << timer_shift))
+                        ? STIME_MAX : (start << timer_shift) + offsets[i];
+            ticks = wheel_tick(t.expires) - start;
+            reachable = (ticks / (WHEEL_RANGE / 2) + 2 * WHEEL_LEVELS <
+                         max_wakeups);
+
+            fired = 0;
+            add_to_wheel(&ts, &t);
+            for ( wakeups = 0; !fired && (wakeups < max_wakeups); wakeups++ )
+                run_wheel(&ts, wheel_next(&ts) + 1);
+
+            if ( fired ? (fired != 1 || ts.clk != wheel_tick(t.expires) + 1)
+                       : (reachable || (ts.clk - start <
+                                        (wakeups - 2 * WHEEL_LEVELS) *
+                                        (WHEEL_RANGE / 2))) )
+            {
+                printk("Timer %"PRId64"ns ahead, at tick %"PRId64" of the "
+                       "wheel: fired %u times, %u wakeups, %"PRId64
+                       " ticks passed\n", offsets[i], phases[j], fired,
+                       wakeups, ts.clk - start);
+                ok = 0;
+            }
+
+            if ( !fired )
+                remove_from_wheel(&ts, &t);
+        }
+
+    spin_unlock_irq(&ts.lock);
+
+    xfree(ts.wheel);
+
+    return ok;
+}
+
+/* Time set, re-set and stop of a batch of timers spread over a second. */
+static void run_timer_bench(unsigned char key)
+{
+    enum { NR_TIMERS = 4096 };
+    struct timer *t = xmalloc_array(struct timer, NR_TIMERS);
+    unsigned int cpu = smp_processor_id(), i;
+    uint32_t seed = NOW();
+    s_time_t start, now, set, reset, stop;
+
+    printk("'%c' pressed -> benchmarking %u timers on CPU%u\n",
+           key, NR_TIMERS, cpu);
+    if ( t == NULL )
+    {
+        printk("Cannot allocate timers\n");
+        return;
+    }
+
+    for ( i = 0; i < NR_TIMERS; i++ )
+        init_timer(&t[i], timer_bench_fn, NULL, cpu);
+
+    /* Expiries far enough away that none fire while being measured. */
+#define BENCH_EXPIRY() \
+    (now + MILLISECS(10) + (seed = seed * 1103515245 + 12345) % SECONDS(1))
+
+    now = NOW();
+    start = NOW();
+    for ( i = 0; i < NR_TIMERS; i++ )
+        set_timer(&t[i], BENCH_EXPIRY());
+    set = NOW() - start;
+
+    start = NOW();
+    for ( i = 0; i < NR_TIMERS; i++ )
+        set_timer(&t[i], BENCH_EXPIRY());
+    reset = NOW() - start;
+
+    start = NOW();
+    for ( i = 0; i < NR_TIMERS; i++ )
+        stop_timer(&t[i]);
+    stop = NOW() - start;
+
+#undef BENCH_EXPIRY
+
+    for ( i = 0; i < NR_TIMERS; i++ )
+        kill_timer(&t[i]);
+    xfree(t);
+
+    printk("set %"PRId64"ns, re-set %"PRId64"ns, stop %"PRId64"ns "
+           "per timer (tick %uns)\n", set / NR_TIMERS, reset / NR_TIMERS,
+           stop / NR_TIMERS, 1u << timer_shift);
+
+    printk("Timer wheel self-test %s\n",
+           timer_wheel_selftest() ? "passed" : "FAILED");
+}
+
+static struct keyhandler timer_bench_keyhandler = {
+    .u.fn = run_timer_bench,
+    .desc = "benchmark and self-test timers"
+};
+
 static void migrate_timers_from_cpu(unsigned int old_cpu)
 {
     unsigned int new_cpu = cpumask_any(&cpu_online_map);
     struct timers *old_ts, *new_ts;
     struct timer *t;
     bool_t notify = 0;
+    unsigned int level;
 
     ASSERT(!cpu_online(old_cpu) && cpu_online(new_cpu));
 
@@ -569,13 +698,16 @@ static void migrate_timers_from_cpu(unsigned int old_cpu)
         spin_lock(&old_ts->lock);
     }
 
-    while ( (t = GET_HEAP_SIZE(old_ts->heap)
-             ? old_ts->heap[1] : old_ts->list) != NULL )
-    {
-        remove_entry(t);
-        write_atomic(&t->cpu, new_cpu);
-        notify |= add_entry(t);
-    }
+    for ( level = 0; level < WHEEL_LEVELS; level++ )
+        while ( old_ts->pending[level] )
+        {
+            t = list_entry(old_ts->wheel[level * WHEEL_SIZE +
+                           find_first_set_bit(old_ts->pending[level])].next,
+                           struct timer, wheel);
+            remove_entry(t);
+            write_atomic(&t->cpu, new_cpu);
+            notify |= add_entry(t);
+        }
 
     while ( !list_empty(&old_ts->inactive) )
     {
@@ -592,20 +724,30 @@ static void migrate_timers_from_cpu(unsigned int old_cpu)
         cpu_raise_softirq(new_cpu, TIMER_SOFTIRQ);
 }
 
-static struct timer *dummy_heap;
-
 static int cpu_callback(
     struct notifier_block *nfb, unsigned long action, void *hcpu)
 {
     unsigned int cpu = (unsigned long)hcpu;
     struct timers *ts = &per_cpu(timers, cpu);
+    unsigned int i;
 
     switch ( action )
     {
     case CPU_UP_PREPARE:
         INIT_LIST_HEAD(&ts->inactive);
         spin_lock_init(&ts->lock);
-        ts->heap = &dummy_heap;
+        /* The wheel is empty whenever the CPU is down; keep it for reuse. */
+        if ( ts->wheel == NULL )
+        {
+            ts->wheel = xmalloc_array(struct list_head,
+                                      WHEEL_LEVELS * WHEEL_SIZE);
+            if ( ts->wheel == NULL )
+                return notifier_from_errno(-ENOMEM);
+            for ( i = 0; i < WHEEL_LEVELS * WHEEL_SIZE; i++ )
+                INIT_LIST_HEAD(&ts->wheel[i]);
+        }
+        /* A stale clock is fine: the softirq skips over empty ticks. */
+        ts->next = STIME_MAX;
         break;
     case CPU_UP_CANCELED:
     case CPU_DEAD:
@@ -629,17 +771,15 @@ void __init timer_init(void)
 
     open_softirq(TIMER_SOFTIRQ, timer_softirq_action);
 
-    /*
-     * All CPUs initially share an empty dummy heap. Only those CPUs that
-     * are brought online will be dynamically allocated their own heap.
-     */
-    SET_HEAP_SIZE(&dummy_heap, 0);
-    SET_HEAP_LIMIT(&dummy_heap, 0);
+    /* Ticks of 1us to 16ms: the largest power of two within timer_slop. */
+    timer_shift = min(max(fls(timer_slop) - 1, 10), 24);
 
-    cpu_callback(&cpu_nfb, CPU_UP_PREPARE, cpu);
+    if ( cpu_callback(&cpu_nfb, CPU_UP_PREPARE, cpu) != NOTIFY_DONE )
+        panic("Cannot allocate timer wheel\n");
     register_cpu_notifier(&cpu_nfb);
 
     register_keyhandler('a', &dump_timerq_keyhandler);
+    register_keyhandler('B', &timer_bench_keyhandler);
 }
 
 /*
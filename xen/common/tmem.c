@@ -23,6 +23,7 @@
 #include <xen/radix-tree.h>
 #include <xen/list.h>
 #include <xen/init.h>
+#include <xen/numa.h>
 
 #define EXPORT /* indicates code other modules are dependent upon */
 #define FORWARD
@@ -110,16 +111,27 @@ DECL_CYC_COUNTER(decompress);
 
 #define MAX_POOLS_PER_DOMAIN 16
 #define MAX_GLOBAL_SHARED_POOLS  16
+#define EVICT_SAMPLES 4  /* ephemeral LRU shards looked at per eviction */
 
 struct tm_pool;
 struct tmem_page_descriptor;
 struct tmem_page_content_descriptor;
+
+/* ephemeral pages in LRU order, one list per client per node */
+struct eph_lru {
+    spinlock_t lock;
+    struct list_head page_list;
+    long count;
+};
+
 struct client {
     struct list_head client_list;
+    struct list_head eph_client_list;
     struct tm_pool *pools[MAX_POOLS_PER_DOMAIN];
     tmh_client_t *tmh;
-    struct list_head ephemeral_page_list;
-    long eph_count, eph_count_max;
+    struct eph_lru eph_lru[MAX_NUMNODES];
+    atomic_t eph_count;
+    long eph_count_max;
     cli_id_t cli_id;
     uint32_t weight;
     uint32_t cap;
@@ -217,10 +229,7 @@ struct tmem_object_node {
 typedef struct tmem_object_node objnode_t;
 
 struct tmem_page_descriptor {
-    union {
-        struct list_head global_eph_pages;
-        struct list_head client_inv_pages;
-    };
+    struct list_head client_inv_pages;
     union {
         struct {
             union {
@@ -237,6 +246,7 @@ struct tmem_page_descriptor {
     /* must hold pcd_tree_rwlocks[firstbyte] to use pcd pointer/siblings */
     uint16_t firstbyte; /* NON_SHAREABLE->pfp  otherwise->pcd */
     bool_t eviction_attempted;  /* CHANGE TO lifetimes? (settable) */
+    uint8_t eph_node; /* which of the client's eph_lru the page is on */
     struct list_head pcd_siblings;
     union {
         pfp_t *pfp;  /* page frame pointer */
@@ -270,9 +280,8 @@ typedef struct tmem_page_content_descriptor pcd_t;
 struct rb_root pcd_tree_roots[256]; /* choose based on first byte of page */
 rwlock_t pcd_tree_rwlocks[256]; /* poor man's concurrency for now */
 
-static LIST_HEAD(global_ephemeral_page_list); /* all pages in ephemeral pools */
-
 static LIST_HEAD(global_client_list);
+static LIST_HEAD(eph_client_list); /* global_client_list, for eviction */
 static LIST_HEAD(global_pool_list);
 
 static pool_t *global_shared_pools[MAX_GLOBAL_SHARED_POOLS] = { 0 };
@@ -284,7 +293,11 @@ static int tmem_initialized = 0;
 
 EXPORT DEFINE_SPINLOCK(tmem_spinlock);  /* used iff tmh_lock_all */
 EXPORT DEFINE_RWLOCK(tmem_rwlock);      /* used iff !tmh_lock_all */
-static DEFINE_SPINLOCK(eph_lists_spinlock); /* protects global AND clients */
+static DEFINE_RWLOCK(eph_client_rwlock); /* protects eph_client_list */
+/* LRU shard the next eviction sample starts at; NULL for the first client */
+static client_t *evict_cursor;
+static unsigned int evict_cursor_node;
+static DEFINE_SPINLOCK(evict_cursor_lock);
 static DEFINE_SPINLOCK(pers_lists_spinlock);
 
 #define tmem_spin_lock(_l)  do {if (!tmh_lock_all) spin_lock(_l);}while(0)
@@ -300,7 +313,7 @@ static DEFINE_SPINLOCK(pers_lists_spinlock);
 #define ASSERT_WRITELOCK(_l) ASSERT(tmh_lock_all || rw_is_write_locked(_l))
 
 /* global counters (should use long_atomic_t access) */
-static long global_eph_count = 0; /* atomicity depends on eph_lists_spinlock */
+static atomic_t global_eph_count = ATOMIC_INIT(0);
 static atomic_t global_obj_count = ATOMIC_INIT(0);
 static atomic_t global_pgp_count = ATOMIC_INIT(0);
 static atomic_t global_pcd_count = ATOMIC_INIT(0);
@@ -612,7 +625,7 @@ static NOINLINE pgp_t *pgp_alloc(obj_t *obj)
     if ( (pgp = tmem_malloc(pgp_t, pool)) == NULL )
         return NULL;
     pgp->us.obj = obj;
-    INIT_LIST_HEAD(&pgp->global_eph_pages);
+    INIT_LIST_HEAD(&pgp->client_inv_pages);
     INIT_LIST_HEAD(&pgp->us.client_eph_pages);
     pgp->pfp = NULL;
     if ( tmh_dedup_enabled() )
@@ -675,10 +688,7 @@ static NOINLINE void pgp_free(pgp_t *pgp, int from_delete)
     ASSERT(pgp->us.obj->pool != NULL);
     pool = pgp->us.obj->pool;
     if ( is_ephemeral(pool) )
-    {
-        ASSERT(list_empty(&pgp->global_eph_pages));
         ASSERT(list_empty(&pgp->us.client_eph_pages));
-    }
     pgp_free_data(pgp, pool);
     atomic_dec_and_assert(global_pgp_count);
     atomic_dec_and_assert(pool->pgp_count);
@@ -707,10 +717,33 @@ static NOINLINE void pgp_free_from_inv_list(client_t *client, pgp_t *pgp)
     tmem_free(pgp,sizeof(pgp_t),pool);
 }
 
+static unsigned int eph_lru_node(void)
+{
+    unsigned int node = cpu_to_node(smp_processor_id());
+
+    return node < MAX_NUMNODES ? node : 0;
+}
+
+/* put an ephemeral page at the tail of the current node's LRU */
+static void eph_lru_add(client_t *client, pgp_t *pgp)
+{
+    struct eph_lru *lru;
+
+    pgp->eph_node = eph_lru_node();
+    lru = &client->eph_lru[pgp->eph_node];
+    tmem_spin_lock(&lru->lock);
+    list_add_tail(&pgp->us.client_eph_pages, &lru->page_list);
+    lru->count++;
+    tmem_spin_unlock(&lru->lock);
+    atomic_inc_and_max(client->eph_count);
+    atomic_inc_and_max(global_eph_count);
+}
+
 /* remove the page from appropriate lists but not from parent object */
 static void pgp_delist(pgp_t *pgp, bool_t no_eph_lock)
 {
     client_t *client;
+    struct eph_lru *lru;
 
     ASSERT(pgp != NULL);
     ASSERT(pgp->us.obj != NULL);
@@ -719,18 +752,19 @@ static void pgp_delist(pgp_t *pgp, bool_t no_eph_lock)
     ASSERT(client != NULL);
     if ( is_ephemeral(pgp->us.obj->pool) )
     {
+        lru = &client->eph_lru[pgp->eph_node];
         if ( !no_eph_lock )
-            tmem_spin_lock(&eph_lists_spinlock);
+            tmem_spin_lock(&lru->lock);
         if ( !list_empty(&pgp->us.client_eph_pages) )
-            client->eph_count--;
-        ASSERT(client->eph_count >= 0);
-        list_del_init(&pgp->us.client_eph_pages);
-        if ( !list_empty(&pgp->global_eph_pages) )
-            global_eph_count--;
-        ASSERT(global_eph_count >= 0);
-        list_del_init(&pgp->global_eph_pages);
+        {
+            list_del_init(&pgp->us.client_eph_pages);
+            lru->count--;
+            ASSERT(lru->count >= 0);
+            atomic_dec_and_assert(client->eph_count);
+            atomic_dec_and_assert(global_eph_count);
+        }
         if ( !no_eph_lock )
-            tmem_spin_unlock(&eph_lists_spinlock);
+            tmem_spin_unlock(&lru->lock);
     } else {
         if ( client->live_migrating )
         {
@@ -1112,12 +1146,28 @@ static int shared_pool_join(pool_t *pool, client_t *new_client)
     return ++pool->shared_count;
 }
 
+/* the i'th of both clients' LRU shards, in address order */
+static struct eph_lru *eph_lru_lock_order(client_t *a, client_t *b,
+                                          unsigned int i)
+{
+    if ( a->eph_lru > b->eph_lru )
+    {
+        client_t *t = a;
+
+        a = b;
+        b = t;
+    }
+    return i < MAX_NUMNODES ? &a->eph_lru[i] : &b->eph_lru[i - MAX_NUMNODES];
+}
+
 /* reassign "ownership" of the pool to another client that shares this pool */
 static NOINLINE void shared_pool_reassign(pool_t *pool)
 {
     sharelist_t *sl;
-    int poolid;
+    int poolid, node;
     client_t *old_client = pool->client, *new_client;
+    struct eph_lru *old_lru, *new_lru;
+    pgp_t *pgp, *pgp2;
 
     ASSERT(is_shared(pool));
     if ( list_empty(&pool->share_list) )
@@ -1128,15 +1178,43 @@ static NOINLINE void shared_pool_reassign(pool_t *pool)
     old_client->pools[pool->pool_id] = NULL;
     sl = list_entry(pool->share_list.next, sharelist_t, share_list);
     ASSERT(sl->client != old_client);
-    pool->client = new_client = sl->client;
+    new_client = sl->client;
     for (poolid = 0; poolid < MAX_POOLS_PER_DOMAIN; poolid++)
         if (new_client->pools[poolid] == pool)
             break;
     ASSERT(poolid != MAX_POOLS_PER_DOMAIN);
-    new_client->eph_count += _atomic_read(pool->pgp_count);
-    old_client->eph_count -= _atomic_read(pool->pgp_count);
-    list_splice_init(&old_client->ephemeral_page_list,
-                     &new_client->ephemeral_page_list);
+    /*
+     * Eviction runs outside tmem_rwlock and finds a page's list through
+     * pool->client, so the owner changes and the pages move under all the
+     * LRU locks of both clients: each client's locks are in one array, so
+     * taking the lower array first keeps to address order.
+     */
+    for ( node = 0; node < 2 * MAX_NUMNODES; node++ )
+        tmem_spin_lock(&eph_lru_lock_order(old_client, new_client,
+                                           node)->lock);
+    pool->client = new_client;
+    /* only this pool's pages move, the old client keeps its other pools */
+    for ( node = 0; node < MAX_NUMNODES; node++ )
+    {
+        old_lru = &old_client->eph_lru[node];
+        new_lru = &new_client->eph_lru[node];
+        if ( old_lru->count == 0 )
+            continue;
+        list_for_each_entry_safe(pgp,pgp2,&old_lru->page_list,
+                                 us.client_eph_pages)
+        {
+            if ( pgp->us.obj->pool != pool )
+                continue;
+            list_move_tail(&pgp->us.client_eph_pages, &new_lru->page_list);
+            old_lru->count--;
+            new_lru->count++;
+            atomic_dec_and_assert(old_client->eph_count);
+            atomic_inc_and_max(new_client->eph_count);
+        }
+    }
+    for ( node = 2 * MAX_NUMNODES; node-- > 0; )
+        tmem_spin_unlock(&eph_lru_lock_order(old_client, new_client,
+                                             node)->lock);
     tmh_client_info("reassigned shared pool from %s=%d to %s=%d pool_id=%d\n",
         cli_id_str, old_client->cli_id, cli_id_str, new_client->cli_id, poolid);
     pool->pool_id = poolid;
@@ -1240,11 +1318,20 @@ static client_t *client_create(cli_id_t cli_id)
             client->shared_auth_uuid[i][1] = -1L;
     client->frozen = 0; client->live_migrating = 0;
     client->weight = 0; client->cap = 0;
+    for ( i = 0; i < MAX_NUMNODES; i++ )
+    {
+        spin_lock_init(&client->eph_lru[i].lock);
+        INIT_LIST_HEAD(&client->eph_lru[i].page_list);
+        client->eph_lru[i].count = 0;
+    }
     list_add_tail(&client->client_list, &global_client_list);
-    INIT_LIST_HEAD(&client->ephemeral_page_list);
+    write_lock(&eph_client_rwlock);
+    list_add_tail(&client->eph_client_list, &eph_client_list);
+    write_unlock(&eph_client_rwlock);
     INIT_LIST_HEAD(&client->persistent_invalidated_list);
     client->cur_pgp = NULL;
-    client->eph_count = client->eph_count_max = 0;
+    atomic_set(&client->eph_count, 0);
+    client->eph_count_max = 0;
     client->total_cycles = 0; client->succ_pers_puts = 0;
     client->succ_eph_gets = 0; client->succ_pers_gets = 0;
     tmh_client_info("ok\n");
@@ -1258,6 +1345,11 @@ static client_t *client_create(cli_id_t cli_id)
 static void client_free(client_t *client)
 {
     list_del(&client->client_list);
+    write_lock(&eph_client_rwlock);
+    list_del(&client->eph_client_list);
+    if ( evict_cursor == client )
+        evict_cursor = NULL;
+    write_unlock(&eph_client_rwlock);
     tmh_client_destroy(client->tmh);
     tmh_free_infra(client);
 }
@@ -1283,12 +1375,13 @@ static void client_flush(client_t *client, bool_t destroy)
 static bool_t client_over_quota(client_t *client)
 {
     int total = _atomic_read(client_weight_total);
+    long eph_count = _atomic_read(client->eph_count);
 
     ASSERT(client != NULL);
     if ( (total == 0) || (client->weight == 0) || 
-          (client->eph_count == 0) )
+          (eph_count == 0) )
         return 0;
-    return ( ((global_eph_count*100L) / client->eph_count ) >
+    return ( ((_atomic_read(global_eph_count)*100L) / eph_count ) >
              ((total*100L) / client->weight) );
 }
 
@@ -1299,11 +1392,11 @@ static void client_freeze(client_t *client, int freeze)
 
 /************ MEMORY REVOCATION ROUTINES *******************************/
 
-static bool_t tmem_try_to_evict_pgp(pgp_t *pgp, bool_t *hold_pool_rwlock)
+static bool_t tmem_try_to_evict_pgp(pgp_t *pgp, struct eph_lru *lru,
+                                    bool_t *hold_pool_rwlock)
 {
     obj_t *obj = pgp->us.obj;
     pool_t *pool = obj->pool;
-    client_t *client = pool->client;
     uint16_t firstbyte = pgp->firstbyte;
 
     if ( pool->is_dying )
@@ -1323,10 +1416,8 @@ static bool_t tmem_try_to_evict_pgp(pgp_t *pgp, bool_t *hold_pool_rwlock)
             if ( pgp->pcd->pgp_ref_count > 1 && !pgp->eviction_attempted )
             {
                 pgp->eviction_attempted++;
-                list_del(&pgp->global_eph_pages);
-                list_add_tail(&pgp->global_eph_pages,&global_ephemeral_page_list);
-                list_del(&pgp->us.client_eph_pages);
-                list_add_tail(&pgp->us.client_eph_pages,&client->ephemeral_page_list);
+                pgp->timestamp = get_cycles();
+                list_move_tail(&pgp->us.client_eph_pages,&lru->page_list);
                 goto pcd_unlock;
             }
         }
@@ -1345,32 +1436,19 @@ obj_unlock:
     return 0;
 }
 
-static int tmem_evict(void)
+/* evict the least recently used evictable page on one LRU shard */
+static int tmem_evict_from_lru(struct eph_lru *lru)
 {
-    client_t *client = tmh_client_from_current();
     pgp_t *pgp = NULL, *pgp2, *pgp_del;
     obj_t *obj;
     pool_t *pool;
     int ret = 0;
     bool_t hold_pool_rwlock = 0;
 
-    evict_attempts++;
-    tmem_spin_lock(&eph_lists_spinlock);
-    if ( (client != NULL) && client_over_quota(client) &&
-         !list_empty(&client->ephemeral_page_list) )
-    {
-        list_for_each_entry_safe(pgp,pgp2,&client->ephemeral_page_list,us.client_eph_pages)
-            if ( tmem_try_to_evict_pgp(pgp,&hold_pool_rwlock) )
-                goto found;
-    } else if ( list_empty(&global_ephemeral_page_list) ) {
-        goto out;
-    } else {
-        list_for_each_entry_safe(pgp,pgp2,&global_ephemeral_page_list,global_eph_pages)
-            if ( tmem_try_to_evict_pgp(pgp,&hold_pool_rwlock) )
-                goto found;
-    }
-
-    ret = 0;
+    tmem_spin_lock(&lru->lock);
+    list_for_each_entry_safe(pgp,pgp2,&lru->page_list,us.client_eph_pages)
+        if ( tmem_try_to_evict_pgp(pgp,lru,&hold_pool_rwlock) )
+            goto found;
     goto out;
 
 found:
@@ -1405,7 +1483,119 @@ found:
     ret = 1;
 
 out:
-    tmem_spin_unlock(&eph_lists_spinlock);
+    tmem_spin_unlock(&lru->lock);
+    return ret;
+}
+
+/* the client after @client on eph_client_list, wrapping round */
+static client_t *eph_client_next(client_t *client)
+{
+    struct list_head *next = client->eph_client_list.next;
+
+    if ( next == &eph_client_list )
+        next = next->next;
+    return list_entry(next, client_t, eph_client_list);
+}
+
+/*
+ * Pick up to EVICT_SAMPLES non-empty LRU shards, starting at a position
+ * which moves on by one each time, and sort them oldest head page first.
+ * There is no global LRU order any more, so the head of the oldest shard
+ * sampled stands in for it.  The walk stops once it has its samples, and
+ * skips clients without ephemeral pages whole, so it only goes round every
+ * client when nearly all are empty.  Called with eph_client_rwlock held.
+ */
+static unsigned int tmem_evict_sample(struct eph_lru **sample)
+{
+    client_t *client, *start;
+    struct eph_lru *lru;
+    uint64_t age[EVICT_SAMPLES], head;
+    unsigned int nr = 0, i, node, start_node, end;
+    bool_t wrapped = 0;
+
+    if ( list_empty(&eph_client_list) )
+        return 0;
+
+    spin_lock(&evict_cursor_lock);
+    start = evict_cursor;
+    start_node = evict_cursor_node;
+    if ( start == NULL )
+    {
+        start = list_entry(eph_client_list.next, client_t, eph_client_list);
+        start_node = 0;
+    }
+    if ( start_node + 1 < MAX_NUMNODES )
+    {
+        evict_cursor = start;
+        evict_cursor_node = start_node + 1;
+    }
+    else
+    {
+        evict_cursor = eph_client_next(start);
+        evict_cursor_node = 0;
+    }
+    spin_unlock(&evict_cursor_lock);
+
+    /* start's shards from start_node, the other clients', then the rest */
+    for ( client = start; ; )
+    {
+        node = (client == start && !wrapped) ? start_node : 0;
+        end = (client == start && wrapped) ? start_node : MAX_NUMNODES;
+        for ( ; node < end && _atomic_read(client->eph_count); node++ )
+        {
+            lru = &client->eph_lru[node];
+            if ( lru->count == 0 )
+                continue;
+            tmem_spin_lock(&lru->lock);
+            if ( list_empty(&lru->page_list) )
+            {
+                tmem_spin_unlock(&lru->lock);
+                continue;
+            }
+            head = list_entry(lru->page_list.next, pgp_t,
+                              us.client_eph_pages)->timestamp;
+            tmem_spin_unlock(&lru->lock);
+            for ( i = nr; i > 0 && age[i - 1] > head; i-- )
+            {
+                age[i] = age[i - 1];
+                sample[i] = sample[i - 1];
+            }
+            age[i] = head;
+            sample[i] = lru;
+            if ( ++nr == EVICT_SAMPLES )
+                return nr;
+        }
+        if ( wrapped )
+            break;
+        client = eph_client_next(client);
+        wrapped = (client == start);
+    }
+    return nr;
+}
+
+static int tmem_evict(void)
+{
+    client_t *client = tmh_client_from_current();
+    struct eph_lru *sample[EVICT_SAMPLES];
+    unsigned int i, nr, node = eph_lru_node();
+    int ret = 0;
+
+    evict_attempts++;
+    read_lock(&eph_client_rwlock);
+    if ( (client != NULL) && client_over_quota(client) &&
+         _atomic_read(client->eph_count) )
+    {
+        /* this node's pages first, they are the cheapest to give up */
+        for ( i = 0; i < MAX_NUMNODES && !ret; i++ )
+            if ( client->eph_lru[(node + i) % MAX_NUMNODES].count )
+                ret = tmem_evict_from_lru(
+                    &client->eph_lru[(node + i) % MAX_NUMNODES]);
+    } else {
+        nr = tmem_evict_sample(sample);
+        for ( i = 0; i < nr && !ret; i++ )
+            ret = tmem_evict_from_lru(sample[i]);
+    }
+    read_unlock(&eph_client_rwlock);
     return ret;
 }
 
@@ -1666,16 +1856,7 @@ copy_uncompressed:
 insert_page:
     if ( is_ephemeral(pool) )
     {
-        tmem_spin_lock(&eph_lists_spinlock);
-        list_add_tail(&pgp->global_eph_pages,
-            &global_ephemeral_page_list);
-        if (++global_eph_count > global_eph_count_max)
-            global_eph_count_max = global_eph_count;
-        list_add_tail(&pgp->us.client_eph_pages,
-            &client->ephemeral_page_list);
-        if (++client->eph_count > client->eph_count_max)
-            client->eph_count_max = client->eph_count;
-        tmem_spin_unlock(&eph_lists_spinlock);
+        eph_lru_add(client, pgp);
     } else { /* is_persistent */
         tmem_spin_lock(&pers_lists_spinlock);
         list_add_tail(&pgp->us.pool_pers_pages,
@@ -1779,12 +1960,13 @@ static NOINLINE int do_tmem_get(pool_t *pool, OID *oidp, uint32_t index,
                 tmem_write_unlock(&pool->pool_rwlock);
             }
         } else {
-            tmem_spin_lock(&eph_lists_spinlock);
-            list_del(&pgp->global_eph_pages);
-            list_add_tail(&pgp->global_eph_pages,&global_ephemeral_page_list);
-            list_del(&pgp->us.client_eph_pages);
-            list_add_tail(&pgp->us.client_eph_pages,&client->ephemeral_page_list);
-            tmem_spin_unlock(&eph_lists_spinlock);
+            struct eph_lru *lru = &client->eph_lru[pgp->eph_node];
+
+            tmem_spin_lock(&lru->lock);
+            /* eviction compares head timestamps, so a get renews it */
+            pgp->timestamp = get_cycles();
+            list_move_tail(&pgp->us.client_eph_pages,&lru->page_list);
+            tmem_spin_unlock(&lru->lock);
             obj->last_client = tmh_get_cli_id_from_current();
         }
     }
@@ -2082,7 +2264,7 @@ static int tmemc_list_client(client_t *c, tmem_cli_va_param_t buf,
     if (use_long)
         n += scnprintf(info+n,BSIZE-n,
              "Ec:%ld,Em:%ld,cp:%ld,cb:%"PRId64",cn:%ld,cm:%ld\n",
-             c->eph_count, c->eph_count_max,
+             (long)_atomic_read(c->eph_count), c->eph_count_max,
              c->compressed_pages, c->compressed_sum_size,
              c->compress_poor, c->compress_nomem);
     tmh_copy_to_client_buf_offset(buf,off+sum,info,n+1);
@@ -2212,7 +2394,7 @@ static int tmemc_list_global(tmem_cli_va_param_t buf, int off, uint32_t len,
         n += scnprintf(info+n,BSIZE-n,
           "Ec:%ld,Em:%ld,Oc:%d,Om:%d,Nc:%d,Nm:%d,Pc:%d,Pm:%d,"
           "Fc:%d,Fm:%d,Sc:%d,Sm:%d,Ep:%lu,Gd:%lu,Zt:%lu,Gz:%lu\n",
-          global_eph_count, global_eph_count_max,
+          (long)_atomic_read(global_eph_count), global_eph_count_max,
           _atomic_read(global_obj_count), global_obj_count_max,
           _atomic_read(global_rtree_node_count), global_rtree_node_count_max,
           _atomic_read(global_pgp_count), global_pgp_count_max,
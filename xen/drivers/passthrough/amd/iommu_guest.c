@@ -808,6 +808,10 @@ int guest_iommu_set_base(struct domain *d, uint64_t base)
     if ( !iommu )
         return -EACCES;
 
+    if ( relocate_mmio_handler(d, &iommu_mmio_handler, iommu->mmio_base,
+                               base, IOMMU_MMIO_SIZE) )
+        return -ENOMEM;
+
     iommu->mmio_base = base;
     base >>= PAGE_SHIFT;
 
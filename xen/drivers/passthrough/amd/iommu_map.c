@@ -435,12 +435,12 @@ static int iommu_merge_pages(struct domain *d, unsigned long pt_mfn,
     return 0;
 }
 
-/* Walk io page tables and build level page tables if necessary
- * {Re, un}mapping super page frames causes re-allocation of io
- * page tables.
+/* Walk io page tables down to level @target and build level page tables
+ * if necessary.  {Re, un}mapping super page frames causes re-allocation of
+ * io page tables.
  */
 static int iommu_pde_from_gfn(struct domain *d, unsigned long pfn, 
-                              unsigned long pt_mfn[])
+                              unsigned int target, unsigned long pt_mfn[])
 {
     u64 *pde, *next_table_vaddr;
     unsigned long  next_table_mfn;
@@ -456,13 +456,13 @@ static int iommu_pde_from_gfn(struct domain *d, unsigned long pfn,
 
     next_table_mfn = page_to_mfn(table);
 
-    if ( level == IOMMU_PAGING_MODE_LEVEL_1 )
+    if ( level == target )
     {
         pt_mfn[level] = next_table_mfn;
         return 0;
     }
 
-    while ( level > IOMMU_PAGING_MODE_LEVEL_1 )
+    while ( level > target )
     {
         unsigned int next_level = level - 1;
         pt_mfn[level] = next_table_mfn;
@@ -538,7 +538,7 @@ static int iommu_pde_from_gfn(struct domain *d, unsigned long pfn,
         level--;
     }
 
-    /* mfn of level 1 page table */
+    /* mfn of the level @target page table */
     pt_mfn[level] = next_table_mfn;
     return 0;
 }
@@ -656,7 +656,8 @@ int amd_iommu_map_page(struct domain *d, unsigned long gfn, unsigned long mfn,
         }
     }
 
-    if ( iommu_pde_from_gfn(d, gfn, pt_mfn) || (pt_mfn[1] == 0) )
+    if ( iommu_pde_from_gfn(d, gfn, IOMMU_PAGING_MODE_LEVEL_1, pt_mfn) ||
+         (pt_mfn[1] == 0) )
     {
         spin_unlock(&hd->mapping_lock);
         AMD_IOMMU_DEBUG("Invalid IO pagetable entry gfn = %lx\n", gfn);
@@ -733,7 +734,8 @@ int amd_iommu_unmap_page(struct domain *d, unsigned long gfn)
         }
     }
 
-    if ( iommu_pde_from_gfn(d, gfn, pt_mfn) || (pt_mfn[1] == 0) )
+    if ( iommu_pde_from_gfn(d, gfn, IOMMU_PAGING_MODE_LEVEL_1, pt_mfn) ||
+         (pt_mfn[1] == 0) )
     {
         spin_unlock(&hd->mapping_lock);
         AMD_IOMMU_DEBUG("Invalid IO pagetable entry gfn = %lx\n", gfn);
@@ -750,6 +752,157 @@ int amd_iommu_unmap_page(struct domain *d, unsigned long gfn)
     return 0;
 }
 
+/*
+ * Largest page order, up to 1G and the levels the domain's table has, which
+ * @gfn and @mfn are both aligned to and which fits in @nr pages.
+ */
+static unsigned int amd_iommu_page_order(struct domain *d, unsigned long gfn,
+                                         unsigned long mfn, unsigned long nr)
+{
+    struct hvm_iommu *hd = domain_hvm_iommu(d);
+    unsigned int order = 0;
+
+    if ( iommu_superpages )
+        order = min(hd->paging_mode - 1, 2) * PTE_PER_TABLE_SHIFT;
+
+    while ( order &&
+            (((gfn | mfn) & ((1UL << order) - 1)) || nr < (1UL << order)) )
+        order -= PTE_PER_TABLE_SHIFT;
+
+    return order;
+}
+
+/*
+ * Set or (for a zero @flags) clear the level (@order / PTE_PER_TABLE_SHIFT
+ * + 1) entry for @gfn.  Returns whether the IOTLB needs flushing, or
+ * -errno.
+ */
+static int iommu_set_pde(struct domain *d, unsigned long gfn,
+                         unsigned long mfn, unsigned int order,
+                         unsigned int flags)
+{
+    unsigned int level = order / PTE_PER_TABLE_SHIFT + 1;
+    unsigned long pt_mfn[7], old_table = 0;
+    u64 *table, *pte;
+    int need_flush = 0;
+
+    memset(pt_mfn, 0, sizeof(pt_mfn));
+
+    if ( iommu_pde_from_gfn(d, gfn, level, pt_mfn) || (pt_mfn[level] == 0) )
+    {
+        AMD_IOMMU_DEBUG("Invalid IO pagetable entry gfn = %lx\n", gfn);
+        return -EFAULT;
+    }
+
+    table = map_domain_page(pt_mfn[level]);
+    pte = table + pfn_to_pde_idx(gfn, level);
+
+    if ( level > IOMMU_PAGING_MODE_LEVEL_1 && iommu_is_pte_present((u32*)pte) &&
+         iommu_next_level((u32*)pte) != IOMMU_PAGING_MODE_LEVEL_0 )
+        old_table = amd_iommu_get_next_table_from_pte((u32*)pte) >> PAGE_SHIFT;
+
+    if ( flags )
+        need_flush = set_iommu_pde_present((u32*)pte, mfn,
+                                           IOMMU_PAGING_MODE_LEVEL_0,
+                                           !!(flags & IOMMUF_writable),
+                                           !!(flags & IOMMUF_readable));
+    else if ( iommu_is_pte_present((u32*)pte) )
+    {
+        *pte = 0;
+        need_flush = 1;
+    }
+    unmap_domain_page(table);
+
+    /* The smaller pages' table goes once nothing can be using it. */
+    if ( old_table )
+    {
+        amd_iommu_flush_pages(d, gfn, order);
+        deallocate_next_page_table(mfn_to_page(old_table), level - 1);
+    }
+
+    return need_flush;
+}
+
+/*
+ * Map or unmap 2^@order pages with the largest pages which fit, and flush
+ * the IOTLB once for the whole range.
+ */
+static int iommu_update_pages(struct domain *d, unsigned long gfn,
+                              unsigned long mfn, unsigned int order,
+                              unsigned int flags)
+{
+    struct hvm_iommu *hd = domain_hvm_iommu(d);
+    unsigned long i, nr = 1UL << order;
+    unsigned int pg_order;
+    bool_t need_flush = 0;
+    int rc = 0;
+
+    BUG_ON( !hd->root_table );
+
+    if ( iommu_use_hap_pt(d) )
+        return 0;
+
+    spin_lock(&hd->mapping_lock);
+
+    /* Since HVM domain is initialized with 2 level IO page table,
+     * we might need a deeper page table for lager gfn now */
+    if ( is_hvm_domain(d) && update_paging_mode(d, gfn + nr - 1) )
+    {
+        spin_unlock(&hd->mapping_lock);
+        AMD_IOMMU_DEBUG("Update page mode failed gfn = %lx\n", gfn);
+        domain_crash(d);
+        return -EFAULT;
+    }
+
+    for ( i = 0; i < nr; i += 1UL << pg_order )
+    {
+        pg_order = amd_iommu_page_order(d, gfn + i, flags ? mfn + i : 0,
+                                        nr - i);
+        rc = iommu_set_pde(d, gfn + i, mfn + i, pg_order, flags);
+        if ( rc < 0 )
+            break;
+        need_flush |= rc;
+    }
+
+    spin_unlock(&hd->mapping_lock);
+
+    if ( rc < 0 )
+    {
+        domain_crash(d);
+        return rc;
+    }
+
+    /* As in amd_iommu_map_page(), new mappings for PV guests need none. */
+    if ( need_flush && (!flags || is_hvm_domain(d)) )
+        amd_iommu_flush_pages(d, gfn, order);
+
+    return 0;
+}
+
+int amd_iommu_map_pages(struct domain *d, unsigned long gfn,
+                        unsigned long mfn, unsigned int order,
+                        unsigned int flags)
+{
+    /* 4K mappings go through the page coalescing in amd_iommu_map_page(). */
+    if ( !order )
+        return amd_iommu_map_page(d, gfn, mfn, flags);
+
+    /* Should never be asked for, but would look like an unmap below. */
+    if ( !(flags & (IOMMUF_readable | IOMMUF_writable)) )
+        return -EINVAL;
+
+    return iommu_update_pages(d, gfn, mfn, order, flags);
+}
+
+int amd_iommu_unmap_pages(struct domain *d, unsigned long gfn,
+                          unsigned int order)
+{
+    if ( !order )
+        return amd_iommu_unmap_page(d, gfn);
+
+    return iommu_update_pages(d, gfn, 0, order, 0);
+}
+
 int amd_iommu_reserve_domain_unity_map(struct domain *domain,
                                        u64 phys_addr,
                                        unsigned long size, int iw, int ir)
@@ -393,7 +393,7 @@ static int amd_iommu_assign_device(struct domain *d, u16 seg, u8 bus, u8 devfn)
     return reassign_device(dom0, d, seg, bus, devfn);
 }
 
-static void deallocate_next_page_table(struct page_info* pg, int level)
+void deallocate_next_page_table(struct page_info* pg, int level)
 {
     void *table_vaddr, *pde;
     u64 next_table_maddr;
@@ -593,6 +593,8 @@ const struct iommu_ops amd_iommu_ops = {
     .teardown = amd_iommu_domain_destroy,
     .map_page = amd_iommu_map_page,
     .unmap_page = amd_iommu_unmap_page,
+    .map_pages = amd_iommu_map_pages,
+    .unmap_pages = amd_iommu_unmap_pages,
     .reassign_device = amd_iommu_return_device,
     .get_device_group_id = amd_iommu_group_id,
     .update_ire_from_apic = amd_iommu_ioapic_update_ire,
@@ -39,6 +39,7 @@ static void iommu_dump_p2m_table(unsigned char key);
  *   no-snoop                   Disable VT-d Snoop Control
  *   no-qinval                  Disable VT-d Queued Invalidation
  *   no-intremap                Disable VT-d Interrupt Remapping
+ *   no-superpages              Map guest memory with 4K IOMMU pages only
  */
 custom_param("iommu", parse_iommu_param);
 bool_t __initdata iommu_enable = 1;
@@ -52,6 +53,7 @@ bool_t __read_mostly iommu_snoop = 1;
 bool_t __read_mostly iommu_qinval = 1;
 bool_t __read_mostly iommu_intremap = 1;
 bool_t __read_mostly iommu_hap_pt_share = 1;
+bool_t __read_mostly iommu_superpages = 1;
 bool_t __read_mostly iommu_debug;
 bool_t __read_mostly amd_iommu_perdev_intremap;
 
@@ -105,6 +107,8 @@ static void __init parse_iommu_param(char *s)
             iommu_dom0_strict = val;
         else if ( !strcmp(s, "sharept") )
             iommu_hap_pt_share = val;
+        else if ( !strcmp(s, "superpages") )
+            iommu_superpages = val;
 
         s = ss + 1;
     } while ( ss );
@@ -337,6 +341,64 @@ int iommu_unmap_page(struct domain *d, unsigned long gfn)
     return hd->platform_ops->unmap_page(d, gfn);
 }
 
+/*
+ * Map 2^order frames with one call into the IOMMU code, which can use
+ * superpages where the range allows and flushes the IOTLB once for the
+ * whole range (unless the caller has set iommu_dont_flush_iotlb).
+ */
+int iommu_map_pages(struct domain *d, unsigned long gfn, unsigned long mfn,
+                    unsigned int order, unsigned int flags)
+{
+    struct hvm_iommu *hd = domain_hvm_iommu(d);
+    const struct iommu_ops *ops = hd->platform_ops;
+    bool_t dont_flush;
+    unsigned long i;
+    int rc = 0;
+
+    if ( !iommu_enabled || !ops )
+        return 0;
+
+    if ( ops->map_pages )
+        return ops->map_pages(d, gfn, mfn, order, flags);
+
+    dont_flush = this_cpu(iommu_dont_flush_iotlb);
+    this_cpu(iommu_dont_flush_iotlb) = 1;
+    for ( i = 0; !rc && i < (1UL << order); i++ )
+        rc = ops->map_page(d, gfn + i, mfn + i, flags);
+    this_cpu(iommu_dont_flush_iotlb) = dont_flush;
+
+    if ( !dont_flush )
+        iommu_iotlb_flush(d, gfn, 1UL << order);
+
+    return rc;
+}
+
+int iommu_unmap_pages(struct domain *d, unsigned long gfn, unsigned int order)
+{
+    struct hvm_iommu *hd = domain_hvm_iommu(d);
+    const struct iommu_ops *ops = hd->platform_ops;
+    bool_t dont_flush;
+    unsigned long i;
+    int rc = 0;
+
+    if ( !iommu_enabled || !ops )
+        return 0;
+
+    if ( ops->unmap_pages )
+        return ops->unmap_pages(d, gfn, order);
+
+    dont_flush = this_cpu(iommu_dont_flush_iotlb);
+    this_cpu(iommu_dont_flush_iotlb) = 1;
+    for ( i = 0; i < (1UL << order); i++ )
+        rc = ops->unmap_page(d, gfn + i) ? : rc;
+    this_cpu(iommu_dont_flush_iotlb) = dont_flush;
+
+    if ( !dont_flush )
+        iommu_iotlb_flush(d, gfn, 1UL << order);
+
+    return rc;
+}
+
 void iommu_iotlb_flush(struct domain *d, unsigned long gfn, unsigned int page_count)
 {
     struct hvm_iommu *hd = domain_hvm_iommu(d);
@@ -244,7 +244,61 @@ static u64 bus_to_context_maddr(struct iommu *iommu, u8 bus)
     return maddr;
 }
 
-static u64 addr_to_dma_page_maddr(struct domain *domain, u64 addr, int alloc)
+/* Largest page order which every VT-d unit can map with one entry. */
+static unsigned int __read_mostly vtd_max_page_order;
+
+/*
+ * Replace the superpage at @pte, an entry in a level @level table, with a
+ * table one level down which maps the same frames with the same
+ * permissions.  Returns the new table's machine address, or 0.
+ */
+static u64 dma_split_superpage(struct domain *domain, struct dma_pte *pte,
+                               int level)
+{
+    struct acpi_drhd_unit *drhd;
+    struct pci_dev *pdev;
+    struct dma_pte *table;
+    u64 maddr, attr;
+    int i;
+
+    pdev = pci_get_pdev_by_domain(domain, -1, -1, -1);
+    drhd = acpi_find_matched_drhd_unit(pdev);
+    maddr = alloc_pgtable_maddr(drhd, 1);
+    if ( !maddr )
+        return 0;
+
+    attr = pte->val & ~PAGE_MASK_4K;
+    if ( level == 2 )
+        attr &= ~DMA_PTE_SP;
+
+    table = (struct dma_pte *)map_vtd_domain_page(maddr);
+    for ( i = 0; i < PTE_NUM; i++ )
+        table[i].val = (dma_pte_addr(*pte) +
+                        offset_level_address(i, level - 1)) | attr;
+    iommu_flush_cache_page(table, 1);
+    unmap_vtd_domain_page(table);
+
+    pte->val = 0;
+    dma_set_pte_addr(*pte, maddr);
+    dma_set_pte_readable(*pte);
+    dma_set_pte_writable(*pte);
+    iommu_flush_cache_entry(pte, sizeof(struct dma_pte));
+
+    return maddr;
+}
+
+/*
+ * Return the machine address of the table holding the level @target entry
+ * (1 for a 4K page, 2 for 2M, 3 for 1G) for @addr, or 0 if there is none.
+ * Missing tables are allocated if @alloc.  Superpages above @target are
+ * split, as the caller is about to change part of what they map.  If a
+ * split can't be done when unmapping (!@alloc), the whole superpage is
+ * cleared instead and *@rc set to -ENOMEM, so that nothing stays mapped
+ * which the caller meant to unmap; the caller has to flush all of the
+ * domain's IOTLB entries.
+ */
+static u64 addr_to_dma_table_maddr(struct domain *domain, u64 addr,
+                                   int target, int alloc, int *rc)
 {
     struct acpi_drhd_unit *drhd;
     struct pci_dev *pdev;
@@ -270,8 +324,11 @@ static u64 addr_to_dma_page_maddr(struct domain *domain, u64 addr, int alloc)
             goto out;
     }
 
+    if ( level == target )
+        return hd->pgd_maddr;
+
     parent = (struct dma_pte *)map_vtd_domain_page(hd->pgd_maddr);
-    while ( level > 1 )
+    while ( level > target )
     {
         offset = address_level_offset(addr, level);
         pte = &parent[offset];
@@ -298,12 +355,27 @@ static u64 addr_to_dma_page_maddr(struct domain *domain, u64 addr, int alloc)
             dma_set_pte_writable(*pte);
             iommu_flush_cache_entry(pte, sizeof(struct dma_pte));
         }
+        else if ( dma_pte_superpage(*pte) )
+        {
+            maddr = dma_split_superpage(domain, pte, level);
+            if ( !maddr )
+            {
+                if ( !alloc )
+                {
+                    dma_clear_pte(*pte);
+                    iommu_flush_cache_entry(pte, sizeof(struct dma_pte));
+                    *rc = -ENOMEM;
+                }
+                break;
+            }
+            vaddr = map_vtd_domain_page(maddr);
+        }
         else
         {
             vaddr = map_vtd_domain_page(pte->val);
         }
 
-        if ( level == 2 )
+        if ( level == target + 1 )
         {
             pte_maddr = pte->val & PAGE_MASK_4K;
             unmap_vtd_domain_page(vaddr);
@@ -321,6 +393,7 @@ static u64 addr_to_dma_page_maddr(struct domain *domain, u64 addr, int alloc)
     return pte_maddr;
 }
 
+
 static void iommu_flush_write_buffer(struct iommu *iommu)
 {
     u32 val;
@@ -588,7 +661,9 @@ static void __intel_iommu_iotlb_flush(struct domain *d, unsigned long gfn,
         if ( iommu_domid == -1 )
             continue;
 
-        if ( page_count > 1 || gfn == -1 )
+        /* A naturally aligned power of two pages is one PSI flush. */
+        if ( !page_count || (page_count & (page_count - 1)) ||
+             (gfn & (page_count - 1)) || gfn == -1 )
         {
             if ( iommu_flush_iotlb_dsi(iommu, iommu_domid,
                         0, flush_dev_iotlb) )
@@ -597,7 +672,8 @@ static void __intel_iommu_iotlb_flush(struct domain *d, unsigned long gfn,
         else
         {
             if ( iommu_flush_iotlb_psi(iommu, iommu_domid,
-                        (paddr_t)gfn << PAGE_SHIFT_4K, 0,
+                        (paddr_t)gfn << PAGE_SHIFT_4K,
+                        get_order_from_pages(page_count),
                         !dma_old_pte_present, flush_dev_iotlb) )
                 iommu_flush_write_buffer(iommu);
         }
@@ -614,56 +690,81 @@ static void intel_iommu_iotlb_flush_all(struct domain *d)
     __intel_iommu_iotlb_flush(d, 0, 0, 0);
 }
 
-/* clear one page's page table */
-static void dma_pte_clear_one(struct domain *domain, u64 addr)
+static void iommu_free_pagetable(u64 pt_maddr, int level);
+
+/*
+ * Clear the level (@order / LEVEL_STRIDE + 1) entry mapping @gfn.  Sets
+ * *@flush if the IOTLB needs flushing for it.
+ */
+static int dma_pte_clear(struct domain *domain, unsigned long gfn,
+                         unsigned int order, int *flush)
 {
     struct hvm_iommu *hd = domain_hvm_iommu(domain);
-    struct dma_pte *page = NULL, *pte = NULL;
+    struct dma_pte *page = NULL, *pte = NULL, old;
+    int level = order / LEVEL_STRIDE + 1;
+    u64 addr = (paddr_t)gfn << PAGE_SHIFT_4K;
+    u64 end = addr + (PAGE_SIZE_4K << order) - 1;
     u64 pg_maddr;
-    struct mapped_rmrr *mrmrr;
+    struct mapped_rmrr *mrmrr, *tmp;
+    int rc = 0;
 
     spin_lock(&hd->mapping_lock);
-    /* get last level pte */
-    pg_maddr = addr_to_dma_page_maddr(domain, addr, 0);
+    pg_maddr = addr_to_dma_table_maddr(domain, addr, level, 0, &rc);
     if ( pg_maddr == 0 )
     {
         spin_unlock(&hd->mapping_lock);
-        return;
+        if ( rc )
+        {
+            /* A superpage around @gfn has gone altogether. */
+            __intel_iommu_iotlb_flush(domain, 0, 1, 0);
+            if ( domain->domain_id )
+                domain_crash(domain);
+        }
+        return rc;
     }
 
     page = (struct dma_pte *)map_vtd_domain_page(pg_maddr);
-    pte = page + address_level_offset(addr, 1);
+    pte = page + address_level_offset(addr, level);
+    old = *pte;
 
-    if ( !dma_pte_present(*pte) )
+    if ( !dma_pte_present(old) )
     {
         spin_unlock(&hd->mapping_lock);
         unmap_vtd_domain_page(page);
-        return;
+        return 0;
     }
 
     dma_clear_pte(*pte);
     spin_unlock(&hd->mapping_lock);
     iommu_flush_cache_entry(pte, sizeof(struct dma_pte));
-
-    if ( !this_cpu(iommu_dont_flush_iotlb) )
-        __intel_iommu_iotlb_flush(domain, addr >> PAGE_SHIFT_4K , 0, 1);
-
     unmap_vtd_domain_page(page);
+    *flush = 1;
+
+    /*
+     * A table of smaller pages which was mapped here can only be freed once
+     * the IOTLB and paging-structure caches no longer refer to it.
+     */
+    if ( level > 1 && !dma_pte_superpage(old) )
+    {
+        __intel_iommu_iotlb_flush(domain, gfn, 1, 1U << order);
+        iommu_free_pagetable(dma_pte_addr(old), level - 1);
+    }
 
     /* if the cleared address is between mapped RMRR region,
      * remove the mapped RMRR
      */
     spin_lock(&hd->mapping_lock);
-    list_for_each_entry ( mrmrr, &hd->mapped_rmrrs, list )
+    list_for_each_entry_safe ( mrmrr, tmp, &hd->mapped_rmrrs, list )
     {
-        if ( addr >= mrmrr->base && addr <= mrmrr->end )
+        if ( addr <= mrmrr->end && end >= mrmrr->base )
         {
             list_del(&mrmrr->list);
             xfree(mrmrr);
-            break;
         }
     }
     spin_unlock(&hd->mapping_lock);
+
+    return 0;
 }
 
 static void iommu_free_pagetable(u64 pt_maddr, int level)
@@ -683,7 +784,7 @@ static void iommu_free_pagetable(u64 pt_maddr, int level)
         if ( !dma_pte_present(*pte) )
             continue;
 
-        if ( next_level >= 1 )
+        if ( next_level >= 1 && !dma_pte_superpage(*pte) )
             iommu_free_pagetable(dma_pte_addr(*pte), next_level);
 
         dma_clear_pte(*pte);
@@ -1350,7 +1451,7 @@ int domain_context_mapping_one(
         /* Ensure we have pagetables allocated down to leaf PTE. */
         if ( hd->pgd_maddr == 0 )
         {
-            addr_to_dma_page_maddr(domain, 0, 1);
+            addr_to_dma_table_maddr(domain, 0, 1, 1, NULL);
             if ( hd->pgd_maddr == 0 )
             {
             nomem:
@@ -1707,37 +1808,37 @@ void iommu_domain_teardown(struct domain *d)
     spin_unlock(&hd->mapping_lock);
 }
 
-static int intel_iommu_map_page(
-    struct domain *d, unsigned long gfn, unsigned long mfn,
-    unsigned int flags)
+/*
+ * Map @mfn at @gfn with a level (@order / LEVEL_STRIDE + 1) entry.  Sets
+ * *@flush to 1 if only non-present entries changed, or 2 if a present one
+ * did.
+ */
+static int dma_pte_set(struct domain *d, unsigned long gfn, unsigned long mfn,
+                       unsigned int order, unsigned int flags, int *flush)
 {
     struct hvm_iommu *hd = domain_hvm_iommu(d);
     struct dma_pte *page = NULL, *pte = NULL, old, new = { 0 };
+    int level = order / LEVEL_STRIDE + 1;
+    u64 addr = (paddr_t)gfn << PAGE_SHIFT_4K;
     u64 pg_maddr;
 
-    /* Do nothing if VT-d shares EPT page table */
-    if ( iommu_use_hap_pt(d) )
-        return 0;
-
-    /* do nothing if dom0 and iommu supports pass thru */
-    if ( iommu_passthrough && (d->domain_id == 0) )
-        return 0;
-
     spin_lock(&hd->mapping_lock);
 
-    pg_maddr = addr_to_dma_page_maddr(d, (paddr_t)gfn << PAGE_SHIFT_4K, 1);
+    pg_maddr = addr_to_dma_table_maddr(d, addr, level, 1, NULL);
     if ( pg_maddr == 0 )
     {
         spin_unlock(&hd->mapping_lock);
         return -ENOMEM;
     }
     page = (struct dma_pte *)map_vtd_domain_page(pg_maddr);
-    pte = page + (gfn & LEVEL_MASK);
+    pte = page + address_level_offset(addr, level);
     old = *pte;
     dma_set_pte_addr(new, (paddr_t)mfn << PAGE_SHIFT_4K);
     dma_set_pte_prot(new,
                      ((flags & IOMMUF_readable) ? DMA_PTE_READ  : 0) |
                      ((flags & IOMMUF_writable) ? DMA_PTE_WRITE : 0));
+    if ( level > 1 )
+        dma_set_pte_superpage(new);
 
     /* Set the SNP on leaf page table if Snoop Control available */
     if ( iommu_snoop )
@@ -1755,21 +1856,103 @@ static int intel_iommu_map_page(
     spin_unlock(&hd->mapping_lock);
     unmap_vtd_domain_page(page);
 
-    if ( !this_cpu(iommu_dont_flush_iotlb) )
-        __intel_iommu_iotlb_flush(d, gfn, dma_pte_present(old), 1);
+    if ( dma_pte_present(old) )
+        *flush = 2;
+    else if ( !*flush )
+        *flush = 1;
+
+    /* As in dma_pte_clear(), a table replaced by a superpage goes last. */
+    if ( level > 1 && dma_pte_present(old) && !dma_pte_superpage(old) )
+    {
+        __intel_iommu_iotlb_flush(d, gfn, 1, 1U << order);
+        iommu_free_pagetable(dma_pte_addr(old), level - 1);
+    }
 
     return 0;
 }
 
-static int intel_iommu_unmap_page(struct domain *d, unsigned long gfn)
+/*
+ * Largest page order, up to what the IOMMUs support, which @gfn and @mfn
+ * are both aligned to and which fits in @nr pages.
+ */
+static unsigned int dma_page_order(unsigned long gfn, unsigned long mfn,
+                                   unsigned long nr)
+{
+    unsigned int order = vtd_max_page_order;
+
+    while ( order &&
+            (((gfn | mfn) & ((1UL << order) - 1)) || nr < (1UL << order)) )
+        order -= LEVEL_STRIDE;
+
+    return order;
+}
+
+static int intel_iommu_map_pages(
+    struct domain *d, unsigned long gfn, unsigned long mfn,
+    unsigned int order, unsigned int flags)
+{
+    unsigned long i, nr = 1UL << order;
+    unsigned int pg_order;
+    int rc = 0, flush = 0;
+
+    /* Do nothing if VT-d shares EPT page table */
+    if ( iommu_use_hap_pt(d) )
+        return 0;
+
+    /* do nothing if dom0 and iommu supports pass thru */
+    if ( iommu_passthrough && (d->domain_id == 0) )
+        return 0;
+
+    for ( i = 0; i < nr; i += 1UL << pg_order )
+    {
+        pg_order = dma_page_order(gfn + i, mfn + i, nr - i);
+        rc = dma_pte_set(d, gfn + i, mfn + i, pg_order, flags, &flush);
+        if ( rc )
+            break;
+    }
+
+    if ( flush && !this_cpu(iommu_dont_flush_iotlb) )
+        __intel_iommu_iotlb_flush(d, gfn, flush > 1, nr);
+
+    return rc;
+}
+
+static int intel_iommu_map_page(
+    struct domain *d, unsigned long gfn, unsigned long mfn,
+    unsigned int flags)
 {
+    return intel_iommu_map_pages(d, gfn, mfn, 0, flags);
+}
+
+static int intel_iommu_unmap_pages(struct domain *d, unsigned long gfn,
+                                   unsigned int order)
+{
+    unsigned long i, nr = 1UL << order;
+    unsigned int pg_order;
+    int rc = 0, flush = 0;
+
     /* Do nothing if dom0 and iommu supports pass thru. */
     if ( iommu_passthrough && (d->domain_id == 0) )
         return 0;
 
-    dma_pte_clear_one(d, (paddr_t)gfn << PAGE_SHIFT_4K);
+    for ( i = 0; i < nr; i += 1UL << pg_order )
+    {
+        pg_order = dma_page_order(gfn + i, 0, nr - i);
+        rc = dma_pte_clear(d, gfn + i, pg_order, &flush);
+        if ( rc )
+            break;
+    }
 
-    return 0;
+    /* Entries went from present to not present: a real flush, not CM. */
+    if ( flush && !this_cpu(iommu_dont_flush_iotlb) )
+        __intel_iommu_iotlb_flush(d, gfn, 1, nr);
+
+    return rc;
+}
+
+static int intel_iommu_unmap_page(struct domain *d, unsigned long gfn)
+{
+    return intel_iommu_unmap_pages(d, gfn, 0);
 }
 
 void iommu_pte_flush(struct domain *d, u64 gfn, u64 *pte,
@@ -2129,10 +2312,16 @@ int __init intel_vtd_setup(void)
      * engines: Snoop Control, DMA passthrough, Queued Invalidation and
      * Interrupt Remapping.
      */
+    vtd_max_page_order = iommu_superpages ? 2 * LEVEL_STRIDE : 0;
     for_each_drhd_unit ( drhd )
     {
         iommu = drhd->iommu;
 
+        if ( !cap_sps_1gb(iommu->cap) && vtd_max_page_order > LEVEL_STRIDE )
+            vtd_max_page_order = LEVEL_STRIDE;
+        if ( !cap_sps_2mb(iommu->cap) )
+            vtd_max_page_order = 0;
+
         printk("Intel VT-d supported page sizes: 4kB");
         if (cap_sps_2mb(iommu->cap))
             printk(", 2MB");
@@ -2389,7 +2578,7 @@ static void vtd_dump_p2m_table_level(paddr_t pt_maddr, int level, paddr_t gpa,
             continue;
 
         address = gpa + offset_level_address(i, level);
-        if ( next_level >= 1 ) 
+        if ( next_level >= 1 && !dma_pte_superpage(*pte) )
             vtd_dump_p2m_table_level(dma_pte_addr(*pte), next_level, 
                                      address, indent + 1);
         else
@@ -2424,6 +2613,8 @@ const struct iommu_ops intel_iommu_ops = {
     .teardown = iommu_domain_teardown,
     .map_page = intel_iommu_map_page,
     .unmap_page = intel_iommu_unmap_page,
+    .map_pages = intel_iommu_map_pages,
+    .unmap_pages = intel_iommu_unmap_pages,
     .reassign_device = reassign_device_ownership,
     .get_device_group_id = intel_iommu_group_id,
     .update_ire_from_apic = io_apic_write_remap_rte,
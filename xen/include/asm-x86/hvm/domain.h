@@ -34,6 +34,7 @@
 #include <public/grant_table.h>
 #include <public/hvm/params.h>
 #include <public/hvm/save.h>
+#include <public/hvm/hvm_op.h>
 
 struct hvm_ioreq_page {
     spinlock_t lock;
@@ -41,13 +42,39 @@ struct hvm_ioreq_page {
     void *va;
 };
 
+#define NR_IO_RANGE_TYPES (HVMOP_IO_RANGE_PCI + 1)
+
+/* An emulator other than the default device model (HVMOP_*_ioreq_server) */
+struct hvm_ioreq_server {
+    struct list_head       list_entry;
+    ioservid_t             id;
+    domid_t                domid;          /* the emulator's domain */
+    struct hvm_ioreq_page  ioreq;
+    struct hvm_ioreq_page  bufioreq;
+    unsigned long          ioreq_gmfn;
+    unsigned long          bufioreq_gmfn;  /* 0 if no buffered ioreqs */
+    int                   *ioreq_evtchn;   /* one per vcpu */
+    int                    bufioreq_evtchn;
+    struct rangeset       *range[NR_IO_RANGE_TYPES];
+};
+
 struct hvm_domain {
     struct hvm_ioreq_page  ioreq;
     struct hvm_ioreq_page  buf_ioreq;
 
+    /*
+     * Secondary ioreq servers.  The list only changes with the domain
+     * paused, so the I/O paths walk it without taking the lock.
+     */
+    struct list_head       ioreq_server_list;
+    spinlock_t             ioreq_server_lock;
+    ioservid_t             ioreq_server_id;
+    unsigned long          ioreq_gmfn_mask; /* HVM_PARAM_IOREQ_SERVER_PFN.. */
+    uint32_t               pci_cf8;         /* last write to port 0xcf8 */
+
     struct pl_time         pl_time;
 
-    struct hvm_io_handler *io_handler;
+    struct hvm_io_handler  io_handler;
 
     /* Lock protects access to irq, vpic and vioapic. */
     spinlock_t             irq_lock;
@@ -35,8 +35,41 @@ struct hvm_emulate_ctxt {
     uint32_t intr_shadow;
 };
 
+/*
+ * Per-vCPU cache of recently emulated instructions.  A driver's MMIO
+ * accesses, or real-mode code under VMX, emulate the same few instructions
+ * over and over: a hit skips copying the instruction from the guest and
+ * x86_emulate()'s decode of it.
+ *
+ * Not every page table update, INVLPG or CR3 write exits (none do under
+ * HAP), so the cache can't behave like a TLB.  On every hit the linear
+ * address is walked again and must still map to the cached frames, and the
+ * instruction bytes are rechecked against those frames, so remapping and
+ * code modification are always noticed.  Flushing on control register and
+ * EFER updates and on intercepted INVLPGs just drops entries early.
+ */
+#define HVM_INSN_CACHE_ENTRIES 16
+
+struct hvm_insn_cache_entry {
+    unsigned long gen;          /* empty unless it matches the cache's */
+    unsigned long cr3, linear;
+    uint8_t addr_size;
+    bool_t user;
+    uint8_t nr_bytes;
+    uint8_t insn[16];
+    unsigned long gfn[2];       /* frames of the first and last byte */
+    struct x86_emulate_decode decode;
+};
+
+struct hvm_insn_cache {
+    unsigned long gen;
+    struct hvm_insn_cache_entry ent[HVM_INSN_CACHE_ENTRIES];
+};
+
 int hvm_emulate_one(
     struct hvm_emulate_ctxt *hvmemul_ctxt);
+int hvm_insn_cache_init(struct vcpu *v);
+void hvm_insn_cache_destroy(struct vcpu *v);
 void hvm_emulate_prepare(
     struct hvm_emulate_ctxt *hvmemul_ctxt,
     struct cpu_user_regs *regs);
@@ -211,6 +211,10 @@ int prepare_ring_for_helper(struct domain *d, unsigned long gmfn,
 void destroy_ring_for_helper(void **_va, struct page_info *page);
 
 bool_t hvm_send_assist_req(struct vcpu *v);
+void hvm_broadcast_assist_req(struct vcpu *v);
+struct ioreq;
+struct hvm_ioreq_server *hvm_select_ioreq_server(
+    struct domain *d, struct ioreq *p, uint8_t *type, uint64_t *addr);
 
 void hvm_get_guest_pat(struct vcpu *v, u64 *guest_pat);
 int hvm_set_guest_pat(struct vcpu *v, u64 guest_pat);
@@ -273,13 +277,17 @@ hvm_update_host_cr3(struct vcpu *v)
         hvm_funcs.update_host_cr3(v);
 }
 
+void hvm_insn_cache_flush(struct vcpu *v);
+
 static inline void hvm_update_guest_cr(struct vcpu *v, unsigned int cr)
 {
+    hvm_insn_cache_flush(v);
     hvm_funcs.update_guest_cr(v, cr);
 }
 
 static inline void hvm_update_guest_efer(struct vcpu *v)
 {
+    hvm_insn_cache_flush(v);
     hvm_funcs.update_guest_efer(v);
 }
 
@@ -25,10 +25,10 @@
 #include <public/hvm/ioreq.h>
 #include <public/event_channel.h>
 
-#define MAX_IO_HANDLER             16
-
 #define HVM_PORTIO                  0
+#define HVM_MMIO                    1
 #define HVM_BUFFERED_IO             2
+#define HVM_NR_IO_TYPES             3
 
 typedef int (*hvm_mmio_read_t)(struct vcpu *v,
                                unsigned long addr,
@@ -43,6 +43,7 @@ typedef int (*hvm_mmio_check_t)(struct vcpu *v, unsigned long addr);
 typedef int (*portio_action_t)(
     int dir, uint32_t port, uint32_t bytes, uint32_t *val);
 typedef int (*mmio_action_t)(ioreq_t *);
+struct hvm_mmio_handler;
 struct io_handler {
     int                 type;
     unsigned long       addr;
@@ -50,13 +51,21 @@ struct io_handler {
     union {
         portio_action_t portio;
         mmio_action_t   mmio;
+        const struct hvm_mmio_handler *ops;
         void           *ptr;
     } action;
+    unsigned int        refcnt;   /* 0: unregistered, skipped on lookup */
+    unsigned long       hits;     /* approximate, not atomically updated */
 };
 
+/*
+ * A domain's handlers, sorted by type and then address.  The table is
+ * copied on update and read under RCU; NULL until the first registration.
+ */
+struct hvm_io_table;
 struct hvm_io_handler {
-    int     num_slot;
-    struct  io_handler hdl_list[MAX_IO_HANDLER];
+    spinlock_t           lock;
+    struct hvm_io_table *table;
 };
 
 struct hvm_mmio_handler {
@@ -71,10 +80,14 @@ extern const struct hvm_mmio_handler vioapic_mmio_handler;
 extern const struct hvm_mmio_handler msixtbl_mmio_handler;
 extern const struct hvm_mmio_handler iommu_mmio_handler;
 
-#define HVM_MMIO_HANDLER_NR 5
-
 int hvm_io_intercept(ioreq_t *p, int type);
-void register_io_handler(
+void hvm_io_handler_init(struct domain *d);
+void hvm_io_handler_destroy(struct domain *d);
+void hvm_io_handler_dump(struct domain *d);
+int register_io_handler(
+    struct domain *d, unsigned long addr, unsigned long size,
+    void *action, int type);
+void unregister_io_handler(
     struct domain *d, unsigned long addr, unsigned long size,
     void *action, int type);
 void relocate_io_handler(
@@ -115,13 +128,38 @@ static inline void register_buffered_io_handler(
     register_io_handler(d, addr, size, action, HVM_BUFFERED_IO);
 }
 
+/*
+ * Emulated MMIO ranges.  The range only narrows down which handler to ask:
+ * the handler's check_handler() still has the final say, so a range may
+ * cover more than the device decodes for a particular vCPU (e.g. a vLAPIC
+ * which is hardware disabled).  Registering the same handler and range
+ * twice takes a reference; each registration needs its own unregister.
+ */
+static inline int register_mmio_handler(
+    struct domain *d, const struct hvm_mmio_handler *ops,
+    unsigned long addr, unsigned long size)
+{
+    return register_io_handler(d, addr, size, (void *)ops, HVM_MMIO);
+}
+
+static inline void unregister_mmio_handler(
+    struct domain *d, const struct hvm_mmio_handler *ops,
+    unsigned long addr, unsigned long size)
+{
+    unregister_io_handler(d, addr, size, (void *)ops, HVM_MMIO);
+}
+
+int relocate_mmio_handler(
+    struct domain *d, const struct hvm_mmio_handler *ops,
+    unsigned long old_addr, unsigned long new_addr, unsigned long size);
+
 void send_timeoffset_req(unsigned long timeoff);
 void send_invalidate_req(void);
 int handle_mmio(void);
 int handle_mmio_with_translation(unsigned long gva, unsigned long gpfn);
 int handle_pio(uint16_t port, int size, int dir);
 void hvm_interrupt_post(struct vcpu *v, int vector, int type);
-void hvm_io_assist(void);
+void hvm_io_assist(ioreq_t *p);
 void hvm_dpci_eoi(struct domain *d, unsigned int guest_irq,
                   union vioapic_redir_entry *ent);
 
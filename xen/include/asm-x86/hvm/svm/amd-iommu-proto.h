@@ -55,6 +55,12 @@ int amd_iommu_update_ivrs_mapping_acpi(void);
 int amd_iommu_map_page(struct domain *d, unsigned long gfn, unsigned long mfn,
                        unsigned int flags);
 int amd_iommu_unmap_page(struct domain *d, unsigned long gfn);
+int amd_iommu_map_pages(struct domain *d, unsigned long gfn,
+                        unsigned long mfn, unsigned int order,
+                        unsigned int flags);
+int amd_iommu_unmap_pages(struct domain *d, unsigned long gfn,
+                          unsigned int order);
+void deallocate_next_page_table(struct page_info *pg, int level);
 u64 amd_iommu_get_next_table_from_pte(u32 *entry);
 int amd_iommu_reserve_domain_unity_map(struct domain *domain,
                                        u64 phys_addr, unsigned long size,
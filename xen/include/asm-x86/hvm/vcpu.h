@@ -66,6 +66,9 @@ struct hvm_vcpu_io {
     /* We may write up to m256 as a number of device-model transactions. */
     unsigned int mmio_large_write_bytes;
     paddr_t mmio_large_write_pa;
+
+    /* Completion of a request whose ioreq server was destroyed under it. */
+    ioreq_t orphaned_ioreq;
 };
 
 #define VMCX_EADDR    (~0ULL)
@@ -162,6 +165,9 @@ struct hvm_vcpu {
 
     struct hvm_vcpu_io  hvm_io;
 
+    /* Recently emulated instructions (see asm/hvm/emulate.h), or NULL. */
+    struct hvm_insn_cache *insn_cache;
+
     /* Callback into x86_emulate when emulating FPU/MMX/XMM instructions. */
     void (*fpu_exception_callback)(void *, struct cpu_user_regs *);
     void *fpu_exception_callback_arg;
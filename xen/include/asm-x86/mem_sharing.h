@@ -57,6 +57,7 @@ struct page_sharing_info
 
 unsigned int mem_sharing_get_nr_saved_mfns(void);
 unsigned int mem_sharing_get_nr_shared_mfns(void);
+unsigned int mem_sharing_get_nr_cow_breaks(void);
 int mem_sharing_nominate_page(struct domain *d, 
                               unsigned long gfn,
                               int expected_refcnt,
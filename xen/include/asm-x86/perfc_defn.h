@@ -13,11 +13,16 @@ PERFCOUNTER_ARRAY(cause_vector,         "cause vector", VMX_PERF_VECTOR_SIZE)
 #define SVM_PERF_EXIT_REASON_SIZE (1+141)
 PERFCOUNTER_ARRAY(svmexits,             "SVMexits", SVM_PERF_EXIT_REASON_SIZE)
 
+PERFCOUNTER_HISTO(vmexit_cycles,        "vmexit handler cycles")
+PERFCOUNTER_HISTO(hvm_hypercall_cycles, "hvm hypercall cycles")
+
 PERFCOUNTER(seg_fixups,             "segmentation fixups")
 
 PERFCOUNTER(apic_timer,             "apic timer interrupts")
 
 PERFCOUNTER(domain_page_tlb_flush,  "domain page tlb flushes")
+PERFCOUNTER(remote_tlb_flushes,     "remote tlb flushes")
+PERFCOUNTER(remote_tlb_flush_wait_us, "remote tlb flush wait (us)")
 
 PERFCOUNTER(calls_to_mmuext_op,         "calls to mmuext_op")
 PERFCOUNTER(num_mmuext_ops,             "mmuext ops")
@@ -35,6 +40,9 @@ PERFCOUNTER(exception_fixed,        "pre-exception fixed")
 
 PERFCOUNTER(guest_walk,            "guest pagetable walks")
 
+PERFCOUNTER(hvm_insn_cache_hit,    "hvm emulated insn cache hits")
+PERFCOUNTER(hvm_insn_cache_miss,   "hvm emulated insn cache misses")
+
 /* Shadow counters */
 PERFCOUNTER(shadow_alloc,          "calls to shadow_alloc")
 PERFCOUNTER(shadow_alloc_tlbflush, "shadow_alloc flushed TLBs")
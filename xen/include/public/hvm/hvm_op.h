@@ -270,6 +270,76 @@ struct xen_hvm_inject_msi {
 typedef struct xen_hvm_inject_msi xen_hvm_inject_msi_t;
 DEFINE_XEN_GUEST_HANDLE(xen_hvm_inject_msi_t);
 
+/*
+ * Secondary ioreq servers.
+ *
+ * The default ioreq server of a domain is the device model set up through
+ * HVM_PARAM_IOREQ_PFN, HVM_PARAM_BUFIOREQ_PFN and HVM_PARAM_DM_DOMAIN.
+ * Further emulators can each create an ioreq server of their own and claim
+ * I/O port, MMIO and PCI device ranges; an I/O the hypervisor does not
+ * handle itself goes to the server which claimed it, or to the default
+ * server if none did.  Accesses to PCI config space through ports
+ * 0xcfc-0xcff of a claimed device arrive as IOREQ_TYPE_PCI_CONFIG, with
+ * the device and register taken from the last write to port 0xcf8.
+ *
+ * Each server has its own synchronous ioreq page, with one slot and event
+ * channel per vcpu as for the default server, and optionally a buffered
+ * ioreq page.  The pages come from the range set aside with
+ * HVM_PARAM_IOREQ_SERVER_PFN and HVM_PARAM_NR_IOREQ_SERVER_PAGES, and the
+ * emulator maps them as foreign pages.  Event channels are bound to the
+ * calling domain.
+ */
+typedef uint16_t ioservid_t;
+
+#define HVMOP_create_ioreq_server 17
+struct xen_hvm_create_ioreq_server {
+    domid_t domid;           /* IN - domain to be serviced */
+    uint8_t handle_bufioreq; /* IN - should the server get buffered ioreqs */
+    uint8_t pad;
+    ioservid_t id;           /* OUT - server id */
+};
+typedef struct xen_hvm_create_ioreq_server xen_hvm_create_ioreq_server_t;
+DEFINE_XEN_GUEST_HANDLE(xen_hvm_create_ioreq_server_t);
+
+#define HVMOP_get_ioreq_server_info 18
+struct xen_hvm_get_ioreq_server_info {
+    domid_t domid;                 /* IN - domain to be serviced */
+    ioservid_t id;                 /* IN - server id */
+    uint32_t bufioreq_port;        /* OUT - buffered ioreq event channel */
+    uint64_aligned_t ioreq_pfn;    /* OUT - sync ioreq pfn */
+    uint64_aligned_t bufioreq_pfn; /* OUT - buffered ioreq pfn, or 0 */
+};
+typedef struct xen_hvm_get_ioreq_server_info xen_hvm_get_ioreq_server_info_t;
+DEFINE_XEN_GUEST_HANDLE(xen_hvm_get_ioreq_server_info_t);
+
+#define HVMOP_map_io_range_to_ioreq_server     19
+#define HVMOP_unmap_io_range_from_ioreq_server 20
+struct xen_hvm_io_range {
+    domid_t domid;               /* IN - domain to be serviced */
+    ioservid_t id;               /* IN - server id */
+    uint32_t type;               /* IN - type of range */
+# define HVMOP_IO_RANGE_PORT   0 /* I/O port range */
+# define HVMOP_IO_RANGE_MEMORY 1 /* MMIO range */
+# define HVMOP_IO_RANGE_PCI    2 /* PCI segment/bus/dev/func range */
+    uint64_aligned_t start, end; /* IN - inclusive start and end of range */
+};
+typedef struct xen_hvm_io_range xen_hvm_io_range_t;
+DEFINE_XEN_GUEST_HANDLE(xen_hvm_io_range_t);
+
+#define HVMOP_PCI_SBDF(s,b,d,f)                 \
+    ((((s) & 0xffff) << 16) |                   \
+     (((b) & 0xff) << 8) |                      \
+     (((d) & 0x1f) << 3) |                      \
+     ((f) & 0x07))
+
+#define HVMOP_destroy_ioreq_server 21
+struct xen_hvm_destroy_ioreq_server {
+    domid_t domid; /* IN - domain to be serviced */
+    ioservid_t id; /* IN - server id */
+};
+typedef struct xen_hvm_destroy_ioreq_server xen_hvm_destroy_ioreq_server_t;
+DEFINE_XEN_GUEST_HANDLE(xen_hvm_destroy_ioreq_server_t);
+
 #endif /* defined(__XEN__) || defined(__XEN_TOOLS__) */
 
 #endif /* __XEN_PUBLIC_HVM_HVM_OP_H__ */
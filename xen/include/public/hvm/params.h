@@ -141,6 +141,10 @@
 #define HVM_PARAM_ACCESS_RING_PFN   28
 #define HVM_PARAM_SHARING_RING_PFN  29
 
-#define HVM_NR_PARAMS          30
+/* Pages set aside for secondary ioreq servers (see HVMOP_create_ioreq_server) */
+#define HVM_PARAM_IOREQ_SERVER_PFN      30
+#define HVM_PARAM_NR_IOREQ_SERVER_PAGES 31
+
+#define HVM_NR_PARAMS          32
 
 #endif /* __XEN_PUBLIC_HVM_PARAMS_H__ */
@@ -341,11 +341,21 @@ typedef struct xen_pod_target xen_pod_target_t;
  */
 #define XENMEM_get_sharing_freed_pages    18
 #define XENMEM_get_sharing_shared_pages   19
+/*
+ * Get the number of times a shared page had to be copied, because one of
+ * its sharers wrote to it.  The call never fails.
+ */
+#define XENMEM_get_sharing_cow_breaks     26
 
 #define XENMEM_paging_op                    20
 #define XENMEM_paging_op_nominate           0
 #define XENMEM_paging_op_evict              1
 #define XENMEM_paging_op_prep               2
+#define XENMEM_paging_op_nominate_batch     3
+#define XENMEM_paging_op_evict_batch        4
+
+/* Maximum number of gfns in one XENMEM_paging_op_*_batch call */
+#define XENMEM_paging_batch_max             256
 
 #define XENMEM_access_op                    21
 #define XENMEM_access_op_resume             0
@@ -356,13 +366,27 @@ struct xen_mem_event_op {
     
 
     /* PAGING_PREP IN: buffer to immediately fill page in */
+    /* PAGING_*_BATCH IN: array of xen_mem_paging_batch_t */
     uint64_aligned_t    buffer;
+    /* PAGING_*_BATCH IN: number of entries in buffer */
     /* Other OPs */
     uint64_aligned_t    gfn;           /* IN:  gfn of page being operated on */
 };
 typedef struct xen_mem_event_op xen_mem_event_op_t;
 DEFINE_XEN_GUEST_HANDLE(xen_mem_event_op_t);
 
+/*
+ * One gfn of a XENMEM_paging_op_{nominate,evict}_batch call.  Every entry
+ * is operated on, and gets the result the single gfn op would have
+ * returned; the call itself only fails if the array can't be accessed.
+ */
+struct xen_mem_paging_batch {
+    uint64_aligned_t    gfn;           /* IN:  gfn of page being operated on */
+    int32_t             rc;            /* OUT: 0 or -errno */
+    uint32_t            _pad;
+};
+typedef struct xen_mem_paging_batch xen_mem_paging_batch_t;
+
 #define XENMEM_sharing_op                   22
 #define XENMEM_sharing_op_nominate_gfn      0
 #define XENMEM_sharing_op_nominate_gref     1
@@ -34,7 +34,7 @@
 #include "xen.h"
 #include "domctl.h"
 
-#define XEN_SYSCTL_INTERFACE_VERSION 0x00000009
+#define XEN_SYSCTL_INTERFACE_VERSION 0x0000000A
 
 /*
  * Read console content from Xen buffer ring.
@@ -128,7 +128,13 @@ DEFINE_XEN_GUEST_HANDLE(xen_sysctl_sched_id_t);
 struct xen_sysctl_perfc_desc {
     char         name[80];             /* name of perf counter */
     uint32_t     nr_vals;              /* number of values for this counter */
+    uint32_t     flags;                /* XEN_SYSCTL_PERFC_* */
 };
+/*
+ * The values are log2 histogram buckets: value 0 counts zeroes, value n
+ * counts samples in [2^(n-1), 2^n), and the last value all larger ones.
+ */
+#define XEN_SYSCTL_PERFC_histogram (1u << 0)
 typedef struct xen_sysctl_perfc_desc xen_sysctl_perfc_desc_t;
 DEFINE_XEN_GUEST_HANDLE(xen_sysctl_perfc_desc_t);
 typedef uint32_t xen_sysctl_perfc_val_t;
@@ -429,6 +435,17 @@ struct xen_sysctl_page_offline_op {
 /* Sub-operations: */
 #define XEN_SYSCTL_LOCKPROF_reset 1   /* Reset all profile data to zero. */
 #define XEN_SYSCTL_LOCKPROF_query 2   /* Get lock profile information. */
+/*
+ * Runtime contention sampling.  Unlike the operations above, these don't
+ * need a lock_profile=y build.  While enabled, one in every 'period'
+ * spinlock acquisitions on each CPU is sampled for its hold time, and every
+ * acquisition which had to wait is recorded with its wait time.  Samples are
+ * kept per lock and call site.
+ */
+#define XEN_SYSCTL_LOCKPROF_sample_enable  3 /* IN: period */
+#define XEN_SYSCTL_LOCKPROF_sample_disable 4
+#define XEN_SYSCTL_LOCKPROF_sample_reset   5
+#define XEN_SYSCTL_LOCKPROF_sample_query   6 /* OUT: period, 0 if disabled */
 /* Record-type: */
 #define LOCKPROF_TYPE_GLOBAL      0   /* global lock, idx meaningless */
 #define LOCKPROF_TYPE_PERDOM      1   /* per-domain lock, idx is domid */
@@ -444,6 +461,27 @@ struct xen_sysctl_lockprof_data {
 };
 typedef struct xen_sysctl_lockprof_data xen_sysctl_lockprof_data_t;
 DEFINE_XEN_GUEST_HANDLE(xen_sysctl_lockprof_data_t);
+/*
+ * Histogram buckets are log2 of nanoseconds: bucket 0 counts times under
+ * 1ns, bucket n times in [2^(n-1), 2^n), and the last bucket longer ones.
+ */
+#define XEN_SYSCTL_LOCKPROF_BUCKETS 32
+struct xen_sysctl_lock_sample {
+    uint64_aligned_t lock;         /* address of the lock */
+    uint64_aligned_t site;         /* address it was taken from */
+    char     site_name[64];        /* symbol+offset of site */
+    uint32_t domid;                /* domain the lock is part of, or
+                                      DOMID_INVALID */
+    uint32_t pad;
+    uint64_aligned_t sampled;      /* # of acquisitions sampled */
+    uint64_aligned_t contended;    /* # of acquisitions which waited */
+    uint64_aligned_t hold_time;    /* nsecs held, sampled acquisitions */
+    uint64_aligned_t wait_time;    /* nsecs waited, contended acquisitions */
+    uint32_t hold_hist[XEN_SYSCTL_LOCKPROF_BUCKETS];
+    uint32_t wait_hist[XEN_SYSCTL_LOCKPROF_BUCKETS];
+};
+typedef struct xen_sysctl_lock_sample xen_sysctl_lock_sample_t;
+DEFINE_XEN_GUEST_HANDLE(xen_sysctl_lock_sample_t);
 struct xen_sysctl_lockprof_op {
     /* IN variables. */
     uint32_t       cmd;               /* XEN_SYSCTL_LOCKPROF_??? */
@@ -453,6 +491,12 @@ struct xen_sysctl_lockprof_op {
     uint64_aligned_t time;            /* nsecs of profile measurement */
     /* profile information (or NULL) */
     XEN_GUEST_HANDLE_64(xen_sysctl_lockprof_data_t) data;
+    /* Sampling: acquisitions per sample (IN enable, OUT sample_query). */
+    uint32_t       period;
+    /* OUT: samples dropped for lack of table space (sample_query). */
+    uint32_t       dropped;
+    /* sample information, by lock and site (or NULL; sample_query only) */
+    XEN_GUEST_HANDLE_64(xen_sysctl_lock_sample_t) samples;
 };
 typedef struct xen_sysctl_lockprof_op xen_sysctl_lockprof_op_t;
 DEFINE_XEN_GUEST_HANDLE(xen_sysctl_lockprof_op_t);
@@ -0,0 +1,38 @@
+#define XEN_COMPILE_DATE	"Sun Oct 18 08:34:51 UTC 2026"
+#define XEN_COMPILE_TIME	"08:34:51"
+#define XEN_COMPILE_BY		""
+#define XEN_COMPILE_DOMAIN	""
+#define XEN_COMPILE_HOST	"vm"
+#define XEN_COMPILER		"gcc (Debian 12.2.0-14+deb12u1) 12.2.0"
+
+#define XEN_VERSION		4
+#define XEN_SUBVERSION		3
+#define XEN_EXTRAVERSION	"-unstable"
+
+#define XEN_CHANGESET		"unavailable"
+#define XEN_BANNER		\
+"\040\137\137\040\040\137\137\040\040\040\040\040\040\040\040\040\040\040" \
+"\040\137\040\040\137\040\040\040\040\137\137\137\137\137\040\040\040\040" \
+"\040\040\040\040\040\040\040\040\040\040\040\040\040\040\040\040\137\040" \
+"\040\040\040\040\040\040\040\137\040\040\040\040\040\137\040\040\040\040" \
+"\040\040\012\040\134\040\134\057\040\057\137\137\137\040\137\040\137\137" \
+"\040\040\040\174\040\174\174\040\174\040\040\174\137\137\137\040\057\040" \
+"\040\040\040\137\040\040\040\137\040\137\040\137\137\040\040\137\137\137" \
+"\174\040\174\137\040\137\137\040\137\174\040\174\137\137\040\174\040\174" \
+"\040\137\137\137\040\012\040\040\134\040\040\057\057\040\137\040\134\040" \
+"\047\137\040\134\040\040\174\040\174\174\040\174\137\040\040\040\174\137" \
+"\040\134\040\137\137\174\040\174\040\174\040\174\040\047\137\040\134\057" \
+"\040\137\137\174\040\137\137\057\040\137\140\040\174\040\047\137\040\134" \
+"\174\040\174\057\040\137\040\134\012\040\040\057\040\040\134\040\040\137" \
+"\137\057\040\174\040\174\040\174\040\174\137\137\040\040\040\137\174\040" \
+"\137\137\137\051\040\174\137\137\174\040\174\137\174\040\174\040\174\040" \
+"\174\040\134\137\137\040\134\040\174\174\040\050\137\174\040\174\040\174" \
+"\137\051\040\174\040\174\040\040\137\137\057\012\040\057\137\057\134\137" \
+"\134\137\137\137\174\137\174\040\174\137\174\040\040\040\040\174\137\174" \
+"\050\137\051\137\137\137\137\057\040\040\040\040\134\137\137\054\137\174" \
+"\137\174\040\174\137\174\137\137\137\057\134\137\137\134\137\137\054\137" \
+"\174\137\056\137\137\057\174\137\174\134\137\137\137\174\012\040\040\040" \
+"\040\040\040\040\040\040\040\040\040\040\040\040\040\040\040\040\040\040" \
+"\040\040\040\040\040\040\040\040\040\040\040\040\040\040\040\040\040\040" \
+"\040\040\040\040\040\040\040\040\040\040\040\040\040\040\040\040\040\040" \
+"\040\040\040\040\040\040\040\040\040\040\040\040\040\040\040\040\040\012"
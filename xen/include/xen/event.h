@@ -9,6 +9,7 @@
 #ifndef __XEN_EVENT_H__
 #define __XEN_EVENT_H__
 
+#include <xen/errno.h>
 #include <xen/sched.h>
 #include <xen/smp.h>
 #include <xen/softirq.h>
@@ -70,14 +71,91 @@ int guest_enabled_event(struct vcpu *v, uint32_t virq);
 void notify_via_xen_event_channel(struct domain *ld, int lport);
 
 /* Internal event channel object accessors */
+#define group_from_port(d,p) \
+    ((d)->evtchn_group[(p)/EVTCHNS_PER_GROUP])
 #define bucket_from_port(d,p) \
-    ((d)->evtchn[(p)/EVTCHNS_PER_BUCKET])
+    (group_from_port(d,p)[((p)%EVTCHNS_PER_GROUP)/EVTCHNS_PER_BUCKET])
 #define port_is_valid(d,p)    \
     (((p) >= 0) && ((p) < MAX_EVTCHNS(d)) && \
+     (group_from_port(d,p) != NULL) && \
      (bucket_from_port(d,p) != NULL))
 #define evtchn_from_port(d,p) \
     (&(bucket_from_port(d,p))[(p)&(EVTCHNS_PER_BUCKET-1)])
 
+/* Wake any VCPUs polling on the given port. */
+void evtchn_check_pollers(struct domain *d, unsigned int port);
+
+/*
+ * Low-level event channel port ops.  These implement the guest-visible
+ * layout of pending and mask state: the 2-level bitmaps in shared_info
+ * (common/event_2l.c) or the FIFO queues (common/event_fifo.c).
+ */
+struct evtchn_port_ops {
+    void (*init)(struct domain *d, struct evtchn *evtchn);
+    void (*set_pending)(struct vcpu *v, struct evtchn *evtchn);
+    void (*clear_pending)(struct domain *d, struct evtchn *evtchn);
+    void (*unmask)(struct domain *d, struct evtchn *evtchn);
+    bool_t (*is_pending)(struct domain *d, const struct evtchn *evtchn);
+    bool_t (*is_masked)(struct domain *d, const struct evtchn *evtchn);
+    int (*set_priority)(struct domain *d, struct evtchn *evtchn,
+                        unsigned int priority);
+    void (*print_state)(struct domain *d, const struct evtchn *evtchn);
+};
+
+void evtchn_2l_init(struct domain *d);
+
+static inline void evtchn_port_init(struct domain *d, struct evtchn *evtchn)
+{
+    if ( d->evtchn_port_ops->init )
+        d->evtchn_port_ops->init(d, evtchn);
+}
+
+static inline void evtchn_port_set_pending(struct vcpu *v,
+                                           struct evtchn *evtchn)
+{
+    v->domain->evtchn_port_ops->set_pending(v, evtchn);
+}
+
+static inline void evtchn_port_clear_pending(struct domain *d,
+                                             struct evtchn *evtchn)
+{
+    d->evtchn_port_ops->clear_pending(d, evtchn);
+}
+
+static inline void evtchn_port_unmask(struct domain *d,
+                                      struct evtchn *evtchn)
+{
+    d->evtchn_port_ops->unmask(d, evtchn);
+}
+
+static inline bool_t evtchn_port_is_pending(struct domain *d,
+                                            const struct evtchn *evtchn)
+{
+    return d->evtchn_port_ops->is_pending(d, evtchn);
+}
+
+static inline bool_t evtchn_port_is_masked(struct domain *d,
+                                           const struct evtchn *evtchn)
+{
+    return d->evtchn_port_ops->is_masked(d, evtchn);
+}
+
+static inline int evtchn_port_set_priority(struct domain *d,
+                                           struct evtchn *evtchn,
+                                           unsigned int priority)
+{
+    if ( !d->evtchn_port_ops->set_priority )
+        return -ENOSYS;
+    return d->evtchn_port_ops->set_priority(d, evtchn, priority);
+}
+
+static inline void evtchn_port_print_state(struct domain *d,
+                                           const struct evtchn *evtchn)
+{
+    if ( d->evtchn_port_ops->print_state )
+        d->evtchn_port_ops->print_state(d, evtchn);
+}
+
 
 /* Wait on a Xen-attached event channel. */
 #define wait_on_xen_event_channel(port, condition)                      \
@@ -83,12 +83,20 @@ struct grant_table {
     grant_status_t       **status;
     /* Active grant table. */
     struct active_grant_entry **active;
-    /* Mapping tracking table. */
+    /* Mapping tracking table. Free handles are kept on per-vcpu lists. */
     struct grant_mapping **maptrack;
-    unsigned int          maptrack_head;
+    /* Per maptrack frame: the vcpu whose free list its handles return to. */
+    u16                  *maptrack_vcpu;
     unsigned int          maptrack_limit;
-    /* Lock protecting updates to active and shared grant tables. */
-    spinlock_t            lock;
+    /* Lock protecting growth of the maptrack table. */
+    spinlock_t            maptrack_lock;
+    /*
+     * Lock protecting the size, version and layout of the table.  Operations
+     * on individual entries hold it for reading, together with the lock of
+     * the active entry concerned; anything touching the table as a whole
+     * holds it for writing.
+     */
+    rwlock_t              lock;
     /* The defined versions are 1 and 2.  Set to 0 if we don't know
        what version to use yet. */
     unsigned              gt_version;
@@ -99,6 +107,7 @@ int grant_table_create(
     struct domain *d);
 void grant_table_destroy(
     struct domain *d);
+void grant_table_init_vcpu(struct vcpu *v);
 
 /* Domain death release of granted mappings of other domains' memory. */
 void
@@ -106,7 +115,7 @@ gnttab_release_mappings(
     struct domain *d);
 
 /* Increase the size of a domain's grant table.
- * Caller must hold d's grant table lock.
+ * Caller must hold d's grant table lock for writing.
  */
 int
 gnttab_grow_table(struct domain *d, unsigned int req_nr_frames);
@@ -30,6 +30,7 @@ extern bool_t iommu_enable, iommu_enabled;
 extern bool_t force_iommu, iommu_verbose;
 extern bool_t iommu_workaround_bios_bug, iommu_passthrough;
 extern bool_t iommu_snoop, iommu_qinval, iommu_intremap;
+extern bool_t iommu_superpages;
 extern bool_t iommu_hap_pt_share;
 extern bool_t iommu_debug;
 extern bool_t amd_iommu_perdev_intremap;
@@ -69,6 +70,9 @@ int deassign_device(struct domain *d, u16 seg, u8 bus, u8 devfn);
 int iommu_map_page(struct domain *d, unsigned long gfn, unsigned long mfn,
                    unsigned int flags);
 int iommu_unmap_page(struct domain *d, unsigned long gfn);
+int iommu_map_pages(struct domain *d, unsigned long gfn, unsigned long mfn,
+                    unsigned int order, unsigned int flags);
+int iommu_unmap_pages(struct domain *d, unsigned long gfn, unsigned int order);
 void iommu_pte_flush(struct domain *d, u64 gfn, u64 *pte, int order, int present);
 void iommu_set_pgd(struct domain *d);
 void iommu_domain_teardown(struct domain *d);
@@ -102,6 +106,11 @@ struct iommu_ops {
     int (*map_page)(struct domain *d, unsigned long gfn, unsigned long mfn,
                     unsigned int flags);
     int (*unmap_page)(struct domain *d, unsigned long gfn);
+    /* Optional: 2^order pages at once, with one IOTLB flush. */
+    int (*map_pages)(struct domain *d, unsigned long gfn, unsigned long mfn,
+                     unsigned int order, unsigned int flags);
+    int (*unmap_pages)(struct domain *d, unsigned long gfn,
+                       unsigned int order);
     int (*reassign_device)(struct domain *s, struct domain *t,
 			   u16 seg, u8 bus, u8 devfn);
     int (*get_device_group_id)(u16 seg, u8 bus, u8 devfn);
@@ -108,7 +108,7 @@ struct vcpu;
 
 struct pirq {
     int pirq;
-    u16 evtchn;
+    int evtchn;
     bool_t masked;
     struct rcu_head rcu_head;
     struct arch_pirq arch;
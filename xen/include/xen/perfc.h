@@ -6,6 +6,7 @@
 #include <xen/lib.h>
 #include <xen/smp.h>
 #include <xen/percpu.h>
+#include <xen/time.h>
 
 /*
  * NOTE: new counters must be defined in perfc_defn.h
@@ -17,6 +18,11 @@
  * Unlike counters, status variables do not reset:
  * PERFSTATUS (counter, string)               define a new performance stauts
  * PERFSTATUS_ARRAY (counter, string, size)   define an array of status vars
+ *
+ * PERFCOUNTER_HISTO (counter, string)        define a log2 histogram: bucket
+ *                                            0 counts zeroes, bucket n values
+ *                                            in [2^(n-1), 2^n), and the last
+ *                                            bucket everything above
  * 
  * unsigned long perfc_value  (counter)        get value of a counter  
  * unsigned long perfc_valuea (counter, index) get value of an array counter
@@ -28,8 +34,16 @@
  * void perfc_add   (counter, value)           add a value to a counter     
  * void perfc_adda  (counter, index, value)    add a value to array counter 
  * void perfc_print (counter)                  print out the counter
+ * void perfc_histo (counter, value)          add a value to a histogram
+ *
+ * Timing a code path into a histogram, in TSC cycles:
+ *   cycles_t t = perfc_time_start();
+ *   ...
+ *   perfc_time_end(counter, t);
  */
 
+#define PERFC_HISTO_BUCKETS 32
+
 #define PERFCOUNTER( name, descr ) \
   PERFC_##name,
 #define PERFCOUNTER_ARRAY( name, descr, size ) \
@@ -38,6 +52,8 @@
 
 #define PERFSTATUS       PERFCOUNTER
 #define PERFSTATUS_ARRAY PERFCOUNTER_ARRAY
+#define PERFCOUNTER_HISTO( name, descr ) \
+  PERFCOUNTER_ARRAY( name, descr, PERFC_HISTO_BUCKETS )
 
 enum perfcounter {
 #include <xen/perfc_defn.h>
@@ -48,6 +64,7 @@ enum perfcounter {
 #undef PERFCOUNTER_ARRAY
 #undef PERFSTATUS
 #undef PERFSTATUS_ARRAY
+#undef PERFCOUNTER_HISTO
 
 typedef unsigned perfc_t;
 #define PRIperfc ""
@@ -93,6 +110,20 @@ DECLARE_PER_CPU(perfc_t[NUM_PERFCOUNTERS], perfcounters);
 #define perfc_incr_histo(x,v) ((void)0)
 #endif
 
+static inline unsigned int perfc_histo_bucket(uint64_t v)
+{
+    unsigned int b = (v >> 32) ? 32 + fls(v >> 32) : fls((uint32_t)v);
+
+    return min(b, PERFC_HISTO_BUCKETS - 1U);
+}
+
+/* Per-CPU buckets: no locks or atomics, as for the other counters. */
+#define perfc_histo(x,v)                                                \
+    (++this_cpu(perfcounters)[PERFC_ ## x + perfc_histo_bucket(v)])
+
+#define perfc_time_start()  get_cycles()
+#define perfc_time_end(x,t) perfc_histo(x, get_cycles() - (t))
+
 struct xen_sysctl_perfc_op;
 int perfc_control(struct xen_sysctl_perfc_op *);
 
@@ -113,6 +144,9 @@ extern void perfc_reset(unsigned char key);
 #define perfc_add(x,y)    ((void)0)
 #define perfc_adda(x,y,z) ((void)0)
 #define perfc_incr_histo(x,y,z) ((void)0)
+#define perfc_histo(x,v)  ((void)0)
+#define perfc_time_start()  (0)
+#define perfc_time_end(x,t) ((void)(t))
 
 #endif /* PERF_COUNTERS */
 
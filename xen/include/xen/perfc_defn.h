@@ -21,6 +21,7 @@ PERFCOUNTER(dom_init,               "sched: dom_init")
 PERFCOUNTER(dom_destroy,            "sched: dom_destroy")
 PERFCOUNTER(vcpu_init,              "sched: vcpu_init")
 PERFCOUNTER(vcpu_destroy,           "sched: vcpu_destroy")
+PERFCOUNTER_HISTO(schedule_cycles,  "sched: schedule() cycles")
 
 /* credit specific counters */
 PERFCOUNTER(delay_ms,               "csched: delay")
@@ -28,7 +29,9 @@ PERFCOUNTER(vcpu_check,             "csched: vcpu_check")
 PERFCOUNTER(acct_run,               "csched: acct_run")
 PERFCOUNTER(acct_no_work,           "csched: acct_no_work")
 PERFCOUNTER(acct_balance,           "csched: acct_balance")
-PERFCOUNTER(acct_reorder,           "csched: acct_reorder")
+PERFCOUNTER(acct_shard,             "csched: acct_shard")
+PERFCOUNTER(acct_shard_master,      "csched: acct_shard_master")
+PERFCOUNTER(acct_time_us,           "csched: acct_time_us")
 PERFCOUNTER(acct_min_credit,        "csched: acct_min_credit")
 PERFCOUNTER(acct_vcpu_active,       "csched: acct_vcpu_active")
 PERFCOUNTER(acct_vcpu_idle,         "csched: acct_vcpu_idle")
@@ -53,4 +56,11 @@ PERFCOUNTER(vcpu_hot,               "csched: vcpu_hot")
 
 PERFCOUNTER(need_flush_tlb_flush,   "PG_need_flush tlb flushes")
 
+PERFCOUNTER_HISTO(gnttab_copy_cycles, "grant copy cycles")
+
+PERFCOUNTER(page_cache_hit,         "page cache: allocations")
+PERFCOUNTER(page_cache_refill,      "page cache: refills")
+PERFCOUNTER(page_cache_drain,       "page cache: drains")
+PERFCOUNTER(page_scrub_idle,        "idle scrub: chunks scrubbed")
+
 /*#endif*/ /* __XEN_PERFC_DEFN_H__ */
@@ -24,6 +24,7 @@
 #include <public/sysctl.h>
 #include <public/vcpu.h>
 #include <public/mem_event.h>
+#include <public/event_channel.h>
 
 #ifdef CONFIG_COMPAT
 #include <compat/vcpu.h>
@@ -50,9 +51,15 @@ extern struct domain *dom0;
 #else
 #define BITS_PER_EVTCHN_WORD(d) (has_32bit_shinfo(d) ? 32 : BITS_PER_LONG)
 #endif
-#define MAX_EVTCHNS(d) (BITS_PER_EVTCHN_WORD(d) * BITS_PER_EVTCHN_WORD(d))
+/* Number of ports addressable through the domain's event channel ABI. */
+#define MAX_EVTCHNS(d) ((d)->evtchn_fifo ? EVTCHN_FIFO_NR_CHANNELS :      \
+                        BITS_PER_EVTCHN_WORD(d) * BITS_PER_EVTCHN_WORD(d))
+#define MAX_NR_EVTCHNS     EVTCHN_FIFO_NR_CHANNELS
 #define EVTCHNS_PER_BUCKET 128
-#define NR_EVTCHN_BUCKETS  (NR_EVENT_CHANNELS / EVTCHNS_PER_BUCKET)
+#define BUCKETS_PER_GROUP  (PAGE_SIZE / sizeof(struct evtchn *))
+#define EVTCHNS_PER_GROUP  (BUCKETS_PER_GROUP * EVTCHNS_PER_BUCKET)
+#define NR_EVTCHN_GROUPS   \
+    ((MAX_NR_EVTCHNS + EVTCHNS_PER_GROUP - 1) / EVTCHNS_PER_GROUP)
 
 struct evtchn
 {
@@ -66,21 +73,27 @@ struct evtchn
     u8  state;             /* ECS_* */
     u8  xen_consumer;      /* Consumer in Xen, if any? (0 = send to guest) */
     u16 notify_vcpu_id;    /* VCPU for local delivery notification */
+    evtchn_port_t port;    /* Port number of this channel */
     union {
         struct {
             domid_t remote_domid;
         } unbound;     /* state == ECS_UNBOUND */
         struct {
-            u16            remote_port;
+            evtchn_port_t  remote_port;
             struct domain *remote_dom;
         } interdomain; /* state == ECS_INTERDOMAIN */
         struct {
             u16            irq;
-            u16            next_port;
-            u16            prev_port;
+            evtchn_port_t  next_port;
+            evtchn_port_t  prev_port;
         } pirq;        /* state == ECS_PIRQ */
         u16 virq;      /* state == ECS_VIRQ */
     } u;
+    /* FIFO ABI only: see common/event_fifo.c. */
+    u8  priority;      /* Queue to link the next event onto */
+    u8  last_priority; /* Queue the event was last linked onto... */
+    u16 last_vcpu_id;  /* ...and the VCPU owning that queue */
+    bool_t pending;    /* Pending while its event word is not mapped */
 #ifdef FLASK_ENABLE
     void *ssid;
 #endif
@@ -168,9 +181,12 @@ struct vcpu
     atomic_t         pause_count;
 
     /* IRQ-safe virq_lock protects against delivering VIRQ to stale evtchn. */
-    u16              virq_to_evtchn[NR_VIRQS];
+    evtchn_port_t    virq_to_evtchn[NR_VIRQS];
     spinlock_t       virq_lock;
 
+    /* FIFO event channel queues (NULL until the guest selects that ABI). */
+    struct evtchn_fifo_vcpu *evtchn_fifo;
+
     /* Bitmask of CPUs on which this VCPU may run. */
     cpumask_var_t    cpu_affinity;
     /* Used to change affinity temporarily. */
@@ -185,6 +201,10 @@ struct vcpu
     /* Multicall information. */
     struct mc_state  mc_state;
 
+    /* Free grant maptrack handles allocated to this VCPU. */
+    spinlock_t       maptrack_freelist_lock;
+    unsigned int     maptrack_head;
+
     struct waitqueue_vcpu *waitqueue_vcpu;
 
     struct arch_vcpu arch;
@@ -260,8 +280,10 @@ struct domain
     spinlock_t       rangesets_lock;
 
     /* Event channel information. */
-    struct evtchn   *evtchn[NR_EVTCHN_BUCKETS];
+    struct evtchn  **evtchn_group[NR_EVTCHN_GROUPS];
     spinlock_t       event_lock;
+    const struct evtchn_port_ops *evtchn_port_ops;
+    struct evtchn_fifo_domain *evtchn_fifo;
 
     struct grant_table *grant_table;
 
@@ -109,7 +109,6 @@ void _lock_profile_deregister_struct(int32_t, struct lock_profile_qhead *);
 #define lock_profile_deregister_struct(type, ptr)                             \
     _lock_profile_deregister_struct(type, &((ptr)->profile_head))
 
-extern int spinlock_profile_control(xen_sysctl_lockprof_op_t *pc);
 extern void spinlock_profile_printall(unsigned char key);
 extern void spinlock_profile_reset(unsigned char key);
 
@@ -127,6 +126,10 @@ struct lock_profile_qhead { };
 
 #endif
 
+/* Lock profiling and contention sampling: XEN_SYSCTL_lockprof_op. */
+struct xen_sysctl_lockprof_op;
+int spinlock_profile_control(struct xen_sysctl_lockprof_op *pc);
+
 typedef struct spinlock {
     raw_spinlock_t raw;
     u16 recurse_cpu:12;
@@ -20,10 +20,8 @@ struct timer {
 
     /* Position in active-timer data structure. */
     union {
-        /* Timer-heap offset (TIMER_STATUS_in_heap). */
-        unsigned int heap_offset;
-        /* Linked list (TIMER_STATUS_in_list). */
-        struct timer *list_next;
+        /* Timer-wheel slot (TIMER_STATUS_in_wheel). */
+        struct list_head wheel;
         /* Linked list of inactive timers (TIMER_STATUS_inactive). */
         struct list_head inactive;
     };
@@ -40,8 +38,7 @@ struct timer {
 #define TIMER_STATUS_invalid  0 /* Should never see this.           */
 #define TIMER_STATUS_inactive 1 /* Not in use; can be activated.    */
 #define TIMER_STATUS_killed   2 /* Not in use; cannot be activated. */
-#define TIMER_STATUS_in_heap  3 /* In use; on timer heap.           */
-#define TIMER_STATUS_in_list  4 /* In use; on overflow linked list. */
+#define TIMER_STATUS_in_wheel 3 /* In use; on timer wheel.          */
     uint8_t status;
 };
 